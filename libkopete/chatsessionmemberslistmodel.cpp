@@ -120,8 +120,8 @@ void ChatSessionMembersListModel::setChatSession(ChatSession *session)
 
 	connect( session, SIGNAL(closing(Kopete::ChatSession*)),
 			 this, SLOT(slotSessionClosed()) );
-	connect( session, SIGNAL(contactAdded(const Kopete::Contact*,bool)),
-			 this, SLOT(slotContactAdded(const Kopete::Contact*)) );
+	connect( session, SIGNAL(contactsAdded(Kopete::ContactPtrList,bool)),
+			 this, SLOT(slotContactsAdded(Kopete::ContactPtrList)) );
 	connect( session, SIGNAL(contactRemoved(const Kopete::Contact*,QString,Qt::TextFormat,bool)),
 			 this, SLOT(slotContactRemoved(const Kopete::Contact*)) );
 	connect( session, SIGNAL(onlineStatusChanged(Kopete::Contact*,Kopete::OnlineStatus,Kopete::OnlineStatus)),
@@ -213,6 +213,45 @@ void ChatSessionMembersListModel::slotContactAdded( const Kopete::Contact *conta
 	endInsertRows();
 }
 
+void ChatSessionMembersListModel::slotContactsAdded( const Kopete::ContactPtrList &contacts )
+{
+	if ( contacts.count() == 1 )
+	{
+		slotContactAdded( contacts.first() );
+		return;
+	}
+
+	kDebug( 14010 ) << "memberslistmodel" << contacts.count() << "contacts added";
+
+	QList<ContactWrapper> sorted;
+	foreach ( Kopete::Contact *c, contacts )
+		sorted.append( ContactWrapper( c, d->session->contactOnlineStatus( c ).weight() ) );
+	qStableSort( sorted );
+
+	// the sorted contacts land at non-decreasing positions of the current list,
+	// insert each run sharing a position as one range, starting from the end
+	// so the positions of the runs before it stay valid
+	QList<int> indexes;
+	foreach ( const ContactWrapper &w, sorted )
+		indexes.append( d->getInsertIndex( w.contact ) );
+
+	int last = sorted.size();
+	while ( last > 0 )
+	{
+		int first = last - 1;
+		while ( first > 0 && indexes[first - 1] == indexes[last - 1] )
+			first--;
+
+		int index = indexes[first];
+		beginInsertRows( QModelIndex(), index, index + last - first - 1 );
+		for ( int i = first; i < last; i++ )
+			d->contacts.insert( index + i - first, sorted[i].contact );
+		endInsertRows();
+
+		last = first;
+	}
+}
+
 void ChatSessionMembersListModel::slotContactRemoved( const Kopete::Contact *contact )
 {
 	kDebug( 14010 ) << "memberslistmodel contact removed "<< contact->displayName();
@@ -59,6 +59,13 @@ private slots:
 	 */
 	void slotContactAdded( const Kopete::Contact *c );
 
+	/**
+	 * Called when contacts are added to the chat session.
+	 * Inserts them with one row insertion per run of adjacent rows.
+	 * @param contacts The contacts that joined the chat
+	 */
+	void slotContactsAdded( const Kopete::ContactPtrList &contacts );
+
 
 	/**
 	 * Called when a contact is removed from the chat session.
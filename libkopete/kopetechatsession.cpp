@@ -26,6 +26,7 @@
 #include <qfile.h>
 #include <qregexp.h>
 #include <qpointer.h>
+#include <qset.h>
 
 #include <kdebug.h>
 #include <kdeversion.h>
@@ -437,15 +438,27 @@ void Kopete::ChatSession::addContact( const Kopete::Contact *c, const Kopete::On
 }
 
 void Kopete::ChatSession::addContact( const Kopete::Contact *c, bool suppress )
+{
+	addContacts( Kopete::ContactPtrList() << (Kopete::Contact*)c, suppress );
+}
+
+void Kopete::ChatSession::addContacts( const Kopete::ContactPtrList &contacts, bool suppress )
 {
 	//kDebug( 14010 ) ;
-	if ( d->contacts.contains( (Kopete::Contact*)c ) )
-	{
-		kDebug( 14010 ) << "Contact already exists";
-//		emit contactAdded( c, suppress );
-	}
-	else
+	Kopete::ContactPtrList added;
+	QSet<Kopete::Contact*> members = d->contacts.toSet();
+
+	foreach ( Kopete::Contact *c, contacts )
 	{
+		if ( members.contains( c ) )
+		{
+			kDebug( 14010 ) << "Contact already exists";
+//			emit contactAdded( c, suppress );
+			continue;
+		}
+
+		members.insert( c );
+
 		if ( d->contacts.count() == 1 && d->isEmpty )
 		{
 			kDebug( 14010 ) << " FUCKER ZONE ";
@@ -453,7 +466,8 @@ void Kopete::ChatSession::addContact( const Kopete::Contact *c, bool suppress )
 			   message manager was given from that contact status */
 			Kopete::Contact *old = d->contacts.first();
 			d->contacts.removeAll( old );
-			d->contacts.append( (Kopete::Contact*)c );
+			d->contacts.append( c );
+			members.remove( old );
 
 			disconnect( old, SIGNAL(onlineStatusChanged(Kopete::Contact*,Kopete::OnlineStatus,Kopete::OnlineStatus)),
 				this, SLOT(slotOnlineStatusChanged(Kopete::Contact*,Kopete::OnlineStatus,Kopete::OnlineStatus)) );
@@ -474,9 +488,11 @@ void Kopete::ChatSession::addContact( const Kopete::Contact *c, bool suppress )
 		}
 		else
 		{
-			d->contacts.append( (Kopete::Contact*)c );
+			d->contacts.append( c );
 			emit contactAdded( c, suppress );
 		}
+		d->isEmpty = false;
+		added.append( c );
 
 		connect( c, SIGNAL(onlineStatusChanged(Kopete::Contact*,Kopete::OnlineStatus,Kopete::OnlineStatus)),
 			this, SLOT(slotOnlineStatusChanged(Kopete::Contact*,Kopete::OnlineStatus,Kopete::OnlineStatus)) );
@@ -491,10 +507,15 @@ void Kopete::ChatSession::addContact( const Kopete::Contact *c, bool suppress )
 			connect( c, SIGNAL(displayNameChanged(QString,QString)), this, SLOT(slotUpdateDisplayName()) );
 		connect( c, SIGNAL(contactDestroyed(Kopete::Contact*)), this, SLOT(slotContactDestroyed(Kopete::Contact*)) );
 		connect( c, SIGNAL(displayNameChanged(QString,QString)), this, SLOT(slotDisplayNameChanged(QString,QString)) );
+	}
+	d->isEmpty = false;
 
+	if ( !added.isEmpty() )
+	{
+		// one notification and one display name update for the whole batch
+		emit contactsAdded( added, suppress );
 		slotUpdateDisplayName();
 	}
-	d->isEmpty = false;
 }
 
 void Kopete::ChatSession::removeContact( const Kopete::Contact *c, const QString& reason, Qt::TextFormat format, bool suppressNotification )
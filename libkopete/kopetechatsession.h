@@ -269,6 +269,15 @@ signals:
 	// FIXME: What's 'suppress'? Shouldn't this be an enum? - Martijn
 	void contactAdded( const Kopete::Contact *contact, bool suppress );
 
+	/**
+	 * @brief contacts are now in the chat
+	 *
+	 * Emitted once per call to @ref addContact or @ref addContacts with the
+	 * contacts that were actually added, after @ref contactAdded has been
+	 * emitted for each of them.
+	 */
+	void contactsAdded( const Kopete::ContactPtrList &contacts, bool suppress );
+
 	/**
 	 * @brief a contact is no longer in this chat
 	 */
@@ -381,6 +390,16 @@ public slots:
 	 */
 	void addContact( const Kopete::Contact *c, bool suppress = false );
 
+	/**
+	 * Add several contacts to the session at once, e.g. the occupants of
+	 * a room that was just joined. Contacts already in the session are
+	 * skipped. Listeners get a single @ref contactsAdded signal and the
+	 * display name is only updated once.
+	 * @param contacts are the contacts
+	 * @param suppress see @ref addContact
+	 */
+	void addContacts( const Kopete::ContactPtrList &contacts, bool suppress = false );
+
 	/**
 	 * Add a contact to the session with a pre-set initial status
 	 * @param c is the contact
@@ -220,6 +220,11 @@ void Kopete::Transfer::slotProcessed( unsigned int bytes )
 	emitPercent( bytes, d->info.size() );
 }
 
+void Kopete::Transfer::slotInfoMessage( const QString &text )
+{
+	emit infoMessage( this, text );
+}
+
 void Kopete::Transfer::timerEvent( QTimerEvent *event )
 {
 	if ( event->timerId() != d->transferRateTimer )
@@ -231,6 +231,12 @@ public slots:
 	 */
 	void slotProcessed(unsigned int);
 
+	/**
+	 * @brief Show what the transfer is doing, e.g. while it is being prepared.
+	 * An empty @p text clears the message.
+	 */
+	void slotInfoMessage( const QString &text );
+
 	/**
 	 * @brief Indicate that the transfer is complete
 	 */
@@ -39,6 +39,10 @@
 #include <qtimer.h>
 #include <QAbstractSocket>
 #include <QPointer>
+#include <QFile>
+#include <QTextStream>
+#include <QTextCodec>
+#include <QDomDocument>
 
 #include <kcomponentdata.h>
 #include <kconfig.h>
@@ -52,6 +56,7 @@
 #include <kicon.h>
 #include <kactionmenu.h>
 #include <kglobal.h>
+#include <kstandarddirs.h>
 #include <KComponentData>
 
 #include "kopetepassword.h"
@@ -67,6 +72,7 @@
 #include "jabberprotocol.h"
 #include "jabberresourcepool.h"
 #include "jabbercontactpool.h"
+#include "jabbervcardqueue.h"
 #include "jabberfiletransfer.h"
 #include "jabbercontact.h"
 #include "jabbergroupcontact.h"
@@ -103,13 +109,16 @@ JabberAccount::JabberAccount (JabberProtocol * parent, const QString & accountId
 	
 	m_resourcePool = 0L;
 	m_contactPool = 0L;
+	m_vCardQueue = new JabberVCardQueue ( this );
 
 #ifdef JINGLE_SUPPORT
 	m_jcm = 0L;
 #endif
 	m_bookmarks = new JabberBookmarks(this);
 	m_removing=false;
+	m_resuming = false;
 	m_notifiedUserCannotBindTransferPort = false;
+	loadRosterCache ();
 	// add our own contact to the pool
 	JabberContact *myContact = contactPool()->addContact ( XMPP::RosterItem ( accountId ), Kopete::ContactList::self()->myself(), false );
 	setMyself( myContact );
@@ -121,6 +130,7 @@ JabberAccount::JabberAccount (JabberProtocol * parent, const QString & accountId
 	QObject::connect ( m_jabberClient, SIGNAL (csError(int)), this, SLOT (slotCSError(int)) );
 	QObject::connect ( m_jabberClient, SIGNAL (tlsWarning(QCA::TLS::IdentityResult,QCA::Validity)), this, SLOT (slotHandleTLSWarning(QCA::TLS::IdentityResult,QCA::Validity)) );
 	QObject::connect ( m_jabberClient, SIGNAL (connected()), this, SLOT (slotConnected()) );
+	QObject::connect ( m_jabberClient, SIGNAL (resumed()), this, SLOT (slotResumed()) );
 	QObject::connect ( m_jabberClient, SIGNAL (error(JabberClient::ErrorCode)), this, SLOT (slotClientError(JabberClient::ErrorCode)) );
 	
 	QObject::connect ( m_jabberClient, SIGNAL (subscription(XMPP::Jid,QString)),
@@ -284,6 +294,13 @@ JabberContactPool *JabberAccount::contactPool ()
 
 }
 
+JabberVCardQueue *JabberAccount::vCardQueue () const
+{
+
+	return m_vCardQueue;
+
+}
+
 bool JabberAccount::createContact (const QString & contactId,  Kopete::MetaContact * metaContact)
 {
 
@@ -306,6 +323,14 @@ bool JabberAccount::createContact (const QString & contactId,  Kopete::MetaConta
 	item.setName ( metaContact->displayName () );
 	item.setGroups ( groupNames );
 
+	// the cached roster also knows the subscription state
+	QHash<QString, XMPP::RosterItem>::ConstIterator cached = m_rosterCache.constFind ( jid.full().toLower () );
+	if ( cached != m_rosterCache.constEnd () )
+	{
+		item.setSubscription ( cached->subscription () );
+		item.setAsk ( cached->ask () );
+	}
+
 	// this contact will be created with the "dirty" flag set
 	// (it will get reset if the contact appears in the roster during connect)
 	JabberContact *contact = contactPool()->addContact ( item, metaContact, true );
@@ -370,6 +395,10 @@ void JabberAccount::connectWithPassword ( const QString &password )
 		m_jabberClient->setOverrideHost ( false );
 	}
 
+	// connect through a BOSH connection manager (no UI yet, set "BoshUrl" in the account config)
+	m_jabberClient->setBoshUrl ( configGroup()->readEntry ( "BoshUrl", QString () ) );
+	m_jabberClient->setBoshHoldWait ( configGroup()->readEntry ( "BoshHold", 1 ), configGroup()->readEntry ( "BoshWait", 60 ) );
+
 	// set SSL flag (this should be converted to forceTLS when using the new protocol)
 	m_jabberClient->setUseSSL ( configGroup()->readEntry ( "UseSSL", false ) );
 
@@ -632,8 +661,128 @@ void JabberAccount::slotConnected ()
 	m_jcm = new JingleCallsManager(this);
 #endif
 
+	if ( m_resuming )
+	{
+		// the server could not resume our session and started a new one,
+		// so everything we know about presences is stale
+		kDebug (JABBER_DEBUG_GLOBAL) << "Session could not be resumed, doing a full login.";
+		m_resuming = false;
+		resourcePool()->clear();
+		m_initialPresence = m_lastStatus;
+	}
+
+	// hand the cached roster to Iris, if the server supports roster
+	// versioning it will only send us what changed since then
+	XMPP::Roster cache;
+	if ( !m_rosterCacheVersion.isNull () )
+	{
+		foreach ( const XMPP::RosterItem &item, m_rosterCache )
+			cache += item;
+		cache.setVersion ( m_rosterCacheVersion );
+	}
+
 	kDebug (JABBER_DEBUG_GLOBAL) << "Requesting roster...";
-	m_jabberClient->requestRoster ();
+	m_jabberClient->requestRoster ( cache );
+}
+
+void JabberAccount::slotResumed ()
+{
+	kDebug (JABBER_DEBUG_GLOBAL) << "Resumed the previous session, roster and presences are still valid.";
+
+	m_resuming = false;
+}
+
+QString JabberAccount::rosterCacheFileName () const
+{
+
+	QString id = accountId ();
+	id.replace ( '/', '_' );
+	return KStandardDirs::locateLocal ( "appdata", QString::fromUtf8 ( "jabber-roster-%1.xml" ).arg ( id ) );
+
+}
+
+void JabberAccount::loadRosterCache ()
+{
+
+	m_rosterCache.clear ();
+	m_rosterCacheVersion = QString ();
+
+	QFile cacheFile ( rosterCacheFileName () );
+	if ( !cacheFile.open ( QIODevice::ReadOnly ) )
+		return;
+
+	QDomDocument doc;
+	if ( !doc.setContent ( &cacheFile ) )
+	{
+		kDebug (JABBER_DEBUG_GLOBAL) << "Could not parse the roster cache, ignoring it.";
+		return;
+	}
+	cacheFile.close ();
+
+	QDomElement roster = doc.documentElement ();
+	if ( roster.tagName () != "roster" || !roster.hasAttribute ( "ver" ) )
+		return;
+
+	for ( QDomElement e = roster.firstChildElement ( "item" ); !e.isNull (); e = e.nextSiblingElement ( "item" ) )
+	{
+		XMPP::RosterItem item;
+		if ( item.fromXml ( e ) )
+			m_rosterCache.insert ( item.jid().full().toLower (), item );
+	}
+	m_rosterCacheVersion = roster.attribute ( "ver" );
+
+	kDebug (JABBER_DEBUG_GLOBAL) << "Loaded" << m_rosterCache.count () << "cached roster items, version" << m_rosterCacheVersion;
+
+}
+
+void JabberAccount::saveRosterCache ()
+{
+
+	// without a version the server could not use the cache anyway
+	if ( !m_jabberClient || !m_jabberClient->client () || m_jabberClient->client()->rosterVersion().isNull () )
+		return;
+
+	// the version changes with every roster change, an unchanged
+	// roster is already on disk
+	if ( m_jabberClient->client()->rosterVersion () == m_rosterCacheVersion )
+		return;
+
+	m_rosterCache.clear ();
+	m_rosterCacheVersion = m_jabberClient->client()->rosterVersion ();
+
+	QDomDocument doc;
+	QDomElement roster = doc.createElement ( "roster" );
+	roster.setAttribute ( "ver", m_rosterCacheVersion );
+	doc.appendChild ( roster );
+
+	foreach ( const XMPP::LiveRosterItem &item, m_jabberClient->client()->roster () )
+	{
+		m_rosterCache.insert ( item.jid().full().toLower (), item );
+		roster.appendChild ( item.toXml ( &doc ) );
+	}
+
+	QFile cacheFile ( rosterCacheFileName () );
+	if ( !cacheFile.open ( QIODevice::WriteOnly ) )
+	{
+		kDebug (JABBER_DEBUG_GLOBAL) << "Could not write the roster cache.";
+		return;
+	}
+
+	QTextStream textStream ( &cacheFile );
+	textStream.setCodec ( QTextCodec::codecForName ( "UTF-8" ) );
+	textStream << doc.toString ();
+
+}
+
+bool JabberAccount::resumeSession ()
+{
+	if ( m_removing || !isConnected () || !m_jabberClient->canResume () )
+		return false;
+
+	kDebug (JABBER_DEBUG_GLOBAL) << "Connection lost, resuming the previous session...";
+
+	m_resuming = true;
+	return m_jabberClient->resume () == JabberClient::Ok;
 }
 
 void JabberAccount::slotRosterRequestFinished ( bool success )
@@ -641,9 +790,24 @@ void JabberAccount::slotRosterRequestFinished ( bool success )
 
 	if ( success )
 	{
+		if ( !m_jabberClient->client()->rosterVersion().isNull () )
+		{
+			// with roster versioning only the changes were signalled,
+			// the rest of the roster came from our cache
+			foreach ( const XMPP::LiveRosterItem &item, m_jabberClient->client()->roster () )
+			{
+				if ( contactPool()->findExactMatch ( item.jid () ) )
+					contactPool()->setDirty ( item.jid (), false );
+				else
+					slotContactUpdated ( item );
+			}
+		}
+
 		// the roster was imported successfully, clear
 		// all "dirty" items from the contact list
 		contactPool()->cleanUp ();
+
+		saveRosterCache ();
 	}
 
 	/* Since we are online now, set initial presence. Don't do this
@@ -709,11 +873,17 @@ void JabberAccount::disconnect ( Kopete::Account::DisconnectReason reason )
 
 	if (isConnected ())
 	{
+		// keep the roster pushes we got during this session
+		saveRosterCache ();
+
 		kDebug (JABBER_DEBUG_GLOBAL) << "Still connected, closing connection...";
 		/* Tell backend class to disconnect. */
 		m_jabberClient->disconnect ();
 	}
 
+	m_vCardQueue->clear ();
+	m_groupChatPresences.clear ();
+
 	// make sure that the connection animation gets stopped if we're still
 	// in the process of connecting
 	setPresence ( XMPP::Status ("", "", 0, false) );
@@ -738,11 +908,16 @@ void JabberAccount::disconnect( Kopete::Account::DisconnectReason reason, XMPP::
     
 	if (isConnected ())
 	{
+		saveRosterCache ();
+
 		kDebug (JABBER_DEBUG_GLOBAL) << "Still connected, closing connection...";
 		/* Tell backend class to disconnect. */
 		m_jabberClient->disconnect (status);
 	}
 
+	m_vCardQueue->clear ();
+	m_groupChatPresences.clear ();
+
 	// make sure that the connection animation gets stopped if we're still
 	// in the process of connecting
 	setPresence ( status );
@@ -779,6 +954,10 @@ void JabberAccount::slotCSDisconnected ()
 {
 	kDebug (JABBER_DEBUG_GLOBAL) << "Disconnected from Jabber server.";
 
+	if ( resumeSession () )
+		return;
+	m_resuming = false;
+
 	/*
 	 * We should delete the JabberClient instance here,
 	 * but timers etc prevent us from doing so. Iris does
@@ -789,6 +968,7 @@ void JabberAccount::slotCSDisconnected ()
 
 	/* It seems that we don't get offline notifications when going offline
 	 * with the protocol, so clear all resources manually. */
+	m_groupChatPresences.clear ();
 	resourcePool()->clear();
 
 #ifdef JINGLE_SUPPORT
@@ -1049,6 +1229,10 @@ void JabberAccount::slotCSError ( int error )
 	}
 	else
 	{
+		if ( resumeSession () )
+			return;
+		m_resuming = false;
+
 		Kopete::Account::DisconnectReason errorClass =  Kopete::Account::Unknown;
 
 		kDebug ( JABBER_DEBUG_GLOBAL ) << "Disconnecting.";
@@ -1467,6 +1651,9 @@ void JabberAccount::slotReceivedMessage (const XMPP::Message & message)
 
 	if ( message.type() == "groupchat" )
 	{
+		// the sender may be among the occupants we haven't added yet
+		slotGroupChatPresences ();
+
 		// this is a groupchat message, forward it to the group contact
 		// (the one without resource name)
 		XMPP::Jid jid ( message.from().bare() );
@@ -1584,6 +1771,9 @@ void JabberAccount::slotGroupChatJoined (const XMPP::Jid & jid)
 void JabberAccount::slotGroupChatLeft (const XMPP::Jid & jid)
 {
 	kDebug (JABBER_DEBUG_GLOBAL) << "Left groupchat " << jid.full ();
+
+	// apply what the room told us before we left
+	slotGroupChatPresences ();
 	
 	// remove group contact from list
 	Kopete::Contact *contact = 
@@ -1607,17 +1797,53 @@ void JabberAccount::slotGroupChatPresence (const XMPP::Jid & jid, const XMPP::St
 {
 	kDebug (JABBER_DEBUG_GLOBAL) << "Received groupchat presence for room " << jid.full ();
 
-	// fetch room contact (the one without resource)
-	JabberGroupContact *groupContact = dynamic_cast<JabberGroupContact *>( contactPool()->findExactMatch ( XMPP::Jid ( jid.bare() ) ) );
+	// collect everything that arrives in this event loop turn
+	if ( m_groupChatPresences.isEmpty () )
+		QTimer::singleShot ( 0, this, SLOT (slotGroupChatPresences()) );
 
-	if ( !groupContact )
-	{
-		kDebug ( JABBER_DEBUG_GLOBAL ) << "WARNING: Groupchat presence signalled, but we do not have a room contact?";
+	m_groupChatPresences.append ( qMakePair ( jid, status ) );
+
+}
+
+void JabberAccount::slotGroupChatPresences ()
+{
+	if ( m_groupChatPresences.isEmpty () )
 		return;
-	}
 
-	if ( !status.isAvailable () )
+	QList< QPair<XMPP::Jid, XMPP::Status> > presences = m_groupChatPresences;
+	m_groupChatPresences.clear ();
+
+	kDebug (JABBER_DEBUG_GLOBAL) << "Processing " << presences.count () << " groupchat presences";
+
+	// occupants that became available, per room
+	QHash<QString, QList<XMPP::RosterItem> > occupants;
+	QHash<QString, XMPP::ResourceList> resources;
+
+	for ( QList< QPair<XMPP::Jid, XMPP::Status> >::ConstIterator it = presences.constBegin (); it != presences.constEnd (); ++it )
 	{
+		const XMPP::Jid &jid = it->first;
+		const XMPP::Status &status = it->second;
+		QString room = jid.bare().toLower ();
+
+		if ( status.isAvailable () )
+		{
+			occupants[room].append ( XMPP::RosterItem ( jid ) );
+			resources[room].append ( XMPP::Resource ( jid.resource (), status ) );
+			continue;
+		}
+
+		// keep the order within the room, the occupant may have joined in this batch
+		addGroupChatOccupants ( occupants.take ( room ), resources.take ( room ) );
+
+		// fetch room contact (the one without resource)
+		JabberGroupContact *groupContact = dynamic_cast<JabberGroupContact *>( contactPool()->findExactMatch ( XMPP::Jid ( jid.bare() ) ) );
+
+		if ( !groupContact )
+		{
+			kDebug ( JABBER_DEBUG_GLOBAL ) << "WARNING: Groupchat presence signalled, but we do not have a room contact?";
+			continue;
+		}
+
 		kDebug ( JABBER_DEBUG_GLOBAL ) << jid.full () << " has become unavailable, removing from room";
 
 		// remove the resource from the pool
@@ -1626,15 +1852,34 @@ void JabberAccount::slotGroupChatPresence (const XMPP::Jid & jid, const XMPP::St
 		// the person has become unavailable, remove it
 		groupContact->removeSubContact ( XMPP::RosterItem ( jid ) );
 	}
-	else
-	{
-		// add a resource for this contact to the pool (existing resources will be updated)
-		resourcePool()->addResource ( jid, XMPP::Resource ( jid.resource (), status ) );
 
-		// make sure the contact exists in the room (if it exists already, it won't be added twice)
-		groupContact->addSubContact ( XMPP::RosterItem ( jid ) );
+	for ( QHash<QString, QList<XMPP::RosterItem> >::ConstIterator it = occupants.constBegin (); it != occupants.constEnd (); ++it )
+		addGroupChatOccupants ( it.value (), resources.value ( it.key () ) );
+
+}
+
+void JabberAccount::addGroupChatOccupants ( const QList<XMPP::RosterItem> &occupants, const XMPP::ResourceList &resources )
+{
+	if ( occupants.isEmpty () )
+		return;
+
+	XMPP::Jid roomJid ( occupants.first().jid().bare () );
+
+	// fetch room contact (the one without resource)
+	JabberGroupContact *groupContact = dynamic_cast<JabberGroupContact *>( contactPool()->findExactMatch ( roomJid ) );
+
+	if ( !groupContact )
+	{
+		kDebug ( JABBER_DEBUG_GLOBAL ) << "WARNING: Groupchat presence signalled, but we do not have a room contact?";
+		return;
 	}
 
+	// add resources for these contacts to the pool (existing resources will be updated)
+	resourcePool()->addResources ( roomJid, resources );
+
+	// make sure the contacts exist in the room (existing ones won't be added twice)
+	groupContact->addSubContacts ( occupants );
+
 }
 
 void JabberAccount::slotGroupChatError (const XMPP::Jid &jid, int error, const QString &reason)
@@ -1799,6 +2044,8 @@ bool JabberAccount::removeAccount( )
 	{
 		(*it)->jabberAccountRemoved();
 	}
+
+	QFile::remove ( rosterCacheFileName () );
 	return true;
 }
 
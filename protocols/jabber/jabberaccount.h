@@ -33,6 +33,9 @@
 #include "mood.h"
 
 #include <QMap>
+#include <QHash>
+#include <QList>
+#include <QPair>
 #include <QtCrypto>
 
 class QString;
@@ -43,6 +46,7 @@ class JabberContactPool;
 class JabberProtocol;
 class JabberTransport;
 class JabberBookmarks;
+class JabberVCardQueue;
 
 
 #ifdef LIBJINGLE_SUPPORT
@@ -80,6 +84,9 @@ public:
 	JabberResourcePool *resourcePool ();
 	JabberContactPool *contactPool ();
 
+	/* Queue for fetching contacts' vCards */
+	JabberVCardQueue *vCardQueue () const;
+
 	/* to get the protocol from the account */
 	JabberProtocol *protocol () const
 	{
@@ -216,6 +223,7 @@ private:
 
 	JabberResourcePool *m_resourcePool;
 	JabberContactPool *m_contactPool;
+	JabberVCardQueue *m_vCardQueue;
 	JabberBookmarks *m_bookmarks;
 
 	/* Set up our actions for the status menu. */
@@ -237,10 +245,37 @@ private:
 	 */
 	bool isConnecting ();
 
+	/**
+	 * Try to resume the session after the connection dropped.
+	 * Returns false if a full reconnect is needed.
+	 */
+	bool resumeSession ();
+
+	/**
+	 * The roster as of the last session, together with its version
+	 * (XEP-0237), so that a login only transfers what changed since.
+	 * Stored per account in the application data directory.
+	 */
+	QString rosterCacheFileName () const;
+	void loadRosterCache ();
+	void saveRosterCache ();
+	QHash<QString, XMPP::RosterItem> m_rosterCache;
+	QString m_rosterCacheVersion;
+
+	/**
+	 * Room occupant presences received during the current event loop
+	 * turn. Joining a large room brings in thousands of them, so they
+	 * are applied in batches by slotGroupChatPresences().
+	 */
+	QList< QPair<XMPP::Jid, XMPP::Status> > m_groupChatPresences;
+	void addGroupChatOccupants ( const QList<XMPP::RosterItem> &occupants, const XMPP::ResourceList &resources );
+
 	QMap<QString, JabberTransport*> m_transports;
 
 	/* used in removeAccount() */
 	bool m_removing;
+	/* a dropped session is being resumed (XEP-0198) */
+	bool m_resuming;
 	/* keep track if we told the user we were not able to bind the
 	   jabber transfer port, to avoid popup insanity */
 	bool m_notifiedUserCannotBindTransferPort;
@@ -275,6 +310,9 @@ private slots:
 	// we are connected to the server
 	void slotConnected ();
 
+	// the previous session was resumed after a connection drop
+	void slotResumed ();
+
 	/* Called from Psi: tells us when we've been disconnected from the server. */
 	void slotCSDisconnected ();
 
@@ -300,6 +338,7 @@ private slots:
 	void slotGroupChatJoined ( const XMPP::Jid &jid );
 	void slotGroupChatLeft ( const XMPP::Jid &jid );
 	void slotGroupChatPresence ( const XMPP::Jid &jid, const XMPP::Status &status );
+	void slotGroupChatPresences ();
 	void slotGroupChatError ( const XMPP::Jid &jid, int error, const QString &reason );
 
 	/* Incoming subscription request. */
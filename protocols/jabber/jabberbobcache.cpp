@@ -15,18 +15,159 @@
 
 #include "jabberbobcache.h"
 
-JabberBoBCache::JabberBoBCache(QObject *parent) : BoBCache(parent)
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QTimer>
+
+#include <kdebug.h>
+#include <kstandarddirs.h>
+
+#include "jabberprotocol.h"
+
+/**
+ * Bytes of data kept in memory.
+ */
+static const int MAX_MEMORY_SIZE = 4 * 1024 * 1024;
+
+/**
+ * Version of the on-disk format, bump on incompatible changes.
+ */
+static const quint32 FILE_VERSION = 1;
+
+JabberBoBCache::JabberBoBCache(QObject *parent) : BoBCache(parent), mem(MAX_MEMORY_SIZE)
 {
+	dir = KStandardDirs::locateLocal("appdata", "jabber-bob/");
+
+	// not needed for startup, clean up once the event loop runs
+	QTimer::singleShot(0, this, SLOT(removeExpired()));
 }
 
 void JabberBoBCache::put(const XMPP::BoBData &data)
 {
-	mem.insert(data.cid(), data);
+	if (data.isNull())
+		return;
+
+	insertMem(data);
+
+	// max-age 0 means the sender does not want it cached (XEP-0231),
+	// keep it for this session only
+	if (data.maxAge() > 0)
+		writeFile(data);
 }
 
 XMPP::BoBData JabberBoBCache::get(const QString &cid)
 {
-	return mem.value(cid);
+	if (MemEntry *entry = mem.object(cid))
+	{
+		if (!entry->expires)
+			return entry->data;
+
+		uint now = QDateTime::currentDateTime().toTime_t();
+		if (entry->expires > now)
+		{
+			XMPP::BoBData data = entry->data;
+			data.setMaxAge(entry->expires - now);
+			return data;
+		}
+
+		// expired, readFile() removes the file as well
+		mem.remove(cid);
+	}
+
+	XMPP::BoBData data = readFile(cid);
+	if (!data.isNull())
+		insertMem(data);
+
+	return data;
+}
+
+void JabberBoBCache::insertMem(const XMPP::BoBData &data)
+{
+	MemEntry *entry = new MemEntry;
+	entry->data = data;
+	entry->expires = data.maxAge() > 0 ? QDateTime::currentDateTime().addSecs(data.maxAge()).toTime_t() : 0;
+
+	// QCache drops data larger than the whole memory tier right away
+	mem.insert(data.cid(), entry, data.data().size());
+}
+
+QString JabberBoBCache::fileName(const QString &cid) const
+{
+	// CIDs come from the network, never use them as file names directly
+	return dir + QCryptographicHash::hash(cid.toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+void JabberBoBCache::writeFile(const XMPP::BoBData &data)
+{
+	QFile file(fileName(data.cid()));
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		kDebug(JABBER_DEBUG_GLOBAL) << "Cannot write BoB cache file " << file.fileName();
+		return;
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_5);
+
+	// expiry first, removeExpired() reads nothing else
+	stream << QDateTime::currentDateTime().addSecs(data.maxAge()).toTime_t();
+	stream << FILE_VERSION << data.cid() << data.type() << data.data();
+}
+
+XMPP::BoBData JabberBoBCache::readFile(const QString &cid)
+{
+	XMPP::BoBData data;
+
+	QFile file(fileName(cid));
+	if (!file.open(QIODevice::ReadOnly))
+		return data;
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_5);
+
+	uint expires;
+	quint32 version;
+	QString storedCid, type;
+	QByteArray bytes;
+	stream >> expires >> version >> storedCid >> type >> bytes;
+
+	uint now = QDateTime::currentDateTime().toTime_t();
+	if (stream.status() != QDataStream::Ok || version != FILE_VERSION || storedCid != cid || expires <= now)
+	{
+		file.remove();
+		return data;
+	}
+
+	data.setCid(cid);
+	data.setType(type);
+	data.setData(bytes);
+	data.setMaxAge(expires - now);
+
+	return data;
+}
+
+void JabberBoBCache::removeExpired()
+{
+	uint now = QDateTime::currentDateTime().toTime_t();
+
+	QDir cacheDir(dir);
+	foreach (const QString &name, cacheDir.entryList(QDir::Files))
+	{
+		QFile file(cacheDir.filePath(name));
+		if (!file.open(QIODevice::ReadOnly))
+			continue;
+
+		QDataStream stream(&file);
+		uint expires;
+		stream >> expires;
+		file.close();
+
+		if (stream.status() != QDataStream::Ok || expires <= now)
+			file.remove();
+	}
 }
 
 #include "jabberbobcache.moc"
@@ -16,8 +16,19 @@
 #ifndef JABBERBOBCACHE_H
 #define JABBERBOBCACHE_H
 
+#include <QCache>
+#include <QString>
+
 #include <xmpp_status.h>
 
+/**
+ * Cache for XEP-0231 Bits of Binary.
+ *
+ * Recently used data is kept in memory up to a fixed number of bytes.
+ * Data with a max-age is also stored on disk, one file per CID, and
+ * dropped once it expires. Misses are fetched from the network by
+ * XMPP::JT_BitsOfBinary, which puts the result back here.
+ */
 class JabberBoBCache : public XMPP::BoBCache
 {
 	Q_OBJECT
@@ -28,8 +39,24 @@ public:
 	virtual void put(const XMPP::BoBData &data);
 	virtual XMPP::BoBData get(const QString &cid);
 
+private slots:
+	void removeExpired();
+
 private:
-	QHash <QString, XMPP::BoBData> mem;
+	QString fileName(const QString &cid) const;
+	void writeFile(const XMPP::BoBData &data);
+	XMPP::BoBData readFile(const QString &cid);
+
+	struct MemEntry
+	{
+		XMPP::BoBData data;
+		uint expires; // 0 for data kept for this session only
+	};
+
+	void insertMem(const XMPP::BoBData &data);
+
+	QString dir;
+	QCache <QString, MemEntry> mem;
 };
 
 #endif
@@ -157,6 +157,7 @@ void JabberCapabilitiesManager::CapabilitiesInformation::removeAccount(JabberAcc
 	{
 		if( (*it).second == account) 
 		{
+			m_jidSet.remove(*it);
 			it = m_jids.erase(it);
 		}
 		else 
@@ -170,8 +171,9 @@ void JabberCapabilitiesManager::CapabilitiesInformation::addJid(const Jid& jid,
 {
 	QPair<QString, JabberAccount*> jidAccountPair(jid.full(),account);
 
-	if( !m_jids.contains(jidAccountPair) ) 
+	if( !m_jidSet.contains(jidAccountPair) ) 
 	{
+		m_jidSet.insert(jidAccountPair);
 		m_jids.push_back(jidAccountPair);
 		updateLastSeen();
 	}
@@ -186,6 +188,7 @@ void JabberCapabilitiesManager::CapabilitiesInformation::removeJid(const Jid& ji
 	{
 		if( (*it).first == jid.full() ) 
 		{
+			m_jidSet.remove(*it);
 			it = m_jids.erase(it);
 		}
 		else 
@@ -317,27 +320,52 @@ void JabberCapabilitiesManager::CapabilitiesInformation::fromXml(const QDomEleme
 //END CapabilitiesInformation
 
 //BEGIN Private(d-ptr)
+// How long newly discovered capabilities are collected before they are written.
+static const int SAVE_DELAY = 10000;
+// Number of journal entries after which the cache file is rewritten.
+static const int MAX_JOURNAL_ENTRIES = 500;
+
 class JabberCapabilitiesManager::Private
 {
 public:
 	Private()
+		: journalEntries(0)
 	{}
 
 	// Map a full jid to a capabilities
-	QMap<QString,Capabilities> jidCapabilitiesMap;
+	QHash<QString,Capabilities> jidCapabilitiesMap;
 	// Map a capabilities to its detail information
-	QMap<Capabilities,CapabilitiesInformation> capabilitiesInformationMap;
+	QHash<Capabilities,CapabilitiesInformation> capabilitiesInformationMap;
+
+	// Discovered, but not on disk yet
+	QList<Capabilities> pendingCapabilities;
+	// Entries in the journal file since the cache file was last written
+	int journalEntries;
+	QTimer saveTimer;
+
+	static QString cacheFileName()
+	{
+		return KStandardDirs::locateLocal("appdata", QString::fromUtf8("jabber-capabilities-cache.xml"));
+	}
+
+	static QString journalFileName()
+	{
+		return KStandardDirs::locateLocal("appdata", QString::fromUtf8("jabber-capabilities-cache.journal"));
+	}
 };
 //END Private(d-ptr)
 
 JabberCapabilitiesManager::JabberCapabilitiesManager()
 	: d(new Private)
 {
+	d->saveTimer.setSingleShot(true);
+	d->saveTimer.setInterval(SAVE_DELAY);
+	connect(&d->saveTimer, SIGNAL(timeout()), SLOT(appendPendingInformation()));
 }
 
 JabberCapabilitiesManager::~JabberCapabilitiesManager()
 {
-	saveInformation();
+	appendPendingInformation();
 	delete d;
 }
 
@@ -470,8 +498,11 @@ void JabberCapabilitiesManager::discoRequestFinished()
 			d->capabilitiesInformationMap[capabilities].setPendingRequests(0);
 			d->capabilitiesInformationMap[capabilities].setDiscovered(true);
 
-			// Save(Cache) information
-			saveInformation();
+			// Save(Cache) information, together with whatever else
+			// gets discovered in the meantime
+			d->pendingCapabilities += capabilities;
+			if( !d->saveTimer.isActive() )
+				d->saveTimer.start();
 			
 			// Notify affected jids.
 			QStringList jids = d->capabilitiesInformationMap[capabilities].jids();
@@ -512,55 +543,74 @@ void JabberCapabilitiesManager::discoRequestFinished()
 
 void JabberCapabilitiesManager::loadCachedInformation()
 {
-	QString capsFileName;
-	capsFileName = KStandardDirs::locateLocal("appdata", QString::fromUtf8("jabber-capabilities-cache.xml"));
-
 	// Load settings
 	QDomDocument doc;
-	QFile cacheFile(capsFileName);
+	QFile cacheFile(Private::cacheFileName());
 	if( !cacheFile.open(QIODevice::ReadOnly) )
 	{
 		kDebug(JABBER_DEBUG_GLOBAL) << "Could not open the Capabilities cache from disk.";
-		return;
 	}
-	if( !doc.setContent(&cacheFile) )
+	else if( !doc.setContent(&cacheFile) )
 	{
 		kDebug(JABBER_DEBUG_GLOBAL) << "Could not set the Capabilities cache from file.";
-		return;
 	}
-	cacheFile.close();
-
-	QDomElement caps = doc.documentElement();
-	if( caps.tagName() != "capabilities" ) 
+	else if( doc.documentElement().tagName() != "capabilities" ) 
 	{
 		kDebug(JABBER_DEBUG_GLOBAL) << "Invalid capabilities element.";
-		return;
 	}
-	
-	QDomNode node;	
-	for(node = caps.firstChild(); !node.isNull(); node = node.nextSibling()) 
+	else
 	{
-		QDomElement element = node.toElement();
-		if( element.isNull() ) 
+		QDomNode node;	
+		for(node = doc.documentElement().firstChild(); !node.isNull(); node = node.nextSibling()) 
 		{
-			kDebug(JABBER_DEBUG_GLOBAL) << "Found a null element.";
-			continue;
-		}
+			QDomElement element = node.toElement();
+			if( element.isNull() ) 
+			{
+				kDebug(JABBER_DEBUG_GLOBAL) << "Found a null element.";
+				continue;
+			}
 
-		if( element.tagName() == "info" ) 
-		{
-			CapabilitiesInformation info;
-			info.fromXml(element);
-			Capabilities entityCaps( element.attribute("node"),element.attribute("ver"),element.attribute("ext"),element.attribute("hash") );
-			d->capabilitiesInformationMap[entityCaps] = info;
+			readInformation(element);
 		}
-		else 
+	}
+	cacheFile.close();
+
+	// Then everything discovered after the cache file was last written,
+	// one <info/> element per line
+	QFile journalFile(Private::journalFileName());
+	if( journalFile.open(QIODevice::ReadOnly) )
+	{
+		QTextStream textStream(&journalFile);
+		textStream.setCodec(QTextCodec::codecForName("UTF-8"));
+		while( !textStream.atEnd() )
 		{
-			kDebug(JABBER_DEBUG_GLOBAL) << "Unknow element";
+			QString line = textStream.readLine();
+			QDomDocument entry;
+			// a line cut short by a crash is simply skipped
+			if( line.isEmpty() || !entry.setContent(line) )
+				continue;
+
+			readInformation(entry.documentElement());
+			d->journalEntries++;
 		}
 	}
 }
 
+void JabberCapabilitiesManager::readInformation(const QDomElement &element)
+{
+	if( element.tagName() == "info" ) 
+	{
+		CapabilitiesInformation info;
+		info.fromXml(element);
+		Capabilities entityCaps( element.attribute("node"),element.attribute("ver"),element.attribute("ext"),element.attribute("hash") );
+		d->capabilitiesInformationMap[entityCaps] = info;
+	}
+	else 
+	{
+		kDebug(JABBER_DEBUG_GLOBAL) << "Unknow element";
+	}
+}
+
 bool JabberCapabilitiesManager::capabilitiesEnabled(const Jid &jid) const
 {
 	return d->jidCapabilitiesMap.contains( jid.full() );	
@@ -572,11 +622,11 @@ XMPP::Features JabberCapabilitiesManager::features(const Jid& jid) const
 
 	if( capabilitiesEnabled(jid) ) 
 	{
-		CapabilitiesList capabilitiesList = d->jidCapabilitiesMap[jid.full()].flatten();
+		CapabilitiesList capabilitiesList = d->jidCapabilitiesMap.value(jid.full()).flatten();
 
 		foreach(CapabilitiesList::const_reference cap, capabilitiesList)
 		{
-			featuresList += d->capabilitiesInformationMap[cap].features();
+			featuresList += d->capabilitiesInformationMap.value(cap).features();
 		}
 	}
 
@@ -587,8 +637,8 @@ QString JabberCapabilitiesManager::clientName(const Jid& jid) const
 {
 	if( capabilitiesEnabled(jid) ) 
 	{
-		Capabilities caps = d->jidCapabilitiesMap[jid.full()];
-		const XMPP::DiscoItem::Identities &identities = d->capabilitiesInformationMap[Capabilities(caps.node(),caps.version(),caps.version(),caps.hash())].identities();
+		Capabilities caps = d->jidCapabilitiesMap.value(jid.full());
+		const XMPP::DiscoItem::Identities identities = d->capabilitiesInformationMap.value(Capabilities(caps.node(),caps.version(),caps.version(),caps.hash())).identities();
 		QString name;
 
 		for ( int i = 0; i < identities.size(); ++i )
@@ -625,24 +675,28 @@ QString JabberCapabilitiesManager::clientName(const Jid& jid) const
 
 QString JabberCapabilitiesManager::clientVersion(const Jid& jid) const
 {
-	if (capabilitiesEnabled(jid) && d->jidCapabilitiesMap[jid.full()].hash().isEmpty())
-		return d->jidCapabilitiesMap[jid.full()].version();
+	Capabilities caps = d->jidCapabilitiesMap.value(jid.full());
+	if (capabilitiesEnabled(jid) && caps.hash().isEmpty())
+		return caps.version();
 	return QString();
 }
 
 void JabberCapabilitiesManager::saveInformation()
 {
-	QString capsFileName;
-	capsFileName = KStandardDirs::locateLocal("appdata", QString::fromUtf8("jabber-capabilities-cache.xml"));
+	d->saveTimer.stop();
+	d->pendingCapabilities.clear();
 
 	// Generate XML
 	QDomDocument doc;
 	QDomElement capabilities = doc.createElement("capabilities");
 	doc.appendChild(capabilities);
 
-	QMap<Capabilities,CapabilitiesInformation>::ConstIterator it = d->capabilitiesInformationMap.constBegin(), itEnd = d->capabilitiesInformationMap.constEnd();
+	QHash<Capabilities,CapabilitiesInformation>::ConstIterator it = d->capabilitiesInformationMap.constBegin(), itEnd = d->capabilitiesInformationMap.constEnd();
 	for( ; it != itEnd; ++it ) 
 	{
+		if( !it.value().discovered() )
+			continue;
+
 		QDomElement info = it.value().toXml(&doc);
 		info.setAttribute("node",it.key().node());
 		info.setAttribute("ver",it.key().version());
@@ -652,7 +706,7 @@ void JabberCapabilitiesManager::saveInformation()
 	}
 
 	// Save
-	QFile capsFile(capsFileName);
+	QFile capsFile(Private::cacheFileName());
 	if( !capsFile.open(QIODevice::WriteOnly) ) 
 	{
 		kDebug(JABBER_DEBUG_GLOBAL	) << "Error while opening Capabilities cache file.";
@@ -665,6 +719,48 @@ void JabberCapabilitiesManager::saveInformation()
 	textStream << doc.toString();
 	textStream.setDevice(0);
 	capsFile.close();
+
+	// everything in the journal is in the cache file now
+	QFile::remove(Private::journalFileName());
+	d->journalEntries = 0;
+}
+
+void JabberCapabilitiesManager::appendPendingInformation()
+{
+	if( d->pendingCapabilities.isEmpty() )
+		return;
+
+	// Compact once the journal has grown large, so startup stays cheap
+	if( d->journalEntries + d->pendingCapabilities.count() > MAX_JOURNAL_ENTRIES )
+	{
+		saveInformation();
+		return;
+	}
+
+	QFile journalFile(Private::journalFileName());
+	if( !journalFile.open(QIODevice::WriteOnly | QIODevice::Append) )
+	{
+		kDebug(JABBER_DEBUG_GLOBAL) << "Error while opening Capabilities journal file.";
+		return;
+	}
+
+	QTextStream textStream(&journalFile);
+	textStream.setCodec(QTextCodec::codecForName("UTF-8"));
+	foreach( const Capabilities &caps, d->pendingCapabilities )
+	{
+		QDomDocument doc;
+		QDomElement info = d->capabilitiesInformationMap.value(caps).toXml(&doc);
+		info.setAttribute("node",caps.node());
+		info.setAttribute("ver",caps.version());
+		info.setAttribute("ext",caps.extensions());
+		info.setAttribute("hash",caps.hash());
+		doc.appendChild(info);
+
+		// no indentation, so that every entry is a single line
+		textStream << doc.toString(-1).remove('\n') << '\n';
+		d->journalEntries++;
+	}
+	d->pendingCapabilities.clear();
 }
 
 #include "jabbercapabilitiesmanager.moc"
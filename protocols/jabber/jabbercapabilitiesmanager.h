@@ -23,6 +23,8 @@
 
 #include <QPair>
 #include <QList>
+#include <QHash>
+#include <QSet>
 #include <QDate>
 
 #include <QStringList>
@@ -105,6 +107,13 @@ private slots:
 	 */
 	void discoRequestFinished();
 
+	/**
+	 * Append the capabilities discovered since the last call to the
+	 * on-disk journal. Called from a timer so that the burst of new
+	 * node/ver combinations after login results in one write.
+	 */
+	void appendPendingInformation();
+
 private:
 	/**
 	 * @brief Sends a disco#info request to a given node of a jid through an account.
@@ -117,10 +126,15 @@ private:
 	void requestDiscoInfo(JabberAccount *account, const Jid& jid, const QString& node);
 
 	/**
-	 * Save capabilities information to disk.
+	 * Save all capabilities information to disk, replacing the journal.
 	 */
 	void saveInformation();
 
+	/**
+	 * Read one cached <info/> element into the capabilities database.
+	 */
+	void readInformation(const QDomElement &element);
+
 	class Capabilities;
 	typedef QList<Capabilities> CapabilitiesList;
 	/**
@@ -175,6 +189,14 @@ private:
 			bool operator==(const Capabilities&) const;
 			bool operator!=(const Capabilities&) const;
 			bool operator<(const Capabilities&) const;
+
+			friend uint qHash(const Capabilities &caps)
+			{
+				uint h = qHash(caps.m_node);
+				h = h * 31 + qHash(caps.m_version);
+				h = h * 31 + qHash(caps.m_extensions);
+				return h * 31 + qHash(caps.m_hash);
+			}
 				
 		private:
 			QString m_node, m_version, m_extensions, m_hash;
@@ -215,6 +237,8 @@ private:
 
 			typedef QList<QPair<QString, JabberAccount*> > JidList;
 			JidList m_jids;
+			// same pairs as m_jids, for the duplicate check in addJid()
+			QSet<QPair<QString, JabberAccount*> > m_jidSet;
 
 			QDate m_lastSeen;
 	};
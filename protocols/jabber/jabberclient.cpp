@@ -50,7 +50,7 @@ class JabberClient::Private
 public:
 	Private()
 	: jabberClient(0L), jabberClientStream(0L), jabberClientConnector(0L), jabberTLS(0L),
-		       jabberTLSHandler(0L), privacyManager(0L)
+		       jabberTLSHandler(0L), privacyManager(0L), resuming(false)
 	{}
 	~Private()
 	{
@@ -81,6 +81,10 @@ public:
 	QCA::Initializer qcaInit;
 	PrivacyManager *privacyManager;
 
+	// XEP-0198 session left behind by a dropped connection
+	XMPP::StreamManagementState resumeState;
+	bool resuming;
+
 	// ignore TLS warnings
 	bool ignoreTLSWarnings;
 
@@ -111,6 +115,11 @@ public:
 	QString server;
 	int port;
 
+	// BOSH connection manager to connect through, if any
+	QString boshUrl;
+	int boshHold;
+	int boshWait;
+
 	// allow transmission of plaintext passwords
 	bool allowPlainTextPassword;
 
@@ -174,6 +183,9 @@ void JabberClient::cleanUp ()
 
 	d->currentPenaltyTime = 0;
 
+	d->resumeState = XMPP::StreamManagementState ();
+	d->resuming = false;
+
 	d->jid = XMPP::Jid ();
 	d->password.clear();
 
@@ -183,6 +195,7 @@ void JabberClient::cleanUp ()
 	setProbeSSL ( false );
 
 	setOverrideHost ( false );
+	setBoshHoldWait ( 1, 60 );
 
 	setAllowPlainTextPassword ( true );
 
@@ -398,6 +411,42 @@ bool JabberClient::overrideHost () const
 
 }
 
+void JabberClient::setBoshUrl ( const QString &url )
+{
+
+	d->boshUrl = url;
+
+}
+
+QString JabberClient::boshUrl () const
+{
+
+	return d->boshUrl;
+
+}
+
+void JabberClient::setBoshHoldWait ( int hold, int wait )
+{
+
+	d->boshHold = hold;
+	d->boshWait = wait;
+
+}
+
+int JabberClient::boshHold () const
+{
+
+	return d->boshHold;
+
+}
+
+int JabberClient::boshWait () const
+{
+
+	return d->boshWait;
+
+}
+
 void JabberClient::setAllowPlainTextPassword ( bool flag )
 {
 
@@ -621,6 +670,8 @@ JabberClient::ErrorCode JabberClient::connect ( const XMPP::Jid &jid, const QStr
 	d->jid = jid;
 	d->password = password;
 	d->auth = auth;
+	d->resumeState = XMPP::StreamManagementState ();
+	d->resuming = false;
 
 	/*
 	 * Return an error if we should force TLS but it's not available.
@@ -631,72 +682,7 @@ JabberClient::ErrorCode JabberClient::connect ( const XMPP::Jid &jid, const QStr
 		return NoTLS;
 	}
 
-	/*
-	 * Instantiate connector, responsible for dealing with the socket.
-	 * This class uses KDE's socket code, which in turn makes use of
-	 * the global proxy settings.
-	 */
-	d->jabberClientConnector = new XMPP::AdvancedConnector;
-
-	if ( useXMPP09 () )
-	{
-		if ( overrideHost () )
-		{
-			d->jabberClientConnector->setOptHostPort ( d->server, d->port );
-		}
-
-		d->jabberClientConnector->setOptProbe ( probeSSL () );
-
-	}
-
-	d->jabberClientConnector->setOptSSL ( useSSL () );
-
-	/*
-	 * Setup authentication layer
-	 */
-	if ( QCA::isSupported ("tls") )
-	{
-		d->jabberTLS = new QCA::TLS;
-		d->jabberTLS->setTrustedCertificates(QCA::systemStore());
-		d->jabberTLSHandler = new QCATLSHandler(d->jabberTLS);
-		d->jabberTLSHandler->setXMPPCertCheck(true);
-
-		QObject::connect ( d->jabberTLSHandler, SIGNAL (tlsHandshaken()), SLOT (slotTLSHandshaken()) );
-	}
-
-	/*
-	 * Instantiate client stream which handles the network communication by referring
-	 * to a connector (proxying etc.) and a TLS handler (security layer)
-	 */
-	d->jabberClientStream = new XMPP::ClientStream ( d->jabberClientConnector, d->jabberTLSHandler );
-
-	{
-		using namespace XMPP;
-		QObject::connect ( d->jabberClientStream, SIGNAL (needAuthParams(bool,bool,bool)),
-				   this, SLOT (slotCSNeedAuthParams(bool,bool,bool)) );
-		QObject::connect ( d->jabberClientStream, SIGNAL (authenticated()),
-				   this, SLOT (slotCSAuthenticated()) );
-		QObject::connect ( d->jabberClientStream, SIGNAL (connectionClosed()),
-				   this, SLOT (slotCSDisconnected()) );
-		QObject::connect ( d->jabberClientStream, SIGNAL (delayedCloseFinished()),
-				   this, SLOT (slotCSDisconnected()) );
-		QObject::connect ( d->jabberClientStream, SIGNAL (warning(int)),
-				   this, SLOT (slotCSWarning(int)) );
-		QObject::connect ( d->jabberClientStream, SIGNAL (error(int)),
-				   this, SLOT (slotCSError(int)) );
-		QObject::connect ( d->jabberClientStream, SIGNAL (connected()),
-		                   this, SLOT (slotCSConnected()) );
-	}
-
-	/*
-	 * Initiate anti-idle timer (will be triggered every 55 seconds).
-	 */
-	d->jabberClientStream->setNoopTime ( 55000 );
-
-	/*
-	 * Allow plaintext password authentication or not?
-	 */
-	d->jabberClientStream->setAllowPlain( allowPlainTextPassword () ?  XMPP::ClientStream::AllowPlain : XMPP::ClientStream::NoAllowPlain );
+	setupClientStream ();
 
 	/*
 	 * Setup client layer.
@@ -836,6 +822,127 @@ JabberClient::ErrorCode JabberClient::connect ( const XMPP::Jid &jid, const QStr
 
 }
 
+void JabberClient::setupClientStream ()
+{
+	/*
+	 * Instantiate connector, responsible for dealing with the socket.
+	 * This class uses KDE's socket code, which in turn makes use of
+	 * the global proxy settings.
+	 */
+	d->jabberClientConnector = new XMPP::AdvancedConnector;
+
+	if ( useXMPP09 () )
+	{
+		if ( overrideHost () )
+		{
+			d->jabberClientConnector->setOptHostPort ( d->server, d->port );
+		}
+
+		d->jabberClientConnector->setOptProbe ( probeSSL () );
+
+	}
+
+	d->jabberClientConnector->setOptSSL ( useSSL () );
+
+	if ( !boshUrl().isEmpty () )
+	{
+		XMPP::AdvancedConnector::Proxy proxy;
+		proxy.setBosh ( QString (), 0, QUrl ( boshUrl () ) );
+		proxy.setBoshHoldWait ( boshHold (), boshWait () );
+		d->jabberClientConnector->setProxy ( proxy );
+	}
+
+	/*
+	 * Setup authentication layer
+	 */
+	if ( QCA::isSupported ("tls") )
+	{
+		d->jabberTLS = new QCA::TLS;
+		d->jabberTLS->setTrustedCertificates(QCA::systemStore());
+		d->jabberTLSHandler = new QCATLSHandler(d->jabberTLS);
+		d->jabberTLSHandler->setXMPPCertCheck(true);
+
+		QObject::connect ( d->jabberTLSHandler, SIGNAL (tlsHandshaken()), SLOT (slotTLSHandshaken()) );
+	}
+
+	/*
+	 * Instantiate client stream which handles the network communication by referring
+	 * to a connector (proxying etc.) and a TLS handler (security layer)
+	 */
+	d->jabberClientStream = new XMPP::ClientStream ( d->jabberClientConnector, d->jabberTLSHandler );
+
+	{
+		using namespace XMPP;
+		QObject::connect ( d->jabberClientStream, SIGNAL (needAuthParams(bool,bool,bool)),
+				   this, SLOT (slotCSNeedAuthParams(bool,bool,bool)) );
+		QObject::connect ( d->jabberClientStream, SIGNAL (authenticated()),
+				   this, SLOT (slotCSAuthenticated()) );
+		QObject::connect ( d->jabberClientStream, SIGNAL (connectionClosed()),
+				   this, SLOT (slotCSDisconnected()) );
+		QObject::connect ( d->jabberClientStream, SIGNAL (delayedCloseFinished()),
+				   this, SLOT (slotCSDisconnected()) );
+		QObject::connect ( d->jabberClientStream, SIGNAL (warning(int)),
+				   this, SLOT (slotCSWarning(int)) );
+		QObject::connect ( d->jabberClientStream, SIGNAL (error(int)),
+				   this, SLOT (slotCSError(int)) );
+		QObject::connect ( d->jabberClientStream, SIGNAL (connected()),
+		                   this, SLOT (slotCSConnected()) );
+	}
+
+	/*
+	 * Initiate anti-idle timer (will be triggered every 55 seconds).
+	 */
+	d->jabberClientStream->setNoopTime ( 55000 );
+
+	/*
+	 * Allow plaintext password authentication or not?
+	 */
+	d->jabberClientStream->setAllowPlain( allowPlainTextPassword () ?  XMPP::ClientStream::AllowPlain : XMPP::ClientStream::NoAllowPlain );
+
+	/*
+	 * Ask for stream management, so a dropped connection can be resumed.
+	 */
+	d->jabberClientStream->setStreamManagement ( true );
+
+}
+
+bool JabberClient::canResume () const
+{
+
+	return d->jabberClient && !d->resuming && d->resumeState.isResumable ();
+
+}
+
+JabberClient::ErrorCode JabberClient::resume ()
+{
+
+	if ( !canResume () )
+		return AlreadyConnected;
+
+	/*
+	 * The old stream may still be emitting the error that brought us
+	 * here, so only unhook it now and let the event loop delete it.
+	 */
+	d->jabberClientStream->disconnect ();
+	d->jabberClientStream->deleteLater ();
+	d->jabberClientConnector->deleteLater ();
+	if ( d->jabberTLSHandler )
+		d->jabberTLSHandler->deleteLater ();
+	if ( d->jabberTLS )
+		d->jabberTLS->deleteLater ();
+	d->jabberTLSHandler = 0L;
+	d->jabberTLS = 0L;
+
+	setupClientStream ();
+	d->jabberClientStream->setResumeState ( d->resumeState );
+	d->resuming = true;
+
+	d->jabberClient->connectToServer ( d->jabberClientStream, jid(), d->auth );
+
+	return Ok;
+
+}
+
 void JabberClient::disconnect ()
 {
 
@@ -928,10 +1035,10 @@ void JabberClient::send ( const QString &packet )
 
 }
 
-void JabberClient::requestRoster ()
+void JabberClient::requestRoster ( const XMPP::Roster &cache )
 {
 
-	client()->rosterRequest ();
+	client()->rosterRequest ( cache );
 
 }
 
@@ -1062,8 +1169,20 @@ void JabberClient::slotCSAuthenticated ()
 	// update only resource and do not change bare jid, see bug 324937
 	d->jid = XMPP::Jid ( d->jid.node(), d->jid.domain(), d->jabberClientStream->jid().resource() );
 
-	// start the client operation
-	d->jabberClient->start ( jid().domain (), jid().node (), d->password, jid().resource () );
+	bool wasResuming = d->resuming;
+	d->resuming = false;
+	d->resumeState = XMPP::StreamManagementState ();
+
+	// the server kept our session, roster and presences are still valid
+	if ( wasResuming && d->jabberClientStream->isResumed () )
+	{
+		emit resumed ();
+		return;
+	}
+
+	// start the client operation (unless we are reusing a client that was already started)
+	if ( !wasResuming )
+		d->jabberClient->start ( jid().domain (), jid().node (), d->password, jid().resource () );
 
 	if (!d->jabberClientStream->old() && d->auth)
 	{
@@ -1090,6 +1209,13 @@ void JabberClient::slotSessionStarted()
 void JabberClient::slotCSDisconnected ()
 {
 
+	// remember a resumable session, unless this was the resume attempt itself
+	if ( !d->resuming )
+		d->resumeState = d->jabberClientStream->streamManagementState ();
+	else
+		d->resumeState = XMPP::StreamManagementState ();
+	d->resuming = false;
+
 	/* FIXME:
 	 * We should delete the XMPP::Client instance here,
 	 * but timers etc prevent us from doing so. (Psi does
@@ -1135,6 +1261,13 @@ void JabberClient::slotCSError ( int error )
 
 	emit debugMessage ( "Client stream error." );
 
+	// remember a resumable session, unless this was the resume attempt itself
+	if ( !d->resuming && d->jabberClientStream )
+		d->resumeState = d->jabberClientStream->streamManagementState ();
+	else
+		d->resumeState = XMPP::StreamManagementState ();
+	d->resuming = false;
+
 	emit csError ( error );
 
 }
@@ -1143,6 +1276,10 @@ void JabberClient::slotCSConnected ()
 {
 	Kopete::SocketTimeoutWatcher* timeoutWatcher = 0;
 
+	QString timings = d->jabberClientConnector->connectTimings ();
+	if ( !timings.isEmpty () )
+		emit debugMessage ( "Connected: " + timings );
+
 	ByteStream *irisByteStream = d->jabberClientConnector->stream ();
 	if ( irisByteStream && irisByteStream->abstractSocket () )
 		timeoutWatcher = Kopete::SocketTimeoutWatcher::watch ( irisByteStream->abstractSocket () );
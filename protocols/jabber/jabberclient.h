@@ -108,6 +108,19 @@ public:
 	 */
 	bool isConnected () const;
 
+	/**
+	 * Returns true if the connection dropped while a resumable
+	 * (XEP-0198) session was active, so @ref resume can be used.
+	 */
+	bool canResume () const;
+
+	/**
+	 * Reconnect and resume the session that was lost. The XMPP::Client
+	 * instance with its roster and tasks is kept. Emits @ref resumed on
+	 * success, or @ref connected if the server started a new session.
+	 */
+	ErrorCode resume ();
+
 	/**
 	 * Returns the JID associated with this instance.
 	 */
@@ -203,6 +216,33 @@ public:
 	 */
 	bool overrideHost () const;
 
+	/**
+	 * Connect through the BOSH connection manager at @p url
+	 * (XEP-0206) instead of a direct TCP connection. Useful
+	 * behind proxies that only let HTTP through. An empty
+	 * URL, the default, connects directly.
+	 */
+	void setBoshUrl ( const QString &url );
+	/**
+	 * Returns the BOSH connection manager URL, if any.
+	 */
+	QString boshUrl () const;
+
+	/**
+	 * Requests the BOSH connection manager may hold open, and
+	 * seconds it may hold each of them before answering.
+	 * Defaults are 1 and 60.
+	 */
+	void setBoshHoldWait ( int hold, int wait );
+	/**
+	 * Returns the requests the BOSH connection manager may hold.
+	 */
+	int boshHold () const;
+	/**
+	 * Returns the seconds the BOSH connection manager may hold a request.
+	 */
+	int boshWait () const;
+
 	/**
 	 * Allow the transmission of a plain text password. If digested
 	 * passwords are supported by the server, they will still be preferred.
@@ -407,8 +447,10 @@ public:
 
 	/**
 	 * Request the roster from the Jabber server.
+	 * If @p cache carries a version and the server supports
+	 * roster versioning, only changes since then are fetched.
 	 */
-	void requestRoster ();
+	void requestRoster ( const XMPP::Roster &cache = XMPP::Roster () );
 
 signals:
 	/**
@@ -416,6 +458,12 @@ signals:
 	 */
 	void connected ();
 
+	/**
+	 * The previous session has been resumed, the roster
+	 * and presences are still valid.
+	 */
+	void resumed ();
+
 	/**
 	 * Client stream authenticated. This
 	 * signal is emitted when the socket
@@ -532,6 +580,11 @@ private:
 	 */
 	void cleanUp ();
 
+	/**
+	 * Create connector, TLS handler and client stream for a new connection.
+	 */
+	void setupClientStream ();
+
 	/** 
 	 * Return current instance of the S5B server.
 	 */
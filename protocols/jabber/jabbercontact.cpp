@@ -57,6 +57,7 @@
 #include "jabberchatsession.h"
 #include "jabberresource.h"
 #include "jabberresourcepool.h"
+#include "jabbervcardqueue.h"
 #include "jabberfiletransfer.h"
 #include "jabbertransport.h"
 #include "dlgjabbervcard.h"
@@ -90,8 +91,6 @@ JabberContact::JabberContact (const XMPP::RosterItem &rosterItem, Kopete::Accoun
 	 * special case.
 	 */
 
-	mVCardUpdateInProgress = false;
-
 	if ( !account()->myself () )
 	{
 		// JabberContact (this) is the myself instance
@@ -116,8 +115,7 @@ JabberContact::JabberContact (const XMPP::RosterItem &rosterItem, Kopete::Accoun
 		 */
 		if ( account()->myself()->onlineStatus().isDefinitelyOnline() )
 		{
-			mVCardUpdateInProgress = true;
-			QTimer::singleShot ( 1000, this, SLOT (slotGetTimedVCard()) );
+			account()->vCardQueue()->check ( this );
 		}
 	}
 
@@ -532,58 +530,16 @@ void JabberContact::slotCheckVCard ()
 
 	kDebug ( JABBER_DEBUG_GLOBAL ) << "Cached vCard data for " << contactId () << " from " << cacheDate.toString ();
 
-	if ( !mVCardUpdateInProgress && ( cacheDate.addDays ( 1 ) < QDateTime::currentDateTime () ) )
+	if ( cacheDate.addDays ( 1 ) < QDateTime::currentDateTime () )
 	{
 		kDebug ( JABBER_DEBUG_GLOBAL ) << "Scheduling update.";
 
-		mVCardUpdateInProgress = true;
-
 		// current data is older than 24 hours, request a new one
-		QTimer::singleShot ( account()->client()->getPenaltyTime () * 1000, this, SLOT (slotGetTimedVCard()) );
+		account()->vCardQueue()->enqueue ( this );
 	}
 
 }
 
-void JabberContact::slotGetTimedVCard ()
-{
-	mVCardUpdateInProgress = false;
-
-	// check if we are still connected - eventually we lost our connection in the meantime
-	if ( !account()->myself()->onlineStatus().isDefinitelyOnline () )
-	{
-		// we are not connected, discard this update
-		return;
-	}
-	
-	if(!mDiscoDone)
-	{
-		if(transport()) //no need to disco if this is a legacy contact
-			mDiscoDone = true;
-		else if(!rosterItem().jid().node().isEmpty())
-			mDiscoDone = true; //contact with an @ are not transport for sure
-		else
-		{
-			//disco to see if it's not a transport
-			XMPP::JT_DiscoInfo *jt = new XMPP::JT_DiscoInfo(account()->client()->rootTask());
-			QObject::connect(jt, SIGNAL(finished()),this, SLOT(slotDiscoFinished()));
-			jt->get(rosterItem().jid(), QString());
-			jt->go(true);
-		}
-	}
-
-	kDebug ( JABBER_DEBUG_GLOBAL ) << "Requesting vCard for " << contactId () << " from update timer.";
-
-	mVCardUpdateInProgress = true;
-
-	// request vCard
-	XMPP::JT_VCard *task = new XMPP::JT_VCard ( account()->client()->rootTask () );
-	// signal to ourselves when the vCard data arrived
-	QObject::connect ( task, SIGNAL (finished()), this, SLOT (slotGotVCard()) );
-	task->get ( mRosterItem.jid () );
-	task->go ( true );
-
-}
-
 void JabberContact::slotGotVCard ()
 {
 
@@ -595,8 +551,6 @@ void JabberContact::slotGotVCard ()
 		setProperty ( protocol()->propVCardCacheTimeStamp, QDateTime::currentDateTime().toString ( Qt::ISODate ) );
 	}
 
-	mVCardUpdateInProgress = false;
-
 	if ( !vCard->success() )
 	{
 		/*
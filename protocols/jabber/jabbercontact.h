@@ -165,14 +165,9 @@ private slots:
 	 */
 	void slotCheckVCard ();
 
-	/**
-	 * Triggered from a timer, requests the vCard.
-	 * Timer is initiated by @ref slotCheckVCard.
-	 */
-	void slotGetTimedVCard ();
-	
 	/**
 	 * Passes vCard on to parsing function.
+	 * Connected by the account's JabberVCardQueue.
 	 */
 	void slotGotVCard ();
 
@@ -258,12 +253,6 @@ private:
 	 */
 	QList<JabberChatSession*> mManagers;
 
-	/**
-	 * Indicates whether the vCard is currently
-	 * being updated or not.
-	 */
-	bool mVCardUpdateInProgress :1;
-
 	bool mRequestComposingEvent :1;
 	bool mRequestOfflineEvent :1;
 	bool mRequestDisplayedEvent :1;
@@ -50,15 +50,23 @@ JabberContactPoolItem *JabberContactPool::findPoolItem ( const XMPP::RosterItem
 {
 
 	// see if the contact already exists
-	foreach(JabberContactPoolItem *mContactItem, mPool)
-	{
-		if ( mContactItem->contact()->rosterItem().jid().full().toLower() == contact.jid().full().toLower() )
-		{
-			return mContactItem;
-		}
-	}
+	return mJidIndex.find ( contact.jid () );
+
+}
+
+void JabberContactPool::insertItem ( JabberContactPoolItem *item )
+{
+
+	mPool.insert ( item->contact (), item );
+	mJidIndex.insert ( item->jid (), item );
+
+}
+
+void JabberContactPool::removeItem ( JabberContactPoolItem *item )
+{
 
-	return 0;
+	mPool.remove ( item->contact () );
+	mJidIndex.remove ( item->jid (), item );
 
 }
 
@@ -112,7 +120,7 @@ JabberContact *JabberContactPool::addContact ( const XMPP::RosterItem &contact,
 	JabberContactPoolItem *newContactItem = new JabberContactPoolItem ( newContact );
 	connect ( newContact, SIGNAL (contactDestroyed(Kopete::Contact*)), this, SLOT (slotContactDestroyed(Kopete::Contact*)) );
 	newContactItem->setDirty ( dirty );
-	mPool.append ( newContactItem );
+	insertItem ( newContactItem );
 
 	return newContact;
 
@@ -172,7 +180,7 @@ JabberBaseContact *JabberContactPool::addGroupContact ( const XMPP::RosterItem &
 	connect ( newContact, SIGNAL (contactDestroyed(Kopete::Contact*)), this, SLOT (slotContactDestroyed(Kopete::Contact*)) );
 
 	newContactItem->setDirty ( dirty );
-	mPool.append ( newContactItem );
+	insertItem ( newContactItem );
 
 	return newContact;
 
@@ -182,25 +190,23 @@ void JabberContactPool::removeContact ( const XMPP::Jid &jid )
 {
 	kDebug(JABBER_DEBUG_GLOBAL) << "Removing contact " << jid.full();
 
-	foreach(JabberContactPoolItem *mContactItem, mPool)
+	JabberContactPoolItem *mContactItem = mJidIndex.find ( jid );
+	if ( mContactItem )
 	{
-		if ( mContactItem->contact()->rosterItem().jid().full().toLower() == jid.full().toLower() )
+		/*
+		 * The following deletion will cause slotContactDestroyed()
+		 * to be called, which will clean the up the list.
+		 */
+		if(mContactItem->contact())
 		{
-			/*
-			 * The following deletion will cause slotContactDestroyed()
-			 * to be called, which will clean the up the list.
-			 */
-			if(mContactItem->contact())
+			Kopete::MetaContact *mc=mContactItem->contact()->metaContact();
+			delete mContactItem->contact ();
+			if(mc && mc->contacts().isEmpty())
 			{
-				Kopete::MetaContact *mc=mContactItem->contact()->metaContact();
-				delete mContactItem->contact ();
-				if(mc && mc->contacts().isEmpty())
-				{
-					Kopete::ContactList::self()->removeMetaContact(mc) ;
-				}
+				Kopete::ContactList::self()->removeMetaContact(mc) ;
 			}
-			return;
 		}
+		return;
 	}
 
 	kDebug(JABBER_DEBUG_GLOBAL) << "WARNING: No match found!";
@@ -215,15 +221,11 @@ void JabberContactPool::slotContactDestroyed ( Kopete::Contact *contact )
 	//WARNING  this ptr is not usable, we are in the Kopete::Contact destructor
 
 	// remove contact from the pool
-	foreach(JabberContactPoolItem *mContactItem, mPool)
+	JabberContactPoolItem *deletedItem = mPool.value ( jabberContact );
+	if ( deletedItem )
 	{
-		if ( mContactItem->contact() == jabberContact )
-		{
-			JabberContactPoolItem *deletedItem = mPool.takeAt( mPool.indexOf(mContactItem) );
-			delete deletedItem;
-
-			break;
-		}
+		removeItem ( deletedItem );
+		delete deletedItem;
 	}
 
 	// delete all resources for it
@@ -258,13 +260,11 @@ void JabberContactPool::setDirty ( const XMPP::Jid &jid, bool dirty )
 {
 	kDebug(JABBER_DEBUG_GLOBAL) << "Setting flag for " << jid.full() << " to " << dirty;
 
-	foreach(JabberContactPoolItem *mContactItem, mPool)
+	JabberContactPoolItem *mContactItem = mJidIndex.find ( jid );
+	if ( mContactItem )
 	{
-		if ( mContactItem->contact()->rosterItem().jid().full().toLower() == jid.full().toLower() )
-		{
-			mContactItem->setDirty ( dirty );
-			return;
-		}
+		mContactItem->setDirty ( dirty );
+		return;
 	}
 
 	kDebug(JABBER_DEBUG_GLOBAL) << "WARNING: No match found!";
@@ -294,30 +294,16 @@ void JabberContactPool::cleanUp ()
 JabberBaseContact *JabberContactPool::findExactMatch ( const XMPP::Jid &jid )
 {
 
-	foreach(JabberContactPoolItem *mContactItem, mPool)
-	{
-		if ( mContactItem->contact()->rosterItem().jid().full().toLower () == jid.full().toLower () )
-		{
-			return mContactItem->contact ();
-		}
-	}
-
-	return 0L;
+	JabberContactPoolItem *mContactItem = mJidIndex.find ( jid );
+	return mContactItem ? mContactItem->contact () : 0L;
 
 }
 
 JabberBaseContact *JabberContactPool::findRelevantRecipient ( const XMPP::Jid &jid )
 {
 
-	foreach(JabberContactPoolItem *mContactItem, mPool)
-	{
-		if ( mContactItem->contact()->rosterItem().jid().full().toLower () == jid.bare().toLower () )
-		{
-			return mContactItem->contact ();
-		}
-	}
-
-	return 0L;
+	JabberContactPoolItem *mContactItem = mJidIndex.findWithoutResource ( jid );
+	return mContactItem ? mContactItem->contact () : 0L;
 
 }
 
@@ -325,12 +311,9 @@ QList<JabberBaseContact*> JabberContactPool::findRelevantSources ( const XMPP::J
 {
 	QList<JabberBaseContact*> list;
 
-	foreach(JabberContactPoolItem *mContactItem, mPool)
+	foreach(JabberContactPoolItem *mContactItem, mJidIndex.findBare ( jid ))
 	{
-		if ( mContactItem->contact()->rosterItem().jid().bare().toLower () == jid.bare().toLower () )
-		{
-			list.append ( mContactItem->contact () );
-		}
+		list.append ( mContactItem->contact () );
 	}
 
 	return list;
@@ -341,6 +324,7 @@ JabberContactPoolItem::JabberContactPoolItem ( JabberBaseContact *contact )
 {
 	mDirty = true;
 	mContact = contact;
+	mJid = contact->rosterItem().jid ();
 }
 
 JabberContactPoolItem::~JabberContactPoolItem ()
@@ -362,4 +346,9 @@ JabberBaseContact *JabberContactPoolItem::contact ()
 	return mContact;
 }
 
+const XMPP::Jid &JabberContactPoolItem::jid () const
+{
+	return mJid;
+}
+
 #include "jabbercontactpool.moc"
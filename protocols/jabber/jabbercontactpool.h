@@ -20,8 +20,11 @@
 
 #include <qobject.h>
 #include <QList>
+#include <QHash>
 #include <im.h>
 
+#include "jabberjidindex.h"
+
 namespace Kopete { class MetaContact; }
 namespace Kopete { class Contact; }
 class JabberContactPoolItem;
@@ -99,7 +102,16 @@ private slots:
 private:
 	JabberContactPoolItem *findPoolItem ( const XMPP::RosterItem &contact );
 
-	QList<JabberContactPoolItem*> mPool;
+	/**
+	 * Keep the JID indexes in sync when an item enters or leaves the pool.
+	 */
+	void insertItem ( JabberContactPoolItem *item );
+	void removeItem ( JabberContactPoolItem *item );
+
+	// all items, by contact
+	QHash<JabberBaseContact*, JabberContactPoolItem*> mPool;
+	// the same items by full and bare JID
+	JabberJidIndex<JabberContactPoolItem*> mJidIndex;
 	JabberAccount *mAccount;
 
 };
@@ -115,9 +127,16 @@ public:
 	bool dirty ();
 	JabberBaseContact *contact ();
 
+	/**
+	 * The JID the item was indexed with. Stays valid while
+	 * the contact is being destroyed.
+	 */
+	const XMPP::Jid &jid () const;
+
 private:
 	bool mDirty;
 	JabberBaseContact *mContact;
+	XMPP::Jid mJid;
 };
 
 #endif
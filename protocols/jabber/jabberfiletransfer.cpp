@@ -132,6 +132,9 @@ JabberFileTransfer::JabberFileTransfer ( JabberAccount *account, JabberBaseConta
 
 	initializeVariables ();
 
+	// libiris reads the file itself
+	mXMPPTransfer->setFile ( &mLocalFile );
+
 	connect ( mXMPPTransfer, SIGNAL (connected()), this, SLOT (slotOutgoingConnected()) );
 	connect ( mXMPPTransfer, SIGNAL (bytesWritten(qint64)), this, SLOT (slotOutgoingBytesWritten(qint64)) );
 	connect ( mXMPPTransfer, SIGNAL (error(int)), this, SLOT (slotTransferError(int)) );
@@ -242,7 +245,9 @@ void JabberFileTransfer::slotIncomingTransferAccepted ( Kopete::Transfer *transf
 	else
 	{
 		connect ( mKopeteTransfer, SIGNAL (result(KJob*)), this, SLOT (slotTransferResult()) );
-		connect ( mXMPPTransfer, SIGNAL (readyRead(QByteArray)), this, SLOT (slotIncomingDataReady(QByteArray)) );
+		// libiris writes to the file itself
+		mXMPPTransfer->setFile ( &mLocalFile );
+		connect ( mXMPPTransfer, SIGNAL (bytesReceived(qint64)), this, SLOT (slotIncomingBytesReceived(qint64)) );
 		connect ( mXMPPTransfer, SIGNAL (error(int)), this, SLOT (slotTransferError(int)) );
 		mXMPPTransfer->accept ( offset, length );
 	}
@@ -302,6 +307,12 @@ void JabberFileTransfer::slotTransferError ( int errorCode )
 										 mXMPPTransfer->peer().full () );
 			break;
 
+		case XMPP::FileTransfer::ErrFile:
+			// reading or writing the local file failed
+			mKopeteTransfer->slotError ( mKopeteTransfer->info().direction () == Kopete::FileTransferInfo::Outgoing ? KIO::ERR_COULD_NOT_READ : KIO::ERR_COULD_NOT_WRITE,
+										 mLocalFile.fileName () );
+			break;
+
 		default:
 			// unknown error
 			mKopeteTransfer->slotError ( KIO::ERR_UNKNOWN,
@@ -313,16 +324,14 @@ void JabberFileTransfer::slotTransferError ( int errorCode )
 
 }
 
-void JabberFileTransfer::slotIncomingDataReady ( const QByteArray &data )
+void JabberFileTransfer::slotIncomingBytesReceived ( qint64 nrReceived )
 {
 
-	mBytesTransferred += data.size ();
-	mBytesToTransfer -= data.size ();
+	mBytesTransferred += nrReceived;
+	mBytesToTransfer -= nrReceived;
 
 	mKopeteTransfer->slotProcessed ( mBytesTransferred );
 
-	mLocalFile.write ( data );
-
 	if ( mBytesToTransfer <= 0 )
 	{
 		kDebug(JABBER_DEBUG_GLOBAL) << "Transfer from " << mXMPPTransfer->peer().full () << " done.";
@@ -340,7 +349,6 @@ void JabberFileTransfer::slotOutgoingConnected ()
 	kDebug ( JABBER_DEBUG_GLOBAL ) << "Outgoing data connection is open.";
 
 	mBytesTransferred = mXMPPTransfer->offset ();
-	mLocalFile.seek ( mXMPPTransfer->offset () );
 	mBytesToTransfer = ( mXMPPTransfer->fileSize () > mXMPPTransfer->length () ) ? mXMPPTransfer->length () : mXMPPTransfer->fileSize ();
 
 	slotOutgoingBytesWritten ( 0 );
@@ -355,17 +363,7 @@ void JabberFileTransfer::slotOutgoingBytesWritten ( qint64 nrWritten )
 
 	mKopeteTransfer->slotProcessed ( mBytesTransferred );
 
-	if ( mBytesToTransfer )
-	{
-		int nrToWrite = mXMPPTransfer->dataSizeNeeded ();
-
-		QByteArray readBuffer ( nrToWrite , '\0' );
-
-		mLocalFile.read ( readBuffer.data (), nrToWrite );
-
-		mXMPPTransfer->writeFileData ( readBuffer );
-	}
-	else
+	if ( mBytesToTransfer <= 0 )
 	{
 		kDebug(JABBER_DEBUG_GLOBAL) << "Transfer to " << mXMPPTransfer->peer().full () << " done.";
 
@@ -55,7 +55,7 @@ private slots:
 	void slotOutgoingConnected ();
 	void slotOutgoingBytesWritten ( qint64 nrWritten );
 
-	void slotIncomingDataReady ( const QByteArray &data );
+	void slotIncomingBytesReceived ( qint64 nrReceived );
 
 	void slotThumbnailReceived ();
 	void askIncomingTransfer ( const QByteArray &thumbnail = QByteArray() );
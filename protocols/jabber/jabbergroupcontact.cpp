@@ -279,6 +279,29 @@ JabberBaseContact *JabberGroupContact::addSubContact ( const XMPP::RosterItem &r
 
 }
 
+void JabberGroupContact::addSubContacts ( const QList<XMPP::RosterItem> &rosterItems )
+{
+	kDebug ( JABBER_DEBUG_GLOBAL ) << "Adding " << rosterItems.count () << " subcontacts to room " << mRosterItem.jid().full ();
+
+	Kopete::ContactPtrList added;
+
+	foreach ( const XMPP::RosterItem &rosterItem, rosterItems )
+	{
+		// skip the ones we already have, like addSubContact() does
+		if ( dynamic_cast<JabberGroupMemberContact *>( account()->contactPool()->findExactMatch ( rosterItem.jid () ) ) )
+			continue;
+
+		// create the contact, but hand it to the manager together with the others
+		JabberBaseContact *subContact = addSubContact ( rosterItem, false );
+		if ( subContact )
+			added.append ( subContact );
+	}
+
+	if ( mManager && !added.isEmpty () )
+		mManager->addContacts ( added );
+
+}
+
 void JabberGroupContact::removeSubContact ( const XMPP::RosterItem &rosterItem )
 {
 	kDebug ( JABBER_DEBUG_GLOBAL ) << "Removing subcontact " << rosterItem.jid().full () << " from room " << mRosterItem.jid().full ();
@@ -54,6 +54,12 @@ public:
 	 */
 	JabberBaseContact *addSubContact ( const XMPP::RosterItem &rosterItem, bool addToManager = true );
 
+	/**
+	 * Add several contacts to this room at once. The message
+	 * manager gets them all in a single update.
+	 */
+	void addSubContacts ( const QList<XMPP::RosterItem> &rosterItems );
+
 	/**
 	 * Remove a contact from this room.
 	 */
@@ -0,0 +1,124 @@
+ /*
+  * jabberjidindex.h
+  *
+  * Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+  *
+  * *************************************************************************
+  * *                                                                       *
+  * * This program is free software; you can redistribute it and/or modify  *
+  * * it under the terms of the GNU General Public License as published by  *
+  * * the Free Software Foundation; either version 2 of the License, or     *
+  * * (at your option) any later version.                                   *
+  * *                                                                       *
+  * *************************************************************************
+  */
+
+#ifndef JABBERJIDINDEX_H
+#define JABBERJIDINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <im.h>
+
+/**
+ * Items by full and by bare JID, compared case-insensitively.
+ *
+ * Inserting, removing and finding an item take constant time, also
+ * when many items share one bare JID like the occupants of a room.
+ * Items under the same bare JID come in no particular order.
+ */
+template <class T>
+class JabberJidIndex
+{
+public:
+	/**
+	 * Add @p item under @p jid. An item already indexed under the
+	 * same full JID is replaced in the full JID index, but still
+	 * listed under the bare JID until it is removed.
+	 */
+	void insert ( const XMPP::Jid &jid, T item )
+	{
+		mFull.insert ( fullKey ( jid ), item );
+		mBare[bareKey ( jid )].insert ( item );
+	}
+
+	/**
+	 * Remove @p item, which was inserted under @p jid.
+	 */
+	void remove ( const XMPP::Jid &jid, T item )
+	{
+		QString full = fullKey ( jid );
+		typename QHash<QString, T>::Iterator it = mFull.find ( full );
+		if ( it != mFull.end () && it.value () == item )
+			mFull.erase ( it );
+
+		typename QHash<QString, QSet<T> >::Iterator bare = mBare.find ( bareKey ( jid ) );
+		if ( bare != mBare.end () )
+		{
+			bare->remove ( item );
+			if ( bare->isEmpty () )
+				mBare.erase ( bare );
+		}
+	}
+
+	/**
+	 * The item indexed under exactly @p jid, or a default constructed T.
+	 */
+	T find ( const XMPP::Jid &jid ) const
+	{
+		return mFull.value ( fullKey ( jid ) );
+	}
+
+	/**
+	 * The item indexed under the bare JID of @p jid without a resource,
+	 * or a default constructed T.
+	 */
+	T findWithoutResource ( const XMPP::Jid &jid ) const
+	{
+		return mFull.value ( bareKey ( jid ) );
+	}
+
+	/**
+	 * All items under the bare JID of @p jid, whatever their resource.
+	 */
+	QList<T> findBare ( const XMPP::Jid &jid ) const
+	{
+		return mBare.value ( bareKey ( jid ) ).toList ();
+	}
+
+	/**
+	 * Number of items under the bare JID of @p jid.
+	 */
+	int countBare ( const XMPP::Jid &jid ) const
+	{
+		return mBare.value ( bareKey ( jid ) ).count ();
+	}
+
+	bool isEmpty () const
+	{
+		return mBare.isEmpty ();
+	}
+
+	void clear ()
+	{
+		mFull.clear ();
+		mBare.clear ();
+	}
+
+	static QString fullKey ( const XMPP::Jid &jid )
+	{
+		return jid.full().toLower ();
+	}
+
+	static QString bareKey ( const XMPP::Jid &jid )
+	{
+		return jid.bare().toLower ();
+	}
+
+private:
+	QHash<QString, T> mFull;
+	QHash<QString, QSet<T> > mBare;
+};
+
+#endif
@@ -0,0 +1,199 @@
+ /*
+  * jabberrequestthrottle.cpp
+  *
+  * Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+  *
+  * *************************************************************************
+  * *                                                                       *
+  * * This program is free software; you can redistribute it and/or modify  *
+  * * it under the terms of the GNU General Public License as published by  *
+  * * the Free Software Foundation; either version 2 of the License, or     *
+  * * (at your option) any later version.                                   *
+  * *                                                                       *
+  * *************************************************************************
+  */
+
+#include "jabberrequestthrottle.h"
+
+/**
+ * Requests on the wire at the same time.
+ */
+static const int MAX_IN_FLIGHT = 4;
+
+/**
+ * Response time (ms) we consider healthy. Slower answers
+ * stretch the gap between requests, faster ones shrink it.
+ */
+static const int TARGET_RESPONSE_TIME = 1000;
+
+/**
+ * Bounds for the gap between two requests (ms).
+ */
+static const int MIN_DELAY = 50;
+static const int MAX_DELAY = 10000;
+
+/**
+ * Time (ms) after which an unanswered request gives up its slot.
+ */
+static const int DEFAULT_TIMEOUT = 30000;
+
+JabberRequestThrottle::JabberRequestThrottle ( QObject *parent )
+	: QObject ( parent ), mResponseTime ( TARGET_RESPONSE_TIME ), mDelay ( MIN_DELAY ), mTimeout ( DEFAULT_TIMEOUT )
+{
+
+	mExpiryTimer.setSingleShot ( true );
+	connect ( &mExpiryTimer, SIGNAL (timeout()), this, SLOT (slotExpire()) );
+
+}
+
+JabberRequestThrottle::~JabberRequestThrottle ()
+{
+}
+
+bool JabberRequestThrottle::canSend () const
+{
+
+	return mInFlight.count () < MAX_IN_FLIGHT;
+
+}
+
+int JabberRequestThrottle::delay () const
+{
+
+	return mDelay;
+
+}
+
+int JabberRequestThrottle::inFlight () const
+{
+
+	return mInFlight.count ();
+
+}
+
+int JabberRequestThrottle::timeout () const
+{
+
+	return mTimeout;
+
+}
+
+void JabberRequestThrottle::setTimeout ( int timeout )
+{
+
+	mTimeout = timeout;
+	scheduleExpiry ();
+
+}
+
+void JabberRequestThrottle::sent ( QObject *request )
+{
+
+	QTime sent;
+	sent.start ();
+	mInFlight.insert ( request, sent );
+	connect ( request, SIGNAL (destroyed(QObject*)), this, SLOT (slotRequestDestroyed(QObject*)) );
+
+	scheduleExpiry ();
+
+}
+
+bool JabberRequestThrottle::answered ( QObject *request, bool success )
+{
+
+	QHash<QObject*, QTime>::Iterator it = mInFlight.find ( request );
+	if ( it == mInFlight.end () )
+		return false;
+
+	int elapsed = it.value().elapsed ();
+	mInFlight.erase ( it );
+	request->disconnect ( this );
+
+	// smooth out single slow answers
+	mResponseTime = ( 7 * mResponseTime + elapsed ) / 8;
+
+	// back off while the server is slow or refuses us, speed up again when it recovers
+	if ( !success || mResponseTime > TARGET_RESPONSE_TIME )
+		backOff ();
+	else
+		mDelay = qMax ( mDelay / 2, MIN_DELAY );
+
+	scheduleExpiry ();
+	return true;
+
+}
+
+void JabberRequestThrottle::clear ()
+{
+
+	foreach ( QObject *request, mInFlight.keys () )
+		request->disconnect ( this );
+	mInFlight.clear ();
+
+	mExpiryTimer.stop ();
+	mResponseTime = TARGET_RESPONSE_TIME;
+	mDelay = MIN_DELAY;
+
+}
+
+void JabberRequestThrottle::backOff ()
+{
+
+	mDelay = qMin ( mDelay * 2, MAX_DELAY );
+
+}
+
+void JabberRequestThrottle::scheduleExpiry ()
+{
+
+	if ( mInFlight.isEmpty () )
+	{
+		mExpiryTimer.stop ();
+		return;
+	}
+
+	// the oldest request expires first
+	int oldest = 0;
+	foreach ( const QTime &sent, mInFlight )
+		oldest = qMax ( oldest, sent.elapsed () );
+
+	mExpiryTimer.start ( qMax ( mTimeout - oldest, 0 ) );
+
+}
+
+void JabberRequestThrottle::slotExpire ()
+{
+
+	QList<QObject*> timedOut;
+	for ( QHash<QObject*, QTime>::Iterator it = mInFlight.begin (); it != mInFlight.end (); )
+	{
+		if ( it.value().elapsed () >= mTimeout )
+		{
+			timedOut.append ( it.key () );
+			it.key()->disconnect ( this );
+			it = mInFlight.erase ( it );
+		}
+		else
+			++it;
+	}
+
+	// a server that drops requests is as overloaded as one that refuses them
+	if ( !timedOut.isEmpty () )
+		backOff ();
+
+	scheduleExpiry ();
+
+	foreach ( QObject *request, timedOut )
+		emit expired ( request );
+
+}
+
+void JabberRequestThrottle::slotRequestDestroyed ( QObject *request )
+{
+
+	mInFlight.remove ( request );
+	scheduleExpiry ();
+
+}
+
+#include "jabberrequestthrottle.moc"
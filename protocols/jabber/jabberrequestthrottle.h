@@ -0,0 +1,105 @@
+ /*
+  * jabberrequestthrottle.h
+  *
+  * Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+  *
+  * *************************************************************************
+  * *                                                                       *
+  * * This program is free software; you can redistribute it and/or modify  *
+  * * it under the terms of the GNU General Public License as published by  *
+  * * the Free Software Foundation; either version 2 of the License, or     *
+  * * (at your option) any later version.                                   *
+  * *                                                                       *
+  * *************************************************************************
+  */
+
+#ifndef JABBERREQUESTTHROTTLE_H
+#define JABBERREQUESTTHROTTLE_H
+
+#include <qobject.h>
+#include <QHash>
+#include <QTime>
+#include <QTimer>
+
+/**
+ * Flow control for a series of requests to the server.
+ *
+ * Only a few requests are on the wire at a time, and the gap between
+ * them follows the server's response times. A request the server does
+ * not answer within timeout() gives up its slot, so a server that drops
+ * requests does not stop the series.
+ */
+class JabberRequestThrottle : public QObject
+{
+
+Q_OBJECT
+
+public:
+	JabberRequestThrottle ( QObject *parent = 0 );
+	~JabberRequestThrottle ();
+
+	/**
+	 * True if another request may be sent.
+	 */
+	bool canSend () const;
+
+	/**
+	 * Gap before the next request, in ms.
+	 */
+	int delay () const;
+
+	/**
+	 * Number of requests waiting for an answer.
+	 */
+	int inFlight () const;
+
+	/**
+	 * Time a request may wait for its answer, in ms.
+	 */
+	int timeout () const;
+	void setTimeout ( int timeout );
+
+	/**
+	 * @p request was sent. It holds a slot until answered() is
+	 * called for it, it times out or it is destroyed.
+	 */
+	void sent ( QObject *request );
+
+	/**
+	 * The server answered @p request. Slow answers and errors stretch
+	 * the gap between requests, fast successful ones shrink it.
+	 * @return false if @p request was not waiting, e.g. it timed out
+	 */
+	bool answered ( QObject *request, bool success );
+
+	/**
+	 * Forget all requests and start over, e.g. after a disconnect.
+	 */
+	void clear ();
+
+signals:
+	/**
+	 * @p request timed out, its slot is free again.
+	 */
+	void expired ( QObject *request );
+
+private slots:
+	void slotExpire ();
+	void slotRequestDestroyed ( QObject *request );
+
+private:
+	void backOff ();
+	void scheduleExpiry ();
+
+	// requests on the wire and when they were sent
+	QHash<QObject*, QTime> mInFlight;
+
+	// smoothed response time and the resulting gap between requests, in ms
+	int mResponseTime;
+	int mDelay;
+	int mTimeout;
+
+	QTimer mExpiryTimer;
+};
+
+#endif
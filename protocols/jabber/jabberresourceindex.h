@@ -0,0 +1,192 @@
+ /*
+  * jabberresourceindex.h
+  *
+  * Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+  *
+  * *************************************************************************
+  * *                                                                       *
+  * * This program is free software; you can redistribute it and/or modify  *
+  * * it under the terms of the GNU General Public License as published by  *
+  * * the Free Software Foundation; either version 2 of the License, or     *
+  * * (at your option) any later version.                                   *
+  * *                                                                       *
+  * *************************************************************************
+  */
+
+#ifndef JABBERRESOURCEINDEX_H
+#define JABBERRESOURCEINDEX_H
+
+#include <QHash>
+#include <QLatin1Char>
+#include <QList>
+#include <QPair>
+#include <QSet>
+#include <im.h>
+
+/**
+ * Resources by bare JID and resource name, compared case-insensitively,
+ * with the best resource of each bare JID at hand.
+ *
+ * R needs jid() and resource() like JabberResource. The best resource
+ * has the highest priority, and of those the newest presence.
+ *
+ * Adding, updating and removing a resource take constant time, unless
+ * the best resource of its bare JID gets worse or goes away. Then the
+ * remaining resources of that bare JID are compared once.
+ */
+template <class R>
+class JabberResourceIndex
+{
+public:
+	void insert ( R *resource )
+	{
+		QString bareJid = key ( resource->jid () );
+		mPool[bareJid].insert ( resource );
+		mResources.insert ( key ( resource->jid (), resource->resource().name () ), resource );
+
+		Best &best = mBest[bareJid];
+		if ( !best.first || isBetter ( resource, best.first ) )
+			best = Best ( resource, resource->resource().priority () );
+	}
+
+	/**
+	 * @p resource got a new presence. Call it after every change of
+	 * its priority or timestamp.
+	 */
+	void update ( R *resource )
+	{
+		QString bareJid = key ( resource->jid () );
+		typename QHash<QString, Best>::Iterator best = mBest.find ( bareJid );
+		if ( best == mBest.end () )
+			return;
+
+		if ( best->first == resource )
+		{
+			// a newer presence at the same or a higher priority still wins
+			if ( resource->resource().priority () >= best->second )
+				best->second = resource->resource().priority ();
+			else
+				updateBest ( bareJid );
+		}
+		else if ( isBetter ( resource, best->first ) )
+			*best = Best ( resource, resource->resource().priority () );
+	}
+
+	void remove ( R *resource )
+	{
+		QString bareJid = key ( resource->jid () );
+
+		QString resourceKey = key ( resource->jid (), resource->resource().name () );
+		typename QHash<QString, R*>::Iterator it = mResources.find ( resourceKey );
+		if ( it != mResources.end () && it.value () == resource )
+			mResources.erase ( it );
+
+		typename QHash<QString, QSet<R*> >::Iterator pool = mPool.find ( bareJid );
+		if ( pool == mPool.end () || !pool->remove ( resource ) )
+			return;
+
+		if ( pool->isEmpty () )
+		{
+			mPool.erase ( pool );
+			mBest.remove ( bareJid );
+		}
+		else if ( mBest.value ( bareJid ).first == resource )
+			updateBest ( bareJid );
+	}
+
+	/**
+	 * Remove and return all resources of the bare JID of @p jid.
+	 */
+	QList<R*> take ( const XMPP::Jid &jid )
+	{
+		QString bareJid = key ( jid );
+		QList<R*> resources = mPool.take ( bareJid ).toList ();
+		mBest.remove ( bareJid );
+
+		foreach ( R *resource, resources )
+		{
+			QString resourceKey = key ( resource->jid (), resource->resource().name () );
+			if ( mResources.value ( resourceKey ) == resource )
+				mResources.remove ( resourceKey );
+		}
+
+		return resources;
+	}
+
+	/**
+	 * Remove and return all resources.
+	 */
+	QList<R*> takeAll ()
+	{
+		QList<R*> resources;
+		foreach ( const QSet<R*> &set, mPool )
+			resources += set.toList ();
+
+		mPool.clear ();
+		mResources.clear ();
+		mBest.clear ();
+
+		return resources;
+	}
+
+	R *find ( const XMPP::Jid &jid, const QString &resourceName ) const
+	{
+		return mResources.value ( key ( jid, resourceName ) );
+	}
+
+	/**
+	 * All resources of the bare JID of @p jid, in no particular order.
+	 */
+	QList<R*> resources ( const XMPP::Jid &jid ) const
+	{
+		return mPool.value ( key ( jid ) ).toList ();
+	}
+
+	R *best ( const XMPP::Jid &jid ) const
+	{
+		return mBest.value ( key ( jid ) ).first;
+	}
+
+	static QString key ( const XMPP::Jid &jid )
+	{
+		return jid.bare().toLower ();
+	}
+
+	static QString key ( const XMPP::Jid &jid, const QString &resourceName )
+	{
+		return key ( jid ) + QLatin1Char ( '/' ) + resourceName.toLower ();
+	}
+
+	static bool isBetter ( const R *resource, const R *than )
+	{
+		if ( resource->resource().priority () != than->resource().priority () )
+			return resource->resource().priority () > than->resource().priority ();
+
+		return resource->resource().status().timeStamp () > than->resource().status().timeStamp ();
+	}
+
+private:
+	// the best resource and its priority when it was chosen
+	typedef QPair<R*, int> Best;
+
+	void updateBest ( const QString &bareJid )
+	{
+		R *bestResource = 0L;
+		foreach ( R *resource, mPool.value ( bareJid ) )
+		{
+			if ( !bestResource || isBetter ( resource, bestResource ) )
+				bestResource = resource;
+		}
+
+		if ( bestResource )
+			mBest.insert ( bareJid, Best ( bestResource, bestResource->resource().priority () ) );
+		else
+			mBest.remove ( bareJid );
+	}
+
+	QHash<QString, QSet<R*> > mPool;
+	QHash<QString, R*> mResources;
+	QHash<QString, Best> mBest;
+};
+
+#endif
@@ -18,9 +18,13 @@
 
 #include "jabberresourcepool.h"
 
+#include <QHash>
+#include <QSet>
+
 #include <kdebug.h>
 
 #include "jabberresource.h"
+#include "jabberresourceindex.h"
 #include "jabbercontactpool.h"
 #include "jabberbasecontact.h"
 #include "jabberaccount.h"
@@ -40,16 +44,49 @@ public:
 	Private(JabberAccount *pAccount)
 	 : account(pAccount)
 	{}
-	
-	QList<JabberResource*> pool;
-	QList<JabberResource*> lockList;
+
+	/**
+	 * Resources by lowercase bare JID and resource name, with the
+	 * best resource per bare JID. Rooms put all occupants under one
+	 * bare JID, single occupants are looked up directly instead of
+	 * walking all resources of the room.
+	 */
+	JabberResourceIndex<JabberResource> index;
+
+	/**
+	 * Locked resource per lowercase bare JID.
+	 */
+	QHash<QString, JabberResource*> lockList;
 
 	/**
 	 * Pointer to the JabberAccount instance.
 	 */
 	JabberAccount *account;
+
+	static QString key ( const XMPP::Jid &jid )
+	{
+		return JabberResourceIndex<JabberResource>::key ( jid );
+	}
+
+	JabberResource *find ( const XMPP::Jid &jid, const QString &resourceName ) const
+	{
+		return index.find ( jid, resourceName );
+	}
+
+	void deleteResource ( JabberResource *resource );
 };
 
+void JabberResourcePool::Private::deleteResource ( JabberResource *resource )
+{
+	index.remove ( resource );
+
+	QString bareJid = key ( resource->jid () );
+	if ( lockList.value ( bareJid ) == resource )
+		lockList.remove ( bareJid );
+
+	delete resource;
+}
+
 JabberResourcePool::JabberResourcePool ( JabberAccount *account )
 	: d(new Private(account))
 {}
@@ -57,7 +94,7 @@ JabberResourcePool::JabberResourcePool ( JabberAccount *account )
 JabberResourcePool::~JabberResourcePool ()
 {
 	// Delete all resources in the pool upon removal
-	qDeleteAll(d->pool);
+	qDeleteAll(d->index.takeAll ());
 	delete d;
 }
 
@@ -68,7 +105,12 @@ void JabberResourcePool::slotResourceDestroyed (QObject *sender)
 	JabberResource *oldResource = static_cast<JabberResource *>(sender);
 
 	// remove this resource from the lock list if it existed
-	d->lockList.removeAll ( oldResource );
+	QMutableHashIterator<QString, JabberResource*> it ( d->lockList );
+	while ( it.hasNext () )
+	{
+		if ( it.next().value () == oldResource )
+			it.remove ();
+	}
 }
 
 void JabberResourcePool::slotResourceUpdated ( JabberResource *resource )
@@ -94,6 +136,11 @@ void JabberResourcePool::notifyRelevantContacts ( const XMPP::Jid &jid, bool rem
 
 	foreach(JabberBaseContact *mContact, list)
 	{
+		// contacts bound to another resource (e.g. other room occupants) are not affected
+		QString resource = mContact->rosterItem().jid().resource ();
+		if ( !jid.resource().isEmpty () && !resource.isEmpty () && resource.toLower () != jid.resource().toLower () )
+			continue;
+
 		if ( removed )
 			mContact->setSendsDeliveredEvent ( false );
 
@@ -104,23 +151,22 @@ void JabberResourcePool::notifyRelevantContacts ( const XMPP::Jid &jid, bool rem
 void JabberResourcePool::addResource ( const XMPP::Jid &jid, const XMPP::Resource &resource )
 {
 	// see if the resource already exists
-	foreach(JabberResource *mResource, d->pool)
+	JabberResource *mResource = d->find ( jid, resource.name () );
+	if ( mResource )
 	{
-		if ( (mResource->jid().bare().toLower() == jid.bare().toLower()) && (mResource->resource().name().toLower() == resource.name().toLower()) )
-		{
-			kDebug(JABBER_DEBUG_GLOBAL) << "Updating existing resource " << resource.name() << " for " << jid.bare();
+		kDebug(JABBER_DEBUG_GLOBAL) << "Updating existing resource " << resource.name() << " for " << jid.bare();
 
-			// It exists, update it. Don't do a "lazy" update by deleting
-			// it here and readding it with new parameters later on,
-			// any possible lockings to this resource will get lost.
-			mResource->setResource ( resource );
+		// It exists, update it. Don't do a "lazy" update by deleting
+		// it here and readding it with new parameters later on,
+		// any possible lockings to this resource will get lost.
+		mResource->setResource ( resource );
+		d->index.update ( mResource );
 
-			// we still need to notify the contact in case the status
-			// of this resource changed
-			notifyRelevantContacts ( jid );
+		// we still need to notify the contact in case the status
+		// of this resource changed
+		notifyRelevantContacts ( jid );
 
-			return;
-		}
+		return;
 	}
 
 	kDebug(JABBER_DEBUG_GLOBAL) << "Adding new resource " << resource.name() << " for " << jid.bare();
@@ -137,27 +183,64 @@ void JabberResourcePool::addResource ( const XMPP::Jid &jid, const XMPP::Resourc
 	JabberResource *newResource = new JabberResource(d->account, jid, resource);
 	connect ( newResource, SIGNAL (destroyed(QObject*)), this, SLOT (slotResourceDestroyed(QObject*)) );
 	connect ( newResource, SIGNAL (updated(JabberResource*)), this, SLOT (slotResourceUpdated(JabberResource*)) );
-	d->pool.append ( newResource );
+	d->index.insert ( newResource );
 
 	// send notifications out to the relevant contacts that
 	// a new resource is available for them
 	notifyRelevantContacts ( jid );
 }
 
+void JabberResourcePool::addResources ( const XMPP::Jid &jid, const XMPP::ResourceList &resources )
+{
+	kDebug(JABBER_DEBUG_GLOBAL) << "Adding or updating " << resources.count () << " resources for " << jid.bare();
+
+	QSet<QString> names;
+
+	for ( XMPP::ResourceList::ConstIterator it = resources.begin (); it != resources.end (); ++it )
+	{
+		const XMPP::Resource &resource = *it;
+		XMPP::Jid resourceJid = jid.withResource ( resource.name () );
+
+		names.insert ( resource.name().toLower () );
+
+		JabberResource *mResource = d->find ( jid, resource.name () );
+		if ( mResource )
+		{
+			mResource->setResource ( resource );
+			d->index.update ( mResource );
+			continue;
+		}
+
+		if( !resource.status().capsNode().isEmpty() )
+			d->account->protocol()->capabilitiesManager()->updateCapabilities( d->account, resourceJid, resource.status() );
+
+		JabberResource *newResource = new JabberResource(d->account, resourceJid, resource);
+		connect ( newResource, SIGNAL (destroyed(QObject*)), this, SLOT (slotResourceDestroyed(QObject*)) );
+		connect ( newResource, SIGNAL (updated(JabberResource*)), this, SLOT (slotResourceUpdated(JabberResource*)) );
+		d->index.insert ( newResource );
+	}
+
+	// notify the contacts without a resource and the ones bound
+	// to one of the new resources, once
+	foreach(JabberBaseContact *mContact, d->account->contactPool()->findRelevantSources ( jid ))
+	{
+		QString resource = mContact->rosterItem().jid().resource ();
+		if ( resource.isEmpty () || names.contains ( resource.toLower () ) )
+			mContact->reevaluateStatus ();
+	}
+}
+
 void JabberResourcePool::removeResource ( const XMPP::Jid &jid, const XMPP::Resource &resource )
 {
 	kDebug(JABBER_DEBUG_GLOBAL) << "Removing resource " << resource.name() << " from " << jid.bare();
 
-	foreach(JabberResource *mResource, d->pool)
+	JabberResource *mResource = d->find ( jid, resource.name () );
+	if ( mResource )
 	{
-		if ( (mResource->jid().bare().toLower() == jid.bare().toLower()) && (mResource->resource().name().toLower() == resource.name().toLower()) )
-		{
-			JabberResource *deletedResource = d->pool.takeAt( d->pool.indexOf(mResource) );
-			delete deletedResource;
+		d->deleteResource ( mResource );
 
-			notifyRelevantContacts ( jid, true );
-			return;
-		}
+		notifyRelevantContacts ( jid, true );
+		return;
 	}
 
 	kDebug(JABBER_DEBUG_GLOBAL) << "WARNING: No match found!";
@@ -167,19 +250,22 @@ void JabberResourcePool::removeAllResources ( const XMPP::Jid &jid )
 {
 	kDebug(JABBER_DEBUG_GLOBAL) << "Removing all resources for " << jid.bare();
 
-	foreach(JabberResource *mResource, d->pool)
+	// only remove preselected resource in case there is one
+	if ( !jid.resource().isEmpty () )
 	{
-		if ( mResource->jid().bare().toLower() == jid.bare().toLower() )
+		JabberResource *mResource = d->find ( jid, jid.resource () );
+		if ( mResource )
 		{
-			// only remove preselected resource in case there is one
-			if ( jid.resource().isEmpty () || ( jid.resource().toLower () == mResource->resource().name().toLower () ) )
-			{
-				kDebug(JABBER_DEBUG_GLOBAL) << "Removing resource " << jid.bare() << "/" << mResource->resource().name ();
-				JabberResource *deletedResource = d->pool.takeAt( d->pool.indexOf(mResource) );
-				delete deletedResource;
-			}
+			kDebug(JABBER_DEBUG_GLOBAL) << "Removing resource " << jid.bare() << "/" << mResource->resource().name ();
+			d->deleteResource ( mResource );
 		}
+		return;
 	}
+
+	// take them all at once, removing them one by one would look
+	// for a new best resource after each of them
+	d->lockList.remove ( Private::key ( jid ) );
+	qDeleteAll ( d->index.take ( jid ) );
 }
 
 void JabberResourcePool::clear ()
@@ -190,30 +276,34 @@ void JabberResourcePool::clear ()
 	 * Since many contacts can have multiple resources, we can't simply delete
 	 * each resource and trigger a notification upon each deletion. This would
 	 * cause lots of status updates in the GUI and create unnecessary flicker
-	 * and API traffic. Instead, collect all JIDs, clear the dictionary
-	 * and then notify all JIDs after the resources have been deleted.
+	 * and API traffic. Instead, collect all bare JIDs, clear the dictionary
+	 * and then notify each bare JID once after the resources have been deleted.
 	 */
 
-	QStringList jidList;
-
-	foreach(JabberResource *mResource, d->pool)
-	{
-		jidList += mResource->jid().full ();
-	}
+	QList<XMPP::Jid> jidList;
+	QSet<QString> bareJids;
 
 	/*
 	 * The lock list will be cleaned automatically.
 	 */
-	qDeleteAll(d->pool);
-	d->pool.clear ();
+	QList<JabberResource*> resources = d->index.takeAll ();
+	foreach(JabberResource *mResource, resources)
+	{
+		if ( !bareJids.contains ( Private::key ( mResource->jid () ) ) )
+		{
+			bareJids.insert ( Private::key ( mResource->jid () ) );
+			jidList += mResource->jid().bare ();
+		}
+	}
+	qDeleteAll(resources);
 
 	/*
 	 * Now go through the list of JIDs and notify each contact
 	 * of its status change
 	 */
-	for ( QStringList::Iterator it = jidList.begin (); it != jidList.end (); ++it )
+	foreach(const XMPP::Jid &jid, jidList)
 	{
-		notifyRelevantContacts ( XMPP::Jid ( *it ), true );
+		notifyRelevantContacts ( jid, true );
 	}
 
 }
@@ -226,13 +316,11 @@ void JabberResourcePool::lockToResource ( const XMPP::Jid &jid, const XMPP::Reso
 	removeLock ( jid );
 
 	// find the resource in our dictionary that matches
-	foreach(JabberResource *mResource, d->pool)
+	JabberResource *mResource = d->find ( jid, resource.name () );
+	if ( mResource )
 	{
-		if ( (mResource->jid().bare().toLower() == jid.bare().toLower()) && (mResource->resource().name().toLower() == resource.name().toLower()) )
-		{
-			d->lockList.append ( mResource );
-			return;
-		}
+		d->lockList.insert ( Private::key ( jid ), mResource );
+		return;
 	}
 
 	kDebug(JABBER_DEBUG_GLOBAL) << "WARNING: No match found!";
@@ -242,16 +330,8 @@ void JabberResourcePool::removeLock ( const XMPP::Jid &jid )
 {
 	kDebug(JABBER_DEBUG_GLOBAL) << "Removing resource lock for " << jid.bare();
 
-	// find the resource in our dictionary that matches
-	foreach(JabberResource *mResource, d->pool)
-	{
-		if ( (mResource->jid().bare().toLower() == jid.bare().toLower()) )
-		{
-			d->lockList.removeAll (mResource);
-		}
-	}
-
-	kDebug(JABBER_DEBUG_GLOBAL) << "No locks found.";
+	if ( !d->lockList.remove ( Private::key ( jid ) ) )
+		kDebug(JABBER_DEBUG_GLOBAL) << "No locks found.";
 }
 
 JabberResource *JabberResourcePool::lockedJabberResource( const XMPP::Jid &jid )
@@ -260,13 +340,9 @@ JabberResource *JabberResourcePool::lockedJabberResource( const XMPP::Jid &jid )
 	if ( !jid.resource().isEmpty () )
 	{
 		// we are subscribed to a JID, find the according resource in the pool
-		foreach(JabberResource *mResource, d->pool)
-		{
-			if ( ( mResource->jid().bare().toLower () == jid.bare().toLower () ) && ( mResource->resource().name () == jid.resource () ) )
-			{
-				return mResource;
-			}
-		}
+		JabberResource *mResource = d->find ( jid, jid.resource () );
+		if ( mResource && mResource->resource().name () == jid.resource () )
+			return mResource;
 
 		kDebug ( JABBER_DEBUG_GLOBAL ) << "WARNING: No resource found in pool, returning as offline.";
 
@@ -274,13 +350,11 @@ JabberResource *JabberResourcePool::lockedJabberResource( const XMPP::Jid &jid )
 	}
 
 	// see if we have a locked resource
-	foreach(JabberResource *mResource, d->lockList)
+	JabberResource *mResource = d->lockList.value ( Private::key ( jid ) );
+	if ( mResource )
 	{
-		if ( mResource->jid().bare().toLower() == jid.bare().toLower() )
-		{
-			kDebug (JABBER_DEBUG_GLOBAL) << "Current lock for " << jid.bare() << " is '" << mResource->resource().name () << "'";
-			return mResource;
-		}
+		kDebug (JABBER_DEBUG_GLOBAL) << "Current lock for " << jid.bare() << " is '" << mResource->resource().name () << "'";
+		return mResource;
 	}
 
 	kDebug (JABBER_DEBUG_GLOBAL) << "No lock available for " << jid.bare();
@@ -310,49 +384,8 @@ JabberResource *JabberResourcePool::bestJabberResource( const XMPP::Jid &jid, bo
 		}
 	}
 
-	JabberResource *bestResource = 0L;
-	JabberResource *currentResource = 0L;
-
-	foreach(currentResource, d->pool)
-	{
-		// make sure we are only looking up resources for the specified JID
-		if ( currentResource->jid().bare().toLower() != jid.bare().toLower() )
-		{
-			continue;
-		}
-
-		// take first resource if no resource has been chosen yet
-		if(!bestResource)
-		{
-			kDebug(JABBER_DEBUG_GLOBAL) << "Taking '" << currentResource->resource().name () << "' as first available resource.";
-
-			bestResource = currentResource;
-			continue;
-		}
-
-		if(currentResource->resource().priority() > bestResource->resource().priority())
-		{
-			kDebug(JABBER_DEBUG_GLOBAL) << "Using '" << currentResource->resource().name () << "' due to better priority.";
-
-			// got a better match by priority
-			bestResource = currentResource;
-		}
-		else
-		{
-			if(currentResource->resource().priority() == bestResource->resource().priority())
-			{
-				if(currentResource->resource().status().timeStamp() > bestResource->resource().status().timeStamp())
-				{
-					kDebug(JABBER_DEBUG_GLOBAL) << "Using '" << currentResource->resource().name () << "' due to better timestamp.";
-
-					// got a better match by timestamp (priorities are equal)
-					bestResource = currentResource;
-				}
-			}
-		}
-	}
-
-	return (bestResource) ? bestResource : 0L;
+	// kept up to date by addResource() and the removal methods
+	return d->index.best ( jid );
 }
 
 const XMPP::Resource &JabberResourcePool::bestResource ( const XMPP::Jid &jid, bool honourLock )
@@ -364,35 +397,29 @@ const XMPP::Resource &JabberResourcePool::bestResource ( const XMPP::Jid &jid, b
 //TODO: Find Resources based on certain Features.
 void JabberResourcePool::findResources ( const XMPP::Jid &jid, JabberResourcePool::ResourceList &resourceList )
 {
-	foreach(JabberResource *mResource, d->pool)
+	foreach(JabberResource *mResource, d->index.resources ( jid ))
 	{
-		if ( mResource->jid().bare().toLower() == jid.bare().toLower() )
-		{
-			// we found a resource for the JID, let's see if the JID already contains a resource
-			if ( !jid.resource().isEmpty() && ( jid.resource().toLower() != mResource->resource().name().toLower() ) )
-				// the JID contains a resource but it's not the one we have in the dictionary,
-				// thus we have to ignore this resource
-				continue;
+		// we found a resource for the JID, let's see if the JID already contains a resource
+		if ( !jid.resource().isEmpty() && ( jid.resource().toLower() != mResource->resource().name().toLower() ) )
+			// the JID contains a resource but it's not the one we have in the dictionary,
+			// thus we have to ignore this resource
+			continue;
 
-			resourceList.append ( mResource );
-		}
+		resourceList.append ( mResource );
 	}
 }
 
 void JabberResourcePool::findResources ( const XMPP::Jid &jid, XMPP::ResourceList &resourceList )
 {
-	foreach(JabberResource *mResource, d->pool)
+	foreach(JabberResource *mResource, d->index.resources ( jid ))
 	{
-		if ( mResource->jid().bare().toLower() == jid.bare().toLower() )
-		{
-			// we found a resource for the JID, let's see if the JID already contains a resource
-			if ( !jid.resource().isEmpty() && ( jid.resource().toLower() != mResource->resource().name().toLower() ) )
-				// the JID contains a resource but it's not the one we have in the dictionary,
-				// thus we have to ignore this resource
-				continue;
+		// we found a resource for the JID, let's see if the JID already contains a resource
+		if ( !jid.resource().isEmpty() && ( jid.resource().toLower() != mResource->resource().name().toLower() ) )
+			// the JID contains a resource but it's not the one we have in the dictionary,
+			// thus we have to ignore this resource
+			continue;
 
-			resourceList.append ( mResource->resource () );
-		}
+		resourceList.append ( mResource->resource () );
 	}
 }
 
@@ -401,9 +428,9 @@ JabberResource *JabberResourcePool::getJabberResource ( const XMPP::Jid &jid, co
 	if ( resource.isEmpty() )
 		return bestJabberResource(jid);
 
-	foreach(JabberResource *mResource, d->pool)
+	if ( jid.resource().toLower() == resource )
 	{
-		if ( mResource->jid().bare().toLower() == jid.bare().toLower() && jid.resource().toLower() == resource )
+		foreach(JabberResource *mResource, d->index.resources ( jid ))
 		{
 			// we found a resource for the JID, let's see if the JID already contains a resource
 			if ( !jid.resource().isEmpty() && ( jid.resource().toLower() != mResource->resource().name().toLower() ) )
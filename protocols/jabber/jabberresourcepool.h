@@ -59,6 +59,13 @@ public:
 	 */
 	void addResource ( const XMPP::Jid &jid, const XMPP::Resource &resource );
 
+	/**
+	 * Add or update several resources of the same bare JID, e.g. the
+	 * occupants of a room. The best resource is determined and the
+	 * relevant contacts are notified only once for all of them.
+	 */
+	void addResources ( const XMPP::Jid &jid, const XMPP::ResourceList &resources );
+
 	/**
 	 * Remove a resource from the pool
 	 */
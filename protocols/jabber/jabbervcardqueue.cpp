@@ -0,0 +1,235 @@
+ /*
+  * jabbervcardqueue.cpp
+  *
+  * Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+  *
+  * *************************************************************************
+  * *                                                                       *
+  * * This program is free software; you can redistribute it and/or modify  *
+  * * it under the terms of the GNU General Public License as published by  *
+  * * the Free Software Foundation; either version 2 of the License, or     *
+  * * (at your option) any later version.                                   *
+  * *                                                                       *
+  * *************************************************************************
+  */
+
+#include "jabbervcardqueue.h"
+
+#include <kdebug.h>
+
+#include <xmpp_tasks.h>
+
+#include "kopetechatsession.h"
+#include "kopeteonlinestatus.h"
+
+#include "jabberaccount.h"
+#include "jabberclient.h"
+#include "jabbercontact.h"
+#include "jabberprotocol.h"
+
+/**
+ * Delay (ms) before contacts created while online check their vCard.
+ */
+static const int CHECK_DELAY = 1000;
+
+JabberVCardQueue::JabberVCardQueue ( JabberAccount *account )
+	: QObject ( account ), mAccount ( account )
+{
+
+	connect ( &mThrottle, SIGNAL (expired(QObject*)), this, SLOT (slotTaskExpired(QObject*)) );
+
+	mDispatchTimer.setSingleShot ( true );
+	connect ( &mDispatchTimer, SIGNAL (timeout()), this, SLOT (slotDispatch()) );
+
+	mCheckTimer.setSingleShot ( true );
+	connect ( &mCheckTimer, SIGNAL (timeout()), this, SLOT (slotCheck()) );
+
+}
+
+JabberVCardQueue::~JabberVCardQueue ()
+{
+}
+
+JabberVCardQueue::Priority JabberVCardQueue::priorityFor ( JabberContact *contact ) const
+{
+
+	if ( contact->manager ( Kopete::Contact::CannotCreate ) )
+		return High;
+
+	if ( contact->onlineStatus().isDefinitelyOnline () )
+		return Normal;
+
+	return Low;
+
+}
+
+void JabberVCardQueue::enqueue ( JabberContact *contact )
+{
+
+	Priority priority = priorityFor ( contact );
+
+	QHash<JabberContact*, Priority>::Iterator it = mQueued.find ( contact );
+	if ( it != mQueued.end () )
+	{
+		if ( priority <= it.value () )
+			return;
+
+		// move it forward, the old entry becomes stale
+		it.value () = priority;
+	}
+	else
+	{
+		mQueued.insert ( contact, priority );
+		connect ( contact, SIGNAL (contactDestroyed(Kopete::Contact*)), this, SLOT (slotContactDestroyed(Kopete::Contact*)) );
+		if ( priority < Normal )
+			connect ( contact, SIGNAL (onlineStatusChanged(Kopete::Contact*,Kopete::OnlineStatus,Kopete::OnlineStatus)),
+					  this, SLOT (slotContactStatusChanged(Kopete::Contact*,Kopete::OnlineStatus,Kopete::OnlineStatus)) );
+	}
+
+	mQueues[priority].append ( contact );
+
+	schedule ();
+
+}
+
+void JabberVCardQueue::check ( JabberContact *contact )
+{
+
+	mChecks.append ( contact );
+
+	if ( !mCheckTimer.isActive () )
+		mCheckTimer.start ( CHECK_DELAY );
+
+}
+
+void JabberVCardQueue::slotCheck ()
+{
+
+	QList< QPointer<JabberContact> > checks = mChecks;
+	mChecks.clear ();
+
+	foreach ( const QPointer<JabberContact> &contact, checks )
+	{
+		// queues the request only if the cached vCard is out of date
+		if ( contact )
+			QMetaObject::invokeMethod ( contact, "slotCheckVCard" );
+	}
+
+}
+
+void JabberVCardQueue::clear ()
+{
+
+	foreach ( JabberContact *contact, mQueued.keys () )
+		contact->disconnect ( this );
+
+	for ( int i = Low; i <= High; i++ )
+		mQueues[i].clear ();
+	mQueued.clear ();
+	mChecks.clear ();
+	mCheckTimer.stop ();
+
+	// the tasks die with the client, don't wait for them
+	mThrottle.clear ();
+
+	mDispatchTimer.stop ();
+
+}
+
+int JabberVCardQueue::count () const
+{
+
+	return mQueued.count ();
+
+}
+
+void JabberVCardQueue::schedule ()
+{
+
+	if ( !mDispatchTimer.isActive () && !mQueued.isEmpty () && mThrottle.canSend () )
+		mDispatchTimer.start ( mThrottle.delay () );
+
+}
+
+void JabberVCardQueue::slotDispatch ()
+{
+
+	if ( !mAccount->isConnected () )
+	{
+		clear ();
+		return;
+	}
+
+	// send one request per tick, highest priority first
+	for ( int i = High; i >= Low; i-- )
+	{
+		while ( !mQueues[i].isEmpty () )
+		{
+			QPointer<JabberContact> contact = mQueues[i].takeFirst ();
+
+			// gone, or moved to a higher queue
+			if ( !contact || mQueued.value ( contact, Priority ( -1 ) ) != i )
+				continue;
+
+			mQueued.remove ( contact );
+			contact->disconnect ( this );
+
+			kDebug ( JABBER_DEBUG_GLOBAL ) << "Requesting vCard for " << contact->contactId () << ", " << mQueued.count () << " left";
+
+			XMPP::JT_VCard *task = new XMPP::JT_VCard ( mAccount->client()->rootTask () );
+			// signal the contact first, it reads the result from the task
+			QObject::connect ( task, SIGNAL (finished()), contact, SLOT (slotGotVCard()) );
+			QObject::connect ( task, SIGNAL (finished()), this, SLOT (slotTaskFinished()) );
+			task->get ( contact->rosterItem().jid () );
+			task->go ( true );
+
+			mThrottle.sent ( task );
+
+			schedule ();
+			return;
+		}
+	}
+
+}
+
+void JabberVCardQueue::slotTaskFinished ()
+{
+
+	XMPP::JT_VCard *task = static_cast<XMPP::JT_VCard *> ( sender () );
+
+	// late answers to expired requests were already accounted for
+	if ( !mThrottle.answered ( task, task->success () ) )
+		return;
+
+	schedule ();
+
+}
+
+void JabberVCardQueue::slotTaskExpired ( QObject *task )
+{
+
+	// the contact still gets the answer if it turns up, but it no longer holds a slot
+	kDebug ( JABBER_DEBUG_GLOBAL ) << "vCard request " << static_cast<XMPP::JT_VCard *> ( task )->jid().full () << " timed out, slowing down to " << mThrottle.delay () << " ms";
+
+	schedule ();
+
+}
+
+void JabberVCardQueue::slotContactStatusChanged ( Kopete::Contact *contact, const Kopete::OnlineStatus &newStatus, const Kopete::OnlineStatus & )
+{
+
+	// contacts coming online become visible, fetch them first
+	if ( newStatus.isDefinitelyOnline () )
+		enqueue ( static_cast<JabberContact *> ( contact ) );
+
+}
+
+void JabberVCardQueue::slotContactDestroyed ( Kopete::Contact *contact )
+{
+
+	// the QPointer in the queue clears itself
+	mQueued.remove ( static_cast<JabberContact *> ( contact ) );
+
+}
+
+#include "jabbervcardqueue.moc"
@@ -0,0 +1,106 @@
+ /*
+  * jabbervcardqueue.h
+  *
+  * Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+  *
+  * *************************************************************************
+  * *                                                                       *
+  * * This program is free software; you can redistribute it and/or modify  *
+  * * it under the terms of the GNU General Public License as published by  *
+  * * the Free Software Foundation; either version 2 of the License, or     *
+  * * (at your option) any later version.                                   *
+  * *                                                                       *
+  * *************************************************************************
+  */
+
+#ifndef JABBERVCARDQUEUE_H
+#define JABBERVCARDQUEUE_H
+
+#include <qobject.h>
+#include <QHash>
+#include <QList>
+#include <QPointer>
+#include <QTimer>
+
+#include "jabberrequestthrottle.h"
+
+namespace Kopete { class Contact; class OnlineStatus; }
+namespace XMPP { class JT_VCard; }
+class JabberAccount;
+class JabberContact;
+
+/**
+ * Account-wide queue for vCard (and with it, avatar) requests.
+ *
+ * Contacts are queued at most once. Contacts with an open chat go first,
+ * then online contacts (the ones visible in the contact list by default),
+ * then the rest. JabberRequestThrottle decides when the next request
+ * is sent.
+ */
+class JabberVCardQueue : public QObject
+{
+
+Q_OBJECT
+
+public:
+	enum Priority { Low = 0, Normal = 1, High = 2 };
+
+	JabberVCardQueue ( JabberAccount *account );
+	~JabberVCardQueue ();
+
+	/**
+	 * Queue a vCard request for @p contact. If the contact is already
+	 * queued it keeps its place, unless it now has a higher priority.
+	 * JabberContact::slotGotVCard() is called with the result.
+	 */
+	void enqueue ( JabberContact *contact );
+
+	/**
+	 * Check the cached vCard of @p contact a little later and queue a
+	 * request if it is out of date. Used for contacts that are created
+	 * while we are online, their properties are not set up yet. All
+	 * checks share one timer.
+	 */
+	void check ( JabberContact *contact );
+
+	/**
+	 * Drop all queued and pending requests, e.g. after a disconnect.
+	 */
+	void clear ();
+
+	/**
+	 * Number of contacts waiting for their request to be sent.
+	 */
+	int count () const;
+
+private slots:
+	void slotDispatch ();
+	void slotCheck ();
+	void slotTaskFinished ();
+	void slotTaskExpired ( QObject *task );
+	void slotContactStatusChanged ( Kopete::Contact *contact, const Kopete::OnlineStatus &newStatus, const Kopete::OnlineStatus &oldStatus );
+	void slotContactDestroyed ( Kopete::Contact *contact );
+
+private:
+	Priority priorityFor ( JabberContact *contact ) const;
+	void schedule ();
+
+	JabberAccount *mAccount;
+
+	/*
+	 * One FIFO per priority. Raising a contact's priority appends it to
+	 * the higher list and leaves a stale entry behind, which is skipped
+	 * because mQueued no longer matches that list.
+	 */
+	QList< QPointer<JabberContact> > mQueues[High + 1];
+	QHash<JabberContact*, Priority> mQueued;
+
+	JabberRequestThrottle mThrottle;
+	QTimer mDispatchTimer;
+
+	// contacts waiting for slotCheck()
+	QList< QPointer<JabberContact> > mChecks;
+	QTimer mCheckTimer;
+};
+
+#endif
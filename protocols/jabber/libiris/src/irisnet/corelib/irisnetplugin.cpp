@@ -81,4 +81,9 @@ void NameProvider::resolve_localError(int id, XMPP::NameResolver::Error e)
 	Q_UNUSED(e);
 }
 
+XMPP::NameCacheStats NameProvider::cacheStats() const
+{
+	return XMPP::NameCacheStats();
+}
+
 }
@@ -113,6 +113,9 @@ public:
 	virtual void resolve_localResultsReady(int id, const QList<XMPP::NameRecord> &results);
 	virtual void resolve_localError(int id, XMPP::NameResolver::Error e);
 
+	// providers with a response cache report on it here
+	virtual XMPP::NameCacheStats cacheStats() const;
+
 signals:
 	void resolve_resultsReady(int id, const QList<XMPP::NameRecord> &results);
 	void resolve_error(int id, XMPP::NameResolver::Error e);
@@ -38,6 +38,19 @@
 
 namespace XMPP {
 
+//----------------------------------------------------------------------------
+// NameCacheStats
+//----------------------------------------------------------------------------
+NameCacheStats::NameCacheStats() :
+	count(0),
+	maximum(0),
+	hits(0),
+	misses(0),
+	evictions(0),
+	expirations(0)
+{
+}
+
 //----------------------------------------------------------------------------
 // NameRecord
 //----------------------------------------------------------------------------
@@ -753,6 +766,28 @@ public:
 		res_instances.insert(np->id, np);
 	}
 
+	NameCacheStats cacheStats()
+	{
+		QMutexLocker locker(nman_mutex());
+
+		NameCacheStats out;
+		NameProvider *providers[] = { p_net, p_local };
+		for(int n = 0; n < 2; ++n)
+		{
+			if(!providers[n])
+				continue;
+
+			NameCacheStats stats = providers[n]->cacheStats();
+			out.count += stats.count;
+			out.maximum += stats.maximum;
+			out.hits += stats.hits;
+			out.misses += stats.misses;
+			out.evictions += stats.evictions;
+			out.expirations += stats.expirations;
+		}
+		return out;
+	}
+
 	void resolve_stop(NameResolver::Private *np)
 	{
 		// FIXME: stop sub instances?
@@ -1464,6 +1499,11 @@ QString NetNames::diagnosticText()
 	return QString();
 }
 
+NameCacheStats NetNames::cacheStats()
+{
+	return NameManager::instance()->cacheStats();
+}
+
 QByteArray NetNames::idnaFromString(const QString &in)
 {
 	// TODO
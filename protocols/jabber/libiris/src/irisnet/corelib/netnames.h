@@ -33,6 +33,24 @@ namespace XMPP {
 
 class NameManager;
 
+/**
+   \brief Statistics of the DNS response cache
+
+   \sa NetNames::cacheStats()
+*/
+class IRISNET_EXPORT NameCacheStats
+{
+public:
+	int count;       //!< Records currently cached
+	int maximum;     //!< Bound on the number of cached records
+	int hits;        //!< Lookups answered from the cache
+	int misses;      //!< Lookups that went to the network
+	int evictions;   //!< Records dropped to stay within the bound
+	int expirations; //!< Records dropped because their TTL ran out
+
+	NameCacheStats();
+};
+
 class IRISNET_EXPORT NetNames
 {
 public:
@@ -42,6 +60,9 @@ public:
 	// return current diagnostic text, clear the buffer.
 	static QString diagnosticText();
 
+	// statistics of the response cache of the name providers in use.
+	static NameCacheStats cacheStats();
+
 	// convert idn names
 	static QByteArray idnaFromString(const QString &in);
 	static QString idnaToString(const QByteArray &in);
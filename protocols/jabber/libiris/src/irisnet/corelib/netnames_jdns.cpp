@@ -547,6 +547,24 @@ public:
 		emit resolve_error(id, error);
 	}
 
+	virtual NameCacheStats cacheStats() const
+	{
+		QJDnsShared *shared = (mode == Internet) ? global->uni_net : global->uni_local;
+
+		NameCacheStats out;
+		if(!shared)
+			return out;
+
+		QJDns::CacheStats stats = shared->cacheStats();
+		out.count = stats.count;
+		out.maximum = stats.max;
+		out.hits = stats.hits;
+		out.misses = stats.misses;
+		out.evictions = stats.evictions;
+		out.expirations = stats.expirations;
+		return out;
+	}
+
 	virtual bool supportsSingle() const
 	{
 		return true;
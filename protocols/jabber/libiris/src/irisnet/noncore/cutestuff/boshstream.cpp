@@ -0,0 +1,597 @@
+/*
+ * boshstream.cpp - XMPP over BOSH (XEP-0124/XEP-0206)
+ * Copyright (C) 2010  Kopete Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include "boshstream.h"
+
+#include <QUrl>
+#include <QHash>
+#include <QMap>
+#include <QTimer>
+#include <QPointer>
+#include <QRegExp>
+#include <QDomDocument>
+#include <QNetworkAccessManager>
+#include <QNetworkProxy>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QtCrypto>
+
+//#define BOSH_DEBUG
+
+#ifdef BOSH_DEBUG
+# include <QDebug>
+# define BOSHDEBUG (qDebug() << this << "#" << __FUNCTION__ << ":")
+#endif
+
+#define BOSH_NS "http://jabber.org/protocol/httpbind"
+#define XBOSH_NS "urn:xmpp:xbosh"
+
+// times a request is sent again after the connection broke
+#define MAX_RETRIES 3
+// seconds past the wait time before a request counts as stuck
+#define REQUEST_TIMEOUT_MARGIN 5
+
+// CS_NAMESPACE_BEGIN
+
+static QByteArray escape(const QString &s)
+{
+	QString e = s;
+	e.replace('&', "&amp;");
+	e.replace('<', "&lt;");
+	e.replace('>', "&gt;");
+	e.replace('\'', "&apos;");
+	e.replace('"', "&quot;");
+	return e.toUtf8();
+}
+
+/* attribute value from the start tag in 'tag' */
+static QString tagAttribute(const QByteArray &tag, const QString &name)
+{
+	QRegExp rx(QString("\\s") + QRegExp::escape(name) + "\\s*=\\s*(['\"])([^'\"]*)\\1");
+	if(rx.indexIn(QString::fromUtf8(tag)) == -1)
+		return QString();
+	return rx.cap(2);
+}
+
+class BoshStream::Private
+{
+public:
+	Private(BoshStream *q) :
+		nam(q)
+	{
+	}
+
+	enum State { Idle, Creating, Connected, Closing };
+
+	/*! A request until its response was processed */
+	struct Request
+	{
+		QByteArray data;
+		int written; //!< Bytes of the stream it carries
+		int retries;
+	};
+
+	QNetworkAccessManager nam;
+	QUrl url;
+	QString domain;
+	QString lang;
+	int hold;
+	int wait;
+
+	State state;
+	QString sid;
+	QString authid;
+	QString from;
+	int requests; //!< Requests allowed on the wire, set by the connection manager
+
+	qint64 rid; //!< Request id for the next request
+	qint64 processRid; //!< Request id of the next response to process
+	qint64 terminateRid; //!< Request id of our terminate request, 0 if none
+
+	QMap<qint64, Request> sent; //!< Requests whose response was not processed yet
+	QHash<QNetworkReply*, qint64> replies; //!< Requests on the wire
+	QMap<qint64, QByteArray> responses; //!< Responses that overtook an earlier one
+
+	QByteArray out; //!< Stanzas for the next request
+	int outWritten; //!< Bytes of the stream behind out
+	bool headerSeen; //!< User has written its stream header
+	bool restart; //!< User restarted the stream
+	bool terminate; //!< User closed the stream
+	QByteArray early; //!< Data that arrived before the user's stream header
+
+	QTimer sendTimer; //!< Collects the writes of one event loop pass into a request
+
+	QByteArray streamHeader() const
+	{
+		QByteArray h = "<?xml version=\"1.0\"?><stream:stream xmlns=\"jabber:client\" "
+			"xmlns:stream=\"http://etherx.jabber.org/streams\" version=\"1.0\"";
+		h += " from=\"" + escape(from.isEmpty() ? domain : from) + '"';
+		h += " id=\"" + escape(authid.isEmpty() ? sid : authid) + '"';
+		if(!lang.isEmpty())
+			h += " xml:lang=\"" + escape(lang) + '"';
+		h += '>';
+		return h;
+	}
+};
+
+BoshStream::BoshStream(QObject *parent)
+:ByteStream(parent)
+{
+	d = new Private(this);
+	d->hold = 1;
+	d->wait = 60;
+
+	d->sendTimer.setSingleShot(true);
+	connect(&d->sendTimer, SIGNAL(timeout()), SLOT(do_send()));
+
+	resetConnection(true);
+}
+
+BoshStream::~BoshStream()
+{
+	resetConnection(true);
+	delete d;
+}
+
+void BoshStream::resetConnection(bool clear)
+{
+	foreach(QNetworkReply *reply, d->replies.keys()) {
+		reply->disconnect(this);
+		reply->abort();
+		reply->deleteLater();
+	}
+	d->replies.clear();
+	d->sent.clear();
+	d->responses.clear();
+
+	if(clear)
+		clearReadBuffer();
+	clearWriteBuffer();
+
+	d->state = Private::Idle;
+	d->sid.clear();
+	d->authid.clear();
+	d->from.clear();
+	d->lang.clear();
+	d->requests = 1;
+	d->rid = 0;
+	d->processRid = 0;
+	d->terminateRid = 0;
+	d->out.clear();
+	d->outWritten = 0;
+	d->headerSeen = false;
+	d->restart = false;
+	d->terminate = false;
+	d->early.clear();
+	d->sendTimer.stop();
+	setOpenMode(QIODevice::NotOpen);
+}
+
+void BoshStream::setProxy(const QString &host, int port, const QString &user, const QString &pass)
+{
+	d->nam.setProxy(QNetworkProxy(QNetworkProxy::HttpProxy, host, port, user, pass));
+}
+
+int BoshStream::hold() const
+{
+	return d->hold;
+}
+
+void BoshStream::setHold(int hold)
+{
+	d->hold = hold;
+}
+
+int BoshStream::wait() const
+{
+	return d->wait;
+}
+
+void BoshStream::setWait(int seconds)
+{
+	d->wait = seconds;
+}
+
+void BoshStream::connectToUrl(const QUrl &url, const QString &domain)
+{
+#ifdef BOSH_DEBUG
+	BOSHDEBUG << "u:" << url << "d:" << domain;
+#endif
+
+	resetConnection(true);
+	d->url = url;
+	d->domain = domain;
+	d->state = Private::Creating;
+
+	// unpredictable start (XEP-0124 7.1), 40 bits leave plenty of room below 2^53
+	QCA::SecureArray random = QCA::Random::randomArray(5);
+	d->rid = 0;
+	for(int n = 0; n < random.size(); ++n)
+		d->rid = (d->rid << 8) | quint8(random[n]);
+	++d->rid;
+	d->processRid = d->rid;
+
+	QByteArray attributes = "content='text/xml; charset=utf-8'";
+	attributes += " hold='" + QByteArray::number(d->hold) + "'";
+	attributes += " wait='" + QByteArray::number(d->wait) + "'";
+	attributes += " to='" + escape(domain) + "'";
+	attributes += " ver='1.6' xmpp:version='1.0' xmlns:xmpp='" XBOSH_NS "'";
+	sendRequest(attributes, QByteArray(), 0);
+}
+
+QString BoshStream::sid() const
+{
+	return d->sid;
+}
+
+int BoshStream::requestsInFlight() const
+{
+	return d->replies.count();
+}
+
+bool BoshStream::isOpen() const
+{
+	return d->state == Private::Connected;
+}
+
+void BoshStream::close()
+{
+	if(d->state == Private::Idle || d->state == Private::Closing)
+		return;
+
+	if(d->state == Private::Creating) {
+		resetConnection();
+		return;
+	}
+
+	d->terminate = true;
+	do_send();
+}
+
+int BoshStream::tryWrite()
+{
+	// let the other writes of this pass join the request
+	if(!d->sendTimer.isActive())
+		d->sendTimer.start(0);
+	return 0;
+}
+
+void BoshStream::sendRequest(const QByteArray &attributes, const QByteArray &payload, int written)
+{
+	qint64 rid = d->rid++;
+
+	QByteArray data = "<body rid='" + QByteArray::number(rid) + "'";
+	if(!d->sid.isEmpty())
+		data += " sid='" + escape(d->sid) + "'";
+	if(!attributes.isEmpty())
+		data += ' ' + attributes;
+	data += " xmlns='" BOSH_NS "'";
+	if(payload.isEmpty())
+		data += "/>";
+	else
+		data += '>' + payload + "</body>";
+
+	Private::Request r;
+	r.data = data;
+	r.written = written;
+	r.retries = 0;
+	d->sent.insert(rid, r);
+	post(rid);
+}
+
+void BoshStream::post(qint64 rid)
+{
+#ifdef BOSH_DEBUG
+	BOSHDEBUG << "r:" << rid << d->sent.value(rid).data;
+#endif
+
+	QNetworkRequest req(d->url);
+	req.setHeader(QNetworkRequest::ContentTypeHeader, "text/xml; charset=utf-8");
+	QNetworkReply *reply = d->nam.post(req, d->sent.value(rid).data);
+	connect(reply, SIGNAL(finished()), SLOT(http_finished()));
+	d->replies.insert(reply, rid);
+
+	// the connection manager answers within its wait time, or the request is stuck somewhere
+	QTimer *timer = new QTimer(reply);
+	timer->setSingleShot(true);
+	connect(timer, SIGNAL(timeout()), SLOT(http_timeout()));
+	timer->start((d->wait + REQUEST_TIMEOUT_MARGIN) * 1000);
+}
+
+void BoshStream::retry(qint64 rid)
+{
+	// the session survives a broken connection, send the same request again
+	if(d->state != Private::Creating && d->sent[rid].retries < MAX_RETRIES) {
+		++d->sent[rid].retries;
+		post(rid);
+		return;
+	}
+	fail(ErrRead);
+}
+
+void BoshStream::http_finished()
+{
+	QNetworkReply *reply = static_cast<QNetworkReply*>(sender());
+	if(!d->replies.contains(reply))
+		return;
+
+	qint64 rid = d->replies.take(reply);
+	reply->deleteLater();
+
+	QNetworkReply::NetworkError e = reply->error();
+	if(e != QNetworkReply::NoError) {
+#ifdef BOSH_DEBUG
+		BOSHDEBUG << "r:" << rid << "e:" << e;
+#endif
+		switch(e) {
+			case QNetworkReply::ConnectionRefusedError:
+				fail(ErrConnectionRefused);
+				return;
+			case QNetworkReply::HostNotFoundError:
+				fail(ErrHostNotFound);
+				return;
+			case QNetworkReply::ProxyConnectionRefusedError:
+			case QNetworkReply::ProxyNotFoundError:
+				fail(ErrProxyConnect);
+				return;
+			case QNetworkReply::ProxyAuthenticationRequiredError:
+				fail(ErrProxyAuth);
+				return;
+			case QNetworkReply::RemoteHostClosedError:
+			case QNetworkReply::TimeoutError:
+			case QNetworkReply::ProxyConnectionClosedError:
+			case QNetworkReply::UnknownNetworkError:
+				retry(rid);
+				return;
+			default:
+				// the connection manager refused the request, the session is gone
+				fail(ErrSession);
+				return;
+		}
+	}
+
+	// responses are processed in request order, a long poll may finish last
+	d->responses.insert(rid, reply->readAll());
+
+	QPointer<QObject> self = this;
+	while(d->state != Private::Idle && d->responses.contains(d->processRid)) {
+		qint64 r = d->processRid++;
+		QByteArray body = d->responses.take(r);
+		int written = d->sent.take(r).written;
+
+		if(written > 0) {
+			emit bytesWritten(written);
+			if(!self)
+				return;
+		}
+
+		if(r == d->terminateRid) {
+			resetConnection();
+			emit delayedCloseFinished();
+			return;
+		}
+
+		processResponse(body);
+		if(!self)
+			return;
+	}
+
+	do_send();
+}
+
+void BoshStream::http_timeout()
+{
+	QNetworkReply *reply = static_cast<QNetworkReply*>(sender()->parent());
+	if(!d->replies.contains(reply))
+		return;
+
+	qint64 rid = d->replies.take(reply);
+#ifdef BOSH_DEBUG
+	BOSHDEBUG << "r:" << rid << "timed out";
+#endif
+	reply->disconnect(this);
+	reply->abort();
+	reply->deleteLater();
+	retry(rid);
+}
+
+void BoshStream::processResponse(const QByteArray &body)
+{
+	QDomDocument doc;
+	if(!doc.setContent(body, true)) {
+		fail(ErrRead);
+		return;
+	}
+
+	QDomElement e = doc.documentElement();
+	if(e.localName() != "body" || e.namespaceURI() != BOSH_NS) {
+		fail(ErrRead);
+		return;
+	}
+
+	if(d->state == Private::Creating) {
+		d->sid = e.attribute("sid");
+		if(d->sid.isEmpty()) {
+			fail(ErrSession);
+			return;
+		}
+		d->authid = e.attribute("authid");
+		d->from = e.attribute("from");
+		d->requests = qMax(1, e.attribute("requests", "2").toInt());
+		if(e.hasAttribute("hold"))
+			d->hold = e.attribute("hold").toInt();
+		if(e.hasAttribute("wait"))
+			d->wait = e.attribute("wait").toInt();
+	}
+
+	// the stanzas are handed on as they are, prefixes stay declared by our stream header
+	QByteArray payload;
+	int start = body.indexOf("<body");
+	int open = body.indexOf('>', start);
+	if(start != -1 && open != -1 && body[open - 1] != '/') {
+		int end = body.lastIndexOf("</body>");
+		if(end > open)
+			payload = body.mid(open + 1, end - open - 1);
+	}
+
+	if(!payload.isEmpty()) {
+		if(d->headerSeen) {
+			appendRead(payload);
+		}
+		else {
+			d->early += payload;
+		}
+	}
+
+	QPointer<QObject> self = this;
+	if(d->state == Private::Creating) {
+		d->state = Private::Connected;
+		setOpenMode(QIODevice::ReadWrite);
+		emit connected();
+		if(!self)
+			return;
+	}
+	else if(!payload.isEmpty() && d->headerSeen) {
+		emit readyRead();
+		if(!self)
+			return;
+	}
+
+	if(e.attribute("type") == "terminate") {
+		QString condition = e.attribute("condition");
+		resetConnection();
+		if(condition.isEmpty())
+			emit connectionClosed();
+		else
+			setError(ErrSession, condition);
+	}
+}
+
+/* turn what the user wrote into request payload */
+void BoshStream::processWrites()
+{
+	QByteArray w = takeWrite();
+	if(w.isEmpty())
+		return;
+	d->outWritten += w.size();
+
+	QByteArray header;
+	while(!w.isEmpty()) {
+		int decl = w.indexOf("<?xml");
+		int open = w.indexOf("<stream:stream");
+		int close = w.indexOf("</stream:stream>");
+
+		int at = open;
+		if(decl != -1 && (at == -1 || decl < at))
+			at = decl;
+		if(close != -1 && (at == -1 || close < at)) {
+			d->out += w.left(close);
+			w = w.mid(close + 16);
+			d->terminate = true;
+			continue;
+		}
+		if(at == -1 || open == -1) {
+			d->out += w;
+			break;
+		}
+
+		/* a stream header, it opens or restarts the session */
+		d->out += w.left(at);
+		int end = w.indexOf('>', open);
+		if(end == -1)
+			end = w.size() - 1;
+		QByteArray tag = w.mid(open, end - open + 1);
+		w = w.mid(end + 1);
+
+		QString lang = tagAttribute(tag, "xml:lang");
+		if(!lang.isEmpty())
+			d->lang = lang;
+
+		if(d->headerSeen)
+			d->restart = true;
+		d->headerSeen = true;
+		header += d->streamHeader();
+	}
+
+	// whitespace keepalives are pointless, the connection manager has its own
+	if(d->out.trimmed().isEmpty())
+		d->out.clear();
+
+	if(!header.isEmpty()) {
+		appendRead(header + d->early);
+		d->early.clear();
+		QPointer<QObject> self = this;
+		emit readyRead();
+		if(!self)
+			return;
+	}
+}
+
+void BoshStream::do_send()
+{
+	if(d->state != Private::Connected)
+		return;
+
+	d->sendTimer.stop();
+	processWrites();
+	if(d->state != Private::Connected)
+		return;
+
+	/* restart, stanzas and terminate each need a request of their own, in this order */
+	while(d->replies.count() < d->requests) {
+		if(d->restart) {
+			d->restart = false;
+			QByteArray attributes = "to='" + escape(d->domain) + "'";
+			if(!d->lang.isEmpty())
+				attributes += " xml:lang='" + escape(d->lang) + "'";
+			attributes += " xmpp:restart='true' xmlns:xmpp='" XBOSH_NS "'";
+			sendRequest(attributes, QByteArray(), 0);
+		}
+		else if(d->terminate) {
+			d->terminateRid = d->rid;
+			d->state = Private::Closing;
+			sendRequest("type='terminate'", d->out, d->outWritten);
+			d->out.clear();
+			d->outWritten = 0;
+			return;
+		}
+		else if(!d->out.isEmpty()) {
+			sendRequest(QByteArray(), d->out, d->outWritten);
+			d->out.clear();
+			d->outWritten = 0;
+		}
+		else if(d->replies.isEmpty()) {
+			// keep one request open, so the connection manager can push to us
+			sendRequest(QByteArray(), QByteArray(), d->outWritten);
+			d->outWritten = 0;
+		}
+		else {
+			break;
+		}
+	}
+}
+
+void BoshStream::fail(int code)
+{
+	resetConnection();
+	setError(code);
+}
+
+// CS_NAMESPACE_END
@@ -0,0 +1,102 @@
+/*
+ * boshstream.h - XMPP over BOSH (XEP-0124/XEP-0206)
+ * Copyright (C) 2010  Kopete Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#ifndef CS_BOSHSTREAM_H
+#define CS_BOSHSTREAM_H
+
+#include "bytestream.h"
+
+class QUrl;
+class QNetworkReply;
+
+// CS_NAMESPACE_BEGIN
+
+/*!
+	XMPP stream carried over BOSH.
+
+	The stream looks like a plain XMPP connection to the user: the stream
+	headers written to it are turned into BOSH session creation and restart
+	requests, and matching headers are made up for the reading side.
+	Stanzas written in between are batched into the next request.
+
+	The connection manager holds one request open at all times so it can
+	push data; a second one carries outgoing stanzas as they are written.
+	Requests go through QNetworkAccessManager, which keeps the HTTP
+	connections alive between requests. A request the connection manager
+	did not answer within its wait time is aborted and sent again.
+*/
+class BoshStream : public ByteStream
+{
+	Q_OBJECT
+public:
+	enum Error { ErrConnectionRefused = ErrCustom, ErrHostNotFound, ErrProxyConnect, ErrProxyNeg, ErrProxyAuth, ErrSession };
+	BoshStream(QObject *parent=0);
+	~BoshStream();
+
+	/*! Use an HTTP proxy, \a user and \a pass may be empty */
+	void setProxy(const QString &host, int port, const QString &user="", const QString &pass="");
+
+	/*! Requests the connection manager may hold open, defaults to 1 */
+	int hold() const;
+	void setHold(int hold);
+	/*! Seconds the connection manager may hold a request, defaults to 60 */
+	int wait() const;
+	void setWait(int seconds);
+
+	/*! Create a session with the connection manager at \a url for \a domain,
+	    QCA must be initialized for the random request ids */
+	void connectToUrl(const QUrl &url, const QString &domain);
+
+	/*! Session id, empty until connected */
+	QString sid() const;
+	/*! Requests currently on the wire */
+	int requestsInFlight() const;
+
+	// from ByteStream
+	bool isOpen() const;
+	void close();
+
+signals:
+	void connected();
+
+protected:
+	int tryWrite();
+
+private slots:
+	void http_finished();
+	void http_timeout();
+	void do_send();
+
+private:
+	class Private;
+	Private *d;
+
+	void resetConnection(bool clear=false);
+	void sendRequest(const QByteArray &attributes, const QByteArray &payload, int written);
+	void post(qint64 rid);
+	void retry(qint64 rid);
+	void processResponse(const QByteArray &body);
+	void processWrites();
+	void fail(int code);
+};
+
+// CS_NAMESPACE_END
+
+#endif
@@ -22,6 +22,8 @@
 #include <QTcpSocket>
 #include <QHostAddress>
 #include <QMetaType>
+#include <QTime>
+#include <QTimer>
 
 #include <limits>
 
@@ -38,6 +40,11 @@
 
 #define READBUFSIZE 65536
 
+// head start (ms) of an attempt before the next address is raced against it
+#define ATTEMPT_DELAY 250
+// attempts in flight at the same time
+#define MAX_ATTEMPTS 4
+
 // CS_NAMESPACE_BEGIN
 
 class QTcpSocketSignalRelay : public QObject
@@ -106,6 +113,43 @@ public:
 		qsock = 0;
 		qsock_relay = 0;
 		resolver = 0;
+		lookupPending = false;
+		lookupDone = false;
+		lookupTime = -1;
+		connectTime = -1;
+	}
+
+	/*! A socket racing for the connection, it becomes qsock if it wins */
+	struct Attempt
+	{
+		QTcpSocket *sock;
+		QTcpSocketSignalRelay *relay;
+		bool isSrv;
+		int index; //!< Position in history
+	};
+
+	int indexOf(QObject *relay) const
+	{
+		for(int n = 0; n < attempts.count(); ++n) {
+			if(attempts[n]->relay == relay)
+				return n;
+		}
+		return -1;
+	}
+
+	void finish(Attempt *a, BSocket::ConnectAttempt::Result result)
+	{
+		history[a->index].finished = clock.elapsed();
+		history[a->index].result = result;
+	}
+
+	/* start over the diagnostics for a new connect */
+	void restart()
+	{
+		history.clear();
+		lookupTime = -1;
+		connectTime = -1;
+		clock.start();
 	}
 
 	bool isSrv;
@@ -125,12 +169,31 @@ public:
 	 * will be destroyed and recreated after each lookup
 	 */
 	XMPP::ServiceResolver *resolver;
+
+	QList<Attempt*> attempts; //!< Attempts in flight
+	QList< QPair<QHostAddress,quint16> > endpoints; //!< Addresses given by the user, not tried yet
+	QTimer attemptTimer; //!< Races the next address when it fires
+	bool lookupPending; //!< Resolver was asked for the next address
+	bool lookupDone; //!< Resolver has no address left
+
+	/* diagnostics */
+	QTime clock; //!< Started with each connect
+	int lookupTime;
+	int connectTime;
+	QList<BSocket::ConnectAttempt> history;
 };
 
+BSocket::ConnectAttempt::ConnectAttempt()
+:port(0), started(-1), finished(-1), result(Pending)
+{
+}
+
 BSocket::BSocket(QObject *parent)
 :ByteStream(parent)
 {
 	d = new Private;
+	d->attemptTimer.setSingleShot(true);
+	connect(&d->attemptTimer, SIGNAL(timeout()), SLOT(att_timeout()));
 	resetConnection();
 }
 
@@ -159,6 +222,12 @@ void BSocket::resetConnection(bool clear)
 #ifdef BS_DEBUG
 	BSDEBUG << clear;
 #endif
+	abortAttempts();
+	d->attemptTimer.stop();
+	d->endpoints.clear();
+	d->lookupPending = false;
+	d->lookupDone = false;
+
 	if(d->qsock) {
 		delete d->qsock_relay;
 		d->qsock_relay = 0;
@@ -197,29 +266,53 @@ void BSocket::ensureSocket()
 		d->qsock->setReadBufferSize(READBUFSIZE);
 #endif
 		d->qsock_relay = new QTcpSocketSignalRelay(d->qsock, this);
-		connect(d->qsock_relay, SIGNAL(hostFound()), SLOT(qs_hostFound()));
-		connect(d->qsock_relay, SIGNAL(connected()), SLOT(qs_connected()));
-		connect(d->qsock_relay, SIGNAL(disconnected()), SLOT(qs_closed()));
-		connect(d->qsock_relay, SIGNAL(readyRead()), SLOT(qs_readyRead()));
-		connect(d->qsock_relay, SIGNAL(bytesWritten(qint64)), SLOT(qs_bytesWritten(qint64)));
-		connect(d->qsock_relay, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(qs_error(QAbstractSocket::SocketError)));
+		connectRelay(d->qsock_relay);
 	}
 }
 
+void BSocket::connectRelay(QObject *relay)
+{
+	connect(relay, SIGNAL(hostFound()), SLOT(qs_hostFound()));
+	connect(relay, SIGNAL(connected()), SLOT(qs_connected()));
+	connect(relay, SIGNAL(disconnected()), SLOT(qs_closed()));
+	connect(relay, SIGNAL(readyRead()), SLOT(qs_readyRead()));
+	connect(relay, SIGNAL(bytesWritten(qint64)), SLOT(qs_bytesWritten(qint64)));
+	connect(relay, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(qs_error(QAbstractSocket::SocketError)));
+}
+
 /* Connect to an already resolved host */
 void BSocket::connectToHost(const QHostAddress &address, quint16 port)
+{
+	QList< QPair<QHostAddress,quint16> > endpoints;
+	endpoints += qMakePair(address, port);
+	connectToHost(endpoints);
+}
+
+/* Race connections to already resolved hosts */
+void BSocket::connectToHost(const QList< QPair<QHostAddress,quint16> > &endpoints)
 {
 #ifdef BS_DEBUG
-	BSDEBUG << "a:" << address << "p:" << port;
+	BSDEBUG << "e:" << endpoints;
 #endif
 
 	resetConnection(true);
-	d->address = address;
-	d->port = port;
+	d->restart();
+
+	/* nothing to look up, drop a resolver left over from an earlier connect */
+	if(d->resolver) {
+		disconnect(d->resolver);
+		d->resolver->stop();
+		d->resolver->deleteLater();
+		d->resolver = 0;
+	}
+
+	d->endpoints = endpoints;
+	d->lookupDone = true;
+	d->lookupTime = 0;
 	d->state = Connecting;
 
-	ensureSocket();
-	d->qsock->connectToHost(address, port);
+	tryNextAddress();
+	checkAttemptsFailed();
 }
 
 /* Connect to a host via the specified protocol, or the default protocols if not specified */
@@ -230,6 +323,7 @@ void BSocket::connectToHost(const QString &host, quint16 port, QAbstractSocket::
 #endif
 
 	resetConnection(true);
+	d->restart();
 	d->host = host;
 	d->port = port;
 	d->state = HostLookup;
@@ -262,6 +356,7 @@ void BSocket::connectToHost(const QString &service, const QString &transport, co
 #endif
 
 	resetConnection(true);
+	d->restart();
 	d->domain = domain;
 	d->state = HostLookup;
 
@@ -279,11 +374,19 @@ void BSocket::handle_dns_ready(const QHostAddress &address, quint16 port)
 #ifdef BS_DEBUG
 	BSDEBUG << "a:" << address << "p:" << port;
 #endif
-	d->isSrv = d->resolver->hasPendingSrv(); // if has no then its fallback or SRV is not used at all
-	connectToHost(address, port);
+	d->lookupPending = false;
+
+	/* an earlier attempt already won */
+	if(d->state != HostLookup && d->state != Connecting)
+		return;
+
+	if(d->lookupTime == -1)
+		d->lookupTime = d->clock.elapsed();
+	d->state = Connecting;
+	startAttempt(address, port);
 }
 
-/* resolver failed the dns lookup */
+/* resolver has no (more) addresses */
 void BSocket::handle_dns_error(XMPP::ServiceResolver::Error e) {
 #ifdef BS_DEBUG
 	BSDEBUG << "e:" << e;
@@ -291,22 +394,144 @@ void BSocket::handle_dns_error(XMPP::ServiceResolver::Error e) {
 	Q_UNUSED(e)
 #endif
 
-	emit error(ErrHostNotFound);
+	d->lookupPending = false;
+	d->lookupDone = true;
+
+	/* attempts still in flight may yet connect */
+	checkAttemptsFailed();
 }
 
-/* failed to connect to host */
-void BSocket::handle_connect_error(QAbstractSocket::SocketError e) {
+void BSocket::startAttempt(const QHostAddress &address, quint16 port)
+{
 #ifdef BS_DEBUG
-	BSDEBUG << "d->r:" << d->resolver;
-#else
-	Q_UNUSED(e)
+	BSDEBUG << "a:" << address << "p:" << port;
 #endif
 
-	/* try the next host for this service */
-	Q_ASSERT(d->resolver);
+	Private::Attempt *a = new Private::Attempt;
+	a->sock = new QTcpSocket(this);
+	a->sock->setReadBufferSize(READBUFSIZE);
+	a->relay = new QTcpSocketSignalRelay(a->sock, this);
+	connect(a->relay, SIGNAL(connected()), SLOT(att_connected()));
+	connect(a->relay, SIGNAL(error(QAbstractSocket::SocketError)), SLOT(att_error(QAbstractSocket::SocketError)));
+	// if has no then its fallback or SRV is not used at all
+	a->isSrv = d->resolver && d->resolver->hasPendingSrv();
+	a->index = d->history.count();
+
+	ConnectAttempt info;
+	info.address = address;
+	info.port = port;
+	info.started = d->clock.elapsed();
+	d->history += info;
+	d->attempts += a;
+
+	a->sock->connectToHost(address, port);
+
+	/* give it a head start, then race the next address against it */
+	d->attemptTimer.start(ATTEMPT_DELAY);
+}
+
+/* start an attempt on the next address, or ask the resolver for one */
+void BSocket::tryNextAddress()
+{
+	if(d->attempts.count() >= MAX_ATTEMPTS)
+		return;
+
+	if(!d->endpoints.isEmpty()) {
+		QPair<QHostAddress,quint16> e = d->endpoints.takeFirst();
+		startAttempt(e.first, e.second);
+		return;
+	}
+
+	if(d->lookupPending || d->lookupDone || !d->resolver)
+		return;
+
+	/* may answer right away, through handle_dns_ready() or handle_dns_error() */
+	d->lookupPending = true;
 	d->resolver->tryNext();
 }
 
+void BSocket::abortAttempts()
+{
+	foreach(Private::Attempt *a, d->attempts) {
+		d->finish(a, ConnectAttempt::Cancelled);
+		delete a->relay;
+		a->sock->abort();
+		a->sock->deleteLater();
+		delete a;
+	}
+	d->attempts.clear();
+}
+
+/* fail if nothing is in flight and nothing is left to try */
+void BSocket::checkAttemptsFailed()
+{
+	if(d->state != HostLookup && d->state != Connecting)
+		return;
+	if(!d->attempts.isEmpty() || !d->endpoints.isEmpty() || d->lookupPending || !d->lookupDone)
+		return;
+
+	bool tried = !d->history.isEmpty();
+	resetConnection();
+	emit error(tried ? ErrConnectionRefused : ErrHostNotFound);
+}
+
+void BSocket::att_connected()
+{
+	int n = d->indexOf(sender());
+	if(n == -1)
+		return;
+
+	Private::Attempt *a = d->attempts.takeAt(n);
+	d->finish(a, ConnectAttempt::Connected);
+	d->connectTime = d->clock.elapsed();
+
+	/* we have a winner, cancel the rest */
+	abortAttempts();
+	d->attemptTimer.stop();
+	d->endpoints.clear();
+	if(d->resolver)
+		d->resolver->stop();
+
+	d->qsock = a->sock;
+	d->qsock_relay = a->relay;
+	d->qsock_relay->disconnect(this);
+	connectRelay(d->qsock_relay);
+	d->isSrv = a->isSrv;
+	d->address = d->qsock->peerAddress();
+	d->port = d->qsock->peerPort();
+	delete a;
+
+	qs_connected();
+}
+
+void BSocket::att_error(QAbstractSocket::SocketError x)
+{
+#ifdef BS_DEBUG
+	BSDEBUG << "e:" << x;
+#else
+	Q_UNUSED(x)
+#endif
+
+	int n = d->indexOf(sender());
+	if(n == -1)
+		return;
+
+	Private::Attempt *a = d->attempts.takeAt(n);
+	d->finish(a, ConnectAttempt::Failed);
+	delete a->relay;
+	a->sock->deleteLater();
+	delete a;
+
+	/* no need to wait for the timer, the address is dead */
+	tryNextAddress();
+	checkAttemptsFailed();
+}
+
+void BSocket::att_timeout()
+{
+	tryNextAddress();
+}
+
 QAbstractSocket* BSocket::abstractSocket() const
 {
 	return d->qsock;
@@ -339,6 +564,21 @@ bool BSocket::isPeerFromSrv() const
 	return d->isSrv;
 }
 
+int BSocket::lookupTime() const
+{
+	return d->lookupTime;
+}
+
+int BSocket::connectTime() const
+{
+	return d->connectTime;
+}
+
+QList<BSocket::ConnectAttempt> BSocket::connectAttempts() const
+{
+	return d->history;
+}
+
 bool BSocket::isOpen() const
 {
 	if(d->state == Connected)
@@ -489,13 +729,6 @@ void BSocket::qs_bytesWritten(qint64 x64)
 
 void BSocket::qs_error(QAbstractSocket::SocketError x)
 {
-	/* arriving here from connectToHost() */
-	if (d->state == Connecting) {
-		/* We do our own special error handling in this case */
-		handle_connect_error(x);
-		return;
-	}
-
 	if(x == QTcpSocket::RemoteHostClosedError) {
 #ifdef BS_DEBUG
 		BSDEBUG << "Connection Closed";
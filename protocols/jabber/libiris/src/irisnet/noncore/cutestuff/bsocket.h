@@ -23,6 +23,8 @@
 #define CS_BSOCKET_H
 
 #include <QAbstractSocket>
+#include <QList>
+#include <QPair>
 
 #include <limits>
 
@@ -38,6 +40,10 @@ class QByteArray;
 
 /*!
 	Socket with automatic hostname lookups, using SRV, AAAA and A DNS queries.
+
+	Resolved addresses are raced against each other: the first attempt gets a
+	short head start, then the next address is tried in parallel, and so on.
+	The first attempt to connect wins and the others are cancelled.
 */
 class BSocket : public ByteStream
 {
@@ -45,11 +51,28 @@ class BSocket : public ByteStream
 public:
 	enum Error { ErrConnectionRefused = ErrCustom, ErrHostNotFound };
 	enum State { Idle, HostLookup, Connecting, Connected, Closing };
+
+	/*! One connection attempt, \sa connectAttempts */
+	class ConnectAttempt
+	{
+	public:
+		enum Result { Pending, Connected, Failed, Cancelled };
+		ConnectAttempt();
+
+		QHostAddress address;
+		quint16 port;
+		int started; //!< ms after the connect was requested
+		int finished; //!< ms after the connect was requested, -1 while pending
+		Result result;
+	};
+
 	BSocket(QObject *parent=0);
 	~BSocket();
 
 	/*! Connect to an already resolved host */
 	void connectToHost(const QHostAddress &address, quint16 port);
+	/*! Race connections to already resolved hosts, in the given order */
+	void connectToHost(const QList< QPair<QHostAddress,quint16> > &endpoints);
 	/*! Connect to a host via the specified protocol, or the default protocols if not specified */
 	void connectToHost(const QString &host, quint16 port, QAbstractSocket::NetworkLayerProtocol protocol = QAbstractSocket::UnknownNetworkLayerProtocol);
 	/*! Connect to the hosts for the specified service */
@@ -60,6 +83,13 @@ public:
 	int state() const;
 	bool isPeerFromSrv() const;
 
+	/*! ms until the first address was resolved, -1 if none was */
+	int lookupTime() const;
+	/*! ms until the winning attempt connected, -1 if none did */
+	int connectTime() const;
+	/*! Attempts made by the last connect, in the order they were started */
+	QList<ConnectAttempt> connectAttempts() const;
+
 	// from ByteStream
 	bool isOpen() const;
 	void close();
@@ -93,7 +123,9 @@ private slots:
 
 	void handle_dns_ready(const QHostAddress&, quint16);
 	void handle_dns_error(XMPP::ServiceResolver::Error e);
-	void handle_connect_error(QAbstractSocket::SocketError);
+	void att_connected();
+	void att_error(QAbstractSocket::SocketError);
+	void att_timeout();
 
 private:
 	class Private;
@@ -101,7 +133,12 @@ private:
 
 	void resetConnection(bool clear=false);
 	void ensureSocket();
+	void connectRelay(QObject *relay);
 	void recreate_resolver();
+	void startAttempt(const QHostAddress &address, quint16 port);
+	void tryNextAddress();
+	void abortAttempts();
+	void checkAttemptsFailed();
 	bool check_protocol_fallback();
 	void dns_srv_try_next();
 	bool connect_host_try_next();
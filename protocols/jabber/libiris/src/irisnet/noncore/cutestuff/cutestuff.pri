@@ -5,6 +5,7 @@ HEADERS += \
 	$$PWD/bsocket.h \
 	$$PWD/httpconnect.h \
 	$$PWD/httppoll.h \
+	$$PWD/boshstream.h \
 	$$PWD/socks.h \
 	$$PWD/networkaccessmanager.h \
 	$$PWD/httpstream.h
@@ -14,6 +15,7 @@ SOURCES += \
 	$$PWD/bsocket.cpp \
 	$$PWD/httpconnect.cpp \
 	$$PWD/httppoll.cpp \
+	$$PWD/boshstream.cpp \
 	$$PWD/socks.cpp \
 	$$PWD/networkaccessmanager.cpp \
 	$$PWD/httpstream.cpp
@@ -501,6 +501,30 @@ JDNS_EXPORT jdns_dnsparams_t *jdns_system_dnsparams();
 //   however new applications really should use it.
 JDNS_EXPORT void jdns_set_hold_ids_enabled(jdns_session_t *s, int enabled);
 
+typedef struct jdns_cache_stats
+{
+	int count;       // records currently cached
+	int max;         // size bound
+	int hits;        // lookups answered from the cache
+	int misses;      // lookups that went to the network
+	int evictions;   // records dropped to stay within the bound
+	int expirations; // records dropped because their ttl ran out
+} jdns_cache_stats_t;
+
+// jdns_set_cache_max
+//   s: session
+//   max: maximum number of cached records.  default is 16384
+//   return: nothing
+// when the cache is full, the records used least recently are dropped to
+//   make room.  0 disables caching.  only unicast sessions have a cache.
+JDNS_EXPORT void jdns_set_cache_max(jdns_session_t *s, int max);
+
+// jdns_cache_stats
+//   s: session
+//   stats: store the cache statistics
+//   return: nothing
+JDNS_EXPORT void jdns_cache_stats(jdns_session_t *s, jdns_cache_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
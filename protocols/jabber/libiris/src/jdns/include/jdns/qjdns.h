@@ -123,6 +123,19 @@ public:
 		QList<Record> additionalRecords;
 	};
 
+	class JDNS_EXPORT CacheStats
+	{
+	public:
+		int count;       // records currently cached
+		int max;         // size bound
+		int hits;        // lookups answered from the cache
+		int misses;      // lookups that went to the network
+		int evictions;   // records dropped to stay within the bound
+		int expirations; // records dropped because their ttl ran out
+
+		CacheStats();
+	};
+
 	QJDns(QObject *parent = 0);
 	~QJDns();
 
@@ -130,6 +143,9 @@ public:
 	void shutdown();
 	QStringList debugLines();
 
+	// only unicast mode uses the cache
+	CacheStats cacheStats() const;
+
 	static SystemInfo systemInfo();
 	static QHostAddress detectPrimaryMulticast(const QHostAddress &address);
 
@@ -499,6 +499,13 @@ QStringList finalDebugLines = jdnsSharedDebug.readDebugLines();
 	*/
 	static void waitForShutdown(const QList<QJDnsShared*> &instances);
 
+	/**
+	   \brief Returns the response cache statistics, summed over all interfaces
+
+	   Only the unicast modes cache responses.
+	*/
+	QJDns::CacheStats cacheStats() const;
+
 signals:
 	/**
 	   \brief Indicates the object has been shut down
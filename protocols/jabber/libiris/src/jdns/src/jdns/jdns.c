@@ -36,6 +36,7 @@
 // cache no more than 7 days
 #define JDNS_TTL_MAX          (86400 * 7)
 #define JDNS_CACHE_MAX        16384
+#define JDNS_CACHE_BUCKETS    4096 // power of 2
 #define JDNS_CNAME_MAX        16
 #define JDNS_QUERY_MAX        4096
 
@@ -891,22 +892,31 @@ void datagram_delete(datagram_t *a)
 
 typedef struct cache_item
 {
-	void (*dtor)(struct cache_item *);
 	unsigned char *qname;
 	int qtype;
 	int time_start;
 	int ttl;
 	jdns_rr_t *record; // if zero, nxdomain is assumed
-} cache_item_t;
 
-void cache_item_delete(cache_item_t *e);
+	// bucket chain by (qname, qtype)
+	unsigned int hash;
+	struct cache_item *prev, *next;
+
+	// bucket chain by (record owner, record type), only if there is a record
+	unsigned int rr_hash;
+	struct cache_item *rr_prev, *rr_next;
+
+	// least recently used order, most recent first
+	struct cache_item *lru_prev, *lru_next;
+
+	// position in the expiry heap
+	int heap_index;
+} cache_item_t;
 
 cache_item_t *cache_item_new()
 {
 	cache_item_t *a = alloc_type(cache_item_t);
-	a->dtor = cache_item_delete;
-	a->qname = 0;
-	a->record = 0;
+	memset(a, 0, sizeof(cache_item_t));
 	return a;
 }
 
@@ -920,6 +930,247 @@ void cache_item_delete(cache_item_t *a)
 	jdns_free(a);
 }
 
+static int cache_item_expires(const cache_item_t *a)
+{
+	return a->time_start + (a->ttl * 1000);
+}
+
+// the cache is indexed twice: by (qname, qtype) for lookups, and by the
+//   record itself for duplicate removal.  items are also kept in lru order
+//   for the size bound, and in a binary min-heap by expiry time, so that the
+//   next expiry is at the top and expiring only touches the items that are due.
+typedef struct cache
+{
+	int count;
+	int max;
+	cache_item_t **buckets;
+	cache_item_t **rr_buckets;
+	cache_item_t *lru_first, *lru_last;
+	cache_item_t **heap; // 'count' items
+	int heap_size;       // allocated slots
+
+	// statistics
+	int hits;
+	int misses;
+	int evictions;
+	int expirations;
+} cache_t;
+
+static cache_t *cache_new()
+{
+	cache_t *c = alloc_type(cache_t);
+	c->count = 0;
+	c->max = JDNS_CACHE_MAX;
+	c->buckets = (cache_item_t **)jdns_alloc(sizeof(cache_item_t *) * JDNS_CACHE_BUCKETS);
+	memset(c->buckets, 0, sizeof(cache_item_t *) * JDNS_CACHE_BUCKETS);
+	c->rr_buckets = (cache_item_t **)jdns_alloc(sizeof(cache_item_t *) * JDNS_CACHE_BUCKETS);
+	memset(c->rr_buckets, 0, sizeof(cache_item_t *) * JDNS_CACHE_BUCKETS);
+	c->lru_first = 0;
+	c->lru_last = 0;
+	c->heap = 0;
+	c->heap_size = 0;
+	c->hits = 0;
+	c->misses = 0;
+	c->evictions = 0;
+	c->expirations = 0;
+	return c;
+}
+
+static void cache_delete(cache_t *c)
+{
+	cache_item_t *i, *next;
+	if(!c)
+		return;
+	for(i = c->lru_first; i; i = next)
+	{
+		next = i->lru_next;
+		cache_item_delete(i);
+	}
+	jdns_free(c->buckets);
+	jdns_free(c->rr_buckets);
+	if(c->heap)
+		jdns_free(c->heap);
+	jdns_free(c);
+}
+
+// case-insensitive, like jdns_domain_cmp()
+static unsigned int cache_hash(const unsigned char *name, int type)
+{
+	// FNV-1a
+	unsigned int h = 2166136261u;
+	const unsigned char *p;
+	for(p = name; *p; ++p)
+	{
+		h ^= (unsigned char)tolower(*p);
+		h *= 16777619u;
+	}
+	h ^= (unsigned int)type;
+	h *= 16777619u;
+	return h;
+}
+
+static void cache_heap_set(cache_t *c, int n, cache_item_t *i)
+{
+	c->heap[n] = i;
+	i->heap_index = n;
+}
+
+static void cache_heap_up(cache_t *c, int n)
+{
+	cache_item_t *i = c->heap[n];
+	int expires = cache_item_expires(i);
+	while(n > 0)
+	{
+		int parent = (n - 1) / 2;
+		if(cache_item_expires(c->heap[parent]) <= expires)
+			break;
+		cache_heap_set(c, n, c->heap[parent]);
+		n = parent;
+	}
+	cache_heap_set(c, n, i);
+}
+
+static void cache_heap_down(cache_t *c, int n)
+{
+	cache_item_t *i = c->heap[n];
+	int expires = cache_item_expires(i);
+	while(1)
+	{
+		int child = 2 * n + 1;
+		if(child >= c->count)
+			break;
+		if(child + 1 < c->count && cache_item_expires(c->heap[child + 1]) < cache_item_expires(c->heap[child]))
+			++child;
+		if(expires <= cache_item_expires(c->heap[child]))
+			break;
+		cache_heap_set(c, n, c->heap[child]);
+		n = child;
+	}
+	cache_heap_set(c, n, i);
+}
+
+static void cache_insert(cache_t *c, cache_item_t *i)
+{
+	cache_item_t **head;
+	cache_item_t *last;
+
+	// append to the chain, lookups return answers in insertion order
+	i->hash = cache_hash(i->qname, i->qtype);
+	head = &c->buckets[i->hash & (JDNS_CACHE_BUCKETS - 1)];
+	i->next = 0;
+	if(*head)
+	{
+		for(last = *head; last->next; last = last->next)
+			;
+		last->next = i;
+		i->prev = last;
+	}
+	else
+	{
+		*head = i;
+		i->prev = 0;
+	}
+
+	if(i->record)
+	{
+		i->rr_hash = cache_hash(i->record->owner, i->record->type);
+		head = &c->rr_buckets[i->rr_hash & (JDNS_CACHE_BUCKETS - 1)];
+		i->rr_prev = 0;
+		i->rr_next = *head;
+		if(*head)
+			(*head)->rr_prev = i;
+		*head = i;
+	}
+
+	i->lru_prev = 0;
+	i->lru_next = c->lru_first;
+	if(c->lru_first)
+		c->lru_first->lru_prev = i;
+	else
+		c->lru_last = i;
+	c->lru_first = i;
+
+	if(c->count == c->heap_size)
+	{
+		c->heap_size = c->heap_size ? c->heap_size * 2 : 64;
+		c->heap = (cache_item_t **)jdns_realloc(c->heap, sizeof(cache_item_t *) * c->heap_size);
+	}
+	cache_heap_set(c, c->count, i);
+	++c->count;
+	cache_heap_up(c, i->heap_index);
+}
+
+// unlinks and frees the item
+static void cache_remove(cache_t *c, cache_item_t *i)
+{
+	if(i->prev)
+		i->prev->next = i->next;
+	else
+		c->buckets[i->hash & (JDNS_CACHE_BUCKETS - 1)] = i->next;
+	if(i->next)
+		i->next->prev = i->prev;
+
+	if(i->record)
+	{
+		if(i->rr_prev)
+			i->rr_prev->rr_next = i->rr_next;
+		else
+			c->rr_buckets[i->rr_hash & (JDNS_CACHE_BUCKETS - 1)] = i->rr_next;
+		if(i->rr_next)
+			i->rr_next->rr_prev = i->rr_prev;
+	}
+
+	if(i->lru_prev)
+		i->lru_prev->lru_next = i->lru_next;
+	else
+		c->lru_first = i->lru_next;
+	if(i->lru_next)
+		i->lru_next->lru_prev = i->lru_prev;
+	else
+		c->lru_last = i->lru_prev;
+
+	// fill the hole with the last item and restore the heap order around it
+	--c->count;
+	if(i->heap_index < c->count)
+	{
+		cache_item_t *last = c->heap[c->count];
+		cache_heap_set(c, i->heap_index, last);
+		cache_heap_up(c, last->heap_index);
+		cache_heap_down(c, last->heap_index);
+	}
+
+	cache_item_delete(i);
+}
+
+static void cache_touch(cache_t *c, cache_item_t *i)
+{
+	if(c->lru_first == i)
+		return;
+
+	i->lru_prev->lru_next = i->lru_next;
+	if(i->lru_next)
+		i->lru_next->lru_prev = i->lru_prev;
+	else
+		c->lru_last = i->lru_prev;
+
+	i->lru_prev = 0;
+	i->lru_next = c->lru_first;
+	c->lru_first->lru_prev = i;
+	c->lru_first = i;
+}
+
+// milliseconds until the next item expires, or -1 if the cache is empty
+static int cache_next_timeleft(cache_t *c, int now)
+{
+	int expires;
+
+	if(c->count == 0)
+		return -1;
+
+	expires = cache_item_expires(c->heap[0]);
+	return expires > now ? expires - now : 0;
+}
+
 typedef struct event
 {
 	void (*dtor)(struct event *);
@@ -997,7 +1248,7 @@ struct jdns_session
 	list_t *queries;
 	list_t *outgoing;
 	list_t *events;
-	list_t *cache;
+	cache_t *cache;
 
 	// for blocking req_ids from reuse until user explicitly releases
 	int do_hold_req_ids;
@@ -1028,7 +1279,7 @@ jdns_session_t *jdns_session_new(jdns_callbacks_t *callbacks)
 	s->queries = list_new();
 	s->outgoing = list_new();
 	s->events = list_new();
-	s->cache = list_new();
+	s->cache = cache_new();
 
 	s->do_hold_req_ids = 0;
 	s->held_req_ids_count = 0;
@@ -1051,7 +1302,7 @@ void jdns_session_delete(jdns_session_t *s)
 	list_delete(s->queries);
 	list_delete(s->outgoing);
 	list_delete(s->events);
-	list_delete(s->cache);
+	cache_delete(s->cache);
 
 	if(s->held_req_ids)
 		free(s->held_req_ids);
@@ -1545,6 +1796,26 @@ void jdns_set_hold_ids_enabled(jdns_session_t *s, int enabled)
 	_set_hold_ids_enabled(s, enabled);
 }
 
+void jdns_set_cache_max(jdns_session_t *s, int max)
+{
+	s->cache->max = max;
+	while(s->cache->count > 0 && s->cache->count > max)
+	{
+		cache_remove(s->cache, s->cache->lru_last);
+		++s->cache->evictions;
+	}
+}
+
+void jdns_cache_stats(jdns_session_t *s, jdns_cache_stats_t *stats)
+{
+	stats->count = s->cache->count;
+	stats->max = s->cache->max;
+	stats->hits = s->cache->hits;
+	stats->misses = s->cache->misses;
+	stats->evictions = s->cache->evictions;
+	stats->expirations = s->cache->expirations;
+}
+
 //----------------------------------------------------------------------------
 // jdns - internal functions
 //----------------------------------------------------------------------------
@@ -1623,19 +1894,22 @@ void _remove_query_datagrams(jdns_session_t *s, const query_t *q)
 
 void _process_message(jdns_session_t *s, jdns_packet_t *p, int now, query_t *q, name_server_t *ns);
 
+void _cache_expire(jdns_session_t *s, int now);
+
 // return 1 if 'q' should be deleted, 0 if not
 int _process_response(jdns_session_t *s, jdns_response_t *r, int nxdomain, int now, query_t *q);
 
 jdns_response_t *_cache_get_response(jdns_session_t *s, const unsigned char *qname, int qtype, int *_lowest_timeleft)
 {
-	int n;
+	cache_item_t *i, *next;
+	unsigned int hash = cache_hash(qname, qtype);
 	int lowest_timeleft = -1;
 	int now = s->cb.time_now(s, s->cb.app);
 	jdns_response_t *r = 0;
-	for(n = 0; n < s->cache->count; ++n)
+	for(i = s->cache->buckets[hash & (JDNS_CACHE_BUCKETS - 1)]; i; i = next)
 	{
-		cache_item_t *i = (cache_item_t *)s->cache->item[n];
-		if(jdns_domain_cmp(i->qname, qname) && i->qtype == qtype)
+		next = i->next;
+		if(i->hash == hash && i->qtype == qtype && jdns_domain_cmp(i->qname, qname))
 		{
 			int passed, timeleft;
 
@@ -1649,6 +1923,8 @@ jdns_response_t *_cache_get_response(jdns_session_t *s, const unsigned char *qna
 			timeleft = (i->ttl * 1000) - passed;
 			if(lowest_timeleft == -1 || timeleft < lowest_timeleft)
 				lowest_timeleft = timeleft;
+
+			cache_touch(s->cache, i);
 		}
 	}
 	if(_lowest_timeleft)
@@ -1810,18 +2086,7 @@ int jdns_step_unicast(jdns_session_t *s, int now)
 	}
 
 	// expire cached items
-	for(n = 0; n < s->cache->count; ++n)
-	{
-		cache_item_t *i = (cache_item_t *)s->cache->item[n];
-		if(now >= i->time_start + (i->ttl * 1000))
-		{
-			jdns_string_t *str = _make_printable_cstr((const char *)i->qname);
-			_debug_line(s, "cache exp [%s]", str->data);
-			jdns_string_delete(str);
-			list_remove(s->cache, i);
-			--n; // adjust position
-		}
-	}
+	_cache_expire(s, now);
 
 	need_write = _unicast_do_writes(s, now);
 	need_read = _unicast_do_reads(s, now);
@@ -1841,15 +2106,9 @@ int jdns_step_unicast(jdns_session_t *s, int now)
 				smallest_time = timeleft;
 		}
 	}
-	for(n = 0; n < s->cache->count; ++n)
 	{
-		cache_item_t *i = (cache_item_t *)(s->cache->item[n]);
-		int passed = now - i->time_start;
-		int timeleft = (i->ttl * 1000) - passed;
-		if(timeleft < 0)
-			timeleft = 0;
-
-		if(smallest_time == -1 || timeleft < smallest_time)
+		int timeleft = cache_next_timeleft(s->cache, now);
+		if(timeleft != -1 && (smallest_time == -1 || timeleft < smallest_time))
 			smallest_time = timeleft;
 	}
 
@@ -1912,6 +2171,11 @@ int _unicast_do_writes(jdns_session_t *s, int now)
 				r = _cache_get_response(s, q->qname, qtype, &lowest_timeleft);
 			}
 
+			if(r)
+				++s->cache->hits;
+			else
+				++s->cache->misses;
+
 			if(r)
 			{
 				int nxdomain;
@@ -2151,8 +2415,20 @@ void _cache_add(jdns_session_t *s, const unsigned char *qname, int qtype, int ti
 	jdns_string_t *str;
 	if(ttl == 0)
 		return;
-	if(s->cache->count >= JDNS_CACHE_MAX)
+	if(s->cache->max <= 0)
 		return;
+
+	// make room by dropping what was used least recently
+	while(s->cache->count >= s->cache->max)
+	{
+		i = s->cache->lru_last;
+		str = _make_printable_cstr((const char *)i->qname);
+		_debug_line(s, "cache evict [%s]", str->data);
+		jdns_string_delete(str);
+		cache_remove(s->cache, i);
+		++s->cache->evictions;
+	}
+
 	i = cache_item_new();
 	i->qname = _ustrdup(qname);
 	i->qtype = qtype;
@@ -2160,7 +2436,7 @@ void _cache_add(jdns_session_t *s, const unsigned char *qname, int qtype, int ti
 	i->ttl = ttl;
 	if(record)
 		i->record = jdns_rr_copy(record);
-	list_insert(s->cache, i, -1);
+	cache_insert(s->cache, i);
 
 	str = _make_printable_cstr((const char *)i->qname);
 	_debug_line(s, "cache add [%s] for %d seconds", str->data, i->ttl);
@@ -2169,38 +2445,54 @@ void _cache_add(jdns_session_t *s, const unsigned char *qname, int qtype, int ti
 
 void _cache_remove_all_of_kind(jdns_session_t *s, const unsigned char *qname, int qtype)
 {
-	int n;
-	for(n = 0; n < s->cache->count; ++n)
+	cache_item_t *i, *next;
+	unsigned int hash = cache_hash(qname, qtype);
+	for(i = s->cache->buckets[hash & (JDNS_CACHE_BUCKETS - 1)]; i; i = next)
 	{
-		cache_item_t *i = (cache_item_t *)s->cache->item[n];
-		if(jdns_domain_cmp(i->qname, qname) && i->qtype == qtype)
+		next = i->next;
+		if(i->hash == hash && i->qtype == qtype && jdns_domain_cmp(i->qname, qname))
 		{
 			jdns_string_t *str = _make_printable_cstr((const char *)i->qname);
 			_debug_line(s, "cache del [%s]", str->data);
 			jdns_string_delete(str);
-			list_remove(s->cache, i);
-			--n; // adjust position
+			cache_remove(s->cache, i);
 		}
 	}
 }
 
 void _cache_remove_all_of_record(jdns_session_t *s, const jdns_rr_t *record)
 {
-	int n;
-	for(n = 0; n < s->cache->count; ++n)
+	cache_item_t *i, *next;
+	unsigned int hash = cache_hash(record->owner, record->type);
+	for(i = s->cache->rr_buckets[hash & (JDNS_CACHE_BUCKETS - 1)]; i; i = next)
 	{
-		cache_item_t *i = (cache_item_t *)s->cache->item[n];
-		if(i->record && _cmp_rr(i->record, record))
+		next = i->rr_next;
+		if(i->rr_hash == hash && _cmp_rr(i->record, record))
 		{
 			jdns_string_t *str = _make_printable_cstr((const char *)i->qname);
 			_debug_line(s, "cache del [%s]", str->data);
 			jdns_string_delete(str);
-			list_remove(s->cache, i);
-			--n; // adjust position
+			cache_remove(s->cache, i);
 		}
 	}
 }
 
+void _cache_expire(jdns_session_t *s, int now)
+{
+	cache_t *c = s->cache;
+
+	// the heap top expires first, stop at the first one still valid
+	while(c->count > 0 && now >= cache_item_expires(c->heap[0]))
+	{
+		cache_item_t *i = c->heap[0];
+		jdns_string_t *str = _make_printable_cstr((const char *)i->qname);
+		_debug_line(s, "cache exp [%s]", str->data);
+		jdns_string_delete(str);
+		cache_remove(c, i);
+		++c->expirations;
+	}
+}
+
 // same as _cache_add, but make sure the exact same record (name AND value)
 //   isn't stored twice, and make sure no more than one cname record per name
 //   is stored.
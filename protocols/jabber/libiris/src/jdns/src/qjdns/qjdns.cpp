@@ -284,6 +284,19 @@ bool QJDns::Record::verify() const
 	return (ok ? true : false);
 }
 
+//----------------------------------------------------------------------------
+// QJDns::CacheStats
+//----------------------------------------------------------------------------
+QJDns::CacheStats::CacheStats()
+{
+	count = 0;
+	max = 0;
+	hits = 0;
+	misses = 0;
+	evictions = 0;
+	expirations = 0;
+}
+
 //----------------------------------------------------------------------------
 // QJDns
 //----------------------------------------------------------------------------
@@ -838,6 +851,23 @@ void QJDns::shutdown()
 	d->process();
 }
 
+QJDns::CacheStats QJDns::cacheStats() const
+{
+	CacheStats out;
+	if(!d->sess)
+		return out;
+
+	jdns_cache_stats_t stats;
+	jdns_cache_stats(d->sess, &stats);
+	out.count = stats.count;
+	out.max = stats.max;
+	out.hits = stats.hits;
+	out.misses = stats.misses;
+	out.evictions = stats.evictions;
+	out.expirations = stats.expirations;
+	return out;
+}
+
 QStringList QJDns::debugLines()
 {
 	QStringList tmp = d->debug_strings;
@@ -610,6 +610,22 @@ void QJDnsShared::waitForShutdown(const QList<QJDnsShared*> &instances)
 	s.waitForShutdown(instances);
 }
 
+QJDns::CacheStats QJDnsShared::cacheStats() const
+{
+	QJDns::CacheStats out;
+	foreach(QJDnsSharedPrivate::Instance *i, d->instances)
+	{
+		QJDns::CacheStats stats = i->jdns->cacheStats();
+		out.count += stats.count;
+		out.max += stats.max;
+		out.hits += stats.hits;
+		out.misses += stats.misses;
+		out.evictions += stats.evictions;
+		out.expirations += stats.expirations;
+	}
+	return out;
+}
+
 bool QJDnsSharedPrivate::addInterface(const QHostAddress &addr)
 {
 	if(shutting_down)
@@ -0,0 +1,269 @@
+/*
+ * Copyright (C) 2010  Kopete Developers
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to
+ * the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+// tests for the unicast response cache.  the cache is private to jdns.c,
+//   so it is pulled in here directly and driven with a fake clock.
+
+#include "../src/jdns/jdns.c"
+
+#include <stdio.h>
+
+static int failures = 0;
+static int fake_now = 0;
+
+#define CHECK(cond) \
+	do { \
+		if(!(cond)) \
+		{ \
+			fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+			++failures; \
+		} \
+	} while(0)
+
+static int cb_time_now(jdns_session_t *s, void *app)
+{
+	(void)s;
+	(void)app;
+	return fake_now;
+}
+
+static void cb_debug_line(jdns_session_t *s, void *app, const char *str)
+{
+	(void)s;
+	(void)app;
+	(void)str;
+}
+
+static jdns_session_t *session_new()
+{
+	jdns_callbacks_t cb;
+	memset(&cb, 0, sizeof(cb));
+	cb.time_now = cb_time_now;
+	cb.debug_line = cb_debug_line;
+	fake_now = 0;
+	return jdns_session_new(&cb);
+}
+
+static void add_a(jdns_session_t *s, const char *name, int ttl)
+{
+	jdns_address_t *addr = jdns_address_new();
+	jdns_rr_t *rr = jdns_rr_new();
+	jdns_address_set_cstr(addr, "192.0.2.1");
+	jdns_rr_set_owner(rr, (const unsigned char *)name);
+	rr->ttl = ttl;
+	jdns_rr_set_A(rr, addr);
+	_cache_add(s, (const unsigned char *)name, JDNS_RTYPE_A, fake_now, ttl, rr);
+	jdns_rr_delete(rr);
+	jdns_address_delete(addr);
+}
+
+// number of answers cached for 'name', -1 if none
+static int lookup(jdns_session_t *s, const char *name, int *timeleft)
+{
+	int count;
+	jdns_response_t *r = _cache_get_response(s, (const unsigned char *)name, JDNS_RTYPE_A, timeleft);
+	if(!r)
+		return -1;
+	count = r->answerCount;
+	jdns_response_delete(r);
+	return count;
+}
+
+// every item must expire no earlier than its parent and know its position
+static int heap_valid(const cache_t *c)
+{
+	int n;
+	for(n = 0; n < c->count; ++n)
+	{
+		if(c->heap[n]->heap_index != n)
+			return 0;
+		if(n > 0 && cache_item_expires(c->heap[(n - 1) / 2]) > cache_item_expires(c->heap[n]))
+			return 0;
+	}
+	return 1;
+}
+
+static void test_insert_lookup()
+{
+	jdns_session_t *s = session_new();
+	int timeleft;
+
+	CHECK(lookup(s, "a.example.com.", &timeleft) == -1);
+	CHECK(cache_next_timeleft(s->cache, fake_now) == -1);
+
+	add_a(s, "a.example.com.", 60);
+	add_a(s, "b.example.com.", 30);
+	CHECK(s->cache->count == 2);
+
+	// names compare case-insensitively
+	CHECK(lookup(s, "A.Example.COM.", &timeleft) == 1);
+	CHECK(timeleft == 60000);
+
+	fake_now = 10000;
+	CHECK(lookup(s, "b.example.com.", &timeleft) == 1);
+	CHECK(timeleft == 20000);
+	CHECK(lookup(s, "c.example.com.", &timeleft) == -1);
+
+	jdns_session_delete(s);
+}
+
+static void test_expiry()
+{
+	jdns_session_t *s = session_new();
+	jdns_cache_stats_t stats;
+
+	add_a(s, "a.example.com.", 10);
+	add_a(s, "b.example.com.", 5);
+	add_a(s, "c.example.com.", 30);
+	CHECK(heap_valid(s->cache));
+	CHECK(cache_next_timeleft(s->cache, fake_now) == 5000);
+
+	// nothing is due yet
+	fake_now = 4999;
+	_cache_expire(s, fake_now);
+	CHECK(s->cache->count == 3);
+	CHECK(cache_next_timeleft(s->cache, fake_now) == 1);
+
+	fake_now = 5000;
+	_cache_expire(s, fake_now);
+	CHECK(s->cache->count == 2);
+	CHECK(lookup(s, "b.example.com.", 0) == -1);
+	CHECK(lookup(s, "a.example.com.", 0) == 1);
+	CHECK(cache_next_timeleft(s->cache, fake_now) == 5000);
+
+	// a step that comes late reports the overdue item right away
+	fake_now = 20000;
+	CHECK(cache_next_timeleft(s->cache, fake_now) == 0);
+
+	// far beyond every ttl
+	fake_now = 1000000;
+	_cache_expire(s, fake_now);
+	CHECK(s->cache->count == 0);
+	CHECK(cache_next_timeleft(s->cache, fake_now) == -1);
+
+	jdns_cache_stats(s, &stats);
+	CHECK(stats.expirations == 3);
+
+	jdns_session_delete(s);
+}
+
+static void test_eviction()
+{
+	jdns_session_t *s = session_new();
+	jdns_cache_stats_t stats;
+
+	jdns_set_cache_max(s, 2);
+	add_a(s, "a.example.com.", 60);
+	add_a(s, "b.example.com.", 60);
+
+	// using 'a' makes 'b' the least recently used one
+	CHECK(lookup(s, "a.example.com.", 0) == 1);
+	add_a(s, "c.example.com.", 60);
+
+	CHECK(s->cache->count == 2);
+	CHECK(lookup(s, "a.example.com.", 0) == 1);
+	CHECK(lookup(s, "b.example.com.", 0) == -1);
+	CHECK(lookup(s, "c.example.com.", 0) == 1);
+	CHECK(heap_valid(s->cache));
+
+	jdns_cache_stats(s, &stats);
+	CHECK(stats.count == 2);
+	CHECK(stats.evictions == 1);
+
+	// shrinking the bound evicts right away, 'c' was looked up last
+	jdns_set_cache_max(s, 1);
+	CHECK(s->cache->count == 1);
+	CHECK(lookup(s, "a.example.com.", 0) == -1);
+	CHECK(lookup(s, "c.example.com.", 0) == 1);
+	CHECK(heap_valid(s->cache));
+
+	jdns_session_delete(s);
+}
+
+// many items with mixed ttls, removed in arbitrary order.  the next
+//   timer must always match the earliest expiry
+static void test_heap_order()
+{
+	jdns_session_t *s = session_new();
+	char name[64];
+	int n;
+
+	for(n = 0; n < 1000; ++n)
+	{
+		fake_now = n * 7;
+		jdns_sprintf_s(name, sizeof(name), "host%d.example.com.", n);
+		add_a(s, name, 1 + (n * 7919) % 3600);
+	}
+	CHECK(s->cache->count == 1000);
+	CHECK(heap_valid(s->cache));
+
+	// duplicate removal takes items out of the middle of the heap
+	for(n = 0; n < 1000; n += 3)
+	{
+		jdns_sprintf_s(name, sizeof(name), "host%d.example.com.", n);
+		_cache_remove_all_of_kind(s, (const unsigned char *)name, JDNS_RTYPE_A);
+	}
+	CHECK(heap_valid(s->cache));
+
+	while(s->cache->count > 0)
+	{
+		int lowest = -1;
+		int timeleft;
+		cache_item_t *i;
+
+		for(i = s->cache->lru_first; i; i = i->lru_next)
+		{
+			if(lowest == -1 || cache_item_expires(i) < lowest)
+				lowest = cache_item_expires(i);
+		}
+
+		timeleft = cache_next_timeleft(s->cache, fake_now);
+		CHECK(timeleft == (lowest > fake_now ? lowest - fake_now : 0));
+		if(timeleft != (lowest > fake_now ? lowest - fake_now : 0))
+			break;
+
+		fake_now += timeleft;
+		n = s->cache->count;
+		_cache_expire(s, fake_now);
+		CHECK(s->cache->count < n);
+		CHECK(heap_valid(s->cache));
+	}
+
+	jdns_session_delete(s);
+}
+
+int main()
+{
+	test_insert_lookup();
+	test_expiry();
+	test_eviction();
+	test_heap_order();
+
+	if(failures)
+	{
+		fprintf(stderr, "%d checks failed\n", failures);
+		return 1;
+	}
+	printf("all cache tests passed\n");
+	return 0;
+}
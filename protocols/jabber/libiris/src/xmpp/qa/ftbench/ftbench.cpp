@@ -0,0 +1,639 @@
+/*
+ * ftbench.cpp - loopback file transfer benchmark
+ * Copyright (C) 2013  Kopete Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+// Sends a file between two XMPP::Client instances in one process. They talk
+// to a stand-in server that only knows enough XMPP to log them in and route
+// stanzas between them (optionally with added latency), and to a SOCKS5
+// proxy that pairs and relays S5B connections.
+//
+//   ftbench [-s megabytes] [-l latency-ms] [-m direct,proxy,ibb]
+
+#include <QtCore>
+#include <QtNetwork>
+#include <QtCrypto>
+
+#include <stdio.h>
+#include <time.h>
+
+#include "xmpp/xmpp-core/xmpp.h"
+#include "xmpp/xmpp-core/parser.h"
+#include "xmpp/xmpp-im/xmpp_client.h"
+#include "xmpp/xmpp-im/xmpp_tasks.h"
+#include "xmpp/xmpp-im/filetransfer.h"
+#include "xmpp/xmpp-im/s5b.h"
+#include "xmpp/xmpp-im/xmpp_ibb.h"
+#include "socks.h"
+
+using namespace XMPP;
+
+static const char *SERVER_DOMAIN = "localhost";
+static const char *PROXY_JID = "proxy.localhost";
+
+//----------------------------------------------------------------------------
+// allocation counter
+//----------------------------------------------------------------------------
+static volatile long allocations = 0;
+
+#ifdef __GLIBC__
+extern "C" {
+extern void *__libc_malloc(size_t);
+extern void *__libc_calloc(size_t, size_t);
+extern void *__libc_realloc(void *, size_t);
+
+void *malloc(size_t size) __THROW
+{
+	__sync_fetch_and_add(&allocations, 1);
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size) __THROW
+{
+	__sync_fetch_and_add(&allocations, 1);
+	return __libc_calloc(n, size);
+}
+
+void *realloc(void *p, size_t size) __THROW
+{
+	__sync_fetch_and_add(&allocations, 1);
+	return __libc_realloc(p, size);
+}
+}
+#define HAVE_ALLOC_COUNT
+#endif
+
+//----------------------------------------------------------------------------
+// ServerSession - one client connection to the stand-in server
+//----------------------------------------------------------------------------
+class StandInServer;
+
+class ServerSession : public QObject
+{
+	Q_OBJECT
+public:
+	ServerSession(StandInServer *server, QTcpSocket *sock);
+
+	QString jid() const { return _jid; }
+
+	// send with the server's injected latency
+	void deliver(const QByteArray &data);
+	// send right away
+	void send(const QString &s);
+
+private slots:
+	void sock_readyRead();
+	void flush();
+
+private:
+	void handleElement(QDomElement e);
+	void sendStreamOpen();
+
+	StandInServer *_server;
+	QTcpSocket *_sock;
+	Parser _parser;
+	QString _user, _jid;
+	bool _authed;
+
+	QList< QPair<int, QByteArray> > _queue; // due time, data
+	QTime _clock;
+	QTimer _timer;
+};
+
+class StandInServer : public QObject
+{
+	Q_OBJECT
+public:
+	StandInServer(int latency, int proxyPort)
+		: _latency(latency), _proxyPort(proxyPort)
+	{
+		connect(&_serv, SIGNAL(newConnection()), SLOT(serv_newConnection()));
+		_serv.listen(QHostAddress::LocalHost, 0);
+	}
+
+	int port() const { return _serv.serverPort(); }
+	int latency() const { return _latency; }
+	int proxyPort() const { return _proxyPort; }
+
+	ServerSession *findSession(const Jid &j) const
+	{
+		foreach(ServerSession *s, _sessions) {
+			if(j.compare(Jid(s->jid()), !j.resource().isEmpty()))
+				return s;
+		}
+		return 0;
+	}
+
+private slots:
+	void serv_newConnection()
+	{
+		while(QTcpSocket *sock = _serv.nextPendingConnection())
+			_sessions += new ServerSession(this, sock);
+	}
+
+private:
+	QTcpServer _serv;
+	QList<ServerSession*> _sessions;
+	int _latency;
+	int _proxyPort;
+};
+
+ServerSession::ServerSession(StandInServer *server, QTcpSocket *sock)
+	: QObject(server), _server(server), _sock(sock), _authed(false)
+{
+	_sock->setParent(this);
+	connect(_sock, SIGNAL(readyRead()), SLOT(sock_readyRead()));
+	_clock.start();
+	_timer.setSingleShot(true);
+	connect(&_timer, SIGNAL(timeout()), SLOT(flush()));
+}
+
+void ServerSession::send(const QString &s)
+{
+	_sock->write(s.toUtf8());
+}
+
+void ServerSession::deliver(const QByteArray &data)
+{
+	if(_server->latency() <= 0) {
+		_sock->write(data);
+		return;
+	}
+
+	_queue += qMakePair(_clock.elapsed() + _server->latency(), data);
+	if(!_timer.isActive())
+		flush();
+}
+
+void ServerSession::flush()
+{
+	int now = _clock.elapsed();
+	while(!_queue.isEmpty() && _queue.first().first <= now)
+		_sock->write(_queue.takeFirst().second);
+	if(!_queue.isEmpty())
+		_timer.start(_queue.first().first - now);
+}
+
+void ServerSession::sock_readyRead()
+{
+	_parser.appendData(_sock->readAll());
+	for(Parser::Event e = _parser.readNext(); !e.isNull(); e = _parser.readNext()) {
+		if(e.type() == Parser::Event::DocumentOpen)
+			sendStreamOpen();
+		else if(e.type() == Parser::Event::Element)
+			handleElement(e.element());
+		else if(e.type() == Parser::Event::Error)
+			_sock->close();
+	}
+}
+
+void ServerSession::sendStreamOpen()
+{
+	QString s = QString("<?xml version='1.0'?><stream:stream xmlns='jabber:client' "
+		"xmlns:stream='http://etherx.jabber.org/streams' id='%1' from='%2' version='1.0'>")
+		.arg(QString::number(qrand()), SERVER_DOMAIN);
+	s += "<stream:features>";
+	if(!_authed)
+		s += "<mechanisms xmlns='urn:ietf:params:xml:ns:xmpp-sasl'><mechanism>PLAIN</mechanism></mechanisms>";
+	else
+		s += "<bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'/><session xmlns='urn:ietf:params:xml:ns:xmpp-session'/>";
+	s += "</stream:features>";
+	send(s);
+}
+
+void ServerSession::handleElement(QDomElement e)
+{
+	QString id = e.attribute("id");
+	QString type = e.attribute("type");
+
+	if(!_authed) {
+		if(e.tagName() != "auth")
+			return;
+		// authzid \0 authcid \0 password, anything goes
+		QList<QByteArray> parts = QByteArray::fromBase64(e.text().toLatin1()).split('\0');
+		_user = parts.count() > 1? QString::fromUtf8(parts[1]) : QString("user");
+		_authed = true;
+		send("<success xmlns='urn:ietf:params:xml:ns:xmpp-sasl'/>");
+		// the client restarts the stream, nothing else is sent before that
+		_parser.reset();
+		return;
+	}
+
+	if(e.tagName() == "iq" && !e.firstChildElement("bind").isNull()) {
+		QString resource = e.firstChildElement("bind").firstChildElement("resource").text();
+		if(resource.isEmpty())
+			resource = "ftbench";
+		_jid = Jid(_user, SERVER_DOMAIN, resource).full();
+		send(QString("<iq type='result' id='%1'><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'><jid>%2</jid></bind></iq>")
+			.arg(id, _jid));
+		return;
+	}
+
+	Jid to(e.attribute("to"));
+	bool request = e.tagName() == "iq" && (type == "get" || type == "set");
+
+	// session, roster, disco, ... nothing to say about any of them
+	if(to.isEmpty() || to.full() == SERVER_DOMAIN) {
+		if(request)
+			send(QString("<iq type='result' id='%1' to='%2'/>").arg(id, _jid));
+		return;
+	}
+
+	// xep-0065 proxy: hand out the streamhost, accept any activation
+	if(to.full() == PROXY_JID) {
+		if(!request)
+			return;
+		QString query;
+		if(type == "get")
+			query = QString("<query xmlns='http://jabber.org/protocol/bytestreams'>"
+				"<streamhost jid='%1' host='127.0.0.1' port='%2'/></query>")
+				.arg(PROXY_JID, QString::number(_server->proxyPort()));
+		deliver(QString("<iq type='result' id='%1' from='%2' to='%3'>%4</iq>")
+			.arg(id, PROXY_JID, _jid, query).toUtf8());
+		return;
+	}
+
+	ServerSession *peer = _server->findSession(to);
+	if(!peer) {
+		if(request)
+			send(QString("<iq type='error' id='%1' from='%2' to='%3'><error type='cancel'>"
+				"<service-unavailable xmlns='urn:ietf:params:xml:ns:xmpp-stanzas'/></error></iq>")
+				.arg(id, to.full(), _jid));
+		return;
+	}
+
+	e.setAttribute("from", _jid);
+	peer->deliver(Stream::xmlToString(e).toUtf8());
+}
+
+//----------------------------------------------------------------------------
+// Socks5Proxy - pairs the two connections for the same stream and relays
+//----------------------------------------------------------------------------
+class Socks5Proxy : public QObject
+{
+	Q_OBJECT
+public:
+	Socks5Proxy()
+	{
+		connect(&_serv, SIGNAL(incomingReady()), SLOT(serv_incomingReady()));
+		_serv.listen(0);
+	}
+
+	int port() const { return _serv.port(); }
+
+private slots:
+	void serv_incomingReady()
+	{
+		SocksClient *sc = _serv.takeIncoming();
+		if(!sc)
+			return;
+		sc->setParent(this);
+		connect(sc, SIGNAL(incomingMethods(int)), SLOT(sc_incomingMethods(int)));
+		connect(sc, SIGNAL(incomingConnectRequest(QString,int)), SLOT(sc_incomingConnectRequest(QString,int)));
+		connect(sc, SIGNAL(readyRead()), SLOT(sc_readyRead()));
+	}
+
+	void sc_incomingMethods(int m)
+	{
+		SocksClient *sc = static_cast<SocksClient*>(sender());
+		if(m & SocksClient::AuthNone)
+			sc->chooseMethod(SocksClient::AuthNone);
+		else
+			sc->requestDeny();
+	}
+
+	void sc_incomingConnectRequest(const QString &host, int)
+	{
+		// the host is the stream hash, the same for both sides
+		SocksClient *sc = static_cast<SocksClient*>(sender());
+		sc->grantConnect();
+
+		SocksClient *other = _waiting.take(host);
+		if(!other) {
+			_waiting.insert(host, sc);
+			return;
+		}
+		_peers.insert(sc, other);
+		_peers.insert(other, sc);
+		relay(sc);
+		relay(other);
+	}
+
+	void sc_readyRead()
+	{
+		relay(static_cast<SocksClient*>(sender()));
+	}
+
+private:
+	void relay(SocksClient *sc)
+	{
+		SocksClient *other = _peers.value(sc);
+		if(other && sc->bytesAvailable())
+			other->write(sc->readAll());
+	}
+
+	SocksServer _serv;
+	QHash<QString, SocksClient*> _waiting;
+	QHash<SocksClient*, SocksClient*> _peers;
+};
+
+//----------------------------------------------------------------------------
+// BenchClient - one logged in XMPP::Client
+//----------------------------------------------------------------------------
+class BenchClient : public QObject
+{
+	Q_OBJECT
+public:
+	BenchClient(const QString &node, int port)
+		: _jid(node, SERVER_DOMAIN, "ftbench")
+	{
+		_conn = new AdvancedConnector(this);
+		_conn->setOptHostPort("127.0.0.1", port);
+		_stream = new ClientStream(_conn, 0, this);
+		_stream->setAllowPlain(ClientStream::AllowPlain);
+		_stream->setRequireMutualAuth(false);
+		connect(_stream, SIGNAL(needAuthParams(bool,bool,bool)), SLOT(cs_needAuthParams(bool,bool,bool)));
+		connect(_stream, SIGNAL(authenticated()), SLOT(cs_authenticated()));
+		connect(_stream, SIGNAL(warning(int)), _stream, SLOT(continueAfterWarning()));
+		connect(_stream, SIGNAL(error(int)), SLOT(cs_error(int)));
+
+		_client = new Client(this);
+		_client->setFileTransferEnabled(true);
+	}
+
+	Client *client() const { return _client; }
+	Jid jid() const { return _jid; }
+
+	void connectToServer()
+	{
+		_client->connectToServer(_stream, _jid);
+	}
+
+signals:
+	void ready();
+	void failed();
+
+private slots:
+	void cs_needAuthParams(bool user, bool pass, bool)
+	{
+		if(user)
+			_stream->setUsername(_jid.node());
+		if(pass)
+			_stream->setPassword("ftbench");
+		_stream->continueAfterParams();
+	}
+
+	void cs_authenticated()
+	{
+		_client->start(_jid.domain(), _jid.node(), "ftbench", _jid.resource());
+		JT_Session *j = new JT_Session(_client->rootTask());
+		connect(j, SIGNAL(finished()), SIGNAL(ready()));
+		j->go(true);
+	}
+
+	void cs_error(int x)
+	{
+		fprintf(stderr, "%s: stream error %d\n", qPrintable(_jid.full()), x);
+		emit failed();
+	}
+
+private:
+	Jid _jid;
+	AdvancedConnector *_conn;
+	ClientStream *_stream;
+	Client *_client;
+};
+
+//----------------------------------------------------------------------------
+// Bench - runs one transfer per method and prints the results
+//----------------------------------------------------------------------------
+class Bench : public QObject
+{
+	Q_OBJECT
+public:
+	Bench(qint64 size, int latency, const QStringList &methods)
+		: _size(size), _methods(methods), _server(latency, _proxy.port()),
+		  _sender("sender", _server.port()), _receiver("receiver", _server.port()),
+		  _ready(0), _ft(0), _incoming(0)
+	{
+		_s5bServer.start(0);
+		_s5bServer.setHostList(QStringList() << "127.0.0.1");
+
+		connect(&_sender, SIGNAL(ready()), SLOT(clientReady()));
+		connect(&_receiver, SIGNAL(ready()), SLOT(clientReady()));
+		connect(&_sender, SIGNAL(failed()), SLOT(fail()));
+		connect(&_receiver, SIGNAL(failed()), SLOT(fail()));
+		connect(_receiver.client()->fileTransferManager(), SIGNAL(incomingReady()), SLOT(incomingReady()));
+
+		_sender.connectToServer();
+		_receiver.connectToServer();
+
+		printf("%-8s %10s %10s %10s %12s %12s\n", "method", "size (MB)", "time (s)", "MB/s", "cpu ms/MB", "allocs/MB");
+	}
+
+private slots:
+	void clientReady()
+	{
+		if(++_ready == 2)
+			next();
+	}
+
+	void next()
+	{
+		cleanup();
+		if(_methods.isEmpty()) {
+			QCoreApplication::exit(0);
+			return;
+		}
+		_method = _methods.takeFirst();
+
+		if(!makeSource()) {
+			fail();
+			return;
+		}
+
+		FileTransferManager *ftm = _sender.client()->fileTransferManager();
+		ftm->setDisabled(S5BManager::ns(), _method == "ibb");
+		ftm->setDisabled(IBBManager::ns(), _method != "ibb");
+		// only the direct run has a streamhost of its own
+		_sender.client()->s5bManager()->setServer(_method == "direct"? &_s5bServer : 0);
+
+		_received = 0;
+		_startAllocations = allocations;
+		_startCpu = clock();
+		_wall.start();
+
+		_ft = ftm->createTransfer();
+		if(_method == "proxy")
+			_ft->setProxy(Jid(PROXY_JID));
+		_ft->setFile(&_source);
+		connect(_ft, SIGNAL(error(int)), SLOT(ftError(int)));
+		_ft->sendFile(_receiver.jid(), "ftbench.dat", _size, QString(), FTThumbnail());
+	}
+
+	void incomingReady()
+	{
+		_incoming = _receiver.client()->fileTransferManager()->takeIncoming();
+		if(!_incoming)
+			return;
+		_target.setFileName(_dir.path() + "/target");
+		if(!_target.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+			fail();
+			return;
+		}
+		_incoming->setFile(&_target);
+		connect(_incoming, SIGNAL(bytesReceived(qint64)), SLOT(bytesReceived(qint64)));
+		connect(_incoming, SIGNAL(error(int)), SLOT(ftError(int)));
+		_incoming->accept();
+	}
+
+	void bytesReceived(qint64 x)
+	{
+		_received += x;
+		if(_received < _size)
+			return;
+
+		double secs = _wall.elapsed() / 1000.0;
+		double cpu = double(clock() - _startCpu) * 1000.0 / CLOCKS_PER_SEC;
+		double mb = _size / (1024.0 * 1024.0);
+		long allocs = allocations - _startAllocations;
+
+		printf("%-8s %10.1f %10.2f %10.2f %12.2f ", qPrintable(_method), mb, secs,
+			   secs > 0? mb / secs : 0.0, cpu / mb);
+#ifdef HAVE_ALLOC_COUNT
+		printf("%12.0f\n", allocs / mb);
+#else
+		Q_UNUSED(allocs);
+		printf("%12s\n", "n/a");
+#endif
+		fflush(stdout);
+
+		QTimer::singleShot(0, this, SLOT(next()));
+	}
+
+	void ftError(int x)
+	{
+		fprintf(stderr, "%s: transfer error %d\n", qPrintable(_method), x);
+		fail();
+	}
+
+	void fail()
+	{
+		cleanup();
+		QCoreApplication::exit(1);
+	}
+
+private:
+	bool makeSource()
+	{
+		_source.setFileName(_dir.path() + "/source");
+		if(!_source.open(QIODevice::ReadWrite | QIODevice::Truncate))
+			return false;
+		QByteArray block(1024 * 1024, 0);
+		for(int n = 0; n < block.size(); ++n)
+			block[n] = char(qrand());
+		for(qint64 left = _size; left > 0; left -= block.size())
+			_source.write(block.constData(), qMin(left, (qint64)block.size()));
+		_source.flush();
+		_source.seek(0);
+		return true;
+	}
+
+	void cleanup()
+	{
+		// disconnect first, closing may report errors
+		if(_ft) {
+			_ft->disconnect(this);
+			_ft->close();
+			_ft->deleteLater();
+			_ft = 0;
+		}
+		if(_incoming) {
+			_incoming->disconnect(this);
+			_incoming->close();
+			_incoming->deleteLater();
+			_incoming = 0;
+		}
+		_source.close();
+		_target.close();
+	}
+
+	qint64 _size;
+	QStringList _methods;
+	QString _method;
+
+	Socks5Proxy _proxy;
+	StandInServer _server;
+	S5BServer _s5bServer;
+	BenchClient _sender, _receiver;
+	int _ready;
+
+	struct TempDir
+	{
+		TempDir()
+		{
+			_path = QDir::tempPath() + QString("/ftbench-%1").arg(QCoreApplication::applicationPid());
+			QDir().mkpath(_path);
+		}
+		~TempDir()
+		{
+			QDir d(_path);
+			foreach(const QString &f, d.entryList(QDir::Files))
+				d.remove(f);
+			QDir().rmdir(_path);
+		}
+		QString path() const { return _path; }
+		QString _path;
+	} _dir;
+
+	QFile _source, _target;
+	FileTransfer *_ft, *_incoming;
+	qint64 _received;
+	long _startAllocations;
+	clock_t _startCpu;
+	QTime _wall;
+};
+
+int main(int argc, char **argv)
+{
+	QCA::Initializer init;
+	QCoreApplication app(argc, argv);
+
+	qint64 size = 64;
+	int latency = 0;
+	QStringList methods = QStringList() << "direct" << "proxy" << "ibb";
+
+	QStringList args = app.arguments();
+	for(int n = 1; n < args.count(); ++n) {
+		if(args[n] == "-s" && n + 1 < args.count())
+			size = args[++n].toLongLong();
+		else if(args[n] == "-l" && n + 1 < args.count())
+			latency = args[++n].toInt();
+		else if(args[n] == "-m" && n + 1 < args.count())
+			methods = args[++n].split(',');
+		else {
+			fprintf(stderr, "usage: %s [-s megabytes] [-l latency-ms] [-m direct,proxy,ibb]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	Bench bench(size * 1024 * 1024, latency, methods);
+	return app.exec();
+}
+
+#include "ftbench.moc"
@@ -0,0 +1,15 @@
+include(../../modules.pri)
+include(../../../../iris.pri)
+include(../../common.pri)
+
+CONFIG += crypto console
+CONFIG -= app_bundle
+QT += network xml
+QT -= gui
+
+TARGET = ftbench
+
+SOURCES += \
+	ftbench.cpp
+
+QMAKE_CLEAN += $(QMAKE_TARGET)
@@ -2,3 +2,5 @@
 
 include($$PWD/../base/unittest/unittest.pri)
 include($$PWD/../sasl/unittest/unittest.pri)
+include($$PWD/../zlib/unittest/unittest.pri)
+include($$PWD/../xmpp-core/unittest/unittest.pri)
@@ -5,14 +5,21 @@
 #include "xmpp/zlib/zlibcompressor.h"
 #include "xmpp/zlib/zlibdecompressor.h"
 
-CompressionHandler::CompressionHandler()
+CompressionHandler::CompressionHandler(int level, FlushPolicy policy)
 	: errorCode_(0)
+	, policy_(policy)
+	, flushPending_(false)
+	, readPending_(false)
+	, plainBytes_(0)
 {
 	outgoing_buffer_.open(QIODevice::ReadWrite);
-	compressor_ = new ZLibCompressor(&outgoing_buffer_);
+	compressor_ = new ZLibCompressor(&outgoing_buffer_, level);
+	compressor_->setFlushPolicy(policy == FlushPerWrite ? ZLibCompressor::FlushEveryWrite : ZLibCompressor::FlushOnSync);
 
+	// Inflate straight into the array that read() hands to the parser
 	incoming_buffer_.open(QIODevice::ReadWrite);
 	decompressor_ = new ZLibDecompressor(&incoming_buffer_);
+	decompressor_->setOutputBuffer(&incoming_buffer_.buffer());
 }
 
 CompressionHandler::~CompressionHandler()
@@ -21,30 +28,68 @@ CompressionHandler::~CompressionHandler()
 	delete decompressor_;
 }
 
+void CompressionHandler::setFlushPolicy(FlushPolicy policy)
+{
+	if (policy_ == policy)
+		return;
+
+	policy_ = policy;
+	compressor_->setFlushPolicy(policy == FlushPerWrite ? ZLibCompressor::FlushEveryWrite : ZLibCompressor::FlushOnSync);
+}
+
+CompressionHandler::FlushPolicy CompressionHandler::flushPolicy() const
+{
+	return policy_;
+}
+
 void CompressionHandler::writeIncoming(const QByteArray& a)
 {
 	//qDebug("CompressionHandler::writeIncoming");
 	//qDebug() << QString("Incoming %1 bytes").arg(a.size());
 	errorCode_ = decompressor_->write(a);
-	if (!errorCode_)
-		QTimer::singleShot(0, this, SIGNAL(readyRead()));
-	else
+	if (errorCode_) {
 		QTimer::singleShot(0, this, SIGNAL(error()));
+	}
+	else if (!readPending_) {
+		// a single notification is enough, read() drains everything
+		readPending_ = true;
+		QTimer::singleShot(0, this, SIGNAL(readyRead()));
+	}
 }
 
 void CompressionHandler::write(const QByteArray& a)
 {
 	//qDebug() << QString("CompressionHandler::write(%1)").arg(a.size());
 	errorCode_ = compressor_->write(a);
-	if (!errorCode_)
-		QTimer::singleShot(0, this, SIGNAL(readyReadOutgoing()));
-	else
+	if (errorCode_) {
 		QTimer::singleShot(0, this, SIGNAL(error()));
+		return;
+	}
+
+	plainBytes_ += a.size();
+	if (!flushPending_) {
+		flushPending_ = true;
+		QTimer::singleShot(0, this, SLOT(flushOutgoing()));
+	}
+}
+
+void CompressionHandler::flushOutgoing()
+{
+	flushPending_ = false;
+	if (policy_ == FlushPerBatch) {
+		errorCode_ = compressor_->sync();
+		if (errorCode_) {
+			emit error();
+			return;
+		}
+	}
+	emit readyReadOutgoing();
 }
 
 QByteArray CompressionHandler::read()
 {
 	//qDebug("CompressionHandler::read");
+	readPending_ = false;
 	QByteArray b = incoming_buffer_.buffer();
 	incoming_buffer_.buffer().clear();
 	incoming_buffer_.reset();
@@ -58,7 +103,8 @@ QByteArray CompressionHandler::readOutgoing(int* i)
 	QByteArray b = outgoing_buffer_.buffer();
 	outgoing_buffer_.buffer().clear();
 	outgoing_buffer_.reset();
-	*i = b.size();
+	*i = plainBytes_;
+	plainBytes_ = 0;
 	return b;
 }
 
@@ -12,7 +12,15 @@ class CompressionHandler : public QObject
 	Q_OBJECT
 
 public:
-	CompressionHandler();
+	/**
+	 * FlushPerWrite sync-flushes the compressor after every write() (the
+	 * historic behaviour). FlushPerBatch compresses writes as they come and
+	 * emits a single sync flush once control returns to the event loop, so
+	 * stanzas queued in the same turn share one flush marker.
+	 */
+	enum FlushPolicy { FlushPerWrite, FlushPerBatch };
+
+	CompressionHandler(int level = -1, FlushPolicy policy = FlushPerBatch);
 	~CompressionHandler();
 	void writeIncoming(const QByteArray& a);
 	void write(const QByteArray& a);
@@ -20,16 +28,26 @@ public:
 	QByteArray readOutgoing(int*);
 	int errorCode();
 
+	void setFlushPolicy(FlushPolicy policy);
+	FlushPolicy flushPolicy() const;
+
 signals:
 	void readyRead();
 	void readyReadOutgoing();
 	void error();
 
+private slots:
+	void flushOutgoing();
+
 private:
 	ZLibCompressor* compressor_;
 	ZLibDecompressor* decompressor_;
 	QBuffer outgoing_buffer_, incoming_buffer_;
 	int errorCode_;
+	FlushPolicy policy_;
+	bool flushPending_;
+	bool readPending_;
+	int plainBytes_;
 };
 
 #endif
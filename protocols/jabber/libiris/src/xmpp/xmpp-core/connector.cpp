@@ -33,11 +33,13 @@
 
 #include <QPointer>
 #include <QList>
+#include <QStringList>
 #include <QUrl>
 #include <QTimer>
 #include <qca.h>
 
 #include "bsocket.h"
+#include "boshstream.h"
 #include "httpconnect.h"
 #include "httppoll.h"
 #include "socks.h"
@@ -122,6 +124,8 @@ AdvancedConnector::Proxy::Proxy()
 {
 	t = None;
 	v_poll = 30;
+	v_hold = 1;
+	v_wait = 60;
 }
 
 AdvancedConnector::Proxy::~Proxy()
@@ -163,6 +167,16 @@ int AdvancedConnector::Proxy::pollInterval() const
 	return v_poll;
 }
 
+int AdvancedConnector::Proxy::boshHold() const
+{
+	return v_hold;
+}
+
+int AdvancedConnector::Proxy::boshWait() const
+{
+	return v_wait;
+}
+
 void AdvancedConnector::Proxy::setHttpConnect(const QString &host, quint16 port)
 {
 	t = HttpConnect;
@@ -178,6 +192,14 @@ void AdvancedConnector::Proxy::setHttpPoll(const QString &host, quint16 port, co
 	v_url = url;
 }
 
+void AdvancedConnector::Proxy::setBosh(const QString &host, quint16 port, const QUrl &url)
+{
+	t = Bosh;
+	v_host = host;
+	v_port = port;
+	v_url = url;
+}
+
 void AdvancedConnector::Proxy::setSocks(const QString &host, quint16 port)
 {
 	t = Socks;
@@ -196,6 +218,12 @@ void AdvancedConnector::Proxy::setPollInterval(int secs)
 	v_poll = secs;
 }
 
+void AdvancedConnector::Proxy::setBoshHoldWait(int hold, int secs)
+{
+	v_hold = hold;
+	v_wait = secs;
+}
+
 
 //----------------------------------------------------------------------------
 // AdvancedConnector
@@ -336,6 +364,20 @@ void AdvancedConnector::connectToServer(const QString &server)
 		else
 			s->connectToHost(d->proxy.host(), d->proxy.port(), d->proxy.url());
 	}
+	else if (d->proxy.type() == Proxy::Bosh) {
+		BoshStream *s = new BoshStream;
+		d->bs = s;
+
+		connect(s, SIGNAL(connected()), SLOT(bs_connected()));
+		connect(s, SIGNAL(error(int)), SLOT(bs_error(int)));
+
+		if(!d->proxy.host().isEmpty())
+			s->setProxy(d->proxy.host(), d->proxy.port(), d->proxy.user(), d->proxy.pass());
+		s->setHold(d->proxy.boshHold());
+		s->setWait(d->proxy.boshWait());
+
+		s->connectToUrl(d->proxy.url(), d->host);
+	}
 	else if (d->proxy.type() == Proxy::HttpConnect) {
 		HttpConnect *s = new HttpConnect;
 		d->bs = s;
@@ -419,6 +461,35 @@ int AdvancedConnector::errorCode() const
 	return d->errorCode;
 }
 
+QString AdvancedConnector::connectTimings() const
+{
+	if(!d->bs || d->proxy.type() != Proxy::None)
+		return QString();
+
+	BSocket *s = static_cast<BSocket*>(d->bs);
+	QStringList parts;
+	if(s->lookupTime() != -1)
+		parts += QString("lookup %1ms").arg(s->lookupTime());
+	foreach(const BSocket::ConnectAttempt &a, s->connectAttempts()) {
+		QString peer = a.address.protocol() == QAbstractSocket::IPv6Protocol ?
+			QString("[%1]:%2").arg(a.address.toString()).arg(a.port) :
+			QString("%1:%2").arg(a.address.toString()).arg(a.port);
+		QString result;
+		switch(a.result) {
+			case BSocket::ConnectAttempt::Connected: result = "connected"; break;
+			case BSocket::ConnectAttempt::Failed: result = "failed"; break;
+			case BSocket::ConnectAttempt::Cancelled: result = "cancelled"; break;
+			default: result = "pending"; break;
+		}
+		if(a.finished != -1)
+			result += QString(" after %1ms").arg(a.finished - a.started);
+		parts += QString("%1 at %2ms %3").arg(peer).arg(a.started).arg(result);
+	}
+	if(s->connectTime() != -1)
+		parts += QString("connected in %1ms").arg(s->connectTime());
+	return parts.join(", ");
+}
+
 void AdvancedConnector::bs_connected()
 {
 #ifdef XMPP_DEBUG
@@ -433,7 +504,8 @@ void AdvancedConnector::bs_connected()
 	bool ssl_disabled = d->proxy.type() == Proxy::None &&
 			(static_cast<BSocket*>(d->bs)->isPeerFromSrv() || d->port == XMPP_DEFAULT_PORT);
 	// only allow ssl override if proxy==poll or host:port or when probing legacy ssl port
-	if(d->proxy.type() != Proxy::HttpPoll  && d->opt_ssl != Never && !ssl_disabled)
+	// (BOSH brings its own, through https)
+	if(d->proxy.type() != Proxy::HttpPoll && d->proxy.type() != Proxy::Bosh && d->opt_ssl != Never && !ssl_disabled)
 		setUseSSL(true);
 
 	d->mode = Connected;
@@ -497,6 +569,21 @@ void AdvancedConnector::bs_error(int x)
 				err = ErrProxyConnect;
 		}
 	}
+	else if(t == Proxy::Bosh) {
+		if(x == BoshStream::ErrConnectionRefused)
+			err = ErrConnectionRefused;
+		else if(x == BoshStream::ErrHostNotFound)
+			err = ErrHostNotFound;
+		else {
+			proxyError = true;
+			if(x == BoshStream::ErrProxyAuth)
+				err = ErrProxyAuth;
+			else if(x == BoshStream::ErrProxyConnect)
+				err = ErrProxyConnect;
+			else
+				err = ErrProxyNeg;
+		}
+	}
 	else if(t == Proxy::Socks) {
 		if(x == SocksClient::ErrConnectionRefused)
 			err = ErrConnectionRefused;
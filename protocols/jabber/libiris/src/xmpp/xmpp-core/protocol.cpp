@@ -36,6 +36,9 @@
 
 using namespace XMPP;
 
+// request an ack from the server after this many unacknowledged stanzas
+#define SM_ACK_INTERVAL 5
+
 // printArray
 //
 // This function prints out an array of bytes as latin characters, converting
@@ -88,6 +91,23 @@ StreamFeatures::StreamFeatures()
 	bind_supported = false;
 	tls_required = false;
 	compress_supported = false;
+	sm_supported = false;
+	rosterver_supported = false;
+}
+
+//----------------------------------------------------------------------------
+// StreamManagementState
+//----------------------------------------------------------------------------
+StreamManagementState::StreamManagementState()
+{
+	resumable = false;
+	inbound = 0;
+	outbound = 0;
+}
+
+bool StreamManagementState::isResumable() const
+{
+	return resumable && !id.isEmpty();
 }
 
 //----------------------------------------------------------------------------
@@ -540,6 +560,7 @@ bool BasicProtocol::doStep(const QDomElement &e)
 			if(!i.stanzaToSend.isNull()) {
 				++stanzasPending;
 				writeElement(i.stanzaToSend, TypeStanza, true);
+				stanzaOutgoing(i.stanzaToSend);
 				event = ESend;
 			}
 			// direct send?
@@ -589,6 +610,11 @@ void BasicProtocol::handleStreamOpen(const Parser::Event &)
 	// default does nothing
 }
 
+void BasicProtocol::stanzaOutgoing(const QDomElement &)
+{
+	// default does nothing
+}
+
 //----------------------------------------------------------------------------
 // CoreProtocol
 //----------------------------------------------------------------------------
@@ -620,6 +646,7 @@ void CoreProtocol::init()
 	doAuth = true;
 	doCompress = true;
 	doBinding = true;
+	doSM = false;
 
 	// input
 	user = QString();
@@ -631,6 +658,10 @@ void CoreProtocol::init()
 	tls_started = false;
 	sasl_started = false;
 	compress_started = false;
+	sm = StreamManagementState();
+	sm_enabled = false;
+	sm_resumed = false;
+	sm_unrequested = 0;
 }
 
 void CoreProtocol::reset()
@@ -734,6 +765,61 @@ void CoreProtocol::setDialbackKey(const QString &s)
 	dialback_key = s;
 }
 
+void CoreProtocol::setStreamManagement(bool b)
+{
+	doSM = b;
+}
+
+void CoreProtocol::setResumeState(const StreamManagementState &state)
+{
+	sm = state;
+}
+
+const StreamManagementState& CoreProtocol::streamManagementState() const
+{
+	return sm;
+}
+
+bool CoreProtocol::isStreamManagementEnabled() const
+{
+	return sm_enabled;
+}
+
+bool CoreProtocol::isResumed() const
+{
+	return sm_resumed;
+}
+
+void CoreProtocol::requestAck()
+{
+	if(!sm_enabled || !isReady())
+		return;
+
+	sm_unrequested = 0;
+	sendDirect(QString("<r xmlns='%1'/>").arg(NS_STREAM_MANAGEMENT));
+}
+
+void CoreProtocol::handleAck(quint32 h)
+{
+	// 'h' counts modulo 2^32, so the difference is right even after wrapping
+	quint32 acked = h - sm.outbound;
+	for(quint32 n = 0; n < acked && !sm.unacked.isEmpty(); ++n)
+		sm.unacked.removeFirst();
+	sm.outbound = h;
+}
+
+void CoreProtocol::stanzaOutgoing(const QDomElement &e)
+{
+	if(!sm_enabled)
+		return;
+
+	sm.unacked += e;
+	if(++sm_unrequested >= SM_ACK_INTERVAL) {
+		sm_unrequested = 0;
+		writeString(QString("<r xmlns='%1'/>").arg(NS_STREAM_MANAGEMENT), TypeDirect, false);
+	}
+}
+
 bool CoreProtocol::loginComplete()
 {
 	setReady(true);
@@ -784,6 +870,8 @@ bool CoreProtocol::stepRequiresElement() const
 		case GetBindResponse:
 		case GetAuthGetResponse:
 		case GetAuthSetResponse:
+		case GetSMEnabled:
+		case GetSMResumed:
 		case GetRequest:
 		case GetSASLResponse:
 			return true;
@@ -1105,6 +1193,18 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 				return loginComplete();
 		}
 
+		// resume the previous session instead of binding a new one?
+		if(doSM && features.sm_supported && sm.isResumable()) {
+			QDomElement e = doc.createElementNS(NS_STREAM_MANAGEMENT, "resume");
+			e.setAttribute("previd", sm.id);
+			e.setAttribute("h", QString::number(sm.inbound));
+
+			send(e);
+			event = ESend;
+			step = GetSMResumed;
+			return true;
+		}
+
 		// deal with bind
 		if(!features.bind_supported) {
 			// bind MUST be supported
@@ -1322,6 +1422,12 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 			QDomElement b = e.elementsByTagNameNS(NS_BIND, "bind").item(0).toElement();
 			if(!b.isNull())
 				f.bind_supported = true;
+			QDomElement sme = e.elementsByTagNameNS(NS_STREAM_MANAGEMENT, "sm").item(0).toElement();
+			if(!sme.isNull())
+				f.sm_supported = true;
+			QDomElement rv = e.elementsByTagNameNS(NS_ROSTERVER, "ver").item(0).toElement();
+			if(!rv.isNull())
+				f.rosterver_supported = true;
 			QDomElement h = e.elementsByTagNameNS(NS_HOSTS, "hosts").item(0).toElement();
 			if(!h.isNull()) {
 				QDomNodeList l = h.elementsByTagNameNS(NS_HOSTS, "host");
@@ -1488,6 +1594,17 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 						return true;
 					}
 					jid_ = j;
+
+					// ask for stream management on the fresh session
+					if(doSM && features.sm_supported) {
+						QDomElement e = doc.createElementNS(NS_STREAM_MANAGEMENT, "enable");
+						e.setAttribute("resume", "true");
+
+						send(e);
+						event = ESend;
+						step = GetSMEnabled;
+						return true;
+					}
 					return loginComplete();
 				}
 				else {
@@ -1527,6 +1644,52 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 			// ignore
 		}
 	}
+	else if(step == GetSMEnabled) {
+		if(e.namespaceURI() == NS_STREAM_MANAGEMENT) {
+			if(e.tagName() == "enabled") {
+				QString resume = e.attribute("resume");
+				sm = StreamManagementState();
+				sm.id = e.attribute("id");
+				sm.resumable = (resume == "true" || resume == "1");
+				sm.jid = jid_;
+				sm_enabled = true;
+			}
+			// on <failed/> we just carry on without stream management
+			return loginComplete();
+		}
+		else {
+			// ignore
+		}
+	}
+	else if(step == GetSMResumed) {
+		if(e.namespaceURI() == NS_STREAM_MANAGEMENT) {
+			if(e.tagName() == "resumed") {
+				handleAck(e.attribute("h").toUInt());
+
+				// whatever the server did not get before the drop goes out again
+				QList<QDomElement> pending = sm.unacked;
+				sm.unacked.clear();
+				foreach(const QDomElement &s, pending)
+					sendStanza(s);
+
+				if(sm.jid.isValid())
+					jid_ = sm.jid;
+				sm_enabled = true;
+				sm_resumed = true;
+				return loginComplete();
+			}
+			else if(e.tagName() == "failed") {
+				// the old session is gone (and the server bounced its
+				// unacked stanzas), start a new one the normal way
+				sm = StreamManagementState();
+				step = HandleFeatures;
+				return processStep();
+			}
+		}
+		else {
+			// ignore
+		}
+	}
 	else if(step == GetAuthGetResponse) {
 		// waiting for an iq
 		if(e.namespaceURI() == NS_CLIENT && e.tagName() == "iq") {
@@ -1678,7 +1841,21 @@ bool CoreProtocol::normalStep(const QDomElement &e)
 	}
 
 	if(isReady()) {
-		if(!e.isNull() && isValidStanza(e)) {
+		if(sm_enabled && !e.isNull() && e.namespaceURI() == NS_STREAM_MANAGEMENT) {
+			if(e.tagName() == "r") {
+				QDomElement a = doc.createElementNS(NS_STREAM_MANAGEMENT, "a");
+				a.setAttribute("h", QString::number(sm.inbound));
+				send(a);
+				event = ESend;
+				return true;
+			}
+			else if(e.tagName() == "a") {
+				handleAck(e.attribute("h").toUInt());
+			}
+		}
+		else if(!e.isNull() && isValidStanza(e)) {
+			if(sm_enabled)
+				++sm.inbound;
 			stanzaToRecv = e;
 			event = EStanzaReady;
 			setIncomingAsExternal();
@@ -40,6 +40,8 @@
 #define NS_COMPRESS_FEATURE "http://jabber.org/features/compress"
 #define NS_COMPRESS_PROTOCOL "http://jabber.org/protocol/compress"
 #define NS_HOSTS    "http://barracuda.com/xmppextensions/hosts"
+#define NS_STREAM_MANAGEMENT "urn:xmpp:sm:3"
+#define NS_ROSTERVER "urn:xmpp:features:rosterver"
 
 namespace XMPP
 {
@@ -56,7 +58,8 @@ namespace XMPP
 	public:
 		StreamFeatures();
 
-		bool tls_supported, sasl_supported, bind_supported, compress_supported;
+		bool tls_supported, sasl_supported, bind_supported, compress_supported, sm_supported;
+		bool rosterver_supported;
 		bool tls_required;
 		QStringList sasl_mechs;
 		QStringList compression_mechs;
@@ -204,6 +207,7 @@ namespace XMPP
 		virtual QStringList extraNamespaces(); // stringlist: prefix,uri,prefix,uri, [...]
 		virtual void handleStreamOpen(const Parser::Event &pe);
 		virtual bool doStep2(const QDomElement &e)=0;
+		virtual void stanzaOutgoing(const QDomElement &e);
 
 		void setReady(bool b);
 
@@ -275,6 +279,14 @@ namespace XMPP
 		void setFrom(const QString &s);
 		void setDialbackKey(const QString &s);
 
+		// stream management (XEP-0198)
+		void setStreamManagement(bool b);
+		void setResumeState(const StreamManagementState &state);
+		const StreamManagementState& streamManagementState() const;
+		bool isStreamManagementEnabled() const;
+		bool isResumed() const;
+		void requestAck();
+
 		// input
 		QString user, host;
 
@@ -317,7 +329,9 @@ namespace XMPP
 			HandleAuthGet,      // send old-protocol auth-get
 			GetAuthGetResponse, // read auth-get response
 			HandleAuthSet,      // send old-protocol auth-set
-			GetAuthSetResponse  // read auth-set response
+			GetAuthSetResponse, // read auth-set response
+			GetSMEnabled,       // read stream management <enabled/> response
+			GetSMResumed        // read stream management <resumed/> response
 		};
 
 		QList<DBItem> dbrequests, dbpending, dbvalidated;
@@ -331,15 +345,20 @@ namespace XMPP
 		Jid jid_;
 		bool oldOnly;
 		bool allowPlain;
-		bool doTLS, doAuth, doBinding, doCompress;
+		bool doTLS, doAuth, doBinding, doCompress, doSM;
 		QString password;
 
+		StreamManagementState sm;
+		bool sm_enabled, sm_resumed;
+		int sm_unrequested;
+
 		QString dialback_id, dialback_key;
 		QString self_from;
 
 		void init();
 		static int getOldErrorCode(const QDomElement &e);
 		bool loginComplete();
+		void handleAck(quint32 h);
 
 		bool isValidStanza(const QDomElement &e) const;
 		bool grabPendingItem(const Jid &to, const Jid &from, int type, DBItem *item);
@@ -357,6 +376,7 @@ namespace XMPP
 		bool doStep2(const QDomElement &e);
 		void elementSend(const QDomElement &e);
 		void elementRecv(const QDomElement &e);
+		void stanzaOutgoing(const QDomElement &e);
 	};
 }
 
@@ -450,12 +450,12 @@ void SecureStream::startTLSServer(QCA::TLS *t, const QByteArray &spare)
 	insertData(spare);
 }
 
-void SecureStream::setLayerCompress(const QByteArray& spare)
+void SecureStream::setLayerCompress(const QByteArray& spare, int level)
 {
 	if(!d->active || d->topInProgress || d->haveCompress())
 		return;
 
-	SecureLayer *s = new SecureLayer(new CompressionHandler());
+	SecureLayer *s = new SecureLayer(new CompressionHandler(level));
 	s->prebytes = calcPrebytes();
 	linkLayer(s);
 	d->layers.append(s);
@@ -45,7 +45,7 @@ public:
 
 	void startTLSClient(QCA::TLS *t, const QByteArray &spare=QByteArray());
 	void startTLSServer(QCA::TLS *t, const QByteArray &spare=QByteArray());
-	void setLayerCompress(const QByteArray &spare=QByteArray());
+	void setLayerCompress(const QByteArray &spare=QByteArray(), int level=-1);
 	void setLayerSASL(QCA::SASL *s, const QByteArray &spare=QByteArray());
 #ifdef USE_TLSHANDLER
 	void startTLSClient(XMPP::TLSHandler *t, const QString &server, const QByteArray &spare=QByteArray());
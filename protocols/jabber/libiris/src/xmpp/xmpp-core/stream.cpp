@@ -172,6 +172,8 @@ public:
 		maximumSSF = 0;
 		doBinding = true;
 		doCompress = false;
+		compressionLevel = -1;
+		doSM = false;
 		lang = "";
 
 		in_rrsig = false;
@@ -187,6 +189,7 @@ public:
 		sasl_ssf = 0;
 		tls_warned = false;
 		using_tls = false;
+		resumed = false;
 	}
 
 	Jid jid;
@@ -224,6 +227,10 @@ public:
 	bool tls_warned, using_tls;
 	bool doAuth;
 	bool doCompress;
+	int compressionLevel;
+	bool doSM;
+	bool resumed;
+	StreamManagementState smState;
 
 	QStringList sasl_mechlist;
 
@@ -291,6 +298,10 @@ ClientStream::~ClientStream()
 
 void ClientStream::reset(bool all)
 {
+	// keep the stream management state of a dropped session for resumption
+	if(d->mode == Client && d->state != Closing && d->client.isStreamManagementEnabled())
+		d->smState = d->client.streamManagementState();
+
 	d->reset();
 	d->noopTimer.stop();
 
@@ -499,6 +510,38 @@ void ClientStream::setCompress(bool compress)
 	d->doCompress = compress;
 }
 
+void ClientStream::setCompressionLevel(int level)
+{
+	d->compressionLevel = level;
+}
+
+void ClientStream::setStreamManagement(bool b)
+{
+	d->doSM = b;
+}
+
+StreamManagementState ClientStream::streamManagementState() const
+{
+	if(d->client.isStreamManagementEnabled())
+		return d->client.streamManagementState();
+	return d->smState;
+}
+
+void ClientStream::setResumeState(const StreamManagementState &state)
+{
+	d->smState = state;
+}
+
+bool ClientStream::isResumed() const
+{
+	return d->resumed;
+}
+
+bool ClientStream::isRosterVersioningSupported() const
+{
+	return d->client.features.rosterver_supported;
+}
+
 int ClientStream::errorCondition() const
 {
 	return d->errCond;
@@ -523,6 +566,8 @@ void ClientStream::close()
 {
 	if(d->state == Active) {
 		d->state = Closing;
+		// a clean close ends the session, there is nothing left to resume
+		d->smState = StreamManagementState();
 		d->client.shutdown();
 		processNext();
 	}
@@ -611,6 +656,8 @@ void ClientStream::cr_connected()
 	d->client.setAllowBind(d->doBinding);
 	d->client.setAllowPlain(d->allowPlain == AllowPlain || (d->allowPlain == AllowPlainOverTLS && d->conn->useSSL()));
 	d->client.setLang(d->lang);
+	d->client.setStreamManagement(d->doSM);
+	d->client.setResumeState(d->smState);
 
 	/*d->client.jid = d->jid;
 	d->client.server = d->server;
@@ -1037,6 +1084,8 @@ void ClientStream::processNext()
 #endif
 				// grab the JID, in case it changed
 				d->jid = d->client.jid();
+				d->resumed = d->client.isResumed();
+				d->smState = d->client.streamManagementState();
 				d->state = Active;
 				setNoopTime(d->noop_time);
 				authenticated();
@@ -1112,7 +1161,7 @@ bool ClientStream::handleNeed()
 #ifdef XMPP_DEBUG
 			qDebug("Need compress\n");
 #endif
-			d->ss->setLayerCompress(d->client.spare);
+			d->ss->setLayerCompress(d->client.spare, d->compressionLevel);
 			return true;
 		}
 		case CoreProtocol::NSASLFirst: {
@@ -1227,7 +1276,11 @@ void ClientStream::doNoop()
 #ifdef XMPP_DEBUG
 		qDebug("doPing\n");
 #endif
-		d->client.sendWhitespace();
+		// with stream management an ack request doubles as keepalive
+		if(d->client.isStreamManagementEnabled())
+			d->client.requestAck();
+		else
+			d->client.sendWhitespace();
 		processNext();
 	}
 }
@@ -0,0 +1,267 @@
+/*
+ * Copyright (C) 2010  Kopete Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUrl>
+#include <QtTest/QtTest>
+#include <QtCrypto>
+
+#include "qttestutil/qttestutil.h"
+#include "boshstream.h"
+
+// Stand-in for a BOSH connection manager. It parses the HTTP requests
+// coming in on keep-alive connections and holds them until the test
+// answers them, like a real connection manager holds its long polls.
+class BoshServer : public QObject
+{
+		Q_OBJECT
+
+	public:
+		struct Request {
+			QTcpSocket *socket;
+			QByteArray body;
+		};
+
+		QTcpServer server;
+		QList<Request> pending;
+		QHash<QTcpSocket*, QByteArray> buffers;
+		int connections;
+
+		BoshServer() : connections(0) {
+			connect(&server, SIGNAL(newConnection()), SLOT(accept()));
+			server.listen(QHostAddress::LocalHost);
+		}
+
+		QUrl url() const {
+			return QUrl(QString("http://127.0.0.1:%1/http-bind").arg(server.serverPort()));
+		}
+
+		bool waitForRequests(int count) {
+			for (int i = 0; i < 100 && pending.count() < count; ++i)
+				QTest::qWait(20);
+			return pending.count() >= count;
+		}
+
+		// answers the request whose body contains 'match'
+		void respond(const QByteArray &match, const QByteArray &body) {
+			for (int n = 0; n < pending.count(); ++n) {
+				if (pending[n].body.contains(match)) {
+					Request r = pending.takeAt(n);
+					QByteArray http = "HTTP/1.1 200 OK\r\nContent-Type: text/xml; charset=utf-8\r\n"
+						"Content-Length: " + QByteArray::number(body.size()) + "\r\n\r\n" + body;
+					r.socket->write(http);
+					return;
+				}
+			}
+			QFAIL("no such request");
+		}
+
+		static QByteArray rid(const QByteArray &body) {
+			QRegExp rx("rid='(\\d+)'");
+			rx.indexIn(QString::fromUtf8(body));
+			return rx.cap(1).toLatin1();
+		}
+
+	private slots:
+		void accept() {
+			while (server.hasPendingConnections()) {
+				QTcpSocket *s = server.nextPendingConnection();
+				++connections;
+				connect(s, SIGNAL(readyRead()), SLOT(read()));
+			}
+		}
+
+		void read() {
+			QTcpSocket *s = static_cast<QTcpSocket*>(sender());
+			QByteArray &buf = buffers[s];
+			buf += s->readAll();
+			while (true) {
+				int end = buf.indexOf("\r\n\r\n");
+				if (end == -1)
+					return;
+				QRegExp rx("Content-Length:\\s*(\\d+)", Qt::CaseInsensitive);
+				rx.indexIn(QString::fromLatin1(buf.left(end)));
+				int length = rx.cap(1).toInt();
+				if (buf.size() < end + 4 + length)
+					return;
+				Request r;
+				r.socket = s;
+				r.body = buf.mid(end + 4, length);
+				pending += r;
+				buf.remove(0, end + 4 + length);
+			}
+		}
+};
+
+class BoshStreamTest : public QObject
+{
+		Q_OBJECT
+
+	private:
+		QCA::Initializer qcaInit;
+
+		static const char *sessionResponse() {
+			return "<body xmlns='http://jabber.org/protocol/httpbind' xmlns:xmpp='urn:xmpp:xbosh' "
+				"xmlns:stream='http://etherx.jabber.org/streams' sid='s1' authid='a1' from='example.com' "
+				"wait='60' hold='1' requests='2' xmpp:version='1.0'>"
+				"<stream:features><mechanisms xmlns='urn:ietf:params:xml:ns:xmpp-sasl'>"
+				"<mechanism>PLAIN</mechanism></mechanisms></stream:features></body>";
+		}
+
+		static QByteArray body(const QByteArray &payload) {
+			return "<body xmlns='http://jabber.org/protocol/httpbind'>" + payload + "</body>";
+		}
+
+		static void waitForRead(BoshStream &s, const QByteArray &what, QByteArray *in) {
+			for (int i = 0; i < 100 && !in->contains(what); ++i) {
+				QTest::qWait(20);
+				*in += s.readAll();
+			}
+		}
+
+		// creates a session and opens the stream, leaving one long poll held
+		static void open(BoshServer &server, BoshStream &s) {
+			QSignalSpy connected(&s, SIGNAL(connected()));
+			s.connectToUrl(server.url(), "example.com");
+			QVERIFY(server.waitForRequests(1));
+			QVERIFY(server.pending[0].body.contains("to='example.com'"));
+			QVERIFY(server.pending[0].body.contains("hold='1'"));
+			server.respond("to='example.com'", sessionResponse());
+			for (int i = 0; i < 100 && connected.isEmpty(); ++i)
+				QTest::qWait(20);
+			QCOMPARE(connected.count(), 1);
+			QCOMPARE(s.sid(), QString("s1"));
+
+			s.write("<?xml version=\"1.0\"?><stream:stream xmlns:stream='http://etherx.jabber.org/streams' "
+				"xmlns='jabber:client' to='example.com' version='1.0'>");
+			QByteArray in;
+			waitForRead(s, "</stream:features>", &in);
+			QVERIFY(in.startsWith("<?xml"));
+			QVERIFY(in.contains("id=\"a1\""));
+			QVERIFY(in.contains("<stream:features>"));
+			QVERIFY(server.waitForRequests(1));
+		}
+
+	private slots:
+		void testSessionCreation() {
+			BoshServer server;
+			BoshStream s;
+			open(server, s);
+
+			// only the empty long poll is on the wire
+			QCOMPARE(server.pending.count(), 1);
+			QVERIFY(server.pending[0].body.contains("sid='s1'"));
+			QVERIFY(server.pending[0].body.endsWith("/>"));
+		}
+
+		void testStanzasBatchedOnSecondRequest() {
+			BoshServer server;
+			BoshStream s;
+			open(server, s);
+			QByteArray poll = BoshServer::rid(server.pending[0].body);
+
+			s.write("<message id='1'/>");
+			s.write("<message id='2'/>");
+			QVERIFY(server.waitForRequests(2));
+			QByteArray second = server.pending[1].body;
+			QVERIFY(second.contains("<message id='1'/><message id='2'/>"));
+			QCOMPARE(BoshServer::rid(second).toLongLong(), poll.toLongLong() + 1);
+
+			// both requests are taken, the next stanza waits for one of them
+			s.write("<message id='3'/>");
+			QTest::qWait(100);
+			QCOMPARE(server.pending.count(), 2);
+			QCOMPARE(s.requestsInFlight(), 2);
+
+			server.respond("<message id='1'/>", body(QByteArray()));
+			QVERIFY(server.waitForRequests(2));
+			QVERIFY(server.pending[1].body.contains("<message id='3'/>"));
+
+			// the requests shared the kept-alive connections
+			QVERIFY(server.connections <= 2);
+		}
+
+		void testResponsesInRequestOrder() {
+			BoshServer server;
+			BoshStream s;
+			open(server, s);
+
+			s.write("<presence/>");
+			QVERIFY(server.waitForRequests(2));
+
+			// the later request is answered first, its data must wait
+			server.respond("<presence/>", body("<message id='b'/>"));
+			QTest::qWait(100);
+			QVERIFY(!s.readAll().contains("<message"));
+
+			server.respond("sid='s1' xmlns='http://jabber.org/protocol/httpbind'/>", body("<message id='a'/>"));
+			QByteArray in;
+			waitForRead(s, "<message id='b'/>", &in);
+			QVERIFY(in.indexOf("<message id='a'/>") != -1);
+			QVERIFY(in.indexOf("<message id='a'/>") < in.indexOf("<message id='b'/>"));
+		}
+
+		void testRestartAndTerminate() {
+			BoshServer server;
+			BoshStream s;
+			open(server, s);
+
+			s.write("<?xml version=\"1.0\"?><stream:stream xmlns:stream='http://etherx.jabber.org/streams' "
+				"xmlns='jabber:client' to='example.com' version='1.0'>");
+			QByteArray in;
+			waitForRead(s, "<stream:stream", &in);
+			QVERIFY(server.waitForRequests(2));
+			QVERIFY(server.pending[1].body.contains("xmpp:restart='true'"));
+
+			// the restart response is only looked at after the long poll's
+			server.respond("sid='s1' xmlns='http://jabber.org/protocol/httpbind'/>", body(QByteArray()));
+
+			QSignalSpy closed(&s, SIGNAL(connectionClosed()));
+			server.respond("xmpp:restart='true'", "<body xmlns='http://jabber.org/protocol/httpbind' type='terminate'/>");
+			for (int i = 0; i < 100 && closed.isEmpty(); ++i)
+				QTest::qWait(20);
+			QCOMPARE(closed.count(), 1);
+			QVERIFY(!s.isOpen());
+		}
+
+		void testStuckRequestSentAgain() {
+			BoshServer server;
+			BoshStream s;
+			QSignalSpy connected(&s, SIGNAL(connected()));
+			s.connectToUrl(server.url(), "example.com");
+			QVERIFY(server.waitForRequests(1));
+			server.respond("to='example.com'", QByteArray(sessionResponse()).replace("wait='60'", "wait='0'"));
+			QVERIFY(server.waitForRequests(1));
+			QCOMPARE(connected.count(), 1);
+			QByteArray poll = BoshServer::rid(server.pending[0].body);
+
+			// nobody answers the long poll, it is given up and sent again with the same rid
+			for (int i = 0; i < 400 && server.pending.count() < 2; ++i)
+				QTest::qWait(20);
+			QCOMPARE(server.pending.count(), 2);
+			QCOMPARE(BoshServer::rid(server.pending[1].body), poll);
+			QCOMPARE(s.requestsInFlight(), 1);
+			QVERIFY(s.isOpen());
+		}
+};
+
+QTTESTUTIL_REGISTER_TEST(BoshStreamTest);
+#include "boshstreamtest.moc"
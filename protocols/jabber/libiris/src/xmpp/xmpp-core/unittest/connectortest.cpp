@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2010  Kopete Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtTest/QtTest>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include "qttestutil/qttestutil.h"
+#include "bsocket.h"
+
+typedef QPair<QHostAddress,quint16> Endpoint;
+
+// The tests below race BSocket attempts against local listeners. A
+// "blackhole" is a listener whose accept queue is full, so the kernel
+// silently drops further SYNs and the connect hangs like it would
+// against a dead host.
+class ConnectorTest : public QObject
+{
+		Q_OBJECT
+
+	private:
+		int blackholeFd;
+		QTcpSocket *filler;
+		QTcpServer *server;
+
+		quint16 openBlackhole() {
+			blackholeFd = ::socket(AF_INET, SOCK_STREAM, 0);
+			struct sockaddr_in sa;
+			memset(&sa, 0, sizeof(sa));
+			sa.sin_family = AF_INET;
+			sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+			::bind(blackholeFd, (struct sockaddr *)&sa, sizeof(sa));
+			::listen(blackholeFd, 0);
+			socklen_t len = sizeof(sa);
+			::getsockname(blackholeFd, (struct sockaddr *)&sa, &len);
+			quint16 port = ntohs(sa.sin_port);
+
+			// never accepted, takes the only slot in the queue
+			filler = new QTcpSocket;
+			filler->connectToHost(QHostAddress::LocalHost, port);
+			filler->waitForConnected(1000);
+			return port;
+		}
+
+		quint16 closedPort() {
+			QTcpServer s;
+			s.listen(QHostAddress::LocalHost);
+			quint16 port = s.serverPort();
+			s.close();
+			return port;
+		}
+
+		static void waitFor(QSignalSpy &spy) {
+			for (int i = 0; i < 100 && spy.isEmpty(); ++i)
+				QTest::qWait(50);
+		}
+
+	private slots:
+		void init() {
+			blackholeFd = -1;
+			filler = 0;
+			server = new QTcpServer;
+			server->listen(QHostAddress::LocalHost);
+		}
+
+		void cleanup() {
+			delete server;
+			delete filler;
+			if (blackholeFd != -1)
+				::close(blackholeFd);
+		}
+
+		void testRaceAroundBlackhole() {
+			QList<Endpoint> endpoints;
+			endpoints += Endpoint(QHostAddress(QHostAddress::LocalHost), openBlackhole());
+			endpoints += Endpoint(QHostAddress(QHostAddress::LocalHost), server->serverPort());
+
+			BSocket s;
+			QSignalSpy connected(&s, SIGNAL(connected()));
+			s.connectToHost(endpoints);
+			waitFor(connected);
+
+			QCOMPARE(connected.count(), 1);
+			QCOMPARE(s.peerPort(), server->serverPort());
+
+			// the blackhole got its head start, then lost the race
+			QList<BSocket::ConnectAttempt> attempts = s.connectAttempts();
+			QCOMPARE(attempts.count(), 2);
+			QCOMPARE(attempts[0].result, BSocket::ConnectAttempt::Cancelled);
+			QCOMPARE(attempts[1].result, BSocket::ConnectAttempt::Connected);
+			QVERIFY(attempts[1].started >= 200);
+			QVERIFY(s.connectTime() < 2000);
+		}
+
+		void testFailureStartsNextAttempt() {
+			QList<Endpoint> endpoints;
+			endpoints += Endpoint(QHostAddress(QHostAddress::LocalHost), closedPort());
+			endpoints += Endpoint(QHostAddress(QHostAddress::LocalHost), server->serverPort());
+
+			BSocket s;
+			QSignalSpy connected(&s, SIGNAL(connected()));
+			s.connectToHost(endpoints);
+			waitFor(connected);
+
+			QCOMPARE(connected.count(), 1);
+
+			// the refused attempt does not make the next one wait
+			QList<BSocket::ConnectAttempt> attempts = s.connectAttempts();
+			QCOMPARE(attempts.count(), 2);
+			QCOMPARE(attempts[0].result, BSocket::ConnectAttempt::Failed);
+			QCOMPARE(attempts[1].result, BSocket::ConnectAttempt::Connected);
+			QVERIFY(attempts[1].started < 200);
+		}
+
+		void testAllAttemptsFail() {
+			QList<Endpoint> endpoints;
+			endpoints += Endpoint(QHostAddress(QHostAddress::LocalHost), closedPort());
+			endpoints += Endpoint(QHostAddress(QHostAddress::LocalHost), closedPort());
+
+			BSocket s;
+			QSignalSpy error(&s, SIGNAL(error(int)));
+			s.connectToHost(endpoints);
+			waitFor(error);
+
+			QCOMPARE(error.count(), 1);
+			QCOMPARE(error[0][0].toInt(), int(BSocket::ErrConnectionRefused));
+			QCOMPARE(s.connectAttempts().count(), 2);
+			QCOMPARE(s.connectAttempts()[1].result, BSocket::ConnectAttempt::Failed);
+			QVERIFY(s.connectTime() == -1);
+		}
+};
+
+QTTESTUTIL_REGISTER_TEST(ConnectorTest);
+#include "connectortest.moc"
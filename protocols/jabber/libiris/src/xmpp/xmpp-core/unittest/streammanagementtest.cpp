@@ -0,0 +1,422 @@
+/*
+ * Copyright (C) 2010  Kopete Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <QObject>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtCrypto>
+#include <QtTest/QtTest>
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/xmpp-core/protocol.h"
+#include "xmpp/xmpp-core/xmpp.h"
+#include "xmpp/xmpp-core/xmpp_clientstream.h"
+#include "xmpp/xmpp-im/xmpp_client.h"
+
+using namespace XMPP;
+
+// Stand-in for a server with stream management on a local socket. It walks
+// each connection through the login, resuming the session if the client
+// asks for it, and records what it gets afterwards. It never acks anything.
+class SMServer : public QObject
+{
+		Q_OBJECT
+
+	public:
+		enum Step { StreamOpen, Auth, Restart, Bind, Enable, Active };
+
+		QTcpServer server;
+		QTcpSocket *socket;
+		Step step;
+		QByteArray buffer;
+		QByteArray log;
+		int connections;
+		// h we report in <resumed/>
+		int resumeHandled;
+
+		SMServer() : socket(0), step(StreamOpen), connections(0), resumeHandled(0) {
+			connect(&server, SIGNAL(newConnection()), SLOT(accept()));
+			server.listen(QHostAddress::LocalHost);
+		}
+
+		void drop() {
+			socket->close();
+		}
+
+		bool waitFor(Step s, int connection) {
+			for (int i = 0; i < 100 && (connections < connection || step != s); ++i)
+				QTest::qWait(20);
+			return connections == connection && step == s;
+		}
+
+		bool waitForData(const QByteArray &a) {
+			for (int i = 0; i < 100 && !log.contains(a); ++i)
+				QTest::qWait(20);
+			return log.contains(a);
+		}
+
+	private slots:
+		void accept() {
+			socket = server.nextPendingConnection();
+			connect(socket, SIGNAL(readyRead()), SLOT(read()));
+			step = StreamOpen;
+			buffer.clear();
+			log.clear();
+			connections++;
+		}
+
+		void read() {
+			QByteArray a = socket->readAll();
+			buffer += a;
+			log += a;
+
+			// each reply empties the buffer, so this stops once nothing matches
+			while (true) {
+				if (step == StreamOpen && buffer.contains("<stream:stream")) {
+					reply(QString("<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams' "
+						"id='s%1' from='example.com' version='1.0'>").arg(connections) +
+						"<stream:features><mechanisms xmlns='urn:ietf:params:xml:ns:xmpp-sasl'>"
+						"<mechanism>PLAIN</mechanism></mechanisms></stream:features>", Auth);
+				}
+				else if (step == Auth && buffer.contains("</auth>")) {
+					reply("<success xmlns='urn:ietf:params:xml:ns:xmpp-sasl'/>", Restart);
+				}
+				else if (step == Restart && buffer.contains("<stream:stream")) {
+					reply("<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams' "
+						"id='r1' from='example.com' version='1.0'>"
+						"<stream:features><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'/>"
+						"<sm xmlns='urn:xmpp:sm:3'/></stream:features>", Bind);
+				}
+				else if (step == Bind && buffer.contains("<resume")) {
+					reply(QString("<resumed xmlns='urn:xmpp:sm:3' previd='sm-1' h='%1'/>").arg(resumeHandled), Active);
+				}
+				else if (step == Bind && buffer.contains("</iq>")) {
+					reply("<iq type='result' id='bind_1'><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'>"
+						"<jid>user@example.com/kopete</jid></bind></iq>", Enable);
+				}
+				else if (step == Enable && buffer.contains("<enable")) {
+					reply("<enabled xmlns='urn:xmpp:sm:3' id='sm-1' resume='true'/>", Active);
+				}
+				else
+					break;
+			}
+		}
+
+	private:
+		void reply(const QString &xml, Step next) {
+			buffer.clear();
+			step = next;
+			socket->write(xml.toUtf8());
+		}
+};
+
+// Answers what ClientStream asks for during the login, like JabberClient does.
+class SMClientDriver : public QObject
+{
+		Q_OBJECT
+
+	public:
+		ClientStream *stream;
+
+		SMClientDriver(ClientStream *s) : stream(s) {
+			connect(stream, SIGNAL(warning(int)), SLOT(warning()));
+			connect(stream, SIGNAL(needAuthParams(bool,bool,bool)), SLOT(needAuthParams()));
+		}
+
+	private slots:
+		void warning() {
+			stream->continueAfterWarning();
+		}
+
+		void needAuthParams() {
+			stream->setUsername("user");
+			stream->setPassword("secret");
+			stream->continueAfterParams();
+		}
+};
+
+// The tests below play a scripted server against CoreProtocol. Dropping the
+// TCP connection is simulated by throwing the protocol instance away and
+// starting a new one from the saved stream management state.
+class StreamManagementTest : public QObject
+{
+		Q_OBJECT
+
+	private:
+		static QString streamOpen(const QString &id) {
+			return QString("<stream:stream xmlns='jabber:client' xmlns:stream='http://etherx.jabber.org/streams' "
+				"id='%1' from='example.com' version='1.0'>").arg(id);
+		}
+
+		static QString saslFeatures() {
+			return "<stream:features><mechanisms xmlns='urn:ietf:params:xml:ns:xmpp-sasl'>"
+				"<mechanism>PLAIN</mechanism></mechanisms></stream:features>";
+		}
+
+		static QString sessionFeatures() {
+			return "<stream:features><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'/>"
+				"<sm xmlns='urn:xmpp:sm:3'/></stream:features>";
+		}
+
+		// Feeds 'incoming' to the protocol and runs it until it waits for
+		// more input. Returns everything it wrote.
+		static QString exchange(CoreProtocol &p, const QString &incoming = QString()) {
+			if (!incoming.isEmpty())
+				p.addIncomingData(incoming.toUtf8());
+
+			QString out;
+			while (true) {
+				if (p.processStep()) {
+					if (p.event == XmlProtocol::ESend) {
+						QByteArray a = p.takeOutgoingData();
+						out += QString::fromUtf8(a);
+						p.outgoingDataWritten(a.size());
+					}
+					else if (p.event == BasicProtocol::EStanzaReady)
+						p.recvStanza();
+					else if (p.event == XmlProtocol::EError)
+						break;
+				}
+				else if (p.need == BasicProtocol::NSASLFirst)
+					p.setSASLFirst("PLAIN", QByteArray("\0user\0secret", 12));
+				else if (p.need != BasicProtocol::NSASLLayer)
+					break;
+			}
+			return out;
+		}
+
+		static void start(CoreProtocol &p, const StreamManagementState &state = StreamManagementState()) {
+			p.startClientOut(Jid("user@example.com/kopete"), false, true, true, false);
+			p.setAllowTLS(false);
+			p.setStreamManagement(true);
+			p.setResumeState(state);
+		}
+
+		// runs a full login up to (but excluding) bind
+		static QString authenticate(CoreProtocol &p) {
+			exchange(p);
+			exchange(p, streamOpen("s1") + saslFeatures());
+			return exchange(p, "<success xmlns='urn:ietf:params:xml:ns:xmpp-sasl'/>" + streamOpen("s2") + sessionFeatures());
+		}
+
+		static void login(CoreProtocol &p) {
+			authenticate(p);
+			exchange(p, "<iq type='result' id='bind_1'><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'>"
+				"<jid>user@example.com/kopete</jid></bind></iq>");
+			exchange(p, "<enabled xmlns='urn:xmpp:sm:3' id='sm-1' resume='true'/>");
+		}
+
+		static QDomElement message(QDomDocument &doc, const QString &body) {
+			QDomElement m = doc.createElementNS(NS_CLIENT, "message");
+			m.setAttribute("to", "friend@example.com");
+			QDomElement b = doc.createElement("body");
+			b.appendChild(doc.createTextNode(body));
+			m.appendChild(b);
+			return m;
+		}
+
+		static QDomElement message(CoreProtocol &p, const QString &body) {
+			return message(p.doc, body);
+		}
+
+		static ClientStream *createStream(const SMServer &server) {
+			AdvancedConnector *conn = new AdvancedConnector;
+			conn->setOptHostPort("127.0.0.1", server.server.serverPort());
+			ClientStream *stream = new ClientStream(conn);
+			conn->setParent(stream);
+			stream->setAllowPlain(ClientStream::AllowPlain);
+			stream->setRequireMutualAuth(false);
+			stream->setStreamManagement(true);
+			return stream;
+		}
+
+	private slots:
+		void testEnable() {
+			CoreProtocol p;
+			start(p);
+			authenticate(p);
+			QString out = exchange(p, "<iq type='result' id='bind_1'><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'>"
+				"<jid>user@example.com/kopete</jid></bind></iq>");
+			QVERIFY(out.contains("enable"));
+			QVERIFY(out.contains("urn:xmpp:sm:3"));
+			QVERIFY(!p.isReady());
+
+			exchange(p, "<enabled xmlns='urn:xmpp:sm:3' id='sm-1' resume='true'/>");
+			QVERIFY(p.isReady());
+			QVERIFY(p.isStreamManagementEnabled());
+			QVERIFY(p.streamManagementState().isResumable());
+			QCOMPARE(p.streamManagementState().id, QString("sm-1"));
+		}
+
+		void testEnableFailed() {
+			CoreProtocol p;
+			start(p);
+			authenticate(p);
+			exchange(p, "<iq type='result' id='bind_1'><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'>"
+				"<jid>user@example.com/kopete</jid></bind></iq>");
+			exchange(p, "<failed xmlns='urn:xmpp:sm:3'/>");
+
+			QVERIFY(p.isReady());
+			QVERIFY(!p.isStreamManagementEnabled());
+			QVERIFY(!p.streamManagementState().isResumable());
+		}
+
+		void testCountersAndAcks() {
+			CoreProtocol p;
+			start(p);
+			login(p);
+
+			p.sendStanza(message(p, "one"));
+			p.sendStanza(message(p, "two"));
+			p.sendStanza(message(p, "three"));
+			exchange(p);
+			QCOMPARE(p.streamManagementState().unacked.count(), 3);
+
+			exchange(p, "<a xmlns='urn:xmpp:sm:3' h='2'/>");
+			QCOMPARE(p.streamManagementState().unacked.count(), 1);
+			QCOMPARE(p.streamManagementState().outbound, quint32(2));
+
+			exchange(p, "<message from='friend@example.com/home' to='user@example.com/kopete'><body>hi</body></message>");
+			QCOMPARE(p.streamManagementState().inbound, quint32(1));
+
+			QString out = exchange(p, "<r xmlns='urn:xmpp:sm:3'/>");
+			QVERIFY(out.contains("h=\"1\""));
+		}
+
+		void testAckRequestedPeriodically() {
+			CoreProtocol p;
+			start(p);
+			login(p);
+
+			for (int i = 0; i < 5; ++i)
+				p.sendStanza(message(p, QString::number(i)));
+			QString out = exchange(p);
+			QVERIFY(out.contains("<r xmlns='urn:xmpp:sm:3'/>"));
+		}
+
+		void testResumeAfterDrop() {
+			StreamManagementState state;
+			{
+				CoreProtocol p;
+				start(p);
+				login(p);
+				exchange(p, "<message from='friend@example.com/home' to='user@example.com/kopete'><body>hi</body></message>");
+				p.sendStanza(message(p, "delivered"));
+				p.sendStanza(message(p, "lost"));
+				exchange(p);
+				state = p.streamManagementState();
+				// connection drops here, before the server acked anything
+			}
+			QCOMPARE(state.unacked.count(), 2);
+
+			CoreProtocol p;
+			start(p, state);
+			QString out = authenticate(p);
+			QVERIFY(out.contains("resume"));
+			QVERIFY(out.contains("previd=\"sm-1\""));
+			QVERIFY(out.contains("h=\"1\""));
+			QVERIFY(!out.contains("bind"));
+
+			out = exchange(p, "<resumed xmlns='urn:xmpp:sm:3' previd='sm-1' h='1'/>");
+			QVERIFY(p.isReady());
+			QVERIFY(p.isResumed());
+			QCOMPARE(p.jid().full(), QString("user@example.com/kopete"));
+
+			// only the stanza the server did not get is sent again
+			QVERIFY(out.contains("lost"));
+			QVERIFY(!out.contains("delivered"));
+			QCOMPARE(p.streamManagementState().unacked.count(), 1);
+			QCOMPARE(p.streamManagementState().inbound, quint32(1));
+		}
+
+		void testResumeFailedFallsBackToBind() {
+			StreamManagementState state;
+			{
+				CoreProtocol p;
+				start(p);
+				login(p);
+				state = p.streamManagementState();
+			}
+
+			CoreProtocol p;
+			start(p, state);
+			authenticate(p);
+			QString out = exchange(p, "<failed xmlns='urn:xmpp:sm:3'/>");
+			QVERIFY(out.contains("bind"));
+
+			exchange(p, "<iq type='result' id='bind_1'><bind xmlns='urn:ietf:params:xml:ns:xmpp-bind'>"
+				"<jid>user@example.com/kopete</jid></bind></iq>");
+			exchange(p, "<enabled xmlns='urn:xmpp:sm:3' id='sm-2' resume='true'/>");
+			QVERIFY(p.isReady());
+			QVERIFY(!p.isResumed());
+			QCOMPARE(p.streamManagementState().id, QString("sm-2"));
+		}
+
+		// Same as testResumeAfterDrop(), but through Client and ClientStream
+		// over a real socket, with stanzas sent while the connection is down.
+		void testClientResumeOverSocket() {
+			QCA::Initializer qcaInit;
+			SMServer server;
+			Client client;
+			Jid jid("user@example.com/kopete");
+
+			ClientStream *first = createStream(server);
+			SMClientDriver firstDriver(first);
+			client.connectToServer(first, jid);
+			QVERIFY(server.waitFor(SMServer::Active, 1));
+			for (int i = 0; i < 100 && !first->isAuthenticated(); ++i)
+				QTest::qWait(20);
+			QVERIFY(first->isAuthenticated());
+
+			client.send(message(*client.doc(), "delivered"));
+			client.send(message(*client.doc(), "lost"));
+			QVERIFY(server.waitForData("lost"));
+
+			// the server only got the first one before the drop
+			server.resumeHandled = 1;
+			server.drop();
+			for (int i = 0; i < 100 && first->isAuthenticated(); ++i)
+				QTest::qWait(20);
+			QVERIFY(!first->isAuthenticated());
+			QVERIFY(first->streamManagementState().isResumable());
+
+			// written while there is no connection, must not get lost
+			client.send(message(*client.doc(), "queued"));
+
+			ClientStream *second = createStream(server);
+			SMClientDriver secondDriver(second);
+			second->setResumeState(first->streamManagementState());
+			client.connectToServer(second, jid);
+
+			QVERIFY(server.waitFor(SMServer::Active, 2));
+			QVERIFY(server.waitForData("queued"));
+			QVERIFY(second->isResumed());
+			QVERIFY(server.log.contains("lost"));
+			QVERIFY(!server.log.contains("delivered"));
+			// the unacked stanza goes out before the queued one
+			QVERIFY(server.log.indexOf("lost") < server.log.indexOf("queued"));
+
+			client.close();
+			delete second;
+			delete first;
+		}
+};
+
+QTTESTUTIL_REGISTER_TEST(StreamManagementTest);
+#include "streammanagementtest.moc"
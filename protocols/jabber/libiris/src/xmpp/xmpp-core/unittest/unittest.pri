@@ -0,0 +1,4 @@
+SOURCES += \
+	$$PWD/streammanagementtest.cpp \
+	$$PWD/connectortest.cpp \
+	$$PWD/boshstreamtest.cpp
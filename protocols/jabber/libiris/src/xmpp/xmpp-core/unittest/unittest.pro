@@ -0,0 +1,4 @@
+include(../../modules.pri)
+include($$IRIS_XMPP_QA_UNITTEST_MODULE)
+include(../../../../iris.pri)
+include(unittest.pri)
@@ -113,7 +113,7 @@ namespace XMPP
 		class Proxy
 		{
 		public:
-			enum { None, HttpConnect, HttpPoll, Socks };
+			enum { None, HttpConnect, HttpPoll, Socks, Bosh };
 			Proxy();
 			~Proxy();
 
@@ -124,12 +124,17 @@ namespace XMPP
 			QString user() const;
 			QString pass() const;
 			int pollInterval() const;
+			int boshHold() const;
+			int boshWait() const;
 
 			void setHttpConnect(const QString &host, quint16 port);
 			void setHttpPoll(const QString &host, quint16 port, const QUrl &url);
+			/*! BOSH connection manager at \a url, through the HTTP proxy at \a host unless empty */
+			void setBosh(const QString &host, quint16 port, const QUrl &url);
 			void setSocks(const QString &host, quint16 port);
 			void setUserPass(const QString &user, const QString &pass);
 			void setPollInterval(int secs);
+			void setBoshHoldWait(int hold, int secs);
 
 		private:
 			int t;
@@ -138,6 +143,7 @@ namespace XMPP
 			quint16 v_port;
 			QString v_user, v_pass;
 			int v_poll;
+			int v_hold, v_wait;
 		};
 
 		void setProxy(const Proxy &proxy);
@@ -153,6 +159,13 @@ namespace XMPP
 
 		int errorCode() const;
 
+		/*!
+		  Summary of the connection phase for diagnostics: how long the
+		  lookup took and how each raced address fared. Empty when
+		  connecting through a proxy.
+		*/
+		QString connectTimings() const;
+
 		virtual QString host() const;
 
 	signals:
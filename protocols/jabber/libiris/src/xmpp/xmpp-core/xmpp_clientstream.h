@@ -21,6 +21,7 @@
 #define XMPP_CLIENTSTREAM_H
 
 #include <QtCrypto>
+#include <QList>
 
 #include "xmpp_stream.h"
 
@@ -37,6 +38,22 @@ namespace XMPP
 	class TLSHandler;
 	class Connector;
 
+	// XEP-0198 stream management state that outlives a single connection
+	class StreamManagementState
+	{
+	public:
+		StreamManagementState();
+
+		bool isResumable() const;
+
+		QString id;                 // stream id from <enabled/>, used as 'previd' to resume
+		bool resumable;             // server allows resumption of this stream
+		Jid jid;                    // full jid bound to the session
+		quint32 inbound;            // stanzas received ('h' we report)
+		quint32 outbound;           // stanzas sent and acknowledged by the server
+		QList<QDomElement> unacked; // stanzas sent but not yet acknowledged, oldest first
+	};
+
 	class ClientStream : public Stream
 	{
 		Q_OBJECT
@@ -131,6 +148,16 @@ namespace XMPP
 
 		// Compression
 		void setCompress(bool);
+		void setCompressionLevel(int level); // zlib level, -1 for the zlib default
+
+		// Stream management (XEP-0198)
+		void setStreamManagement(bool);
+		StreamManagementState streamManagementState() const;
+		void setResumeState(const StreamManagementState &state);
+		bool isResumed() const;
+
+		// Roster versioning (XEP-0237), known once authenticated
+		bool isRosterVersioningSupported() const;
 
 		// reimplemented
 		QDomDocument & doc() const;
@@ -72,6 +72,7 @@
 #include <stdarg.h>
 #include <qobject.h>
 #include <QMap>
+#include <QHash>
 #include <qtimer.h>
 #include <qpointer.h>
 //Added by qt3to4:
@@ -138,6 +139,7 @@ public:
 	bool active;
 
 	LiveRoster roster;
+	QString rosterVersion;
 	ResourceList resourceList;
 	S5BManager *s5bman;
 	IBBManager *ibbman;
@@ -145,6 +147,11 @@ public:
 	FileTransferManager *ftman;
 	bool ftEnabled;
 	QList<GroupChat> groupChatList;
+
+	// the connection dropped and the owner may resume the session (XEP-0198),
+	// stanzas sent until then wait in pendingStanzas
+	bool resumePending;
+	QList<QDomElement> pendingStanzas;
 };
 
 
@@ -155,6 +162,7 @@ Client::Client(QObject *par)
 	d->tzoffset = 0;
 	d->useTzoffset = false;
 	d->active = false;
+	d->resumePending = false;
 	d->osname = "N/A";
 	d->clientName = "N/A";
 	d->clientVersion = "0.0";
@@ -189,10 +197,17 @@ Client::~Client()
 
 void Client::connectToServer(ClientStream *s, const Jid &j, bool auth)
 {
+	// a stream carrying the state of our dropped session resumes it,
+	// hold back what we send until it is authenticated
+	if(s->streamManagementState().isResumable())
+		d->resumePending = true;
+
 	d->stream = s;
 	//connect(d->stream, SIGNAL(connected()), SLOT(streamConnected()));
 	//connect(d->stream, SIGNAL(handshaken()), SLOT(streamHandshaken()));
 	connect(d->stream, SIGNAL(error(int)), SLOT(streamError(int)));
+	connect(d->stream, SIGNAL(connectionClosed()), SLOT(streamConnectionClosed()));
+	connect(d->stream, SIGNAL(authenticated()), SLOT(streamAuthenticated()));
 	//connect(d->stream, SIGNAL(sslCertificateReady(QSSLCert)), SLOT(streamSSLCertificateReady(QSSLCert)));
 	connect(d->stream, SIGNAL(readyRead()), SLOT(streamReadyRead()));
 	//connect(d->stream, SIGNAL(closeFinished()), SLOT(streamCloseFinished()));
@@ -436,6 +451,8 @@ void Client::cleanup()
 	d->active = false;
 	//d->authed = false;
 	d->groupChatList.clear();
+	d->resumePending = false;
+	d->pendingStanzas.clear();
 }
 
 /*void Client::continueAfterCert()
@@ -458,12 +475,44 @@ void Client::streamError(int)
 	//StreamError e = err;
 	//error(e);
 
+	// The server keeps a resumable (XEP-0198) session around for a while, so
+	// hold on to our state until the owner either resumes it through
+	// connectToServer() with a new stream or closes us for good.
+	if(d->stream && d->stream->streamManagementState().isResumable()) {
+		d->stream->disconnect(this);
+		d->stream = 0;
+		d->resumePending = true;
+		return;
+	}
+
 	//if(!e.isWarning()) {
 		disconnected();
 		cleanup();
 	//}
 }
 
+void Client::streamConnectionClosed()
+{
+	// the owner decides whether to resume or to close us, until then
+	// keep what we send instead of writing it to a dead stream
+	if(d->stream && d->stream->streamManagementState().isResumable())
+		d->resumePending = true;
+}
+
+void Client::streamAuthenticated()
+{
+	if(!d->resumePending)
+		return;
+
+	// if the server refused the resume these go out in the new session,
+	// which is still better than losing them
+	d->resumePending = false;
+	QList<QDomElement> pending = d->pendingStanzas;
+	d->pendingStanzas.clear();
+	foreach(const QDomElement &x, pending)
+		send(x);
+}
+
 /*void Client::streamSSLCertificateReady(const QSSLCert &cert)
 {
 	sslCertReady(cert);
@@ -600,6 +649,11 @@ void Client::distribute(const QDomElement &x)
 
 void Client::send(const QDomElement &x)
 {
+	if(d->resumePending) {
+		d->pendingStanzas += x;
+		return;
+	}
+
 	if(!d->stream)
 		return;
 
@@ -876,28 +930,74 @@ void Client::pmMessage(const Message &m)
 void Client::prRoster(const Roster &r)
 {
 	importRoster(r);
+	if(!r.version().isNull())
+		d->rosterVersion = r.version();
 }
 
 void Client::rosterRequest()
+{
+	rosterRequest(Roster());
+}
+
+/**
+ * Requests the roster from the server. If \a cached carries a version and
+ * the server supports roster versioning (XEP-0237), only the changes since
+ * that version are transferred. The cached items are taken into the live
+ * roster without emitting rosterItemAdded(), the caller is expected to know
+ * them already.
+ */
+void Client::rosterRequest(const Roster &cached)
 {
 	if(!d->active)
 		return;
 
 	JT_Roster *r = new JT_Roster(rootTask());
 	connect(r, SIGNAL(finished()), SLOT(slotRosterRequestFinished()));
-	r->get();
+	if(!cached.version().isNull() && d->stream && d->stream->isRosterVersioningSupported()) {
+		// index the live roster once, LiveRoster::find() is a linear scan
+		QHash<QString, int> index;
+		for(int n = 0; n < d->roster.count(); ++n)
+			index.insert(d->roster.at(n).jid().bare(), n);
+		for(Roster::ConstIterator it = cached.begin(); it != cached.end(); ++it) {
+			const QString bare = (*it).jid().bare();
+			QHash<QString, int>::ConstIterator i = index.constFind(bare);
+			if(i != index.constEnd())
+				d->roster[i.value()].setRosterItem(*it);
+			else {
+				index.insert(bare, d->roster.count());
+				d->roster += LiveRosterItem(*it);
+			}
+		}
+		d->rosterVersion = cached.version();
+		r->get(cached.version());
+	}
+	else {
+		d->rosterVersion = QString();
+		r->get();
+	}
 	d->roster.flagAllForDelete(); // mod_groups patch
 	r->go(true);
 }
 
+QString Client::rosterVersion() const
+{
+	return d->rosterVersion;
+}
+
 void Client::slotRosterRequestFinished()
 {
 	JT_Roster *r = (JT_Roster *)sender();
 	// on success, let's take it
-	if(r->success()) {
+	if(r->success() && r->isUnchanged()) {
+		// our cached copy is current, nothing to import or remove
+		for(LiveRoster::Iterator it = d->roster.begin(); it != d->roster.end(); ++it)
+			(*it).setFlagForDelete(false);
+	}
+	else if(r->success()) {
 		//d->roster.flagAllForDelete(); // mod_groups patch
 
 		importRoster(r->roster());
+		d->rosterVersion = r->roster().version();
 
 		for(LiveRoster::Iterator it = d->roster.begin(); it != d->roster.end();) {
 			LiveRosterItem &i = *it;
@@ -23,13 +23,26 @@
 #include <QList>
 #include <QTimer>
 #include <QPointer>
+#include <QFile>
 #include <QFileInfo>
 #include <QSet>
+#include <QAbstractSocket>
+#include <QNetworkProxy>
+#ifndef QT_NO_OPENSSL
+#include <QSslSocket>
+#endif
 #include "xmpp_xmlcommon.h"
 #include "s5b.h"
 #include "xmpp_ibb.h"
 
+#ifdef Q_OS_LINUX
+#include <sys/sendfile.h>
+#include <errno.h>
+#endif
+
 #define SENDBUFSIZE 65536
+#define FILEBUFSIZE 262144
+#define SENDFILE_CHUNK 1048576
 
 using namespace XMPP;
 
@@ -45,6 +58,25 @@ static QDomElement firstChildElement(const QDomElement &e)
 	return QDomElement();
 }
 
+#ifdef Q_OS_LINUX
+// sendfile() may only write to sockets that carry our data as is: plain
+// tcp, not encrypted, and not tunneled through a Qt proxy.
+static bool isPlainSocket(QAbstractSocket *sock)
+{
+	if(!sock || sock->socketType() != QAbstractSocket::TcpSocket || sock->state() != QAbstractSocket::ConnectedState)
+		return false;
+#ifndef QT_NO_OPENSSL
+	QSslSocket *ssl = qobject_cast<QSslSocket*>(sock);
+	if(ssl && ssl->mode() != QSslSocket::UnencryptedMode)
+		return false;
+#endif
+	QNetworkProxy proxy = sock->proxy();
+	if(proxy.type() == QNetworkProxy::DefaultProxy)
+		proxy = QNetworkProxy::applicationProxy();
+	return proxy.type() == QNetworkProxy::NoProxy;
+}
+#endif
+
 //----------------------------------------------------------------------------
 // FileTransfer
 //----------------------------------------------------------------------------
@@ -68,6 +100,12 @@ public:
 	Jid proxy;
 	int state;
 	bool sender;
+
+	// setFile() transfers
+	QFile *file;
+	qlonglong filePos;
+	QByteArray buffer;
+	bool zeroCopy;
 };
 
 FileTransfer::FileTransfer(FileTransferManager *m, QObject *parent)
@@ -77,6 +115,7 @@ FileTransfer::FileTransfer(FileTransferManager *m, QObject *parent)
 	d->m = m;
 	d->ft = 0;
 	d->c = 0;
+	d->file = 0;
 	reset();
 }
 
@@ -88,6 +127,7 @@ FileTransfer::FileTransfer(const FileTransfer& other)
 	d->m = other.d->m;
 	d->ft = 0;
 	d->c = 0;
+	d->file = 0;
 	reset();
 
 	if (d->m->isActive(&other))
@@ -112,6 +152,8 @@ void FileTransfer::reset()
 	delete d->ft;
 	d->ft = 0;
 
+	d->buffer.clear();
+
 	if (d->c) {
 		d->c->disconnect(this);
 		d->c->manager()->deleteConnection(d->c, d->state == Active && !d->sender ?
@@ -123,6 +165,7 @@ void FileTransfer::reset()
 	d->needStream = false;
 	d->sent = 0;
 	d->sender = false;
+	d->zeroCopy = false;
 }
 
 void FileTransfer::setProxy(const Jid &proxy)
@@ -244,6 +287,11 @@ BSConnection *FileTransfer::bsConnection() const
 	return d->c;
 }
 
+void FileTransfer::setFile(QFile *file)
+{
+	d->file = file;
+}
+
 // file transfer request accepted or error happened
 void FileTransfer::ft_finished()
 {
@@ -305,6 +353,17 @@ void FileTransfer::takeConnection(BSConnection *c)
 void FileTransfer::stream_connected()
 {
 	d->state = Active;
+
+	if(d->sender && d->file) {
+		d->filePos = d->rangeOffset;
+		d->file->seek(d->filePos);
+#ifdef Q_OS_LINUX
+		// S5B is usually a plain tcp socket, let the kernel copy the file into it
+		d->zeroCopy = isPlainSocket(d->c->abstractSocket());
+#endif
+		QTimer::singleShot(0, this, SLOT(sendFileData()));
+	}
+
 	emit connected();
 }
 
@@ -316,6 +375,33 @@ void FileTransfer::stream_connectionClosed()
 
 void FileTransfer::stream_readyRead()
 {
+	if(d->file) {
+		if(d->buffer.isEmpty())
+			d->buffer.resize(FILEBUFSIZE);
+
+		qint64 total = 0;
+		qlonglong need = d->length - d->sent;
+		while(need > 0) {
+			qint64 n = d->c->read(d->buffer.data(), qMin(need, (qlonglong)d->buffer.size()));
+			if(n <= 0)
+				break;
+			if(d->file->write(d->buffer.constData(), n) != n) {
+				reset();
+				emit error(ErrFile);
+				return;
+			}
+			need -= n;
+			total += n;
+		}
+
+		d->sent += total;
+		if(d->sent == d->length)
+			reset();
+		if(total)
+			emit bytesReceived(total);
+		return;
+	}
+
 	QByteArray a = d->c->readAll();
 	qlonglong need = d->length - d->sent;
 	if((qlonglong)a.size() > need)
@@ -331,9 +417,87 @@ void FileTransfer::stream_bytesWritten(qint64 x)
 	d->sent += x;
 	if(d->sent == d->length)
 		reset();
+	else if(d->file)
+		sendFileData();
 	emit bytesWritten(x);
 }
 
+void FileTransfer::sendFileData()
+{
+	if(d->state != Active || !d->file)
+		return;
+
+	// filePos is the next byte to send, by sendfile() or through Qt
+	qlonglong left = d->length - (d->filePos - d->rangeOffset);
+	if(left <= 0)
+		return;
+
+#ifdef Q_OS_LINUX
+	QAbstractSocket *sock = d->zeroCopy ? d->c->abstractSocket() : 0;
+	if(sock) {
+		// never write to the descriptor while Qt has data queued for it,
+		// ours would overtake it.  its bytesWritten() brings us back.
+		if(d->c->bytesToWrite() || sock->bytesToWrite())
+			return;
+
+		qlonglong chunk = qMin(left, (qlonglong)SENDFILE_CHUNK);
+		off_t offset = d->filePos;
+		ssize_t n = ::sendfile(sock->socketDescriptor(), d->file->handle(), &offset, chunk);
+		if(n < 0 && errno != EAGAIN && errno != EINTR) {
+			// not supported for this file or socket, copy it ourselves
+			d->zeroCopy = false;
+		}
+		else {
+			if(n < 0)
+				n = 0;
+			d->filePos += n;
+			d->sent += n;
+			left -= n;
+
+			if(d->sent == d->length) {
+				reset();
+			}
+			else if(n == chunk) {
+				// the socket still takes more, go on from the event loop
+				QTimer::singleShot(0, this, SLOT(sendFileData()));
+			}
+			else {
+				// the socket is full.  queue one block through Qt, which
+				// knows when the socket is writable again
+				if(!writeFileBlock(left))
+					return;
+			}
+
+			if(n > 0)
+				emit bytesWritten(n);
+			return;
+		}
+	}
+#endif
+
+	int pending = d->c->bytesToWrite();
+	if(pending >= FILEBUFSIZE)
+		return;
+	writeFileBlock(qMin(left, (qlonglong)(FILEBUFSIZE - pending)));
+}
+
+bool FileTransfer::writeFileBlock(qlonglong size)
+{
+	if(d->buffer.isEmpty())
+		d->buffer.resize(FILEBUFSIZE);
+	if(d->file->pos() != d->filePos)
+		d->file->seek(d->filePos);
+	qint64 n = d->file->read(d->buffer.data(), qMin(size, (qlonglong)FILEBUFSIZE));
+	if(n <= 0) {
+		reset();
+		emit error(ErrFile);
+		return false;
+	}
+	d->filePos += n;
+	d->c->write(d->buffer.constData(), n);
+	return true;
+}
+
 void FileTransfer::stream_error(int x)
 {
 	reset();
@@ -23,6 +23,8 @@
 
 #include "im.h"
 
+class QFile;
+
 namespace XMPP
 {
 	//class BSConnection;
@@ -64,7 +66,7 @@ namespace XMPP
 	{
 		Q_OBJECT
 	public:
-		enum { ErrReject, ErrNeg, ErrConnect, ErrProxy, ErrStream, Err400 };
+		enum { ErrReject, ErrNeg, ErrConnect, ErrProxy, ErrStream, Err400, ErrFile };
 		enum { Idle, Requesting, Connecting, WaitingForAccept, Active };
 		~FileTransfer();
 
@@ -92,11 +94,18 @@ namespace XMPP
 		void close(); // reject, or stop sending/receiving
 		BSConnection *bsConnection() const; // active link
 
+		// transfer straight from/to an open file.  when sending, the data
+		// starts at offset() and progress is reported by bytesWritten().
+		// when receiving, data is written at the file's current position
+		// and reported by bytesReceived() instead of readyRead().
+		void setFile(QFile *file);
+
 	signals:
 		void accepted(); // indicates BSConnection has started
 		void connected();
 		void readyRead(const QByteArray &a);
 		void bytesWritten(qint64);
+		void bytesReceived(qint64);
 		void error(int);
 
 	private slots:
@@ -106,6 +115,7 @@ namespace XMPP
 		void stream_readyRead();
 		void stream_bytesWritten(qint64);
 		void stream_error(int);
+		void sendFileData();
 		void doAccept();
 		void reset();
 
@@ -113,6 +123,8 @@ namespace XMPP
 		class Private;
 		Private *d;
 
+		bool writeFileBlock(qlonglong size);
+
 		friend class FileTransferManager;
 		FileTransfer(FileTransferManager *, QObject *parent=0);
 		FileTransfer(const FileTransfer& other);
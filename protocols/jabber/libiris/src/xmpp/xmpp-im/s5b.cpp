@@ -354,6 +354,15 @@ qint64 S5BConnection::bytesToWrite() const
 		return 0;
 }
 
+QAbstractSocket* S5BConnection::abstractSocket() const
+{
+	// only an active stream carries nothing but our data
+	if(d->state == Active && d->mode == Stream && d->sc)
+		return d->sc->abstractSocket();
+	else
+		return 0;
+}
+
 void S5BConnection::writeDatagram(const S5BDatagram &i)
 {
 	QByteArray buf;
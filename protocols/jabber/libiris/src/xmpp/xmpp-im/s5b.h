@@ -88,6 +88,7 @@ namespace XMPP
 
 		qint64 bytesAvailable() const;
 		qint64 bytesToWrite() const;
+		QAbstractSocket* abstractSocket() const;
 
 		void writeDatagram(const S5BDatagram &);
 		S5BDatagram readDatagram();
@@ -2870,6 +2870,16 @@ Roster::ConstIterator Roster::find(const Jid &j) const
 	return end();
 }
 
+QString Roster::version() const
+{
+	return v_version;
+}
+
+void Roster::setVersion(const QString &version)
+{
+	v_version = version;
+}
+
 
 //---------------------------------------------------------------------------
 // FormField
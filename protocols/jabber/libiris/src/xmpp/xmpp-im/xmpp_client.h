@@ -80,6 +80,8 @@ namespace XMPP
 		Jid jid() const;
 
 		void rosterRequest();
+		void rosterRequest(const Roster &cached);
+		QString rosterVersion() const;
 		void sendMessage(const Message &);
 		void sendSubscription(const Jid &, const QString &, const QString& nick = QString());
 		void setPresence(const Status &);
@@ -166,6 +168,8 @@ namespace XMPP
 		//void streamSSLCertificateReady(const QSSLCert &);
 		//void streamCloseFinished();
 		void streamError(int);
+		void streamConnectionClosed();
+		void streamAuthenticated();
 		void streamReadyRead();
 		void streamIncomingXml(const QString &);
 		void streamOutgoingXml(const QString &);
@@ -26,8 +26,11 @@
 
 #include <stdlib.h>
 
-#define IBB_PACKET_SIZE   4096
-#define IBB_PACKET_DELAY  0
+#define IBB_PACKET_SIZE     16384
+#define IBB_MIN_PACKET_SIZE 4096
+#define IBB_MAX_PACKET_SIZE 65535
+#define IBB_WINDOW_SIZE     4
+#define IBB_PACKET_DELAY    0
 
 using namespace XMPP;
 
@@ -48,11 +51,13 @@ public:
 	Jid peer;
 	QString sid;
 	IBBManager *m;
-	JT_IBB *j;
+	JT_IBB *j; // open or close request
+	QList<JT_IBB*> sending; // data packets waiting for their ack
 	QString iq_id;
 	QString stanza;
 
 	int blockSize;
+	Stanza::Kind kind;
 	//QByteArray recvBuf, sendBuf;
 	bool closePending, closing;
 
@@ -65,7 +70,8 @@ IBBConnection::IBBConnection(IBBManager *m)
 	d = new Private;
 	d->m = m;
 	d->j = 0;
-	d->blockSize = IBB_PACKET_SIZE;
+	d->blockSize = m->blockSize();
+	d->kind = Stanza::IQ;
 	resetConnection();
 
 	++num_conn;
@@ -85,6 +91,8 @@ void IBBConnection::resetConnection(bool clear)
 
 	delete d->j;
 	d->j = 0;
+	qDeleteAll(d->sending);
+	d->sending.clear();
 
 	clearWriteBuffer();
 	if(clear)
@@ -113,14 +121,21 @@ void IBBConnection::connectToJid(const Jid &peer, const QString &sid)
 	d->state = Requesting;
 	d->peer = peer;
 	d->sid = sid;
+	d->blockSize = d->m->blockSize();
+	d->kind = d->m->stanzaKind();
 
 #ifdef IBB_DEBUG
 	qDebug("IBBConnection[%d]: initiating request to %s", d->id, qPrintable(peer.full()));
 #endif
 
+	sendRequest();
+}
+
+void IBBConnection::sendRequest()
+{
 	d->j = new JT_IBB(d->m->client()->rootTask());
 	connect(d->j, SIGNAL(finished()), SLOT(ibb_finished()));
-	d->j->request(d->peer, d->sid);
+	d->j->request(d->peer, d->sid, d->blockSize, d->kind);
 	d->j->go(true);
 }
 
@@ -223,6 +238,7 @@ void IBBConnection::waitForAccept(const Jid &peer, const QString &iq_id,
 	d->sid = sid;
 	d->blockSize = blockSize;
 	d->stanza = stanza;
+	d->kind = stanza == "message"? Stanza::Message : Stanza::IQ;
 
 }
 
@@ -250,8 +266,11 @@ void IBBConnection::setRemoteClosed()
 
 void IBBConnection::ibb_finished()
 {
-	JT_IBB *j = d->j;
-	d->j = 0;
+	JT_IBB *j = static_cast<JT_IBB*>(sender());
+	if(j == d->j)
+		d->j = 0;
+	else
+		d->sending.removeAll(j);
 
 	if(j->success()) {
 		if(j->mode() == JT_IBB::ModeRequest) {
@@ -274,11 +293,27 @@ void IBBConnection::ibb_finished()
 			if(bytesToWrite() || d->closePending)
 				QTimer::singleShot(IBB_PACKET_DELAY, this, SLOT(trySend()));
 
-			emit bytesWritten(j->bytesWritten()); // will delete this connection if no bytes left.
+			if(j->bytesWritten())
+				emit bytesWritten(j->bytesWritten()); // will delete this connection if no bytes left.
 		}
 	}
 	else {
 		if(j->mode() == JT_IBB::ModeRequest) {
+			// the peer wants smaller blocks, ask again.  xep-0047 says
+			// resource-constraint, but some peers refuse a block size
+			// they don't like with bad-request or not-acceptable.
+			int cond = j->errorCondition();
+			bool blockSizeRefused = cond == Stanza::Error::ResourceConstraint ||
+									cond == Stanza::Error::BadRequest ||
+									cond == Stanza::Error::NotAcceptable;
+			if(blockSizeRefused && d->blockSize / 2 >= IBB_MIN_PACKET_SIZE) {
+				d->blockSize /= 2;
+#ifdef IBB_DEBUG
+				qDebug("IBBConnection[%d]: retrying with block size %d", d->id, d->blockSize);
+#endif
+				sendRequest();
+				return;
+			}
 #ifdef IBB_DEBUG
 			qDebug("IBBConnection[%d]: %s refused.", d->id, qPrintable(d->peer.full()));
 #endif
@@ -294,36 +329,41 @@ void IBBConnection::ibb_finished()
 
 void IBBConnection::trySend()
 {
-	// if we already have an active task, then don't do anything
+	// if we are opening or closing, then don't do anything
 	if(d->j)
 		return;
 
-	QByteArray a = takeWrite(d->blockSize);
+	// keep up to windowSize() packets on the wire
+	while(d->sending.count() < d->m->windowSize()) {
+		QByteArray a = takeWrite(d->blockSize);
+		if(a.isEmpty())
+			break;
 
-	if(a.isEmpty()) {
-		if (!d->closePending)
-			return; // null operation?
-		d->closePending = false;
-		d->closing = true;
-#ifdef IBB_DEBUG
-		qDebug("IBBConnection[%d]: closing", d->id);
-#endif
-	}
-	else {
 #ifdef IBB_DEBUG
 		qDebug("IBBConnection[%d]: sending [%d] bytes (%d bytes left)",
 			   d->id, a.size(), bytesToWrite());
 #endif
+
+		JT_IBB *j = new JT_IBB(d->m->client()->rootTask());
+		connect(j, SIGNAL(finished()), SLOT(ibb_finished()));
+		j->sendData(d->peer, IBBData(d->sid, d->seq++, a), d->kind);
+		d->sending.append(j);
+		j->go(true);
 	}
 
+	// close only after all data has been acked
+	if(!d->closePending || bytesToWrite() || !d->sending.isEmpty())
+		return;
+
+	d->closePending = false;
+	d->closing = true;
+#ifdef IBB_DEBUG
+	qDebug("IBBConnection[%d]: closing", d->id);
+#endif
+
 	d->j = new JT_IBB(d->m->client()->rootTask());
 	connect(d->j, SIGNAL(finished()), SLOT(ibb_finished()));
-	if (d->closing) {
-		d->j->close(d->peer, d->sid);
-	}
-	else {
-		d->j->sendData(d->peer, IBBData(d->sid, d->seq++, a));
-	}
+	d->j->close(d->peer, d->sid);
 	d->j->go(true);
 }
 
@@ -362,6 +402,11 @@ public:
 	IBBConnectionList activeConns;
 	IBBConnectionList incomingConns;
 	JT_IBB *ibb;
+
+	int blockSize;
+	int maxBlockSize;
+	int windowSize;
+	Stanza::Kind stanzaKind;
 };
 
 IBBManager::IBBManager(Client *parent)
@@ -369,6 +414,10 @@ IBBManager::IBBManager(Client *parent)
 {
 	d = new Private;
 	d->client = parent;
+	d->blockSize = IBB_PACKET_SIZE;
+	d->maxBlockSize = IBB_MAX_PACKET_SIZE;
+	d->windowSize = IBB_WINDOW_SIZE;
+	d->stanzaKind = Stanza::IQ;
 
 	d->ibb = new JT_IBB(d->client->rootTask(), true);
 	connect(d->ibb,
@@ -410,10 +459,56 @@ IBBConnection *IBBManager::takeIncoming()
 	return d->incomingConns.isEmpty()? 0 : d->incomingConns.takeFirst();
 }
 
+int IBBManager::blockSize() const
+{
+	return d->blockSize;
+}
+
+void IBBManager::setBlockSize(int size)
+{
+	d->blockSize = qBound(IBB_MIN_PACKET_SIZE, size, IBB_MAX_PACKET_SIZE);
+}
+
+int IBBManager::maxBlockSize() const
+{
+	return d->maxBlockSize;
+}
+
+void IBBManager::setMaxBlockSize(int size)
+{
+	d->maxBlockSize = qBound(IBB_MIN_PACKET_SIZE, size, IBB_MAX_PACKET_SIZE);
+}
+
+int IBBManager::windowSize() const
+{
+	return d->windowSize;
+}
+
+void IBBManager::setWindowSize(int size)
+{
+	d->windowSize = qMax(1, size);
+}
+
+Stanza::Kind IBBManager::stanzaKind() const
+{
+	return d->stanzaKind;
+}
+
+void IBBManager::setStanzaKind(Stanza::Kind kind)
+{
+	d->stanzaKind = kind;
+}
+
 void IBBManager::ibb_incomingRequest(const Jid &from, const QString &id,
 									 const QString &sid, int blockSize,
 									 const QString &stanza)
 {
+	// xep-0047: ask the initiator for smaller blocks
+	if(blockSize <= 0 || blockSize > d->maxBlockSize) {
+		d->ibb->respondError(from, id, Stanza::Error::ResourceConstraint, "Block size too large");
+		return;
+	}
+
 	// create a "waiting" connection
 	IBBConnection *c = new IBBConnection(this);
 	c->waitForAccept(from, id, sid, blockSize, stanza);
@@ -507,6 +602,8 @@ public:
 	Jid to;
 	QString sid;
 	int bytesWritten;
+	int errorCondition;
+	Stanza::Kind kind;
 };
 
 JT_IBB::JT_IBB(Task *parent, bool serve)
@@ -514,6 +611,9 @@ JT_IBB::JT_IBB(Task *parent, bool serve)
 {
 	d = new Private;
 	d->serve = serve;
+	d->bytesWritten = 0;
+	d->errorCondition = 0;
+	d->kind = Stanza::IQ;
 }
 
 JT_IBB::~JT_IBB()
@@ -521,7 +621,8 @@ JT_IBB::~JT_IBB()
 	delete d;
 }
 
-void JT_IBB::request(const Jid &to, const QString &sid)
+void JT_IBB::request(const Jid &to, const QString &sid, int blockSize,
+					 Stanza::Kind kind)
 {
 	d->mode = ModeRequest;
 	QDomElement iq;
@@ -531,19 +632,28 @@ void JT_IBB::request(const Jid &to, const QString &sid)
 	//genUniqueKey
 	query.setAttribute("xmlns", IBB_NS);
 	query.setAttribute("sid", sid);
-	query.setAttribute("block-size", IBB_PACKET_SIZE);
-	query.setAttribute("stanza", "iq");
+	query.setAttribute("block-size", blockSize);
+	query.setAttribute("stanza", kind == Stanza::Message? "message" : "iq");
 	iq.appendChild(query);
 	d->iq = iq;
 }
 
-void JT_IBB::sendData(const Jid &to, const IBBData &ibbData)
+void JT_IBB::sendData(const Jid &to, const IBBData &ibbData,
+					  Stanza::Kind kind)
 {
 	d->mode = ModeSendData;
+	d->kind = kind;
 	QDomElement iq;
 	d->to = to;
 	d->bytesWritten = ibbData.data.size();
-	iq = createIQ(doc(), "set", to.full(), id());
+	if(kind == Stanza::Message) {
+		iq = doc()->createElement("message");
+		iq.setAttribute("to", to.full());
+		iq.setAttribute("id", id());
+	}
+	else {
+		iq = createIQ(doc(), "set", to.full(), id());
+	}
 	iq.appendChild(ibbData.toXml(doc()));
 	d->iq = iq;
 }
@@ -565,7 +675,9 @@ void JT_IBB::respondError(const Jid &to, const QString &id,
 						  Stanza::Error::ErrorCond cond, const QString &text)
 {
 	QDomElement iq = createIQ(doc(), "error", to.full(), id);
-	Stanza::Error error(Stanza::Error::Cancel, cond, text);
+	// xep-0047 wants the initiator to retry with smaller blocks
+	int type = cond == Stanza::Error::ResourceConstraint? Stanza::Error::Modify : Stanza::Error::Cancel;
+	Stanza::Error error(type, cond, text);
 	iq.appendChild(error.toXml(*client()->doc(), client()->stream().baseNS()));
 	send(iq);
 }
@@ -578,6 +690,16 @@ void JT_IBB::respondAck(const Jid &to, const QString &id)
 void JT_IBB::onGo()
 {
 	send(d->iq);
+
+	// messages are not acked.  finish from the event loop, so the
+	// connection does not recurse into sending the next packet.
+	if(d->kind == Stanza::Message)
+		QTimer::singleShot(IBB_PACKET_DELAY, this, SLOT(messageSent()));
+}
+
+void JT_IBB::messageSent()
+{
+	setSuccess();
 }
 
 bool JT_IBB::take(const QDomElement &e)
@@ -619,6 +741,9 @@ bool JT_IBB::take(const QDomElement &e)
 			setSuccess();
 		}
 		else {
+			Stanza::Error err;
+			err.fromXml(e.firstChildElement("error"), client()->streamBaseNS());
+			d->errorCondition = err.condition;
 			setError(e);
 		}
 
@@ -641,3 +766,8 @@ int JT_IBB::bytesWritten() const
 	return d->bytesWritten;
 }
 
+int JT_IBB::errorCondition() const
+{
+	return d->errorCondition;
+}
+
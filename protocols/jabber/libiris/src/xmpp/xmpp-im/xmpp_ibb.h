@@ -89,6 +89,7 @@ namespace XMPP
 		Private *d;
 
 		void resetConnection(bool clear=false);
+		void sendRequest();
 
 		friend class IBBManager;
 		void waitForAccept(const Jid &peer, const QString &iq_id,
@@ -113,6 +114,25 @@ namespace XMPP
 		BSConnection *createConnection();
 		IBBConnection *takeIncoming();
 
+		// block size offered for outgoing streams.  it is halved while
+		// the peer answers with resource-constraint, bad-request or
+		// not-acceptable, down to the old default of 4096.
+		int blockSize() const;
+		void setBlockSize(int size);
+
+		// largest block size accepted for incoming streams
+		int maxBlockSize() const;
+		void setMaxBlockSize(int size);
+
+		// data packets sent before waiting for the first ack
+		int windowSize() const;
+		void setWindowSize(int size);
+
+		// stanza carrying the data of outgoing streams.  messages are
+		// not acked, so they only make sense on servers that keep up.
+		Stanza::Kind stanzaKind() const;
+		void setStanzaKind(Stanza::Kind kind);
+
 	public slots:
 		void takeIncomingData(const Jid &from, const QString &id,
 							  const IBBData &data, Stanza::Kind);
@@ -148,8 +168,10 @@ namespace XMPP
 		JT_IBB(Task *, bool serve=false);
 		~JT_IBB();
 
-		void request(const Jid &, const QString &sid);
-		void sendData(const Jid &, const IBBData &ibbData);
+		void request(const Jid &, const QString &sid, int blockSize,
+					 Stanza::Kind kind = Stanza::IQ);
+		void sendData(const Jid &, const IBBData &ibbData,
+					  Stanza::Kind kind = Stanza::IQ);
 		void close(const Jid &, const QString &sid);
 		void respondError(const Jid &, const QString &id,
 						  Stanza::Error::ErrorCond cond, const QString &text = "");
@@ -161,6 +183,7 @@ namespace XMPP
 		Jid jid() const;
 		int mode() const;
 		int bytesWritten() const;
+		int errorCondition() const;
 
 	signals:
 		void incomingRequest(const Jid &from, const QString &id,
@@ -170,6 +193,9 @@ namespace XMPP
 						  const IBBData &data, Stanza::Kind);
 		void closeRequest(const Jid &from, const QString &id, const QString &sid);
 
+	private slots:
+		void messageSent();
+
 	private:
 		class Private;
 		Private *d;
@@ -21,6 +21,7 @@
 #define XMPP_ROSTER_H
 
 #include <QList>
+#include <QString>
 
 #include "xmpp_rosteritem.h"
 
@@ -39,8 +40,12 @@ namespace XMPP
 		Roster::Iterator find(const Jid &);
 		Roster::ConstIterator find(const Jid &) const;
 
+		// roster version (XEP-0237), null if the server did not send one
+		QString version() const;
+		void setVersion(const QString &);
+
 	private:
-		class RosterPrivate *d;
+		QString v_version;
 	};
 }
 
@@ -87,6 +87,7 @@ static Roster xmlReadRoster(const QDomElement &q, bool push)
 			r += item;
 		}
 	}
+	r.setVersion(q.attribute("ver"));
 
 	return r;
 }
@@ -364,10 +365,11 @@ void JT_UnRegister::unregFinished()
 class JT_Roster::Private
 {
 public:
-	Private() {}
+	Private() : unchanged(false) {}
 
 	Roster roster;
 	QList<QDomElement> itemList;
+	bool unchanged;
 };
 
 JT_Roster::JT_Roster(Task *parent)
@@ -382,13 +384,15 @@ JT_Roster::~JT_Roster()
 	delete d;
 }
 
-void JT_Roster::get()
+void JT_Roster::get(const QString &version)
 {
 	type = 0;
 	//to = client()->host();
 	iq = createIQ(doc(), "get", to.full(), id());
 	QDomElement query = doc()->createElement("query");
 	query.setAttribute("xmlns", "jabber:iq:roster");
+	if(!version.isNull())
+		query.setAttribute("ver", version);
 	iq.appendChild(query);
 }
 
@@ -436,6 +440,11 @@ const Roster & JT_Roster::roster() const
 	return d->roster;
 }
 
+bool JT_Roster::isUnchanged() const
+{
+	return d->unchanged;
+}
+
 QString JT_Roster::toString() const
 {
 	if(type != 1)
@@ -481,7 +490,12 @@ bool JT_Roster::take(const QDomElement &x)
 	if(type == 0) {
 		if(x.attribute("type") == "result") {
 			QDomElement q = queryTag(x);
-			d->roster = xmlReadRoster(q, false);
+			// an empty result to a versioned request means our copy is
+			// current and any changes will follow as roster pushes
+			if(q.isNull())
+				d->unchanged = true;
+			else
+				d->roster = xmlReadRoster(q, false);
 			setSuccess();
 		}
 		else {
@@ -94,11 +94,12 @@ namespace XMPP
 		JT_Roster(Task *parent);
 		~JT_Roster();
 
-		void get();
+		void get(const QString &version = QString());
 		void set(const Jid &, const QString &name, const QStringList &groups);
 		void remove(const Jid &);
 
 		const Roster & roster() const;
+		bool isUnchanged() const;
 
 		QString toString() const;
 		bool fromString(const QString &);
@@ -2,6 +2,7 @@
 #define ZLIB_COMMON_H
 
 #define CHUNK_SIZE 1024
+#define OUTPUT_BUFFER_SIZE 16384
 
 static void initZStream(z_stream* z)
 {
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2010  Kopete Developers
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ *
+ */
+
+#include <QObject>
+#include <QBuffer>
+#include <QtTest/QtTest>
+
+#include "qttestutil/qttestutil.h"
+#include "xmpp/zlib/zlibcompressor.h"
+#include "xmpp/zlib/zlibdecompressor.h"
+
+class ZLibCompressorTest : public QObject
+{
+		Q_OBJECT
+
+	private:
+		// A roster-login-like burst of presence stanzas
+		static QList<QByteArray> stanzas(int count) {
+			QList<QByteArray> result;
+			for (int i = 0; i < count; ++i) {
+				result += QString("<presence from='contact%1@example.com/Kopete' to='me@example.com/Kopete'>"
+					"<show>away</show><status>Away from keyboard</status><priority>5</priority>"
+					"<c xmlns='http://jabber.org/protocol/caps' node='http://kopete.kde.org/jabber/caps' ver='0.17' ext='ext1 ext2'/>"
+					"</presence>").arg(i).toUtf8();
+			}
+			return result;
+		}
+
+		// Compresses the stanzas, sync-flushing after every 'batch' writes
+		// when the compressor does not flush by itself.
+		static QByteArray compress(const QList<QByteArray>& input, ZLibCompressor::FlushPolicy policy, int batch) {
+			QBuffer wire;
+			wire.open(QIODevice::ReadWrite);
+			ZLibCompressor compressor(&wire);
+			compressor.setFlushPolicy(policy);
+			for (int i = 0; i < input.size(); ++i) {
+				compressor.write(input[i]);
+				if (policy == ZLibCompressor::FlushOnSync && (i + 1) % batch == 0)
+					compressor.sync();
+			}
+			compressor.sync();
+			return wire.buffer();
+		}
+
+		static QByteArray decompress(const QByteArray& input) {
+			QBuffer plain;
+			plain.open(QIODevice::ReadWrite);
+			ZLibDecompressor decompressor(&plain);
+			decompressor.write(input);
+			return plain.buffer();
+		}
+
+		static QByteArray join(const QList<QByteArray>& input) {
+			QByteArray result;
+			foreach(const QByteArray& a, input)
+				result += a;
+			return result;
+		}
+
+	private slots:
+		void testRoundTripFlushEveryWrite() {
+			QList<QByteArray> input = stanzas(100);
+			QCOMPARE(decompress(compress(input, ZLibCompressor::FlushEveryWrite, 1)), join(input));
+		}
+
+		void testRoundTripFlushOnSync() {
+			QList<QByteArray> input = stanzas(100);
+			QCOMPARE(decompress(compress(input, ZLibCompressor::FlushOnSync, 10)), join(input));
+		}
+
+		void testSyncMakesDataAvailable() {
+			QBuffer wire;
+			wire.open(QIODevice::ReadWrite);
+			ZLibCompressor compressor(&wire);
+			compressor.setFlushPolicy(ZLibCompressor::FlushOnSync);
+			compressor.write("<presence/>");
+			compressor.sync();
+
+			QCOMPARE(decompress(wire.buffer()), QByteArray("<presence/>"));
+		}
+
+		void testDecompressIntoOutputBuffer() {
+			QList<QByteArray> input = stanzas(20);
+			QByteArray compressed = compress(input, ZLibCompressor::FlushEveryWrite, 1);
+
+			QBuffer device;
+			device.open(QIODevice::ReadWrite);
+			QByteArray target("prefix");
+			ZLibDecompressor decompressor(&device);
+			decompressor.setOutputBuffer(&target);
+			QCOMPARE(decompressor.write(compressed), qint64(0));
+
+			QCOMPARE(target, QByteArray("prefix") + join(input));
+			QVERIFY(device.buffer().isEmpty());
+			decompressor.setOutputBuffer(0);
+		}
+
+		void testCompressionLevel() {
+			QBuffer wire;
+			wire.open(QIODevice::ReadWrite);
+			ZLibCompressor compressor(&wire, 1);
+			QList<QByteArray> input = stanzas(10);
+			compressor.write(join(input.mid(0, 5)));
+			QCOMPARE(compressor.setCompressionLevel(9), int(Z_OK));
+			QCOMPARE(compressor.compressionLevel(), 9);
+			compressor.write(join(input.mid(5)));
+
+			QCOMPARE(decompress(wire.buffer()), join(input));
+		}
+
+		void testBatchingSavesWireBytes() {
+			QList<QByteArray> input = stanzas(500);
+			QByteArray perWrite = compress(input, ZLibCompressor::FlushEveryWrite, 1);
+			QByteArray perBatch = compress(input, ZLibCompressor::FlushOnSync, 50);
+			QVERIFY(perWrite.size() < join(input).size());
+			QVERIFY(perBatch.size() < perWrite.size());
+		}
+
+		void benchmarkFlushEveryWrite() {
+			QList<QByteArray> input = stanzas(1000);
+			QBENCHMARK {
+				compress(input, ZLibCompressor::FlushEveryWrite, 1);
+			}
+		}
+
+		void benchmarkFlushOnSync() {
+			QList<QByteArray> input = stanzas(1000);
+			QBENCHMARK {
+				compress(input, ZLibCompressor::FlushOnSync, 50);
+			}
+		}
+
+		void benchmarkDecompress() {
+			QList<QByteArray> input = stanzas(1000);
+			QByteArray compressed = compress(input, ZLibCompressor::FlushEveryWrite, 1);
+			QBENCHMARK {
+				decompress(compressed);
+			}
+		}
+};
+
+QTTESTUTIL_REGISTER_TEST(ZLibCompressorTest);
+#include "zlibcompressortest.moc"
@@ -7,7 +7,7 @@
 
 #include "common.h"
 
-ZLibCompressor::ZLibCompressor(QIODevice* device, int compression) : device_(device)
+ZLibCompressor::ZLibCompressor(QIODevice* device, int compression) : device_(device), policy_(FlushEveryWrite), compression_(compression), output_position_(0)
 {
 	zlib_stream_ = (z_stream*) malloc(sizeof(z_stream));
 	initZStream(zlib_stream_);
@@ -16,6 +16,10 @@ ZLibCompressor::ZLibCompressor(QIODevice* device, int compression) : device_(dev
 	Q_UNUSED(result);
 	connect(device, SIGNAL(aboutToClose()), this, SLOT(flush()));
 	flushed_ = false;
+
+	// The output buffer lives as long as the compressor, so steady state
+	// writes do not allocate.
+	output_.resize(OUTPUT_BUFFER_SIZE);
 }
 
 ZLibCompressor::~ZLibCompressor()
@@ -38,56 +42,121 @@ void ZLibCompressor::flush()
 	flushed_ = true;
 }
 
+void ZLibCompressor::setFlushPolicy(FlushPolicy policy)
+{
+	policy_ = policy;
+}
+
+ZLibCompressor::FlushPolicy ZLibCompressor::flushPolicy() const
+{
+	return policy_;
+}
+
+int ZLibCompressor::setCompressionLevel(int compression)
+{
+	if (flushed_ || compression == compression_)
+		return Z_OK;
+
+	// deflateParams() may emit the data compressed so far with the old
+	// level, so make sure it lands in our buffer and not on the floor.
+	zlib_stream_->avail_in = 0;
+	zlib_stream_->next_in = NULL;
+	int result;
+	do {
+		if (output_.size() - output_position_ < CHUNK_SIZE)
+			output_.resize(output_.size() * 2);
+		zlib_stream_->avail_out = output_.size() - output_position_;
+		zlib_stream_->next_out = (Bytef*) (output_.data() + output_position_);
+		result = deflateParams(zlib_stream_, compression, Z_DEFAULT_STRATEGY);
+		output_position_ = output_.size() - zlib_stream_->avail_out;
+	}
+	while (result == Z_BUF_ERROR && zlib_stream_->avail_out == 0);
+	writeOutput();
+
+	if (result != Z_OK) {
+		qWarning() << QString("compressor.cpp: deflateParams failed (%1)").arg(result);
+		return result;
+	}
+	compression_ = compression;
+	return Z_OK;
+}
+
+int ZLibCompressor::compressionLevel() const
+{
+	return compression_;
+}
+
 int ZLibCompressor::write(const QByteArray& input)
 {
 	return write(input,false);
 }
 
+int ZLibCompressor::sync()
+{
+	if (flushed_)
+		return 0;
+
+	zlib_stream_->avail_in = 0;
+	zlib_stream_->next_in = NULL;
+	int result = deflateInput(Z_SYNC_FLUSH);
+	if (result == Z_STREAM_ERROR)
+		return result;
+
+	writeOutput();
+	return 0;
+}
+
 int ZLibCompressor::write(const QByteArray& input, bool flush)
 {
-	int result;
 	zlib_stream_->avail_in = input.size();
 	zlib_stream_->next_in = (Bytef*) input.data();
-	QByteArray output;
 
 	// Write the data
-	int output_position = 0;
-	do {
-		output.resize(output_position + CHUNK_SIZE);
-		zlib_stream_->avail_out = CHUNK_SIZE;
-		zlib_stream_->next_out = (Bytef*) (output.data() + output_position);
-		result = deflate(zlib_stream_,(flush ? Z_FINISH : Z_NO_FLUSH));
-		if (result == Z_STREAM_ERROR) {
-			qWarning() << QString("compressor.cpp: Error ('%1')").arg(zlib_stream_->msg);
-			return result;
-		}
-		output_position += CHUNK_SIZE;
-	}
-	while (zlib_stream_->avail_out == 0);
+	int result = deflateInput(flush ? Z_FINISH : Z_NO_FLUSH);
+	if (result == Z_STREAM_ERROR)
+		return result;
 	if (zlib_stream_->avail_in != 0) {
 		qWarning("ZLibCompressor: avail_in != 0");
 	}
-	output_position -= zlib_stream_->avail_out;
 
 	// Flush the data
-	if (!flush) {
-		do {
-			output.resize(output_position + CHUNK_SIZE);
-			zlib_stream_->avail_out = CHUNK_SIZE;
-			zlib_stream_->next_out = (Bytef*) (output.data() + output_position);
-			result = deflate(zlib_stream_,Z_SYNC_FLUSH);
-			if (result == Z_STREAM_ERROR) {
-				qWarning() << QString("compressor.cpp: Error ('%1')").arg(zlib_stream_->msg);
-				return result;
-			}
-			output_position += CHUNK_SIZE;
-		}
-		while (zlib_stream_->avail_out == 0);
-		output_position -= zlib_stream_->avail_out;
+	if (!flush && policy_ == FlushEveryWrite) {
+		result = deflateInput(Z_SYNC_FLUSH);
+		if (result == Z_STREAM_ERROR)
+			return result;
 	}
-	output.resize(output_position);
 
 	// Write the compressed data
-	device_->write(output);
+	writeOutput();
 	return 0;
 }
+
+int ZLibCompressor::deflateInput(int mode)
+{
+	int result;
+	do {
+		// Grow the persistent buffer instead of allocating a new one; it is
+		// rewound in writeOutput() and keeps its capacity.
+		if (output_.size() - output_position_ < CHUNK_SIZE)
+			output_.resize(output_.size() * 2);
+		zlib_stream_->avail_out = output_.size() - output_position_;
+		zlib_stream_->next_out = (Bytef*) (output_.data() + output_position_);
+		result = deflate(zlib_stream_, mode);
+		if (result == Z_STREAM_ERROR) {
+			qWarning() << QString("compressor.cpp: Error ('%1')").arg(zlib_stream_->msg);
+			return result;
+		}
+		output_position_ = output_.size() - zlib_stream_->avail_out;
+	}
+	while (zlib_stream_->avail_out == 0);
+	return result;
+}
+
+void ZLibCompressor::writeOutput()
+{
+	if (output_position_ == 0)
+		return;
+
+	device_->write(output_.constData(), output_position_);
+	output_position_ = 0;
+}
@@ -2,6 +2,7 @@
 #define ZLIBCOMPRESSOR_H
 
 #include <QObject>
+#include <QByteArray>
 
 #include "zlib.h"
 
@@ -12,10 +13,25 @@ class ZLibCompressor : public QObject
 	Q_OBJECT
 
 public:
+	/**
+	 * FlushEveryWrite ends every write() with a Z_SYNC_FLUSH, so each chunk
+	 * can be decoded by the peer on its own. FlushOnSync only compresses on
+	 * write() and leaves it to the caller to call sync() once a batch of
+	 * stanzas is complete, which gives a better ratio and fewer flush markers.
+	 */
+	enum FlushPolicy { FlushEveryWrite, FlushOnSync };
+
 	ZLibCompressor(QIODevice* device, int compression = Z_DEFAULT_COMPRESSION);
 	~ZLibCompressor();
 
 	int write(const QByteArray&);
+	int sync();
+
+	void setFlushPolicy(FlushPolicy policy);
+	FlushPolicy flushPolicy() const;
+
+	int setCompressionLevel(int compression);
+	int compressionLevel() const;
 
 protected slots:
 	void flush();
@@ -24,9 +40,16 @@ protected:
 	int write(const QByteArray&, bool flush);
 
 private:
+	int deflateInput(int mode);
+	void writeOutput();
+
 	QIODevice* device_;
 	z_stream* zlib_stream_;
 	bool flushed_;
+	FlushPolicy policy_;
+	int compression_;
+	QByteArray output_;
+	int output_position_;
 };
 
 #endif
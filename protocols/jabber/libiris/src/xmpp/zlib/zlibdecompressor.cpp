@@ -7,7 +7,7 @@
 
 #include "xmpp/zlib/common.h"
 
-ZLibDecompressor::ZLibDecompressor(QIODevice* device) : device_(device)
+ZLibDecompressor::ZLibDecompressor(QIODevice* device) : device_(device), target_(0)
 {
 	zlib_stream_ = (z_stream*) malloc(sizeof(z_stream));
 	initZStream(zlib_stream_);
@@ -24,6 +24,11 @@ ZLibDecompressor::~ZLibDecompressor()
 	free(zlib_stream_);
 }
 
+void ZLibDecompressor::setOutputBuffer(QByteArray* target)
+{
+	target_ = target;
+}
+
 void ZLibDecompressor::flush()
 {
 	if (flushed_)
@@ -48,48 +53,44 @@ qint64 ZLibDecompressor::write(const QByteArray& input, bool flush)
 	int result;
 	zlib_stream_->avail_in = input.size();
 	zlib_stream_->next_in = (Bytef*) input.data();
-	QByteArray output;
 
-	// Write the data
-	int output_position = 0;
+	// Either append to the caller's buffer directly, or use our own
+	// persistent one and hand it to the device afterwards.
+	QByteArray& output = target_ ? *target_ : output_;
+	int output_position = target_ ? output.size() : 0;
+	int output_capacity = output_position + qMax(CHUNK_SIZE, input.size() * 4);
+	if (output.size() < output_capacity)
+		output.resize(output_capacity);
+
+	// Inflate everything that is available; Z_SYNC_FLUSH makes zlib hand out
+	// as much as it can, so there is no need for a separate flush pass.
 	do {
-		output.resize(output_position + CHUNK_SIZE);
-		zlib_stream_->avail_out = CHUNK_SIZE;
+		if (output.size() - output_position < CHUNK_SIZE)
+			output.resize(output.size() * 2);
+		zlib_stream_->avail_out = output.size() - output_position;
 		zlib_stream_->next_out = (Bytef*) (output.data() + output_position);
-		result = inflate(zlib_stream_,(flush ? Z_FINISH : Z_NO_FLUSH));
+		result = inflate(zlib_stream_,(flush ? Z_FINISH : Z_SYNC_FLUSH));
 		if (result == Z_STREAM_ERROR) {
 			qWarning() << QString("compressor.cpp: Error ('%1')").arg(zlib_stream_->msg);
+			if (target_)
+				output.resize(output_position);
 			return result;
 		}
-		output_position += CHUNK_SIZE;
+		output_position = output.size() - zlib_stream_->avail_out;
 	}
 	while (zlib_stream_->avail_out == 0);
+
+	if (target_)
+		output.resize(output_position);
+
 	//Q_ASSERT(zlib_stream_->avail_in == 0);
 	if (zlib_stream_->avail_in != 0) {
 		qWarning() << "ZLibDecompressor: Unexpected state: avail_in=" << zlib_stream_->avail_in << ",avail_out=" << zlib_stream_->avail_out << ",result=" << result;
 		return Z_STREAM_ERROR; // FIXME: Should probably return 'result'
 	}
-	output_position -= zlib_stream_->avail_out;
-
-	// Flush the data
-	if (!flush) {
-		do {
-			output.resize(output_position + CHUNK_SIZE);
-			zlib_stream_->avail_out = CHUNK_SIZE;
-			zlib_stream_->next_out = (Bytef*) (output.data() + output_position);
-			result = inflate(zlib_stream_,Z_SYNC_FLUSH);
-			if (result == Z_STREAM_ERROR) {
-				qWarning() << QString("compressor.cpp: Error ('%1')").arg(zlib_stream_->msg);
-				return result;
-			}
-			output_position += CHUNK_SIZE;
-		}
-		while (zlib_stream_->avail_out == 0);
-		output_position -= zlib_stream_->avail_out;
-	}
-	output.resize(output_position);
 
-	// Write the compressed data
-	device_->write(output);
+	// Write the decompressed data
+	if (!target_ && output_position > 0)
+		device_->write(output.constData(), output_position);
 	return 0;
 }
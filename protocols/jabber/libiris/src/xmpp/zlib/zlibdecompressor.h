@@ -17,6 +17,13 @@ public:
 
 	qint64 write(const QByteArray&);
 
+	/**
+	 * Inflate straight into @p target (appending to it) instead of going
+	 * through the device. The array must outlive the decompressor; pass 0 to
+	 * go back to writing to the device.
+	 */
+	void setOutputBuffer(QByteArray* target);
+
 protected slots:
 	void flush();
 
@@ -27,6 +34,8 @@ private:
 	QIODevice* device_;
 	z_stream* zlib_stream_;
 	bool flushed_;
+	QByteArray* target_;
+	QByteArray output_;
 };
 
 #endif
@@ -0,0 +1,170 @@
+/*
+    Tests for JabberJidIndex
+
+    Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This program is free software; you can redistribute it and/or modify  *
+    * it under the terms of the GNU General Public License as published by  *
+    * the Free Software Foundation; either version 2 of the License, or     *
+    * (at your option) any later version.                                   *
+    *                                                                       *
+    *************************************************************************
+*/
+#include "jabberjidindex_test.h"
+#include <qtest_kde.h>
+
+#include "jabberjidindex_test.moc"
+
+#include "jabberjidindex.h"
+
+QTEST_KDEMAIN( JabberJidIndexTest, GUI )
+
+// contacts of the roster and occupants of one room, like the contact pool holds them
+static QList<XMPP::Jid> rosterJids( int count )
+{
+	QList<XMPP::Jid> jids;
+	for ( int i = 0; i < count; ++i )
+		jids.append( XMPP::Jid( QString( "contact%1@example.com" ).arg( i ) ) );
+	return jids;
+}
+
+static QList<XMPP::Jid> roomJids( int count )
+{
+	QList<XMPP::Jid> jids;
+	for ( int i = 0; i < count; ++i )
+		jids.append( XMPP::Jid( QString( "room@conference.example.com/nick%1" ).arg( i ) ) );
+	return jids;
+}
+
+void JabberJidIndexTest::testFind()
+{
+	JabberJidIndex<int> index;
+	index.insert( XMPP::Jid( "user@example.com" ), 1 );
+	index.insert( XMPP::Jid( "user@example.com/home" ), 2 );
+
+	QCOMPARE( index.find( XMPP::Jid( "User@Example.com" ) ), 1 );
+	QCOMPARE( index.find( XMPP::Jid( "user@example.com/Home" ) ), 2 );
+	QCOMPARE( index.find( XMPP::Jid( "user@example.com/work" ) ), 0 );
+
+	// a message from any resource finds the roster contact
+	QCOMPARE( index.findWithoutResource( XMPP::Jid( "user@example.com/work" ) ), 1 );
+	QCOMPARE( index.findWithoutResource( XMPP::Jid( "other@example.com/work" ) ), 0 );
+}
+
+void JabberJidIndexTest::testBare()
+{
+	JabberJidIndex<int> index;
+	index.insert( XMPP::Jid( "room@conference.example.com" ), 1 );
+	index.insert( XMPP::Jid( "room@conference.example.com/alice" ), 2 );
+	index.insert( XMPP::Jid( "room@conference.example.com/bob" ), 3 );
+	index.insert( XMPP::Jid( "other@example.com" ), 4 );
+
+	QList<int> items = index.findBare( XMPP::Jid( "Room@conference.example.com/whoever" ) );
+	qSort( items );
+	QCOMPARE( items, QList<int>() << 1 << 2 << 3 );
+	QCOMPARE( index.countBare( XMPP::Jid( "room@conference.example.com" ) ), 3 );
+	QVERIFY( index.findBare( XMPP::Jid( "nobody@example.com" ) ).isEmpty() );
+}
+
+void JabberJidIndexTest::testReplace()
+{
+	JabberJidIndex<int> index;
+	XMPP::Jid jid( "user@example.com" );
+	index.insert( jid, 1 );
+	index.insert( jid, 2 );
+	QCOMPARE( index.find( jid ), 2 );
+	QCOMPARE( index.countBare( jid ), 2 );
+
+	// removing the replaced item leaves the newer one in place
+	index.remove( jid, 1 );
+	QCOMPARE( index.find( jid ), 2 );
+	QCOMPARE( index.findBare( jid ), QList<int>() << 2 );
+}
+
+void JabberJidIndexTest::testRemove()
+{
+	JabberJidIndex<int> index;
+	index.insert( XMPP::Jid( "room@conference.example.com/alice" ), 1 );
+	index.insert( XMPP::Jid( "room@conference.example.com/bob" ), 2 );
+
+	index.remove( XMPP::Jid( "room@conference.example.com/alice" ), 1 );
+	QCOMPARE( index.find( XMPP::Jid( "room@conference.example.com/alice" ) ), 0 );
+	QCOMPARE( index.findBare( XMPP::Jid( "room@conference.example.com" ) ), QList<int>() << 2 );
+
+	index.remove( XMPP::Jid( "room@conference.example.com/bob" ), 2 );
+	QVERIFY( index.isEmpty() );
+}
+
+void JabberJidIndexTest::benchmarkPresenceStorm_data()
+{
+	QTest::addColumn<int>( "contacts" );
+	QTest::newRow( "1000" ) << 1000;
+	QTest::newRow( "5000" ) << 5000;
+	QTest::newRow( "20000" ) << 20000;
+}
+
+// every contact and every occupant sends a presence. each one is looked
+//   up the way the contact pool does it, so the time per presence should
+//   not grow with the size of the roster and the room
+void JabberJidIndexTest::benchmarkPresenceStorm()
+{
+	QFETCH( int, contacts );
+
+	QList<XMPP::Jid> roster = rosterJids( contacts );
+	QList<XMPP::Jid> room = roomJids( contacts );
+
+	JabberJidIndex<int> index;
+	int id = 0;
+	foreach ( const XMPP::Jid &jid, roster )
+		index.insert( jid, ++id );
+	index.insert( XMPP::Jid( "room@conference.example.com" ), ++id );
+	foreach ( const XMPP::Jid &jid, room )
+		index.insert( jid, ++id );
+
+	QList<XMPP::Jid> presences;
+	foreach ( const XMPP::Jid &jid, roster )
+		presences.append( jid.withResource( "kopete" ) );
+	presences += room;
+
+	int found = 0;
+	QBENCHMARK
+	{
+		foreach ( const XMPP::Jid &jid, presences )
+		{
+			if ( index.find( jid ) || index.findWithoutResource( jid ) )
+				++found;
+		}
+	}
+	QVERIFY( found > 0 );
+}
+
+void JabberJidIndexTest::benchmarkRoomLeave_data()
+{
+	QTest::addColumn<int>( "occupants" );
+	QTest::newRow( "1000" ) << 1000;
+	QTest::newRow( "5000" ) << 5000;
+	QTest::newRow( "20000" ) << 20000;
+}
+
+// join a room and leave it again.  leaving removes one occupant at a
+//   time, which used to cost O(occupants) each
+void JabberJidIndexTest::benchmarkRoomLeave()
+{
+	QFETCH( int, occupants );
+
+	QList<XMPP::Jid> room = roomJids( occupants );
+
+	JabberJidIndex<int> index;
+	QBENCHMARK
+	{
+		int id = 0;
+		foreach ( const XMPP::Jid &jid, room )
+			index.insert( jid, ++id );
+		id = 0;
+		foreach ( const XMPP::Jid &jid, room )
+			index.remove( jid, ++id );
+	}
+	QVERIFY( index.isEmpty() );
+}
@@ -0,0 +1,35 @@
+/*
+    Tests for JabberJidIndex
+
+    Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This program is free software; you can redistribute it and/or modify  *
+    * it under the terms of the GNU General Public License as published by  *
+    * the Free Software Foundation; either version 2 of the License, or     *
+    * (at your option) any later version.                                   *
+    *                                                                       *
+    *************************************************************************
+*/
+#ifndef JABBERJIDINDEX_TEST_H
+#define JABBERJIDINDEX_TEST_H
+
+#include <QObject>
+
+class JabberJidIndexTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void testFind();
+	void testBare();
+	void testReplace();
+	void testRemove();
+
+	void benchmarkPresenceStorm_data();
+	void benchmarkPresenceStorm();
+	void benchmarkRoomLeave_data();
+	void benchmarkRoomLeave();
+};
+
+#endif
@@ -0,0 +1,141 @@
+/*
+    Tests for JabberRequestThrottle
+
+    Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This program is free software; you can redistribute it and/or modify  *
+    * it under the terms of the GNU General Public License as published by  *
+    * the Free Software Foundation; either version 2 of the License, or     *
+    * (at your option) any later version.                                   *
+    *                                                                       *
+    *************************************************************************
+*/
+#include "jabberrequestthrottle_test.h"
+#include <qtest_kde.h>
+
+#include <QtTest/QSignalSpy>
+
+#include "jabberrequestthrottle_test.moc"
+
+#include "jabberrequestthrottle.h"
+
+QTEST_KDEMAIN( JabberRequestThrottleTest, GUI )
+
+void JabberRequestThrottleTest::testLimit()
+{
+	JabberRequestThrottle throttle;
+	QObject requests[4];
+
+	for ( int i = 0; i < 4; i++ )
+	{
+		QVERIFY( throttle.canSend() );
+		throttle.sent( &requests[i] );
+	}
+	QVERIFY( !throttle.canSend() );
+	QCOMPARE( throttle.inFlight(), 4 );
+
+	// a quick answer frees the slot and keeps the pace
+	int delay = throttle.delay();
+	QVERIFY( throttle.answered( &requests[0], true ) );
+	QVERIFY( throttle.canSend() );
+	QCOMPARE( throttle.delay(), delay );
+
+	// answering twice does not free another slot
+	QVERIFY( !throttle.answered( &requests[0], true ) );
+	QCOMPARE( throttle.inFlight(), 3 );
+
+	throttle.clear();
+}
+
+void JabberRequestThrottleTest::testNeverAnswered()
+{
+	// a server that swallows every request must not stall the queue
+	JabberRequestThrottle throttle;
+	throttle.setTimeout( 100 );
+	QSignalSpy spy( &throttle, SIGNAL(expired(QObject*)) );
+
+	QObject requests[4];
+	for ( int i = 0; i < 4; i++ )
+		throttle.sent( &requests[i] );
+	QVERIFY( !throttle.canSend() );
+
+	int delay = throttle.delay();
+	QTest::qWait( 300 );
+
+	QCOMPARE( spy.count(), 4 );
+	QCOMPARE( throttle.inFlight(), 0 );
+	QVERIFY( throttle.canSend() );
+	QVERIFY( throttle.delay() > delay );
+}
+
+void JabberRequestThrottleTest::testLateAnswer()
+{
+	JabberRequestThrottle throttle;
+	throttle.setTimeout( 50 );
+	QSignalSpy spy( &throttle, SIGNAL(expired(QObject*)) );
+
+	QObject early, late;
+	throttle.sent( &early );
+	QTest::qWait( 100 );
+	QCOMPARE( spy.count(), 1 );
+	QCOMPARE( spy.at( 0 ).at( 0 ).value<QObject*>(), &early );
+
+	// the expiry timer is re-armed for requests sent later
+	throttle.sent( &late );
+	QTest::qWait( 100 );
+	QCOMPARE( spy.count(), 2 );
+
+	// answers to expired requests are not counted again
+	int delay = throttle.delay();
+	QVERIFY( !throttle.answered( &early, true ) );
+	QVERIFY( !throttle.answered( &late, false ) );
+	QCOMPARE( throttle.delay(), delay );
+}
+
+void JabberRequestThrottleTest::testErrorBacksOff()
+{
+	JabberRequestThrottle throttle;
+	QObject request;
+
+	int delay = throttle.delay();
+	throttle.sent( &request );
+	QVERIFY( throttle.answered( &request, false ) );
+	QVERIFY( throttle.delay() > delay );
+
+	// and recovers once the server answers again
+	int backedOff = throttle.delay();
+	throttle.sent( &request );
+	QVERIFY( throttle.answered( &request, true ) );
+	QVERIFY( throttle.delay() < backedOff );
+}
+
+void JabberRequestThrottleTest::testDestroyedRequest()
+{
+	JabberRequestThrottle throttle;
+
+	QObject *request = new QObject;
+	throttle.sent( request );
+	QCOMPARE( throttle.inFlight(), 1 );
+
+	delete request;
+	QCOMPARE( throttle.inFlight(), 0 );
+}
+
+void JabberRequestThrottleTest::testClear()
+{
+	JabberRequestThrottle throttle;
+	throttle.setTimeout( 50 );
+	QSignalSpy spy( &throttle, SIGNAL(expired(QObject*)) );
+
+	QObject request;
+	throttle.sent( &request );
+	throttle.answered( &request, false );
+	throttle.sent( &request );
+	throttle.clear();
+
+	QCOMPARE( throttle.inFlight(), 0 );
+	QTest::qWait( 100 );
+	QCOMPARE( spy.count(), 0 );
+}
@@ -0,0 +1,32 @@
+/*
+    Tests for JabberRequestThrottle
+
+    Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This program is free software; you can redistribute it and/or modify  *
+    * it under the terms of the GNU General Public License as published by  *
+    * the Free Software Foundation; either version 2 of the License, or     *
+    * (at your option) any later version.                                   *
+    *                                                                       *
+    *************************************************************************
+*/
+#ifndef JABBERREQUESTTHROTTLE_TEST_H
+#define JABBERREQUESTTHROTTLE_TEST_H
+
+#include <QObject>
+
+class JabberRequestThrottleTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void testLimit();
+	void testNeverAnswered();
+	void testLateAnswer();
+	void testErrorBacksOff();
+	void testDestroyedRequest();
+	void testClear();
+};
+
+#endif
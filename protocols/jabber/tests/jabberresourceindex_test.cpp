@@ -0,0 +1,243 @@
+/*
+    Tests for JabberResourceIndex
+
+    Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This program is free software; you can redistribute it and/or modify  *
+    * it under the terms of the GNU General Public License as published by  *
+    * the Free Software Foundation; either version 2 of the License, or     *
+    * (at your option) any later version.                                   *
+    *                                                                       *
+    *************************************************************************
+*/
+#include "jabberresourceindex_test.h"
+#include <qtest_kde.h>
+
+#include "jabberresourceindex_test.moc"
+
+#include "jabberresourceindex.h"
+
+QTEST_KDEMAIN( JabberResourceIndexTest, GUI )
+
+// the parts of JabberResource the index looks at
+class FakeResource
+{
+public:
+	FakeResource( const XMPP::Jid &jid, const QString &name, int priority, const QDateTime &timeStamp )
+		: mJid( jid.withResource( name ) ), mResource( name )
+	{
+		setStatus( priority, timeStamp );
+	}
+
+	void setStatus( int priority, const QDateTime &timeStamp )
+	{
+		XMPP::Status status;
+		status.setPriority( priority );
+		status.setTimeStamp( timeStamp );
+		mResource.setStatus( status );
+	}
+
+	const XMPP::Jid &jid() const { return mJid; }
+	const XMPP::Resource &resource() const { return mResource; }
+
+private:
+	XMPP::Jid mJid;
+	XMPP::Resource mResource;
+};
+
+static const QDateTime start( QDate( 2010, 1, 1 ), QTime( 12, 0 ) );
+
+// all occupants of one room at the same priority, in the order they joined
+static QList<FakeResource*> occupants( int count )
+{
+	XMPP::Jid room( "room@conference.example.com" );
+	QList<FakeResource*> resources;
+	for ( int i = 0; i < count; ++i )
+		resources.append( new FakeResource( room, QString( "nick%1" ).arg( i ), 0, start.addSecs( i ) ) );
+	return resources;
+}
+
+void JabberResourceIndexTest::testFind()
+{
+	FakeResource home( XMPP::Jid( "user@example.com" ), "Home", 5, start );
+	FakeResource work( XMPP::Jid( "user@example.com" ), "work", 1, start );
+
+	JabberResourceIndex<FakeResource> index;
+	index.insert( &home );
+	index.insert( &work );
+
+	QCOMPARE( index.find( XMPP::Jid( "User@Example.com" ), "home" ), &home );
+	QCOMPARE( index.find( XMPP::Jid( "user@example.com/whatever" ), "WORK" ), &work );
+	QVERIFY( !index.find( XMPP::Jid( "user@example.com" ), "mobile" ) );
+	QVERIFY( !index.find( XMPP::Jid( "other@example.com" ), "home" ) );
+	QCOMPARE( index.resources( XMPP::Jid( "user@example.com" ) ).count(), 2 );
+}
+
+void JabberResourceIndexTest::testBestByPriority()
+{
+	XMPP::Jid jid( "user@example.com" );
+	FakeResource low( jid, "low", 1, start.addSecs( 10 ) );
+	FakeResource high( jid, "high", 5, start );
+
+	JabberResourceIndex<FakeResource> index;
+	index.insert( &low );
+	QCOMPARE( index.best( jid ), &low );
+	index.insert( &high );
+	QCOMPARE( index.best( jid ), &high );
+	QVERIFY( !index.best( XMPP::Jid( "other@example.com" ) ) );
+}
+
+void JabberResourceIndexTest::testBestByTimeStamp()
+{
+	XMPP::Jid jid( "user@example.com" );
+	FakeResource older( jid, "older", 1, start );
+	FakeResource newer( jid, "newer", 1, start.addSecs( 10 ) );
+
+	JabberResourceIndex<FakeResource> index;
+	index.insert( &newer );
+	index.insert( &older );
+	QCOMPARE( index.best( jid ), &newer );
+}
+
+void JabberResourceIndexTest::testUpdate()
+{
+	XMPP::Jid jid( "user@example.com" );
+	FakeResource home( jid, "home", 5, start );
+	FakeResource work( jid, "work", 1, start );
+
+	JabberResourceIndex<FakeResource> index;
+	index.insert( &home );
+	index.insert( &work );
+	QCOMPARE( index.best( jid ), &home );
+
+	// a newer presence at the same priority keeps the best resource
+	home.setStatus( 5, start.addSecs( 10 ) );
+	index.update( &home );
+	QCOMPARE( index.best( jid ), &home );
+
+	// the best resource drops its priority
+	home.setStatus( 0, start.addSecs( 20 ) );
+	index.update( &home );
+	QCOMPARE( index.best( jid ), &work );
+
+	// another resource overtakes it
+	home.setStatus( 10, start.addSecs( 30 ) );
+	index.update( &home );
+	QCOMPARE( index.best( jid ), &home );
+}
+
+void JabberResourceIndexTest::testRemoveBest()
+{
+	XMPP::Jid jid( "user@example.com" );
+	FakeResource home( jid, "home", 5, start );
+	FakeResource work( jid, "work", 1, start );
+
+	JabberResourceIndex<FakeResource> index;
+	index.insert( &home );
+	index.insert( &work );
+
+	index.remove( &work );
+	QCOMPARE( index.best( jid ), &home );
+	index.insert( &work );
+
+	index.remove( &home );
+	QCOMPARE( index.best( jid ), &work );
+	QVERIFY( !index.find( jid, "home" ) );
+
+	index.remove( &work );
+	QVERIFY( !index.best( jid ) );
+	QVERIFY( index.resources( jid ).isEmpty() );
+}
+
+void JabberResourceIndexTest::testTake()
+{
+	XMPP::Jid jid( "user@example.com" );
+	FakeResource home( jid, "home", 5, start );
+	FakeResource work( jid, "work", 1, start );
+	FakeResource other( XMPP::Jid( "other@example.com" ), "home", 1, start );
+
+	JabberResourceIndex<FakeResource> index;
+	index.insert( &home );
+	index.insert( &work );
+	index.insert( &other );
+
+	QCOMPARE( index.take( XMPP::Jid( "user@example.com/home" ) ).count(), 2 );
+	QVERIFY( !index.best( jid ) );
+	QVERIFY( !index.find( jid, "home" ) );
+	QCOMPARE( index.find( XMPP::Jid( "other@example.com" ), "home" ), &other );
+
+	QCOMPARE( index.takeAll(), QList<FakeResource*>() << &other );
+	QVERIFY( !index.best( XMPP::Jid( "other@example.com" ) ) );
+}
+
+void JabberResourceIndexTest::benchmarkPresenceStorm_data()
+{
+	QTest::addColumn<int>( "count" );
+	QTest::newRow( "1000" ) << 1000;
+	QTest::newRow( "5000" ) << 5000;
+	QTest::newRow( "20000" ) << 20000;
+}
+
+// every occupant of a room sends a new presence and the best resource
+//   is looked up after each one, the way the resource pool does it.  the
+//   time per presence should not grow with the size of the room
+void JabberResourceIndexTest::benchmarkPresenceStorm()
+{
+	QFETCH( int, count );
+
+	XMPP::Jid room( "room@conference.example.com" );
+	QList<FakeResource*> resources = occupants( count );
+
+	JabberResourceIndex<FakeResource> index;
+	foreach ( FakeResource *resource, resources )
+		index.insert( resource );
+
+	int seconds = count;
+	QBENCHMARK
+	{
+		foreach ( FakeResource *resource, resources )
+		{
+			FakeResource *found = index.find( room, resource->resource().name() );
+			found->setStatus( 0, start.addSecs( ++seconds ) );
+			index.update( found );
+			if ( index.best( room ) != found )
+				QFAIL( "the newest presence is not the best resource" );
+		}
+	}
+
+	qDeleteAll( resources );
+}
+
+void JabberResourceIndexTest::benchmarkRoomLeave_data()
+{
+	QTest::addColumn<int>( "count" );
+	QTest::newRow( "1000" ) << 1000;
+	QTest::newRow( "5000" ) << 5000;
+	QTest::newRow( "20000" ) << 20000;
+}
+
+// join a room, let the occupants leave one at a time and then leave the
+//   room, which takes the remaining half at once.  both used to cost
+//   O(occupants) per occupant
+void JabberResourceIndexTest::benchmarkRoomLeave()
+{
+	QFETCH( int, count );
+
+	XMPP::Jid room( "room@conference.example.com" );
+	QList<FakeResource*> resources = occupants( count );
+
+	JabberResourceIndex<FakeResource> index;
+	QBENCHMARK
+	{
+		foreach ( FakeResource *resource, resources )
+			index.insert( resource );
+		for ( int i = 0; i < count / 2; ++i )
+			index.remove( resources[i] );
+		index.take( room );
+	}
+	QVERIFY( !index.best( room ) );
+
+	qDeleteAll( resources );
+}
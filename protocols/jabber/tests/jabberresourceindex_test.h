@@ -0,0 +1,37 @@
+/*
+    Tests for JabberResourceIndex
+
+    Kopete    (c) by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This program is free software; you can redistribute it and/or modify  *
+    * it under the terms of the GNU General Public License as published by  *
+    * the Free Software Foundation; either version 2 of the License, or     *
+    * (at your option) any later version.                                   *
+    *                                                                       *
+    *************************************************************************
+*/
+#ifndef JABBERRESOURCEINDEX_TEST_H
+#define JABBERRESOURCEINDEX_TEST_H
+
+#include <QObject>
+
+class JabberResourceIndexTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void testFind();
+	void testBestByPriority();
+	void testBestByTimeStamp();
+	void testUpdate();
+	void testRemoveBest();
+	void testTake();
+
+	void benchmarkPresenceStorm_data();
+	void benchmarkPresenceStorm();
+	void benchmarkRoomLeave_data();
+	void benchmarkRoomLeave();
+};
+
+#endif
@@ -669,6 +669,7 @@ void AIMAccount::connectWithPassword( const QString &password )
 		updateVersionUpdaterStamp();
 
 		engine()->start( server, port, accountId(), password.left(16) );
+		loadSSICache();
 		engine()->setStatus( status, mInitialStatusMessage );
 		engine()->connectToServer( server, port, false, QString() );
 
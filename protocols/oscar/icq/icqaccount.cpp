@@ -261,6 +261,7 @@ void ICQAccount::connectWithPassword( const QString &password )
 		updateVersionUpdaterStamp();
 
 		engine()->start( server, port, accountId(), password.left(8) );
+		loadSSICache();
 		engine()->setStatus( status, mInitialStatusMessage.message(), pres.xtrazStatus(),
 		                     mInitialStatusMessage.title(), pres.mood() );
 		engine()->connectToServer( server, port, encrypted, QString() );
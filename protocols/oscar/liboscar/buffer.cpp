@@ -20,6 +20,7 @@
 #include "buffer.h"
 
 #include <ctype.h>
+#include <string.h>
 #include <kdebug.h>
 
 
@@ -31,6 +32,7 @@ Buffer::Buffer()
 Buffer::Buffer( const Buffer& other )
 {
 	mBuffer =  other.mBuffer;
+	mData = other.mData;
 	mReadPos = other.mReadPos;
 	mBlockStack =  other.mBlockStack;
 }
@@ -47,6 +49,13 @@ Buffer::Buffer( const QByteArray& data )
 	mReadPos = 0;
 }
 
+Buffer::Buffer( const QByteArray& data, int offset, int len )
+{
+	mData = data;
+	mBuffer = QByteArray::fromRawData( mData.constData() + offset, len );
+	mReadPos = 0;
+}
+
 
 Buffer::~Buffer()
 {
@@ -55,16 +64,16 @@ Buffer::~Buffer()
 
 int Buffer::addByte(Oscar::BYTE b)
 {
-	expandBuffer(1);
-	mBuffer[mBuffer.size()-1] = b;
+	char *p = expandBuffer(1);
+	p[0] = b;
 
 	return mBuffer.size();
 }
 
 int Buffer::addLEByte(Oscar::BYTE b)
 {
-	expandBuffer(1);
-	mBuffer[mBuffer.size()-1] = ((b) & 0xff);
+	char *p = expandBuffer(1);
+	p[0] = ((b) & 0xff);
 
 	return mBuffer.size();
 }
@@ -72,18 +81,18 @@ int Buffer::addLEByte(Oscar::BYTE b)
 
 int Buffer::addWord(Oscar::WORD w)
 {
-	expandBuffer(2);
-	mBuffer[mBuffer.size()-2] = ((w & 0xff00) >> 8);
-	mBuffer[mBuffer.size()-1] = (w & 0x00ff);
+	char *p = expandBuffer(2);
+	p[0] = ((w & 0xff00) >> 8);
+	p[1] = (w & 0x00ff);
 
 	return mBuffer.size();
 }
 
 int Buffer::addLEWord(Oscar::WORD w)
 {
-	expandBuffer(2);
-	mBuffer[mBuffer.size()-2] = (unsigned char) ((w >> 0) & 0xff);
-	mBuffer[mBuffer.size()-1] = (unsigned char) ((w >> 8) & 0xff);
+	char *p = expandBuffer(2);
+	p[0] = (unsigned char) ((w >> 0) & 0xff);
+	p[1] = (unsigned char) ((w >> 8) & 0xff);
 
 	return mBuffer.size();
 }
@@ -91,22 +100,22 @@ int Buffer::addLEWord(Oscar::WORD w)
 
 int Buffer::addDWord(Oscar::DWORD dw)
 {
-	expandBuffer(4);
-	mBuffer[mBuffer.size()-4] = (dw & 0xff000000) >> 24;
-	mBuffer[mBuffer.size()-3] = (dw & 0x00ff0000) >> 16;
-	mBuffer[mBuffer.size()-2] = (dw & 0x0000ff00) >> 8;
-	mBuffer[mBuffer.size()-1] = (dw & 0x000000ff);
+	char *p = expandBuffer(4);
+	p[0] = (dw & 0xff000000) >> 24;
+	p[1] = (dw & 0x00ff0000) >> 16;
+	p[2] = (dw & 0x0000ff00) >> 8;
+	p[3] = (dw & 0x000000ff);
 
 	return mBuffer.size();
 }
 
 int Buffer::addLEDWord(Oscar::DWORD dw)
 {
-	expandBuffer(4);
-	mBuffer[mBuffer.size()-4] = (unsigned char) ((dw >> 0) & 0xff);
-	mBuffer[mBuffer.size()-3] = (unsigned char) ((dw >>  8) & 0xff);
-	mBuffer[mBuffer.size()-2] = (unsigned char) ((dw >> 16) & 0xff);
-	mBuffer[mBuffer.size()-1] = (unsigned char) ((dw >> 24) & 0xff);
+	char *p = expandBuffer(4);
+	p[0] = (unsigned char) ((dw >> 0) & 0xff);
+	p[1] = (unsigned char) ((dw >>  8) & 0xff);
+	p[2] = (unsigned char) ((dw >> 16) & 0xff);
+	p[3] = (unsigned char) ((dw >> 24) & 0xff);
 
 	return mBuffer.size();
 }
@@ -125,26 +134,20 @@ int Buffer::addString(QByteArray s, Oscar::DWORD len)
 
 int Buffer::addString( const char* s, Oscar::DWORD len )
 {
-	QByteArray qba( s, len );
-	return addString( qba );
+	if ( len > 0 )
+		memcpy( expandBuffer( len ), s, len );
+	return mBuffer.size();
 }
 
 int Buffer::addString(const unsigned char* s, Oscar::DWORD len)
 {
-	QByteArray qba( (const char*) s, len );
-	return addString( qba );
+	return addString( (const char*) s, len );
 }
 
 int Buffer::addLEString(const char *s, Oscar::DWORD len)
 {
-	unsigned int pos = mBuffer.size();
-	expandBuffer(len);
-	//concatenate the new string onto the buffer
-	for(unsigned int i=0; i<len; i++)
-	{
-		mBuffer[pos+i]=((s[i]) & 0xff);
-	}
-	return mBuffer.size();
+	// a string of bytes has no byte order
+	return addString( s, len );
 }
 
 
@@ -154,6 +157,14 @@ void Buffer::clear()
 	mReadPos=0;
 }
 
+void Buffer::reserve( int size )
+{
+	// QByteArray::reserve() allocates exactly, keep growing geometrically
+	int needed = mBuffer.size() + size;
+	if ( needed > mBuffer.capacity() )
+		mBuffer.reserve( qMax( needed, 2 * mBuffer.capacity() ) );
+}
+
 int Buffer::addTLV( const TLV& t )
 {
 	return addTLV( t.type, t.data );
@@ -161,6 +172,7 @@ int Buffer::addTLV( const TLV& t )
 
 int Buffer::addTLV( Oscar::WORD type, const QByteArray& data )
 {
+	reserve( tlvSize( data.length() ) );
 	addWord( type );
 	addWord( data.length() );
 	return addString( data );
@@ -168,6 +180,7 @@ int Buffer::addTLV( Oscar::WORD type, const QByteArray& data )
 
 int Buffer::addLETLV( Oscar::WORD type, const QByteArray& data )
 {
+	reserve( tlvSize( data.length() ) );
 	addLEWord( type );
 	addLEWord( data.length() );
 	return addString( data );
@@ -202,6 +215,13 @@ Oscar::BYTE Buffer::getLEByte()
 
 Oscar::WORD Buffer::getWord()
 {
+	if ( mReadPos + 2 <= mBuffer.size() )
+	{
+		const unsigned char *p = (const unsigned char*) mBuffer.constData() + mReadPos;
+		mReadPos += 2;
+		return (p[0] << 8) | p[1];
+	}
+
 	Oscar::WORD theword, theword2, retword;
 	theword = getByte();
 	theword2 = getByte();
@@ -220,6 +240,13 @@ Oscar::WORD Buffer::getLEWord()
 
 Oscar::DWORD Buffer::getDWord()
 {
+	if ( mReadPos + 4 <= mBuffer.size() )
+	{
+		const unsigned char *p = (const unsigned char*) mBuffer.constData() + mReadPos;
+		mReadPos += 4;
+		return ((Oscar::DWORD)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+	}
+
 	Oscar::DWORD word1, word2;
 	Oscar::DWORD retdword;
 	word1 = getWord();
@@ -245,26 +272,29 @@ void Buffer::setBuf(char *b, Oscar::WORD len)
 
 QByteArray Buffer::getBlock(Oscar::DWORD len)
 {
-	if ( len > (Oscar::DWORD)(mBuffer.size() - mReadPos) )
+	int available = qMax( mBuffer.size() - mReadPos, 0 );
+	if ( len > (Oscar::DWORD)available )
 	{
 		kDebug(14150) << "Buffer::getBlock(DWORD): mBuffer underflow!!!";
-		len = mBuffer.size() - mReadPos;
+		len = available;
 	}
 
-	QByteArray ch;
-	ch.resize( len );
-
-	for ( Oscar::DWORD i = 0; i < len; i++ )
-	{
-		ch[i] = getByte();
-	}
+	QByteArray ch( mBuffer.constData() + mReadPos, len );
+	mReadPos += len;
 
 	return ch;
 }
 
 QByteArray Buffer::getBBlock(Oscar::WORD len)
 {
-	QByteArray data = QByteArray::fromRawData( mBuffer.data() + mReadPos, len);
+	int available = qMax( mBuffer.size() - mReadPos, 0 );
+	if ( len > available )
+	{
+		kDebug(14150) << "Buffer::getBBlock(WORD): mBuffer underflow!!!";
+		len = available;
+	}
+
+	QByteArray data = QByteArray::fromRawData( mBuffer.constData() + mReadPos, len );
 	mReadPos += len;
 	return data;
 }
@@ -285,11 +315,8 @@ Oscar::WORD *Buffer::getWordBlock(Oscar::WORD len)
 
 QByteArray Buffer::getLEBlock(Oscar::WORD len)
 {
-	QByteArray ch;
-	for (unsigned int i=0;i<len;i++)
-		ch += getLEByte();
-
-	return ch;
+	// a block of bytes has no byte order
+	return getBlock( len );
 }
 
 int Buffer::addTLV32(Oscar::WORD type, Oscar::DWORD data)
@@ -385,9 +412,11 @@ int Buffer::addChatTLV(Oscar::WORD type, Oscar::WORD exchange,
 	return addWord(instance);
 }
 
-void Buffer::expandBuffer(unsigned int inc)
+char* Buffer::expandBuffer(unsigned int inc)
 {
-	mBuffer.resize(mBuffer.size()+inc);
+	int pos = mBuffer.size();
+	mBuffer.resize(pos+inc);
+	return mBuffer.data() + pos;
 }
 
 QByteArray Buffer::getLNTS()
@@ -549,7 +578,8 @@ int Buffer::addGuid( const Guid & g )
 
 Guid Buffer::getGuid()
 {
-	return Guid(getBBlock(16)); //block or bblock?
+	// the guid is kept around, don't hand out a view of the buffer
+	return Guid(getBlock(16));
 }
 
 int Buffer::addLEBlock( const QByteArray& block )
@@ -640,4 +670,66 @@ Buffer::operator QByteArray() const
 {
 	return mBuffer;
 }
+
+
+TLVIterator::TLVIterator( Buffer* buffer )
+	: mBuffer( buffer ), mType( 0 ), mLength( 0 ), mData( 0 )
+{
+}
+
+bool TLVIterator::next()
+{
+	if ( mBuffer->bytesAvailable() < 4 )
+		return false;
+
+	mType = mBuffer->getWord();
+	mLength = mBuffer->getWord();
+	if ( mLength > mBuffer->bytesAvailable() )
+	{
+		kDebug(14150) << "TLV" << mType << "is truncated";
+		mLength = mBuffer->bytesAvailable();
+	}
+
+	mData = mBuffer->mBuffer.constData() + mBuffer->mReadPos;
+	mBuffer->mReadPos += mLength;
+	return true;
+}
+
+Oscar::BYTE TLVIterator::toByte() const
+{
+	return ( mLength >= 1 ) ? mData[0] : 0;
+}
+
+Oscar::WORD TLVIterator::toWord() const
+{
+	if ( mLength < 2 )
+		return 0;
+
+	const unsigned char *p = (const unsigned char*) mData;
+	return (p[0] << 8) | p[1];
+}
+
+Oscar::DWORD TLVIterator::toDWord() const
+{
+	if ( mLength < 4 )
+		return 0;
+
+	const unsigned char *p = (const unsigned char*) mData;
+	return ((Oscar::DWORD)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+QByteArray TLVIterator::toByteArray() const
+{
+	return QByteArray( mData, mLength );
+}
+
+TLV TLVIterator::toTLV() const
+{
+	return TLV( mType, mLength, toByteArray() );
+}
+
+Buffer TLVIterator::buffer() const
+{
+	return Buffer( mData, mLength );
+}
 //kate: tab-width 4; indent-mode csands;
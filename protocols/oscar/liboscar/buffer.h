@@ -55,6 +55,15 @@ class LIBOSCAR_EXPORT Buffer
 		 */
 		Buffer( const QByteArray& data );
 
+		/**
+		 * \brief Create a buffer over a part of existing data
+		 *
+		 * The buffer reads @p len bytes of @p data starting at @p offset
+		 * without copying them. It keeps @p data alive, and writing to the
+		 * buffer makes a copy first.
+		 */
+		Buffer( const QByteArray& data, int offset, int len );
+
 
 		/** Default destructor */
 		~Buffer();
@@ -131,6 +140,12 @@ class LIBOSCAR_EXPORT Buffer
 		 */
 		void clear();
 
+		/**
+		 * Makes room for @p size more bytes, so that adding them doesn't
+		 * grow the buffer again. Use it when the packet size is known up front.
+		 */
+		void reserve( int size );
+
 		/**
 		 * Adds a TLV to the buffer
 		 */
@@ -190,6 +205,11 @@ class LIBOSCAR_EXPORT Buffer
 		 * Allocates memory for and gets a block of buffer bytes
 		 */
 		QByteArray getBlock(Oscar::DWORD len);
+
+		/**
+		 * Gets a block of buffer bytes without copying them. The returned
+		 * data points into this buffer, so it must not outlive it.
+		 */
 		QByteArray getBBlock(Oscar::WORD len);
 
 		/**
@@ -249,6 +269,11 @@ class LIBOSCAR_EXPORT Buffer
 		 */
 		QList<TLV> getTLVList();
 
+		/**
+		 * Returns the number of bytes addTLV() writes for @p dataLength bytes of data
+		 */
+		static int tlvSize( int dataLength ) { return 4 + dataLength; }
+
 		/**
 		 * Creates a chat data segment for a tlv and calls addTLV with that data
 		 */
@@ -316,13 +341,16 @@ class LIBOSCAR_EXPORT Buffer
 		operator QByteArray() const;
 
 	private:
+		friend class TLVIterator;
+
 		/**
-		 * Make the buffer bigger by @p inc bytes
+		 * Make the buffer bigger by @p inc bytes and return the first new byte
 		 */
-		void expandBuffer(unsigned int inc);
+		char* expandBuffer(unsigned int inc);
 
 	private:
 		QByteArray mBuffer;
+		QByteArray mData; // the data mBuffer is a slice of, if any
 		int mReadPos;
 
 		struct Block
@@ -334,6 +362,59 @@ class LIBOSCAR_EXPORT Buffer
 		QStack<Block> mBlockStack;
 };
 
+/**
+ * @brief Reads the TLVs of a buffer in place
+ *
+ * Unlike Buffer::getTLV() the data isn't copied, data() points into the
+ * buffer. The iterator and everything it returns except toTLV() and
+ * toByteArray() are only valid as long as the buffer is alive and not
+ * written to.
+ *
+ * \code
+ * TLVIterator tlv( buffer );
+ * while ( tlv.next() )
+ * {
+ *     if ( tlv.type() == 0x0001 )
+ *         userClass = tlv.toWord();
+ * }
+ * \endcode
+ */
+class LIBOSCAR_EXPORT TLVIterator
+{
+	public:
+		/** Reads TLVs from the read position of @p buffer on */
+		explicit TLVIterator( Buffer* buffer );
+
+		/**
+		 * Reads the next TLV and advances the buffer past it.
+		 * Returns false if there isn't a complete TLV header left.
+		 */
+		bool next();
+
+		Oscar::WORD type() const { return mType; }
+		Oscar::WORD length() const { return mLength; }
+		const char* data() const { return mData; }
+
+		/** The data as a big-endian number, 0 if the TLV is too short */
+		Oscar::BYTE toByte() const;
+		Oscar::WORD toWord() const;
+		Oscar::DWORD toDWord() const;
+
+		/** A deep copy of the data */
+		QByteArray toByteArray() const;
+		/** A deep copy of the whole TLV */
+		TLV toTLV() const;
+
+		/** A buffer reading the data in place */
+		Buffer buffer() const;
+
+	private:
+		Buffer* mBuffer;
+		Oscar::WORD mType;
+		Oscar::WORD mLength;
+		const char* mData;
+};
+
 #endif
 // kate: tab-width 4; indent-mode csands;
 // vim: set noet ts=4 sts=4 sw=4:
@@ -165,6 +165,11 @@ public:
 	};
 	QList<AwayMsgRequest> awayMsgRequestQueue;
 	QTimer* awayMsgRequestTimer;
+
+	//icq info requests
+	ICQInfoRequestBroker icqInfoBroker;
+	QList< QPair<QString, ICQInfoRequestBroker::InfoType> > cachedIcqInfo;
+
 	CodecProvider* codecProvider;
 	
 	const Oscar::ClientVersion* version;
@@ -275,7 +280,8 @@ void Client::close()
 
 	deleteStaticTasks();
 
-	//don't clear the stored status between stage one and two
+	//don't clear the stored status and the SSI list between stage one and two,
+	//stage two asks the server whether the list loaded from disk is still current
 	if ( d->stage == ClientPrivate::StageTwo )
 	{
 		d->status.status = 0x0;
@@ -284,13 +290,13 @@ void Client::close()
 		d->status.sent = false;
 		d->status.message.clear();
 		d->status.title.clear();
+		d->ssiManager->clear();
 	}
 
 	d->exchanges.clear();
 	d->redirectRequested = false;
 	d->currentRedirect = 0;
 	d->redirectionServices.clear();
-	d->ssiManager->clear();
 	d->offlineMessagesRequested = false;
 }
 
@@ -498,9 +504,74 @@ void Client::receivedIcqInfo( const QString& contact, unsigned int type )
 		<< " of type " << type << endl;
 
 	if ( type == ICQUserInfoRequestTask::Short )
+	{
+		d->icqInfoBroker.received( contact, ICQInfoRequestBroker::ShortInfo );
 		emit receivedIcqShortInfo( contact );
+	}
 	else
+	{
+		d->icqInfoBroker.received( contact, ICQInfoRequestBroker::LongInfo );
 		emit receivedIcqLongInfo( contact );
+	}
+}
+
+void Client::receivedTlvInfo( const QString& contact, unsigned int type )
+{
+	switch ( type )
+	{
+	case ICQTlvInfoRequestTask::Short:
+		d->icqInfoBroker.received( contact, ICQInfoRequestBroker::ShortTlvInfo );
+		break;
+	case ICQTlvInfoRequestTask::Medium:
+		d->icqInfoBroker.received( contact, ICQInfoRequestBroker::MediumTlvInfo );
+		break;
+	default:
+		d->icqInfoBroker.received( contact, ICQInfoRequestBroker::LongTlvInfo );
+		break;
+	}
+	emit receivedIcqTlvInfo( contact );
+}
+
+bool Client::icqInfoNeeded( const QString& contact, ICQInfoRequestBroker::InfoType type, const QByteArray& metaInfoId )
+{
+	switch ( d->icqInfoBroker.request( contact, type, metaInfoId ) )
+	{
+	case ICQInfoRequestBroker::Send:
+		return true;
+	case ICQInfoRequestBroker::Pending:
+		kDebug(OSCAR_RAW_DEBUG) << "info for " << contact << " already requested";
+		return false;
+	case ICQInfoRequestBroker::Cached:
+		kDebug(OSCAR_RAW_DEBUG) << "using cached info for " << contact;
+		if ( d->cachedIcqInfo.isEmpty() )
+			QTimer::singleShot( 0, this, SLOT(sendCachedIcqInfo()) );
+		d->cachedIcqInfo.append( qMakePair( contact, type ) );
+		return false;
+	}
+	return true;
+}
+
+void Client::sendCachedIcqInfo()
+{
+	QList< QPair<QString, ICQInfoRequestBroker::InfoType> > infos = d->cachedIcqInfo;
+	d->cachedIcqInfo.clear();
+
+	for ( int i = 0; i < infos.count(); ++i )
+	{
+		const QString& contact = infos.at( i ).first;
+		switch ( infos.at( i ).second )
+		{
+		case ICQInfoRequestBroker::ShortInfo:
+			emit receivedIcqShortInfo( contact );
+			break;
+		case ICQInfoRequestBroker::LongInfo:
+			emit receivedIcqLongInfo( contact );
+			break;
+		default:
+			emit receivedIcqTlvInfo( contact );
+			break;
+		}
+	}
 }
 
 void Client::receivedInfo( Oscar::DWORD sequence )
@@ -855,8 +926,8 @@ void Client::initializeStaticTasks()
 
 	connect( d->icqInfoTask, SIGNAL(receivedInfoFor(QString,uint)),
 	         this, SLOT(receivedIcqInfo(QString,uint)) );
-	connect( d->icqTlvInfoTask, SIGNAL(receivedInfoFor(QString)),
-	         this, SIGNAL(receivedIcqTlvInfo(QString)) );
+	connect( d->icqTlvInfoTask, SIGNAL(receivedInfoFor(QString,uint)),
+	         this, SLOT(receivedTlvInfo(QString,uint)) );
 
 	connect( d->userInfoTask, SIGNAL(receivedProfile(QString,QString)),
 	         this, SIGNAL(receivedProfile(QString,QString)) );
@@ -1061,7 +1132,7 @@ void Client::setPrivacyTLVs( Oscar::BYTE privacy, Oscar::DWORD userClasses )
 void Client::requestShortTlvInfo( const QString& contactId, const QByteArray &metaInfoId )
 {
 	Connection* c = d->connections.connectionForFamily( 0x0015 );
-	if ( !c )
+	if ( !c || !icqInfoNeeded( Oscar::normalize( contactId ), ICQInfoRequestBroker::ShortTlvInfo, metaInfoId ) )
 		return;
 
 	d->icqTlvInfoTask->setUser( Oscar::normalize( contactId ) );
@@ -1073,7 +1144,7 @@ void Client::requestShortTlvInfo( const QString& contactId, const QByteArray &me
 void Client::requestMediumTlvInfo( const QString& contactId, const QByteArray &metaInfoId )
 {
 	Connection* c = d->connections.connectionForFamily( 0x0015 );
-	if ( !c )
+	if ( !c || !icqInfoNeeded( Oscar::normalize( contactId ), ICQInfoRequestBroker::MediumTlvInfo, metaInfoId ) )
 		return;
 
 	d->icqTlvInfoTask->setUser( Oscar::normalize( contactId ) );
@@ -1085,7 +1156,7 @@ void Client::requestMediumTlvInfo( const QString& contactId, const QByteArray &m
 void Client::requestLongTlvInfo( const QString& contactId, const QByteArray &metaInfoId )
 {
 	Connection* c = d->connections.connectionForFamily( 0x0015 );
-	if ( !c )
+	if ( !c || !icqInfoNeeded( Oscar::normalize( contactId ), ICQInfoRequestBroker::LongTlvInfo, metaInfoId ) )
 		return;
 
 	d->icqTlvInfoTask->setUser( Oscar::normalize( contactId ) );
@@ -1097,7 +1168,7 @@ void Client::requestLongTlvInfo( const QString& contactId, const QByteArray &met
 void Client::requestFullInfo( const QString& contactId )
 {
 	Connection* c = d->connections.connectionForFamily( 0x0015 );
-	if ( !c )
+	if ( !c || !icqInfoNeeded( contactId, ICQInfoRequestBroker::LongInfo ) )
 		return;
 	d->icqInfoTask->setUser( contactId );
 	d->icqInfoTask->setType( ICQUserInfoRequestTask::Long );
@@ -1107,7 +1178,7 @@ void Client::requestFullInfo( const QString& contactId )
 void Client::requestShortInfo( const QString& contactId )
 {
 	Connection* c = d->connections.connectionForFamily( 0x0015 );
-	if ( !c )
+	if ( !c || !icqInfoNeeded( contactId, ICQInfoRequestBroker::ShortInfo ) )
 		return;
 	d->icqInfoTask->setUser( contactId );
 	d->icqInfoTask->setType( ICQUserInfoRequestTask::Short );
@@ -1418,6 +1489,7 @@ bool Client::updateProfile( const QList<ICQInfoBase*>& infoList )
 	ICQUserInfoUpdateTask* ui = new ICQUserInfoUpdateTask( c->rootTask() );
 	ui->setInfo( infoList );
 	ui->go( Task::AutoDelete );
+	d->icqInfoBroker.forget( userId() );
 	return true;
 }
 
@@ -1785,6 +1857,10 @@ void Client::deleteStaticTasks()
 	d->userInfoTask = 0;
 	d->typingNotifyTask = 0;
 	d->ssiModifyTask = 0;
+
+	//the info went with the tasks
+	d->icqInfoBroker.clear();
+	d->cachedIcqInfo.clear();
 }
 
 bool Client::hasIconConnection( ) const
@@ -35,6 +35,7 @@
 #include "oscartypeclasses.h"
 #include "oscarmessage.h"
 #include "contact.h"
+#include "icqinforequestbroker.h"
 
 class Connection;
 class ClientStream;
@@ -588,6 +589,12 @@ protected slots:
 	/** we have icq info for a contact */
 	void receivedIcqInfo( const QString& contact, unsigned int type );
 
+	/** we have TLV based icq info for a contact */
+	void receivedTlvInfo( const QString& contact, unsigned int type );
+
+	/** answer icq info requests from the info we already have */
+	void sendCachedIcqInfo();
+
 	/** we have normal user info for a contact */
 	void receivedInfo( Oscar::DWORD sequence );
 
@@ -641,6 +648,13 @@ private:
 	ClientStream* createClientStream();
 	Connection* createConnection();
 
+	/**
+	 * Check with the info request broker whether @p type info about
+	 * @p contact has to be requested. Cached info is announced again.
+	 */
+	bool icqInfoNeeded( const QString& contact, ICQInfoRequestBroker::InfoType type,
+	                    const QByteArray& metaInfoId = QByteArray() );
+
 	/**
 	 * Request the icq away message
 	 * \param contact the contact to get info for
@@ -20,20 +20,114 @@
 
 #include "contactmanager.h"
 
-#include <QtCore/QSet>
+#include <QtCore/QHash>
+#include <QtCore/QIODevice>
+#include <QtCore/QMap>
 
 #include <kdebug.h>
 
 #include "oscarutils.h"
+#include "buffer.h"
+
+// "OSSI" and the version of the format ContactManager::save() writes
+static const Oscar::DWORD SSI_CACHE_MAGIC = 0x4F535349;
+static const Oscar::WORD SSI_CACHE_VERSION = 1;
 
 // -------------------------------------------------------------------
 
+// The identity of an item, the same fields OContact::operator== compares
+struct ContactKey
+{
+	ContactKey( const OContact& item )
+		: name( item.name() ), gid( item.gid() ), bid( item.bid() ), type( item.type() ) {}
+
+	bool operator==( const ContactKey& other ) const
+	{
+		return gid == other.gid && bid == other.bid && type == other.type && name == other.name;
+	}
+
+	QString name;
+	Oscar::WORD gid;
+	Oscar::WORD bid;
+	Oscar::WORD type;
+};
+
+inline uint qHash( const ContactKey& key )
+{
+	return qHash( key.name ) ^ ( uint( key.type ) << 24 ) ^ ( uint( key.gid ) << 12 ) ^ key.bid;
+}
+
+// Bitmap of the ids in use below 0x8000, the highest id we hand out.
+// Looking for a free id skips 32 taken ids at a time.
+class IdAllocator
+{
+public:
+	enum { MaxId = 0x8000 };
+
+	IdAllocator() { clear(); }
+
+	void clear()
+	{
+		qMemSet( m_bits, 0, sizeof( m_bits ) );
+	}
+
+	void insert( Oscar::WORD id )
+	{
+		if ( id < MaxId )
+			m_bits[id >> 5] |= 1u << ( id & 31 );
+	}
+
+	void remove( Oscar::WORD id )
+	{
+		if ( id < MaxId )
+			m_bits[id >> 5] &= ~( 1u << ( id & 31 ) );
+	}
+
+	/** The lowest free id not below @p fromId, 0xFFFF if there is none */
+	Oscar::WORD findFree( Oscar::WORD fromId ) const
+	{
+		for ( int id = fromId; id < MaxId; id = ( id & ~31 ) + 32 )
+		{
+			// treat the ids below fromId in the first word as taken
+			quint32 word = m_bits[id >> 5] | ( ( 1u << ( id & 31 ) ) - 1 );
+			if ( word == 0xFFFFFFFF )
+				continue;
+
+			int bit = 0;
+			while ( word & ( 1u << bit ) )
+				bit++;
+			return ( id & ~31 ) + bit;
+		}
+
+		return 0xFFFF;
+	}
+
+private:
+	quint32 m_bits[MaxId / 32];
+};
+
+typedef QList<int> SequenceList;
+
 class ContactManagerPrivate
 {
 public:
-	QList<OContact> contactList;
-	QSet<Oscar::WORD> itemIdSet;
-	QSet<Oscar::WORD> groupIdSet;
+	// all items keyed by a sequence number that grows with every insertion,
+	// iterating it gives the items in the order they were added. The indexes
+	// below hold sequence numbers in ascending order, so the first entry of
+	// each is the item a scan of the whole list would have found first.
+	QMap<int, OContact> items;
+	int nextSequence;
+
+	QHash<ContactKey, int> itemsByKey;
+	QHash<Oscar::WORD, SequenceList> itemsByType;
+	QHash<QPair<Oscar::WORD, QString>, SequenceList> itemsByName;
+	QHash<QString, SequenceList> groupsByName; // lower case names
+	QHash<Oscar::WORD, SequenceList> groupsById;
+	QHash<Oscar::WORD, SequenceList> contactsById;
+	QHash<Oscar::WORD, SequenceList> contactsByGroup;
+
+	IdAllocator itemIds;
+	IdAllocator groupIds;
 	bool complete;
 	Oscar::DWORD lastModTime;
 	Oscar::WORD maxContacts;
@@ -43,12 +137,130 @@ public:
 	Oscar::WORD maxIgnore;
 	Oscar::WORD nextContactId;
 	Oscar::WORD nextGroupId;
+
+	void insert( const OContact& item );
+	bool remove( const OContact& item );
+	void clear();
+
+	const OContact& at( int sequence ) const { return items.constFind( sequence ).value(); }
+	const OContact* first( const SequenceList& sequences ) const;
+	QList<OContact> itemList( const SequenceList& sequences ) const;
+
+	template <typename Key>
+	static void index( QHash<Key, SequenceList>& hash, const Key& key, int sequence );
+	template <typename Key>
+	static void unindex( QHash<Key, SequenceList>& hash, const Key& key, int sequence );
 };
 
+template <typename Key>
+void ContactManagerPrivate::index( QHash<Key, SequenceList>& hash, const Key& key, int sequence )
+{
+	// new sequence numbers are always the highest, appending keeps the order
+	hash[key].append( sequence );
+}
+
+template <typename Key>
+void ContactManagerPrivate::unindex( QHash<Key, SequenceList>& hash, const Key& key, int sequence )
+{
+	typename QHash<Key, SequenceList>::iterator it = hash.find( key );
+	if ( it == hash.end() )
+		return;
+
+	it.value().removeOne( sequence );
+	if ( it.value().isEmpty() )
+		hash.erase( it );
+}
+
+void ContactManagerPrivate::insert( const OContact& item )
+{
+	int sequence = nextSequence++;
+	items.insert( sequence, item );
+	itemsByKey.insert( ContactKey( item ), sequence );
+
+	const Oscar::WORD type = item.type();
+	index( itemsByType, type, sequence );
+	index( itemsByName, qMakePair( type, item.name() ), sequence );
+
+	if ( type == ROSTER_GROUP )
+	{
+		index( groupsByName, item.name().toLower(), sequence );
+		index( groupsById, item.gid(), sequence );
+	}
+	else if ( type == ROSTER_CONTACT )
+	{
+		index( contactsById, item.bid(), sequence );
+		index( contactsByGroup, item.gid(), sequence );
+	}
+}
+
+bool ContactManagerPrivate::remove( const OContact& item )
+{
+	QHash<ContactKey, int>::iterator it = itemsByKey.find( ContactKey( item ) );
+	if ( it == itemsByKey.end() )
+		return false;
+
+	int sequence = it.value();
+	itemsByKey.erase( it );
+	items.remove( sequence );
+
+	const Oscar::WORD type = item.type();
+	unindex( itemsByType, type, sequence );
+	unindex( itemsByName, qMakePair( type, item.name() ), sequence );
+
+	if ( type == ROSTER_GROUP )
+	{
+		unindex( groupsByName, item.name().toLower(), sequence );
+		unindex( groupsById, item.gid(), sequence );
+	}
+	else if ( type == ROSTER_CONTACT )
+	{
+		unindex( contactsById, item.bid(), sequence );
+		unindex( contactsByGroup, item.gid(), sequence );
+	}
+	return true;
+}
+
+void ContactManagerPrivate::clear()
+{
+	items.clear();
+	itemsByKey.clear();
+	itemsByType.clear();
+	itemsByName.clear();
+	groupsByName.clear();
+	groupsById.clear();
+	contactsById.clear();
+	contactsByGroup.clear();
+	itemIds.clear();
+	groupIds.clear();
+	nextSequence = 0;
+}
+
+const OContact* ContactManagerPrivate::first( const SequenceList& sequences ) const
+{
+	if ( sequences.isEmpty() )
+		return 0;
+
+	QMap<int, OContact>::const_iterator it = items.constFind( sequences.first() );
+	return ( it != items.constEnd() ) ? &it.value() : 0;
+}
+
+QList<OContact> ContactManagerPrivate::itemList( const SequenceList& sequences ) const
+{
+	QList<OContact> list;
+	list.reserve( sequences.count() );
+
+	SequenceList::const_iterator it, listEnd = sequences.constEnd();
+	for ( it = sequences.constBegin(); it != listEnd; ++it )
+		list.append( items.value( *it ) );
+
+	return list;
+}
+
 ContactManager::ContactManager( QObject *parent )
  : QObject(parent)
 {
 	d = new ContactManagerPrivate;
+	d->nextSequence = 0;
 	d->complete = false;
 	d->lastModTime = 0;
 	d->nextContactId = 0;
@@ -70,17 +282,10 @@ ContactManager::~ContactManager()
 void ContactManager::clear()
 {
 	//delete all Contacts from the list
-	if ( d->contactList.count() > 0 )
-	{
+	if ( d->items.count() > 0 )
 		kDebug(OSCAR_RAW_DEBUG) << "Clearing the SSI list";
-		QList<OContact>::iterator it = d->contactList.begin();
 
-		while ( it != d->contactList.end() && d->contactList.count() > 0 )
-			it = d->contactList.erase( it );
-	};
-
-	d->itemIdSet.clear();
-	d->groupIdSet.clear();
+	d->clear();
 	d->complete = false;
 	d->lastModTime = 0;
 	d->nextContactId = 0;
@@ -92,14 +297,14 @@ Oscar::WORD ContactManager::nextContactId()
 	if ( d->nextContactId == 0 )
 		d->nextContactId++;
 
-	d->nextContactId = findFreeId( d->itemIdSet, d->nextContactId );
+	d->nextContactId = d->itemIds.findFree( d->nextContactId );
 	if ( d->nextContactId == 0xFFFF )
 	{
 		kWarning(OSCAR_RAW_DEBUG) << "No free id!";
 		return 0xFFFF;
 	}
 
-	d->itemIdSet.insert( d->nextContactId );
+	d->itemIds.insert( d->nextContactId );
 	return d->nextContactId++;
 }
 
@@ -108,20 +313,20 @@ Oscar::WORD ContactManager::nextGroupId()
 	if ( d->nextGroupId == 0 )
 		d->nextGroupId++;
 
-	d->nextGroupId = findFreeId( d->groupIdSet, d->nextGroupId );
+	d->nextGroupId = d->groupIds.findFree( d->nextGroupId );
 	if ( d->nextGroupId == 0xFFFF )
 	{
 		kWarning(OSCAR_RAW_DEBUG) << "No free group id!";
 		return 0xFFFF;
 	}
 
-	d->groupIdSet.insert( d->nextGroupId );
+	d->groupIds.insert( d->nextGroupId );
 	return d->nextGroupId++;
 }
 
 Oscar::WORD ContactManager::numberOfItems() const
 {
-	return d->contactList.count();
+	return d->items.count();
 }
 
 Oscar::DWORD ContactManager::lastModificationTime() const
@@ -163,41 +368,92 @@ void ContactManager::loadFromExisting( const QList<OContact*>& newList )
 	//FIXME: NOT Implemented!
 }
 
-bool ContactManager::hasItem( const OContact& item ) const
+bool ContactManager::save( QIODevice* device ) const
 {
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
+	Buffer b;
+	b.addDWord( SSI_CACHE_MAGIC );
+	b.addWord( SSI_CACHE_VERSION );
+	b.addDWord( d->lastModTime );
+	b.addDWord( d->items.count() );
 
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-	{
-		OContact s = ( *it );
-		if ( s == item )
-			return true;
-	}
+	QMap<int, OContact>::const_iterator it, listEnd = d->items.constEnd();
+	for ( it = d->items.constBegin(); it != listEnd; ++it )
+		b.addString( ( *it ) );
 
-	return false;
+	return device->write( b.buffer() ) == b.length();
 }
 
-OContact ContactManager::findGroup( const QString &group ) const
+bool ContactManager::load( QIODevice* device )
 {
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
+	clear();
 
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-		if ( ( *it ).type() == ROSTER_GROUP && (*it ).name().toLower() == group.toLower() )
-			return ( *it );
+	Buffer b( device->readAll() );
+	if ( b.bytesAvailable() < 14 || b.getDWord() != SSI_CACHE_MAGIC || b.getWord() != SSI_CACHE_VERSION )
+	{
+		kDebug(OSCAR_RAW_DEBUG) << "No saved SSI list";
+		return false;
+	}
 
+	Oscar::DWORD lastModTime = b.getDWord();
+	Oscar::DWORD itemCount = b.getDWord();
 
-	return m_dummyItem;
+	QList<OContact> items;
+	for ( Oscar::DWORD i = 0; i < itemCount; ++i )
+	{
+		if ( b.bytesAvailable() < 2 )
+			break;
+
+		QString itemName = QString::fromUtf8( b.getBSTR() );
+		if ( b.bytesAvailable() < 8 )
+			break;
+
+		Oscar::WORD groupId = b.getWord();
+		Oscar::WORD itemId = b.getWord();
+		Oscar::WORD itemType = b.getWord();
+		Oscar::WORD tlvLength = b.getWord();
+		if ( b.bytesAvailable() < tlvLength )
+			break;
+
+		Buffer tlvs( b.getBlock( tlvLength ) );
+		items.append( OContact( itemName, groupId, itemId, itemType, tlvs.getTLVList() ) );
+	}
+
+	if ( items.count() != (int)itemCount )
+	{
+		kWarning(OSCAR_RAW_DEBUG) << "Saved SSI list is truncated, ignoring it";
+		return false;
+	}
+
+	QList<OContact>::const_iterator it, listEnd = items.constEnd();
+	for ( it = items.constBegin(); it != listEnd; ++it )
+	{
+		addID( *it );
+		d->insert( *it );
+	}
+
+	d->lastModTime = lastModTime;
+	kDebug(OSCAR_RAW_DEBUG) << "Loaded " << items.count() << " SSI items";
+	return true;
 }
 
-OContact ContactManager::findGroup( int groupId ) const
+bool ContactManager::hasItem( const OContact& item ) const
 {
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
+	return d->itemsByKey.contains( ContactKey( item ) );
+}
 
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-		if ( ( *it ).type() == ROSTER_GROUP && (*it ).gid() == groupId )
-			return ( *it );
+OContact ContactManager::findGroup( const QString &group ) const
+{
+	const OContact* item = d->first( d->groupsByName.value( group.toLower() ) );
+	return item ? *item : m_dummyItem;
+}
 
-	return m_dummyItem;
+OContact ContactManager::findGroup( int groupId ) const
+{
+	if ( groupId < 0 || groupId > 0xFFFF )
+		return m_dummyItem;
+
+	const OContact* item = d->first( d->groupsById.value( groupId ) );
+	return item ? *item : m_dummyItem;
 }
 
 OContact ContactManager::findContact( const QString &contact, const QString &group ) const
@@ -219,16 +475,18 @@ OContact ContactManager::findContact( const QString &contact, const QString &gro
 			", gr->bid= " << gr.bid() <<
 			", gr->type= " << gr.type() << endl;
 
-		QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
+		const SequenceList sequences = d->itemsByName.value( qMakePair( Oscar::WORD( ROSTER_CONTACT ), contact ) );
+		SequenceList::const_iterator it, listEnd = sequences.constEnd();
 
-		for ( it = d->contactList.constBegin(); it != listEnd; ++it )
+		for ( it = sequences.constBegin(); it != listEnd; ++it )
 		{
-			if ( ( *it ).type() == ROSTER_CONTACT && (*it ).name() == contact && (*it ).gid() == gr.gid() )
+			const OContact& item = d->at( *it );
+			if ( item.gid() == gr.gid() )
 			{
 				//we have found our contact
 				kDebug(OSCAR_RAW_DEBUG) <<
 					"Found contact " << contact << " in SSI data" << endl;
-				 return ( *it );
+				 return item;
 			}
 		}
 	}
@@ -242,181 +500,112 @@ OContact ContactManager::findContact( const QString &contact, const QString &gro
 
 OContact ContactManager::findContact( const QString &contact ) const
 {
-
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
-
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-		if ( ( *it ).type() == ROSTER_CONTACT && (*it ).name() == contact )
-			return ( *it );
-
-	return m_dummyItem;
+	return findItem( contact, ROSTER_CONTACT );
 }
 
 OContact ContactManager::findContact( int contactId ) const
 {
-	QList<OContact>::const_iterator it,  listEnd = d->contactList.constEnd();
-
-	for ( it = d->contactList.constBegin(); it!= listEnd; ++it )
-		if ( ( *it ).type() == ROSTER_CONTACT && ( *it ).bid() == contactId )
-			return ( *it );
+	if ( contactId < 0 || contactId > 0xFFFF )
+		return m_dummyItem;
 
-	return m_dummyItem;
+	const OContact* item = d->first( d->contactsById.value( contactId ) );
+	return item ? *item : m_dummyItem;
 }
 
 OContact ContactManager::findItemForIcon( QByteArray iconHash ) const
 {
-	QList<OContact>::const_iterator it,  listEnd = d->contactList.constEnd();
+	const SequenceList sequences = d->itemsByType.value( ROSTER_BUDDYICONS );
+	SequenceList::const_iterator it, listEnd = sequences.constEnd();
 
-	for ( it = d->contactList.constBegin(); it!= listEnd; ++it )
+	for ( it = sequences.constBegin(); it != listEnd; ++it )
 	{
-		if ( ( *it ).type() == ROSTER_BUDDYICONS )
-		{
-			TLV t = Oscar::findTLV( ( *it ).tlvList(), 0x00D5 );
-			Buffer b(t.data);
-			b.skipBytes(1); //don't care about flags
-			Oscar::BYTE iconSize = b.getByte();
-			QByteArray hash( b.getBlock( iconSize ) );
-			if ( hash == iconHash )
-			{
-				OContact s = ( *it );
-				return s;
-			}
-		}
+		const OContact& item = d->at( *it );
+		TLV t = Oscar::findTLV( item.tlvList(), 0x00D5 );
+		Buffer b(t.data);
+		b.skipBytes(1); //don't care about flags
+		Oscar::BYTE iconSize = b.getByte();
+		QByteArray hash( b.getBlock( iconSize ) );
+		if ( hash == iconHash )
+			return item;
 	}
 	return m_dummyItem;
 }
 
 OContact ContactManager::findItemForIconByRef( int ref ) const
 {
-	QList<OContact>::const_iterator it,  listEnd = d->contactList.constEnd();
+	const SequenceList sequences = d->itemsByType.value( ROSTER_BUDDYICONS );
+	SequenceList::const_iterator it, listEnd = sequences.constEnd();
 
-	for ( it = d->contactList.constBegin(); it!= listEnd; ++it )
+	for ( it = sequences.constBegin(); it != listEnd; ++it )
 	{
-		if ( ( *it ).type() == ROSTER_BUDDYICONS )
-		{
-			if ( ( *it ).name().toInt() == ref )
-			{
-				OContact s = ( *it );
-				return s;
-			}
-		}
+		const OContact& item = d->at( *it );
+		if ( item.name().toInt() == ref )
+			return item;
 	}
 	return m_dummyItem;
 }
 
 OContact ContactManager::findItem( const QString &contact, int type ) const
 {
-	QList<OContact>::const_iterator it,  listEnd = d->contactList.constEnd();
-
-	for ( it = d->contactList.constBegin(); it!= listEnd; ++it )
-		if ( ( *it ).type() == type && ( *it ).name() == contact )
-			return ( *it );
+	if ( type < 0 || type > 0xFFFF )
+		return m_dummyItem;
 
-	return m_dummyItem;
+	const OContact* item = d->first( d->itemsByName.value( qMakePair( Oscar::WORD( type ), contact ) ) );
+	return item ? *item : m_dummyItem;
 }
 
 QList<OContact> ContactManager::groupList() const
 {
-	QList<OContact> list;
-
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-		if ( ( *it ).type() == ROSTER_GROUP  )
-			list.append( ( *it ) );
-
-	return list;
+	return d->itemList( d->itemsByType.value( ROSTER_GROUP ) );
 }
 
 QList<OContact> ContactManager::contactList() const
 {
-	QList<OContact> list;
-
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-		if ( ( *it ).type() == ROSTER_CONTACT  )
-			list.append( ( *it ) );
-
-	return list;
+	return d->itemList( d->itemsByType.value( ROSTER_CONTACT ) );
 }
 
 QList<OContact> ContactManager::visibleList() const
 {
-	QList<OContact> list;
-
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-		if ( ( *it ).type() == ROSTER_VISIBLE  )
-			list.append( ( *it ) );
-
-	return list;
+	return d->itemList( d->itemsByType.value( ROSTER_VISIBLE ) );
 }
 
 QList<OContact> ContactManager::invisibleList() const
 {
-	QList<OContact> list;
-
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-		if ( ( *it ).type() == ROSTER_INVISIBLE  )
-			list.append( ( *it ) );
-
-	return list;
+	return d->itemList( d->itemsByType.value( ROSTER_INVISIBLE ) );
 }
 
 QList<OContact> ContactManager::ignoreList() const
 {
-	QList<OContact> list;
-	
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-		if ( ( *it ).type() == ROSTER_IGNORE  )
-			list.append( ( *it ) );
-	
-	return list;
+	return d->itemList( d->itemsByType.value( ROSTER_IGNORE ) );
 }
 
 QList<OContact> ContactManager::contactsFromGroup( const QString &group ) const
 {
-	QList<OContact> list;
-
 	OContact gr = findGroup( group );
 	if ( gr.isValid() )
-	{
-		QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
-		for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-			if ( ( *it ).type() == ROSTER_CONTACT && (*it ).gid() == gr.gid() )
-				list.append( ( *it ) );
-	}
-	return list;
+		return contactsFromGroup( gr.gid() );
+
+	return QList<OContact>();
 }
 
 QList<OContact> ContactManager::contactsFromGroup( int groupId ) const
 {
-	QList<OContact> list;
+	if ( groupId < 0 || groupId > 0xFFFF )
+		return QList<OContact>();
 
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
-		if ( ( *it ).type() == ROSTER_CONTACT && (*it ).gid() == groupId  )
-			list.append( ( *it ) );
-
-	return list;
+	return d->itemList( d->contactsByGroup.value( groupId ) );
 }
 
 OContact ContactManager::visibilityItem() const
 {
-	OContact item = m_dummyItem;
-	QList<OContact>::const_iterator it, listEnd = d->contactList.constEnd();
-	for ( it = d->contactList.constBegin(); it != listEnd; ++it )
+	const OContact* item = d->first( d->itemsByName.value( qMakePair( Oscar::WORD( 0x0004 ), QString() ) ) );
+	if ( item )
 	{
-		if ( ( *it ).type() == 0x0004 && ( *it ).name().isEmpty() )
-		{
-			kDebug(OSCAR_RAW_DEBUG) << "Found visibility setting";
-			item = ( *it );
-			return item;
-		}
+		kDebug(OSCAR_RAW_DEBUG) << "Found visibility setting";
+		return *item;
 	}
 
-	return item;
+	return m_dummyItem;
 }
 
 void ContactManager::setListComplete( bool complete )
@@ -440,7 +629,7 @@ bool ContactManager::newGroup( const OContact& group )
 		kDebug( OSCAR_RAW_DEBUG ) << "Adding group '" << group.name() << "' to SSI list";
 
 		addID( group );
-		d->contactList.append( group );
+		d->insert( group );
 		emit groupAdded( group );
 		return true;
 	}
@@ -454,10 +643,10 @@ bool ContactManager::updateGroup( const OContact& group )
 	if ( oldGroup.isValid() )
 	{
 		removeID( oldGroup );
-		d->contactList.removeAll( oldGroup );
+		d->remove( oldGroup );
 	}
 
-	if ( d->contactList.contains( group ) )
+	if ( hasItem( group ) )
 	{
 		kDebug(OSCAR_RAW_DEBUG) << "New group is already in list.";
 		return false;
@@ -465,7 +654,7 @@ bool ContactManager::updateGroup( const OContact& group )
 
 	kDebug( OSCAR_RAW_DEBUG ) << "Updating group '" << group.name() << "' in SSI list";
 	addID( group );
-	d->contactList.append( group );
+	d->insert( group );
 	emit groupUpdated( group );
 	return true;
 }
@@ -475,8 +664,7 @@ bool ContactManager::removeGroup( const OContact& group )
 	QString groupName = group.name();
 	kDebug(OSCAR_RAW_DEBUG) << "Removing group " << group.name();
 	removeID( group );
-	int remcount = d->contactList.removeAll( group );
-	if ( remcount == 0 )
+	if ( !d->remove( group ) )
 	{
 		kDebug(OSCAR_RAW_DEBUG) << "No groups removed";
 		return false;
@@ -502,7 +690,7 @@ bool ContactManager::removeGroup( const QString &group )
 
 bool ContactManager::newContact( const OContact& contact )
 {
-	if ( d->contactList.contains( contact ) )
+	if ( hasItem( contact ) )
 	{
 		kDebug(OSCAR_RAW_DEBUG) << "New contact is already in list.";
 		return false;
@@ -510,7 +698,7 @@ bool ContactManager::newContact( const OContact& contact )
 		
 	kDebug( OSCAR_RAW_DEBUG ) << "Adding contact '" << contact.name() << "' to SSI list";
 	addID( contact );
-	d->contactList.append( contact );
+	d->insert( contact );
 	emit contactAdded( contact );
 	return true;
 }
@@ -522,10 +710,10 @@ bool ContactManager::updateContact( const OContact& contact )
 	if ( oldContact.isValid() )
 	{
 		removeID( oldContact );
-		d->contactList.removeAll( oldContact );
+		d->remove( oldContact );
 	}
 
-	if ( d->contactList.contains( contact ) )
+	if ( hasItem( contact ) )
 	{
 		kDebug(OSCAR_RAW_DEBUG) << "New contact is already in list.";
 		return false;
@@ -533,7 +721,7 @@ bool ContactManager::updateContact( const OContact& contact )
 
 	kDebug( OSCAR_RAW_DEBUG ) << "Updating contact '" << contact.name() << "' in SSI list";
 	addID( contact );
-	d->contactList.append( contact );
+	d->insert( contact );
 	emit contactUpdated( contact );
 	return true;
 }
@@ -542,9 +730,8 @@ bool ContactManager::removeContact( const OContact& contact )
 {
 	QString contactName = contact.name();
 	removeID( contact );
-	int remcount = d->contactList.removeAll( contact );
 
-	if ( remcount == 0 )
+	if ( !d->remove( contact ) )
 	{
 		kDebug(OSCAR_RAW_DEBUG) << "No contacts were removed.";
 		return false;
@@ -568,7 +755,7 @@ bool ContactManager::removeContact( const QString &contact )
 
 bool ContactManager::newItem( const OContact& item )
 {
-	if ( d->contactList.contains( item ) )
+	if ( hasItem( item ) )
 	{
 		kDebug(OSCAR_RAW_DEBUG) << "Item is already in list.";
 		return false;
@@ -576,7 +763,7 @@ bool ContactManager::newItem( const OContact& item )
 
 	kDebug(OSCAR_RAW_DEBUG) << "Adding item " << item.toString();
 	addID( item );
-	d->contactList.append( item );
+	d->insert( item );
 	return true;
 }
 
@@ -587,10 +774,10 @@ bool ContactManager::updateItem( const OContact& item )
 	if ( oldItem.isValid() )
 	{
 		removeID( oldItem );
-		d->contactList.removeAll( oldItem );
+		d->remove( oldItem );
 	}
 
-	if ( d->contactList.contains( item ) )
+	if ( hasItem( item ) )
 	{
 		kDebug(OSCAR_RAW_DEBUG) << "New item is already in list.";
 		return false;
@@ -598,16 +785,15 @@ bool ContactManager::updateItem( const OContact& item )
 
 	kDebug( OSCAR_RAW_DEBUG ) << "Updating item in SSI list";
 	addID( item );
-	d->contactList.append( item );
+	d->insert( item );
 	return true;
 }
 
 bool ContactManager::removeItem( const OContact& item )
 {
 	removeID( item );
-	int remcount = d->contactList.removeAll( item );
 
-	if ( remcount == 0 )
+	if ( !d->remove( item ) )
 	{
 		kDebug(OSCAR_RAW_DEBUG) << "No items were removed.";
 		return false;
@@ -619,40 +805,29 @@ bool ContactManager::removeItem( const OContact& item )
 void ContactManager::addID( const OContact& item )
 {
 	if ( item.type() == ROSTER_GROUP )
-		d->groupIdSet.insert( item.gid() );
+		d->groupIds.insert( item.gid() );
 	else
-		d->itemIdSet.insert( item.bid() );
+		d->itemIds.insert( item.bid() );
 }
 
 void ContactManager::removeID( const OContact& item )
 {
 	if ( item.type() == ROSTER_GROUP )
 	{
-		d->groupIdSet.remove( item.gid() );
+		d->groupIds.remove( item.gid() );
 
 		if ( d->nextGroupId > item.gid() )
 			d->nextGroupId = item.gid();
 	}
 	else
 	{
-		d->itemIdSet.remove( item.bid() );
+		d->itemIds.remove( item.bid() );
 
 		if ( d->nextContactId > item.bid() )
 			d->nextContactId = item.bid();
 	}
 }
 
-Oscar::WORD ContactManager::findFreeId( const QSet<Oscar::WORD>& idSet, Oscar::WORD fromId ) const
-{
-	for ( Oscar::WORD id = fromId; id < 0x8000; id++ )
-	{
-		if ( !idSet.contains( id ) )
-			return id;
-	}
-
-	return 0xFFFF;
-}
-
 #include "contactmanager.moc"
 
 //kate: tab-width 4; indent-mode csands;
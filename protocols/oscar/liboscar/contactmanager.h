@@ -30,6 +30,7 @@
 
 using namespace Oscar;
 
+class QIODevice;
 class ContactManagerPrivate;
 
 /**
@@ -74,6 +75,21 @@ public:
 	 * replaced with the data from the new list
 	 */
 	void loadFromExisting( const QList<OContact*>& newList );
+
+	/**
+	 * Write the list and its modification time to @p device so a later
+	 * login can load() it and skip downloading the list again.
+	 * Items are stored in the SSI wire format.
+	 */
+	bool save( QIODevice* device ) const;
+
+	/**
+	 * Replace the list with one written by save(). The list isn't
+	 * complete until the server tells us it is up to date.
+	 * \return false if @p device doesn't hold a saved list, the list
+	 * is empty then
+	 */
+	bool load( QIODevice* device );
 	
 	bool hasItem( const OContact& item ) const;
 
@@ -144,8 +160,6 @@ signals:
 	void modifyError( const QString& error );
 	
 private:
-	Oscar::WORD findFreeId( const QSet<Oscar::WORD>& idSet, Oscar::WORD fromId ) const;
-	
 	ContactManagerPrivate* d;
 	OContact m_dummyItem;
 };
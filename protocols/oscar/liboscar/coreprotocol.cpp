@@ -80,6 +80,7 @@ using namespace Oscar;
 
 CoreProtocol::CoreProtocol() : QObject()
 {
+	m_inPos = 0;
 	m_snacProtocol = new SnacProtocol( this );
 	m_flapProtocol = new FlapProtocol( this );
 }
@@ -96,18 +97,37 @@ int CoreProtocol::state()
 void CoreProtocol::addIncomingData( const QByteArray & incomingBytes )
 {
 	kDebug(OSCAR_RAW_DEBUG) << "Received " << incomingBytes.count() << " bytes. ";
-	// store locally
-	m_in.append( incomingBytes );
+	// store locally. Transfers share the bytes they were parsed from,
+	// appending copies m_in away from them instead of changing their data
+	if ( m_inPos == m_in.size() )
+	{
+		m_in = incomingBytes;
+		m_inPos = 0;
+	}
+	else
+		m_in.append( incomingBytes );
 	m_state = Available;
 
 	// convert every event in the chunk to a Transfer, signalling it back to the clientstream
 	int parsedBytes = 0;
 	int transferCount = 0;
 	// while there is data left in the input buffer, and we are able to parse something out of it
-	while ( m_in.size() && ( parsedBytes = wireToTransfer( m_in ) ) )
+	while ( m_inPos < m_in.size() && ( parsedBytes = wireToTransfer( m_in, m_inPos ) ) )
 	{
 		transferCount++;
-		m_in.remove(0, parsedBytes);
+		m_inPos += parsedBytes;
+	}
+
+	// drop the parsed bytes once per chunk, not once per transfer
+	if ( m_inPos == m_in.size() )
+	{
+		m_in.clear();
+		m_inPos = 0;
+	}
+	else if ( m_inPos > 0 )
+	{
+		m_in = m_in.mid( m_inPos );
+		m_inPos = 0;
 	}
 
 	if ( m_state == NeedMore )
@@ -117,7 +137,8 @@ void CoreProtocol::addIncomingData( const QByteArray & incomingBytes )
 	{
 		kDebug(OSCAR_RAW_DEBUG) << "protocol thinks it's out of sync. "
 			<< "discarding the rest of the buffer and hoping the server regains sync soon..." << endl;
-		m_in.truncate( 0 );
+		m_in.clear();
+		m_inPos = 0;
 	}
 }
 
@@ -161,84 +182,72 @@ void CoreProtocol::outgoingTransfer( Transfer* outgoing )
 	return;
 }
 
-int CoreProtocol::wireToTransfer( const QByteArray& wire )
+int CoreProtocol::wireToTransfer( const QByteArray& wire, int offset )
 {
 	// processing incoming data and reassembling it into transfers
 	// may be an event or a response
 
-	Oscar::BYTE flapStart, flapChannel = 0;
-	Oscar::WORD flapLength = 0;
-	Oscar::WORD s1, s2 = 0;
 	uint bytesParsed = 0;
+	int available = wire.size() - offset;
 
-	//kDebug(OSCAR_RAW_DEBUG) << "Current packet" << toString(wire);
-	if ( wire.size() < 6 ) //check for valid flap length
+	//kDebug(OSCAR_RAW_DEBUG) << "Current packet" << toString(wire.mid(offset));
+	if ( available < 6 ) //check for valid flap length
 	{
 		kDebug(OSCAR_RAW_DEBUG) 
 				<< "packet not long enough! couldn't parse FLAP!" << endl;
-		kDebug(OSCAR_RAW_DEBUG) << "packet size is " << wire.size();
+		kDebug(OSCAR_RAW_DEBUG) << "packet size is " << available;
 		m_state = NeedMore;
 		return bytesParsed;
 	}
 
-	QByteArray tempWire = wire;
-	QDataStream din( &tempWire, QIODevice::ReadOnly );
-
-	// look at first four bytes and decide what to do with the chunk
-	if ( okToProceed( din ) )
+	// peek at the FLAP header and decide what to do with the chunk
+	const uchar* header = reinterpret_cast<const uchar*>( wire.constData() ) + offset;
+	Oscar::BYTE flapStart = header[0];
+	if ( flapStart == 0x2A )
 	{
-		din >> flapStart;
-		QByteArray packet( wire );
-		if ( flapStart == 0x2A )
+		Oscar::BYTE flapChannel = header[1];
+		Oscar::WORD flapLength = ( header[4] << 8 ) | header[5];
+		if ( available < flapLength + 6 )
 		{
-			din >> flapChannel;
-			din >> flapLength; //discard the first one it's not really the flap length
-			din >> flapLength;
-			if ( wire.size() < flapLength )
-			{
-				kDebug(OSCAR_RAW_DEBUG) 
-					<< "Not enough bytes to make a correct transfer. Have " << wire.size()
-					<< " bytes. need " << flapLength + 6 << " bytes" << endl;
-				m_state = NeedMore;
-				return bytesParsed;
-			}
-
-			Transfer *t;
-			if ( flapChannel == 2 )
-			{
-				din >> s1;
-				din >> s2;
-				t = m_snacProtocol->parse( packet, bytesParsed );
-			}
-			else
-				t = m_flapProtocol->parse( packet, bytesParsed );
-
-			if ( t )
-			{
-				m_inTransfer = t;
-				m_state = Available;
-				emit incomingData();
-			}
-			else
-			{
-				bytesParsed = 0;
-				m_state = NeedMore;
-			}
+			kDebug(OSCAR_RAW_DEBUG) 
+				<< "Not enough bytes to make a correct transfer. Have " << available
+				<< " bytes. need " << flapLength + 6 << " bytes" << endl;
+			m_state = NeedMore;
+			return bytesParsed;
 		}
+
+		Transfer *t;
+		if ( flapChannel == 2 )
+			t = m_snacProtocol->parse( wire, offset, bytesParsed );
 		else
-		{ //unknown wire format
-			kDebug(OSCAR_RAW_DEBUG) << "unknown wire format detected!";
-			kDebug(OSCAR_RAW_DEBUG) << "start byte is " << flapStart;
-			kDebug(OSCAR_RAW_DEBUG) << "Packet is " << endl << toString( wire );
-		}
+			t = m_flapProtocol->parse( wire, offset, bytesParsed );
 
+		if ( t )
+		{
+			m_inTransfer = t;
+			m_state = Available;
+			emit incomingData();
+		}
+		else
+		{
+			bytesParsed = 0;
+			m_state = NeedMore;
+		}
+	}
+	else
+	{ //unknown wire format
+		kDebug(OSCAR_RAW_DEBUG) << "unknown wire format detected!";
+		kDebug(OSCAR_RAW_DEBUG) << "start byte is " << flapStart;
+		kDebug(OSCAR_RAW_DEBUG) << "Packet is " << endl << toString( wire.mid( offset ) );
 	}
+
 	return bytesParsed;
 }
 
 void CoreProtocol::reset()
 {
 	m_in.clear();
+	m_inPos = 0;
 }
 
 void CoreProtocol::slotOutgoingData( const QByteArray &out )
@@ -22,12 +22,13 @@
 #define GW_CORE_PROTOCOL_H
 
 #include <qobject.h>
+#include "liboscar_export.h"
 
 class FlapProtocol;
 class SnacProtocol;
 class Transfer;
 
-class CoreProtocol : public QObject
+class LIBOSCAR_EXPORT CoreProtocol : public QObject
 {
 Q_OBJECT
 public:
@@ -87,13 +88,14 @@ protected:
 	 */
 	bool okToProceed( const QDataStream &din );
 	/**
-	 * Convert incoming wire data into a Transfer object and queue it
+	 * Convert incoming wire data, starting at @p offset, into a Transfer object and queue it
 	 * @return number of bytes from the input that were parsed into a Transfer
 	 */
-	int wireToTransfer( const QByteArray& wire );
+	int wireToTransfer( const QByteArray& wire, int offset );
 
 private:
 	QByteArray m_in;	// buffer containing unprocessed bytes we received
+	int m_inPos;		// read cursor, m_in is parsed up to here
 	int m_error;
 	Transfer* m_inTransfer; // the transfer that is being received
 	int m_state;		// represents the protocol's overall state
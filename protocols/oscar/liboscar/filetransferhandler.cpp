@@ -15,10 +15,12 @@
 */
 #include "filetransferhandler.h"
 
+#include <klocale.h>
+
 #include "filetransfertask.h"
 
 FileTransferHandler::FileTransferHandler( FileTransferTask* fileTransferTask )
-: QObject( fileTransferTask ), mFileTransferTask( fileTransferTask ), mFileTransferDone( false )
+: QObject( fileTransferTask ), mFileTransferTask( fileTransferTask ), mFileTransferDone( false ), mChecksumPercent( -1 )
 {
 	connect( mFileTransferTask, SIGNAL(transferFinished()), this, SLOT(emitTransferFinished()) );
 	connect( mFileTransferTask, SIGNAL(transferCancelled()), this, SLOT(emitTransferCancelled()) );
@@ -31,6 +33,8 @@ FileTransferHandler::FileTransferHandler( FileTransferTask* fileTransferTask )
 	         this, SIGNAL(transferNextFile(QString,uint)) );
 	connect( mFileTransferTask, SIGNAL(fileProcessed(uint,uint)),
 	         this, SIGNAL(transferFileProcessed(uint,uint)) );
+	connect( mFileTransferTask, SIGNAL(checksumProgress(quint64,quint64)),
+	         this, SLOT(emitChecksumProgress(quint64,quint64)) );
 }
 
 FileTransferHandler::~FileTransferHandler()
@@ -132,4 +136,22 @@ void FileTransferHandler::emitTransferFinished()
 	emit transferFinished();
 }
 
+void FileTransferHandler::emitChecksumProgress( quint64 bytesRead, quint64 bytesTotal )
+{
+	if ( bytesRead >= bytesTotal )
+	{
+		mChecksumPercent = -1;
+		emit transferInfoMessage( QString() );
+		return;
+	}
+
+	//the thread reports every block, only tell the user when the percentage changes
+	int percent = bytesRead * 100 / bytesTotal;
+	if ( percent == mChecksumPercent )
+		return;
+
+	mChecksumPercent = percent;
+	emit transferInfoMessage( i18n( "Checking file: %1%", percent ) );
+}
+
 #include "filetransferhandler.moc"
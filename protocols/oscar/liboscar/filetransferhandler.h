@@ -54,15 +54,19 @@ Q_SIGNALS:
 	void transferNextFile( const QString& sourceFile, const QString& destinationFile );
 	void transferNextFile( const QString& fileName, unsigned int fileSize );
 	void transferFileProcessed(unsigned int bytesSent, unsigned int fileSize );
+	/** Status text for the user, e.g. while a big file is checksummed before sending */
+	void transferInfoMessage( const QString &text );
 
 private Q_SLOTS:
 	void emitTransferCancelled();
 	void emitTransferError( int errorCode, const QString &error );
 	void emitTransferFinished();
+	void emitChecksumProgress( quint64 bytesRead, quint64 bytesTotal );
 	
 private:
 	QPointer<FileTransferTask> mFileTransferTask;
 	bool mFileTransferDone;
+	int mChecksumPercent;
 };
 
 #endif
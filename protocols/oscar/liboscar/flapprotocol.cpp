@@ -19,7 +19,6 @@
 
 #include "flapprotocol.h"
 
-#include <qdatastream.h>
 #include <qobject.h>
 #include <kdebug.h>
 
@@ -38,32 +37,25 @@ FlapProtocol::~FlapProtocol()
 
 Transfer* FlapProtocol::parse( const QByteArray & packet, uint& bytes )
 {
-	QDataStream* m_din = new QDataStream( const_cast<QByteArray*>( &packet ), QIODevice::ReadOnly );
+	return parse( packet, 0, bytes );
+}
 
-	Oscar::BYTE b;
-	Oscar::WORD w;
+Transfer* FlapProtocol::parse( const QByteArray & wire, int offset, uint& bytes )
+{
+	const uchar* p = reinterpret_cast<const uchar*>( wire.constData() ) + offset;
 
 	FLAP f;
-	*m_din >> b; //this should be the start byte
-	*m_din >> b;
-	f.channel = b;
-	*m_din >> w;
-	f.sequence = w;
-	*m_din >> w;
-	f.length = w;
+	f.channel = p[1];
+	f.sequence = ( p[2] << 8 ) | p[3];
+	f.length = ( p[4] << 8 ) | p[5];
 
 	kDebug(OSCAR_RAW_DEBUG) << "channel: " << f.channel
 			<< " sequence: " << f.sequence << " length: " << f.length << endl;
-	//use pointer arithmatic to skip the flap and snac headers
-	//so we don't have to do double parsing in the tasks
-	char* charPacket = const_cast<char*>( packet.data() );
-	char* snacData = charPacket + 6;
-	Buffer *snacBuffer = new Buffer( snacData, f.length );
+	//skip the flap header so we don't have to do double parsing in the tasks
+	Buffer *snacBuffer = new Buffer( wire, offset + 6, f.length );
 
 	FlapTransfer* ft = new FlapTransfer( f, snacBuffer );
-	bytes = snacBuffer->length() + 6;
-	delete m_din;
-	m_din = 0;
+	bytes = f.length + 6;
 	return ft;
 }
 
@@ -0,0 +1,93 @@
+/*
+    Kopete Oscar Protocol
+    icqinforequestbroker.cpp - Coalesces and caches ICQ user info requests
+
+    Kopete (c) 2002-2010 by the Kopete developers <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#include "icqinforequestbroker.h"
+
+#include "oscarutils.h"
+
+//requests still unanswered after this many seconds are sent again
+#define PENDING_TIMEOUT 120
+
+//received info is reused for this many seconds
+#define DEFAULT_TIME_TO_LIVE 300
+
+static bool isTlvInfo( ICQInfoRequestBroker::InfoType type )
+{
+	return type >= ICQInfoRequestBroker::ShortTlvInfo;
+}
+
+ICQInfoRequestBroker::ICQInfoRequestBroker()
+: m_timeToLive( DEFAULT_TIME_TO_LIVE )
+{
+}
+
+ICQInfoRequestBroker::Action ICQInfoRequestBroker::request( const QString& contact, InfoType type, const QByteArray& metaInfoId )
+{
+	const QString name = Oscar::normalize( contact );
+	const QDateTime now = QDateTime::currentDateTime();
+
+	//more TLVs include the fewer ones
+	const int last = isTlvInfo( type ) ? LongTlvInfo : type;
+	for ( int t = type; t <= last; ++t )
+	{
+		QHash<Key, Entry>::const_iterator it = m_entries.constFind( qMakePair( name, t ) );
+		if ( it == m_entries.constEnd() )
+			continue;
+
+		const Entry& e = it.value();
+		if ( isTlvInfo( type ) && e.metaInfoId != metaInfoId )
+			continue; //the info changed since
+
+		const int age = e.time.secsTo( now );
+		if ( e.pending && age < PENDING_TIMEOUT )
+			return Pending;
+		if ( !e.pending && age < m_timeToLive )
+			return Cached;
+	}
+
+	Entry e = { now, true, metaInfoId };
+	m_entries.insert( qMakePair( name, int( type ) ), e );
+	return Send;
+}
+
+void ICQInfoRequestBroker::received( const QString& contact, InfoType type )
+{
+	Entry& e = m_entries[qMakePair( Oscar::normalize( contact ), int( type ) )];
+	e.time = QDateTime::currentDateTime();
+	e.pending = false;
+}
+
+void ICQInfoRequestBroker::forget( const QString& contact )
+{
+	const QString name = Oscar::normalize( contact );
+	for ( int t = ShortInfo; t <= LongTlvInfo; ++t )
+		m_entries.remove( qMakePair( name, t ) );
+}
+
+void ICQInfoRequestBroker::clear()
+{
+	m_entries.clear();
+}
+
+int ICQInfoRequestBroker::timeToLive() const
+{
+	return m_timeToLive;
+}
+
+void ICQInfoRequestBroker::setTimeToLive( int seconds )
+{
+	m_timeToLive = seconds;
+}
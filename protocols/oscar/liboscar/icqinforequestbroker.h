@@ -0,0 +1,78 @@
+/*
+    Kopete Oscar Protocol
+    icqinforequestbroker.h - Coalesces and caches ICQ user info requests
+
+    Kopete (c) 2002-2010 by the Kopete developers <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#ifndef ICQINFOREQUESTBROKER_H
+#define ICQINFOREQUESTBROKER_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+#include <QtCore/QString>
+
+#include "liboscar_export.h"
+
+/**
+ * Keeps track of the ICQ user info the client asked for, so contacts
+ * changing status at login and info dialogs don't ask the server for
+ * the same info over and over again.
+ *
+ * A request for info that is on its way is dropped, info received less
+ * than timeToLive() seconds ago is answered from what the tasks already
+ * hold. A TLV request is also answered by one for more TLVs, as long as
+ * the meta info id, which changes with the user's info, is the same.
+ */
+class LIBOSCAR_EXPORT ICQInfoRequestBroker
+{
+public:
+	enum InfoType { ShortInfo = 0, LongInfo, ShortTlvInfo, MediumTlvInfo, LongTlvInfo };
+	enum Action { Send, Pending, Cached };
+
+	ICQInfoRequestBroker();
+
+	/**
+	 * Called before asking the server for @p type info about @p contact
+	 * \return Send if the request has to go out
+	 */
+	Action request( const QString& contact, InfoType type, const QByteArray& metaInfoId = QByteArray() );
+
+	/** The server answered a request */
+	void received( const QString& contact, InfoType type );
+
+	/** Forget what we know about @p contact, its info changed */
+	void forget( const QString& contact );
+
+	/** Forget everything, the info itself is gone */
+	void clear();
+
+	/** Seconds received info stays valid, 5 minutes by default */
+	int timeToLive() const;
+	void setTimeToLive( int seconds );
+
+private:
+	struct Entry
+	{
+		QDateTime time;
+		bool pending;
+		QByteArray metaInfoId;
+	};
+	typedef QPair<QString, int> Key;
+
+	QHash<Key, Entry> m_entries;
+	int m_timeToLive;
+};
+
+#endif
@@ -0,0 +1,202 @@
+// oftchecksum.cpp
+
+// Copyright (C)  2010
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301  USA
+
+#include "oftchecksum.h"
+
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
+#include <QtCore/QPair>
+
+//we're not on the GUI thread, read big chunks
+#define CHECKSUM_BUFFER_SIZE 262144
+
+//keep the checksums of this many files around
+#define CHECKSUM_CACHE_SIZE 256
+
+namespace
+{
+	struct CacheEntry
+	{
+		qint64 size;
+		QDateTime modified;
+		Oscar::DWORD checksum;
+	};
+
+	// (file name, bytes checksummed) -> checksum
+	typedef QHash<QPair<QString, qint64>, CacheEntry> ChecksumCache;
+
+	ChecksumCache& checksumCache()
+	{
+		static ChecksumCache cache;
+		return cache;
+	}
+
+	qint64 checksumLength( qint64 bytes, qint64 fileSize )
+	{
+		return ( bytes < 0 || bytes > fileSize ) ? fileSize : bytes;
+	}
+}
+
+Oscar::DWORD OftChecksum::update( Oscar::DWORD checksum, const char *data, int size, qint64 offset )
+{
+	//code adapted from Miranda's oft_calc_checksum
+	const int evenIndex = ( offset & 1 ) ? 1 : 0;
+
+	checksum = (checksum >> 16) & 0xffff;
+	for ( int i = 0; i < size; i++ )
+	{
+		quint16 val = (uchar)data[i];
+
+		if ( (i & 1) == evenIndex )
+			val = val << 8;
+
+		if (checksum < val)
+			checksum -= val + 1;
+		else // simulate carry
+			checksum -= val;
+	}
+	checksum = ((checksum & 0x0000ffff) + (checksum >> 16));
+	checksum = ((checksum & 0x0000ffff) + (checksum >> 16));
+	return checksum << 16;
+}
+
+bool OftChecksum::lookup( const QString &fileName, qint64 bytes, Oscar::DWORD *checksum )
+{
+	QFileInfo info( fileName );
+	if ( !info.exists() )
+		return false;
+
+	const qint64 length = checksumLength( bytes, info.size() );
+	ChecksumCache::const_iterator it = checksumCache().constFind( qMakePair( info.absoluteFilePath(), length ) );
+	if ( it == checksumCache().constEnd() )
+		return false;
+
+	if ( it.value().size != info.size() || it.value().modified != info.lastModified() )
+		return false; //the file changed since
+
+	*checksum = it.value().checksum;
+	return true;
+}
+
+void OftChecksum::insert( const QString &fileName, qint64 size, const QDateTime &modified,
+                          qint64 bytes, Oscar::DWORD checksum )
+{
+	ChecksumCache& cache = checksumCache();
+	if ( cache.count() >= CHECKSUM_CACHE_SIZE )
+		cache.clear();
+
+	CacheEntry entry = { size, modified, checksum };
+	cache.insert( qMakePair( QFileInfo( fileName ).absoluteFilePath(), checksumLength( bytes, size ) ), entry );
+}
+
+void OftChecksum::clearCache()
+{
+	checksumCache().clear();
+}
+
+OftChecksumThread::OftChecksumThread( const QString &fileName, qint64 bytes, QObject *parent )
+: QThread( parent ), m_fileName( fileName ), m_checksum( OftChecksum::Initial ), m_failed( false ), m_stop( false )
+{
+	QFileInfo info( fileName );
+	m_fileSize = info.size();
+	m_modified = info.lastModified();
+	m_bytes = checksumLength( bytes, m_fileSize );
+}
+
+OftChecksumThread::~OftChecksumThread()
+{
+	stop();
+	wait();
+}
+
+void OftChecksumThread::stop()
+{
+	m_stop = true;
+}
+
+QString OftChecksumThread::fileName() const
+{
+	return m_fileName;
+}
+
+qint64 OftChecksumThread::bytes() const
+{
+	return m_bytes;
+}
+
+bool OftChecksumThread::failed() const
+{
+	return m_failed;
+}
+
+Oscar::DWORD OftChecksumThread::checksum() const
+{
+	return m_checksum;
+}
+
+qint64 OftChecksumThread::fileSize() const
+{
+	return m_fileSize;
+}
+
+QDateTime OftChecksumThread::modified() const
+{
+	return m_modified;
+}
+
+void OftChecksumThread::run()
+{
+	QFile file( m_fileName );
+	if ( !file.open( QIODevice::ReadOnly ) )
+	{
+		m_failed = true;
+		return;
+	}
+
+	Oscar::DWORD checksum = OftChecksum::Initial;
+	QByteArray buffer( CHECKSUM_BUFFER_SIZE, 0 );
+	qint64 totalRead = 0;
+
+	while ( totalRead < m_bytes )
+	{
+		if ( m_stop )
+		{
+			m_failed = true;
+			return;
+		}
+
+		qint64 read = file.read( buffer.data(), qMin<qint64>( buffer.size(), m_bytes - totalRead ) );
+		if ( read == -1 )
+		{
+			m_failed = true;
+			return;
+		}
+		if ( read == 0 )
+			break; //the file got shorter, go with what we have
+
+		checksum = OftChecksum::update( checksum, buffer.constData(), read, totalRead );
+		totalRead += read;
+		emit progress( totalRead, m_bytes );
+	}
+
+	m_checksum = checksum;
+}
+
+#include "oftchecksum.moc"
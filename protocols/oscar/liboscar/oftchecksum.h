@@ -0,0 +1,108 @@
+// oftchecksum.h
+
+// Copyright (C)  2010
+
+// This library is free software; you can redistribute it and/or
+// modify it under the terms of the GNU Lesser General Public
+// License as published by the Free Software Foundation; either
+// version 2.1 of the License, or (at your option) any later version.
+
+// This library is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+// Lesser General Public License for more details.
+
+// You should have received a copy of the GNU Lesser General Public
+// License along with this library; if not, write to the Free Software
+// Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+// 02110-1301  USA
+
+#ifndef OFTCHECKSUM_H
+#define OFTCHECKSUM_H
+
+#include <QtCore/QDateTime>
+#include <QtCore/QThread>
+
+#include "oscartypes.h"
+#include "liboscar_export.h"
+
+/**
+ * The checksum OFT uses to verify files, and a cache of the checksums
+ * of local files so sending or resuming the same file again doesn't
+ * read it again.
+ *
+ * The cache is keyed by path, size and modification time; it must only
+ * be used from the GUI thread.
+ */
+class LIBOSCAR_EXPORT OftChecksum
+{
+public:
+	enum { Initial = 0xFFFF0000 };
+
+	/**
+	 * Continue @p checksum over @p size bytes of @p data, which start
+	 * @p offset bytes into the file
+	 */
+	static Oscar::DWORD update( Oscar::DWORD checksum, const char *data, int size, qint64 offset );
+
+	/**
+	 * Look up the checksum of the first @p bytes of @p fileName,
+	 * -1 meaning the whole file
+	 * \return true if the file is unchanged since it was cached
+	 */
+	static bool lookup( const QString &fileName, qint64 bytes, Oscar::DWORD *checksum );
+
+	/** Remember the checksum of the first @p bytes of a file with @p size and @p modified time */
+	static void insert( const QString &fileName, qint64 size, const QDateTime &modified,
+	                    qint64 bytes, Oscar::DWORD checksum );
+
+	/** Forget all cached checksums */
+	static void clearCache();
+};
+
+/**
+ * Reads a file in the background to calculate its OFT checksum.
+ * Listen to finished() and pick up the result with checksum().
+ */
+class LIBOSCAR_EXPORT OftChecksumThread : public QThread
+{
+Q_OBJECT
+public:
+	/** Checksum the first @p bytes of @p fileName, -1 for the whole file */
+	OftChecksumThread( const QString &fileName, qint64 bytes = -1, QObject *parent = 0 );
+
+	/** Stops the thread and waits for it */
+	~OftChecksumThread();
+
+	/** Ask the thread to stop, the result is marked as failed */
+	void stop();
+
+	QString fileName() const;
+	qint64 bytes() const;
+
+	/** True if the file couldn't be read or we were stopped */
+	bool failed() const;
+	Oscar::DWORD checksum() const;
+
+	/** Size and modification time of the file when we started reading it */
+	qint64 fileSize() const;
+	QDateTime modified() const;
+
+signals:
+	/** Emitted as the file is read */
+	void progress( quint64 bytesRead, quint64 bytesTotal );
+
+protected:
+	virtual void run();
+
+private:
+	QString m_fileName;
+	qint64 m_bytes;
+	qint64 m_fileSize;
+	QDateTime m_modified;
+	Oscar::DWORD m_checksum;
+	bool m_failed;
+	volatile bool m_stop;
+};
+
+#endif
@@ -20,17 +20,32 @@
 #include "oftmetatransfer.h"
 
 #include <QtCore/QFileInfo>
+#include <QtCore/QTimer>
+#include <QtNetwork/QNetworkProxy>
 #include <QtNetwork/QTcpSocket>
 
 #include <kdebug.h>
 
+#ifdef Q_OS_LINUX
+#include <errno.h>
+#include <sys/sendfile.h>
+#endif
+
 #include "ofttransfer.h"
 #include "oftprotocol.h"
+#include "oftchecksum.h"
+
+//the chunk we read from the file or the socket at a time
+#define BUFFER_SIZE 65536
 
-#define BUFFER_SIZE 32768
+//keep this much queued in the socket while sending
+#define SEND_HIGH_WATER 1048576
+
+//most we hand to sendfile() before going back to the event loop
+#define DIRECT_SEND_BUDGET 4194304
 
 OftMetaTransfer::OftMetaTransfer( const QByteArray& cookie, const QStringList &files, const QString &dir, QTcpSocket *socket )
-: m_file( this ), m_socket( socket ), m_state( SetupReceive )
+: m_checksumThread( 0 ), m_checksumUse( PromptChecksum ), m_file( this ), m_buffer( BUFFER_SIZE, 0 ), m_directSend( false ), m_socket( socket ), m_state( SetupReceive )
 {
 	//filetransfertask is responsible for hooking us up to the ui
 	//we're responsible for hooking up the socket and timer
@@ -45,7 +60,7 @@ OftMetaTransfer::OftMetaTransfer( const QByteArray& cookie, const QStringList &f
 }
 
 OftMetaTransfer::OftMetaTransfer( const QByteArray& cookie, const QStringList& files, QTcpSocket *socket )
-: m_file( this ), m_socket( socket ), m_state( SetupSend )
+: m_checksumThread( 0 ), m_checksumUse( PromptChecksum ), m_file( this ), m_buffer( BUFFER_SIZE, 0 ), m_directSend( false ), m_socket( socket ), m_state( SetupSend )
 {
 	//filetransfertask is responsible for hooking us up to the ui
 	//we're responsible for hooking up the socket and timer
@@ -79,6 +94,8 @@ void OftMetaTransfer::start()
 
 OftMetaTransfer::~OftMetaTransfer()
 {
+	stopChecksum();
+
 	if( m_socket )
 	{
 		m_socket->close();
@@ -232,25 +249,35 @@ void OftMetaTransfer::handleReceiveSetup( const OFT &oft )
 	emit fileStarted( m_oft.fileName, m_file.fileName() );
 	emit fileStarted( m_file.fileName(), m_oft.fileSize );
 	if ( m_file.size() > 0 && m_file.size() <= oft.fileSize )
-	{
-		m_oft.sentChecksum = fileChecksum( m_file );
-		if ( m_file.size() < oft.fileSize )
-		{ //could be a partial file
-			resume();
-			return;
-		}
-		else if ( m_oft.checksum == m_oft.sentChecksum )
-		{ //apparently we've already got it
-			//TODO: set bytesSent?
-			done(); //don't redo checksum
-			return;
-		}
+	{ //see what we've got, we go on in receiveExisting
+		startChecksum( ReceiveChecksum );
+		return;
+	}
 
-		//if we didn't break then we need the whole file
-		m_oft.sentChecksum = 0xffff0000;
+	m_file.open( QIODevice::WriteOnly | QIODevice::Unbuffered );
+	//TODO what if open failed?
+	ack();
+}
+
+void OftMetaTransfer::receiveExisting( Oscar::DWORD checksum )
+{
+	m_oft.sentChecksum = checksum;
+	if ( m_file.size() < m_oft.fileSize )
+	{ //could be a partial file
+		resume();
+		return;
 	}
+	else if ( m_oft.checksum == m_oft.sentChecksum )
+	{ //apparently we've already got it
+		//TODO: set bytesSent?
+		done(); //don't redo checksum
+		return;
+	}
+
+	//if we didn't break then we need the whole file
+	m_oft.sentChecksum = 0xffff0000;
 
-	m_file.open( QIODevice::WriteOnly );
+	m_file.open( QIODevice::WriteOnly | QIODevice::Unbuffered );
 	//TODO what if open failed?
 	ack();
 }
@@ -269,11 +296,11 @@ void OftMetaTransfer::handleReceiveResumeSetup( const OFT &oft )
 	QIODevice::OpenMode flags;
 	if ( oft.bytesSent ) //yay, we can resume
 	{
-		flags = QIODevice::WriteOnly | QIODevice::Append;
+		flags = QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered;
 	}
 	else
 	{ //they insist on sending the whole file :(
-		flags = QIODevice::WriteOnly;
+		flags = QIODevice::WriteOnly | QIODevice::Unbuffered;
 		m_oft.sentChecksum = 0xffff0000;
 		m_oft.bytesSent = 0;
 	}
@@ -294,12 +321,8 @@ void OftMetaTransfer::handleSendSetup( const OFT &oft )
 
 	//time to send real data
 	//TODO: validate file again, just to be sure
-	m_file.open( QIODevice::ReadOnly );
-	m_state = Sending;
-
-	//use bytesWritten to trigger writes
-	connect( m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(write()) );
-	write();
+	m_file.open( QIODevice::ReadOnly | QIODevice::Unbuffered );
+	startSending();
 }
 
 void OftMetaTransfer::handleSendResumeSetup( const OFT &oft )
@@ -311,13 +334,9 @@ void OftMetaTransfer::handleSendResumeSetup( const OFT &oft )
 
 	kDebug(OSCAR_RAW_DEBUG) << "resume ack";
 	//TODO: validate file again, just to be sure
-	m_file.open( QIODevice::ReadOnly );
+	m_file.open( QIODevice::ReadOnly | QIODevice::Unbuffered );
 	m_file.seek( m_oft.bytesSent );
-	m_state = Sending;
-
-	//use bytesWritten to trigger writes
-	connect( m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(write()) );
-	write();
+	startSending();
 }
 
 void OftMetaTransfer::handleSendResumeRequest( const OFT &oft )
@@ -331,10 +350,17 @@ void OftMetaTransfer::handleSendResumeRequest( const OFT &oft )
 		<< "\tbytesSent\t" << oft.bytesSent << endl
 		<< "\tflags\t" << oft.flags << endl;
 
-	if ( fileChecksum( m_file, oft.bytesSent ) == oft.sentChecksum )
+	//we go on in sendResumeAgree
+	m_resumeRequest = oft;
+	startChecksum( ResumeChecksum, oft.bytesSent );
+}
+
+void OftMetaTransfer::sendResumeAgree( Oscar::DWORD checksum )
+{
+	if ( checksum == m_resumeRequest.sentChecksum )
 	{
-		m_oft.sentChecksum = oft.sentChecksum;
-		m_oft.bytesSent = oft.bytesSent; //ok, we can resume this
+		m_oft.sentChecksum = m_resumeRequest.sentChecksum;
+		m_oft.bytesSent = m_resumeRequest.bytesSent; //ok, we can resume this
 	}
 
 	rAgree();
@@ -361,62 +387,157 @@ void OftMetaTransfer::handleSendDone( const OFT &oft )
 	}
 }
 
+void OftMetaTransfer::startSending()
+{
+	m_state = Sending;
+
+#ifdef Q_OS_LINUX
+	//the kernel can only do the copying if our bytes go straight to the peer
+	QNetworkProxy proxy = m_socket->proxy();
+	if ( proxy.type() == QNetworkProxy::DefaultProxy )
+		proxy = QNetworkProxy::applicationProxy();
+	m_directSend = m_file.handle() != -1 && m_socket->socketDescriptor() != -1
+	               && proxy.type() == QNetworkProxy::NoProxy;
+#endif
+
+	//use bytesWritten to trigger writes
+	connect( m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(write()) );
+	write();
+}
+
 void OftMetaTransfer::write()
 {
-	if ( m_socket->bytesToWrite() )
-		return; //give hte socket time to catch up
+	if ( m_state != Sending )
+		return; //left over wakeup
 
-	//an arbitrary amount to send each time.
-	char data[BUFFER_SIZE];
+	//how much we let queue up in the socket
+	qint64 highWater = SEND_HIGH_WATER;
 
-	m_file.seek( m_oft.bytesSent );
-	int read = m_file.read( data, BUFFER_SIZE );
-	if( read == -1 )
-	{ //FIXME: handle this properly
-		kWarning(OSCAR_RAW_DEBUG) << "failed to read :(";
-		return;
+	if ( m_directSend )
+	{
+		//a buffered chunk has to drain before sendfile() may go on
+		highWater = 0;
+
+		if ( m_socket->bytesToWrite() == 0 )
+		{
+			switch ( sendDirect() )
+			{
+			case DirectYield: //come back after the event loop had a go
+				QTimer::singleShot( 0, this, SLOT(write()) );
+				break;
+			case DirectBlocked:
+				//the socket is full. one buffered chunk gets us a
+				//bytesWritten when it has drained
+				highWater = 1;
+				break;
+			case DirectFailed:
+				kDebug(OSCAR_RAW_DEBUG) << "sendfile failed, copying the file ourselves";
+				m_directSend = false;
+				highWater = SEND_HIGH_WATER;
+				break;
+			case DirectDone:
+				break;
+			}
+		}
 	}
 
-	int written = m_socket->write( data, read );
-	if( written == -1 )
-	{ //FIXME: handle this properly
-		kWarning(OSCAR_RAW_DEBUG) << "failed to write :(";
-		return;
+	//fill up the socket, bytesWritten brings us back when it drains
+	while ( m_oft.bytesSent < m_oft.fileSize && m_socket->bytesToWrite() < highWater )
+	{
+		if ( m_file.pos() != m_oft.bytesSent )
+			m_file.seek( m_oft.bytesSent );
+
+		qint64 read = m_file.read( m_buffer.data(), qMin<qint64>( m_buffer.size(), m_oft.fileSize - m_oft.bytesSent ) );
+		if( read <= 0 )
+		{ //FIXME: handle this properly
+			kWarning(OSCAR_RAW_DEBUG) << "failed to read :(";
+			return;
+		}
+
+		qint64 written = m_socket->write( m_buffer.constData(), read );
+		if( written == -1 )
+		{ //FIXME: handle this properly
+			kWarning(OSCAR_RAW_DEBUG) << "failed to write :(";
+			return;
+		}
+
+		m_oft.bytesSent += written;
 	}
 
-	m_oft.sentChecksum = chunkChecksum( data, written,
-	                                    m_oft.sentChecksum, m_oft.bytesSent & 1);
-	m_oft.bytesSent += written;
-	
 	//tell the ui
 	emit fileProcessed( m_oft.bytesSent, m_oft.fileSize );
 	if ( m_oft.bytesSent >= m_oft.fileSize )
+		finishSending();
+}
+
+OftMetaTransfer::DirectResult OftMetaTransfer::sendDirect()
+{
+#ifdef Q_OS_LINUX
+	off_t offset = m_oft.bytesSent;
+	qint64 sent = 0;
+
+	while ( m_oft.bytesSent < m_oft.fileSize )
 	{
-		m_file.close();
-		disconnect( m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(write()) );
-		//now we sit and do nothing until either an OFT Done
-		//arrives or the user cancels.
-		//we *should* always get the OFT done right away.
+		if ( sent >= DIRECT_SEND_BUDGET )
+			return DirectYield;
+
+		size_t count = qMin<qint64>( m_oft.fileSize - m_oft.bytesSent, DIRECT_SEND_BUDGET - sent );
+		ssize_t written = ::sendfile( m_socket->socketDescriptor(), m_file.handle(), &offset, count );
+		if ( written > 0 )
+		{
+			m_oft.bytesSent += written;
+			sent += written;
+		}
+		else if ( written == -1 && errno == EINTR )
+			continue;
+		else if ( written == -1 && ( errno == EAGAIN || errno == EWOULDBLOCK ) )
+			return DirectBlocked;
+		else //the file got shorter, or we can't sendfile() here
+			return DirectFailed;
 	}
+#endif
+	return DirectDone;
+}
+
+void OftMetaTransfer::finishSending()
+{
+	m_state = Done;
+	m_file.close();
+	disconnect( m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(write()) );
+
+	//we checksummed the whole file for the prompt, the bytes we sent are
+	//the file so there's no need to checksum them again on the way out
+	m_oft.sentChecksum = m_oft.checksum;
+
+	//now we sit and do nothing until either an OFT Done
+	//arrives or the user cancels.
+	//we *should* always get the OFT done right away.
 }
 
 void OftMetaTransfer::saveData()
 {
-	QByteArray raw = m_socket->readAll(); //is this safe?
-	int written = m_file.write( raw );
-	if( written == -1 )
-	{ //FIXME: handle this properly
-		kWarning(OSCAR_RAW_DEBUG) << "failed to write :(";
-		return;
-	}
+	//read straight into our buffer and never past the end of the file
+	while ( m_oft.bytesSent < m_oft.fileSize )
+	{
+		qint64 read = m_socket->read( m_buffer.data(), qMin<qint64>( m_buffer.size(), m_oft.fileSize - m_oft.bytesSent ) );
+		if ( read <= 0 )
+			break;
 
-	m_oft.sentChecksum = chunkChecksum( raw.constData(), raw.size(),
-	                                    m_oft.sentChecksum, m_oft.bytesSent & 1);
-	m_oft.bytesSent += written;
-	if ( written != raw.size() )
-	{	//FIXME: handle this properly
-		kWarning(OSCAR_RAW_DEBUG) << "didn't write everything we read";
-		doCancel();
+		qint64 written = m_file.write( m_buffer.constData(), read );
+		if( written == -1 )
+		{ //FIXME: handle this properly
+			kWarning(OSCAR_RAW_DEBUG) << "failed to write :(";
+			return;
+		}
+
+		m_oft.sentChecksum = OftChecksum::update( m_oft.sentChecksum, m_buffer.constData(), written, m_oft.bytesSent );
+		m_oft.bytesSent += written;
+		if ( written != read )
+		{	//FIXME: handle this properly
+			kWarning(OSCAR_RAW_DEBUG) << "didn't write everything we read";
+			doCancel();
+			return;
+		}
 	}
 
 	//tell the ui
@@ -424,6 +545,8 @@ void OftMetaTransfer::saveData()
 	if ( m_oft.bytesSent >= m_oft.fileSize )
 	{
 		m_file.close();
+		if ( m_oft.sentChecksum == m_oft.checksum )
+			cacheChecksum(); //a resend of what we just got is instant
 		done();
 	}
 
@@ -453,11 +576,11 @@ void OftMetaTransfer::prompt()
 	m_oft.modTime = fileInfo.lastModified().toTime_t();
 	m_oft.fileSize = fileInfo.size();
 	m_oft.fileName = fileInfo.fileName();
-	m_oft.checksum = fileChecksum( m_file );
 	m_oft.sentChecksum = 0xFFFF0000;
 	m_oft.bytesSent = 0;
-	sendOft();
-	//now we wait for the other side to ack
+
+	//we send the prompt in checksumDone
+	startChecksum( PromptChecksum );
 }
 
 void OftMetaTransfer::ack()
@@ -520,6 +643,7 @@ void OftMetaTransfer::rAgree()
 void OftMetaTransfer::doCancel()
 {
 	kDebug(OSCAR_RAW_DEBUG) ;
+	stopChecksum();
 	//stop our timer in case we were sending stuff
 	disconnect( m_socket, SIGNAL(bytesWritten(qint64)), this, SLOT(write()) );
 	m_socket->close();
@@ -534,58 +658,76 @@ void OftMetaTransfer::emitTransferCompleted()
 	deleteLater(); //yay, it's ok to kill everything now
 }
 
-Oscar::DWORD OftMetaTransfer::fileChecksum( QFile& file, int bytes ) const
+void OftMetaTransfer::startChecksum( ChecksumUse use, qint64 bytes )
 {
-	Oscar::DWORD checksum = 0xFFFF0000;
-	char data[BUFFER_SIZE];
-	int read;
-	int totalRead = 0;
+	m_checksumUse = use;
 
-	file.open( QIODevice::ReadOnly );
-	while ( (read = file.read( data, BUFFER_SIZE )) > 0 )
+	Oscar::DWORD checksum;
+	if ( OftChecksum::lookup( m_file.fileName(), bytes, &checksum ) )
 	{
-		if ( bytes != -1 && (totalRead + read) >= bytes )
-		{
-			read = bytes - totalRead;
-			checksum = chunkChecksum( data, read, checksum, totalRead & 1);
-			break;
-		}
-		else
-		{
-			checksum = chunkChecksum( data, read, checksum, totalRead & 1);
-		}
-		totalRead += read;
+		kDebug(OSCAR_RAW_DEBUG) << "cached checksum for " << m_file.fileName();
+		checksumDone( checksum );
+		return;
 	}
-	file.close();
-	
-	if ( read == -1 )
-		return 0xFFFF0000;
-	
-	return checksum;
+
+	//big files take a while, don't block the ui reading them
+	stopChecksum();
+	m_checksumThread = new OftChecksumThread( m_file.fileName(), bytes, this );
+	connect( m_checksumThread, SIGNAL(progress(quint64,quint64)), this, SIGNAL(checksumProgress(quint64,quint64)) );
+	connect( m_checksumThread, SIGNAL(finished()), this, SLOT(checksumFinished()) );
+	m_checksumThread->start();
 }
 
-Oscar::DWORD OftMetaTransfer::chunkChecksum( const char *buffer, int bufferSize,
-                                             Oscar::DWORD checksum, bool shiftIndex ) const
+void OftMetaTransfer::checksumFinished()
 {
-	//code adapted from Miranda's oft_calc_checksum
-	const int evenIndex = (shiftIndex) ? 1 : 0;
-	
-	checksum = (checksum >> 16) & 0xffff;
-	for ( int i = 0; i < bufferSize; i++ )
+	OftChecksumThread *thread = m_checksumThread;
+	if ( !thread || thread != sender() )
+		return; //stopped
+
+	m_checksumThread = 0;
+	thread->deleteLater();
+
+	if ( thread->failed() )
+		kWarning(OSCAR_RAW_DEBUG) << "failed to read " << thread->fileName();
+	else
+		OftChecksum::insert( thread->fileName(), thread->fileSize(), thread->modified(),
+		                     thread->bytes(), thread->checksum() );
+
+	checksumDone( thread->checksum() );
+}
+
+void OftMetaTransfer::checksumDone( Oscar::DWORD checksum )
+{
+	switch ( m_checksumUse )
 	{
-		quint16 val = (uchar)buffer[i];
-		
-		if ( (i & 1) == evenIndex )
-			val = val << 8;
-		
-		if (checksum < val)
-			checksum -= val + 1;
-		else // simulate carry
-			checksum -= val;
+	case PromptChecksum:
+		m_oft.checksum = checksum;
+		sendOft();
+		//now we wait for the other side to ack
+		break;
+	case ReceiveChecksum:
+		receiveExisting( checksum );
+		break;
+	case ResumeChecksum:
+		sendResumeAgree( checksum );
+		break;
 	}
-	checksum = ((checksum & 0x0000ffff) + (checksum >> 16));
-	checksum = ((checksum & 0x0000ffff) + (checksum >> 16));
-	return checksum << 16;
+}
+
+void OftMetaTransfer::stopChecksum()
+{
+	if ( !m_checksumThread )
+		return;
+
+	disconnect( m_checksumThread, 0, this, 0 );
+	delete m_checksumThread; //stops it and waits
+	m_checksumThread = 0;
+}
+
+void OftMetaTransfer::cacheChecksum()
+{
+	QFileInfo fileInfo( m_file );
+	OftChecksum::insert( fileInfo.filePath(), fileInfo.size(), fileInfo.lastModified(), -1, m_oft.sentChecksum );
 }
 
 #include "oftmetatransfer.moc"
@@ -24,10 +24,12 @@
 #include <QtNetwork/QAbstractSocket>
 
 #include "oscartypes.h"
+#include "liboscar_export.h"
 
 class QTcpSocket;
+class OftChecksumThread;
 
-class OftMetaTransfer : public QObject
+class LIBOSCAR_EXPORT OftMetaTransfer : public QObject
 {
 Q_OBJECT
 public:
@@ -52,6 +54,8 @@ signals:
 	void fileStarted( const QString& fileName, unsigned int fileSize );
 	void fileProcessed( unsigned int bytesSent, unsigned int fileSize );
 	void fileFinished( const QString& fileName, unsigned int fileSize );
+	/** We're reading a file to check it before its data goes over the wire */
+	void checksumProgress( quint64 bytesRead, quint64 bytesTotal );
 
 	void transferCompleted();
 	void transferError( int errorCode, const QString &error );
@@ -62,6 +66,7 @@ private slots:
 	void socketRead();
 	void write();
 	void emitTransferCompleted();
+	void checksumFinished();
 
 private:
 	void initOft();
@@ -81,16 +86,38 @@ private:
 	void rAgree(); //sender agrees to resume
 	void rAck(); //resume ack
 	void saveData(); //save incoming data to disk
+	void startSending(); //file is open, get the data flowing
+	void finishSending();
 	void readOft(); //handle incoming oft packet
 
-	/** return checksum of our file, up to bytes */
-	Oscar::DWORD fileChecksum( QFile& file, int bytes = -1 ) const;
-	Oscar::DWORD chunkChecksum( const char *buffer, int bufferSize,
-	                            Oscar::DWORD checksum, bool shiftIndex ) const;
+	/** What we go on with once the checksum of our file is known */
+	enum ChecksumUse { PromptChecksum, ReceiveChecksum, ResumeChecksum };
+
+	/**
+	 * Get the checksum of our file, up to bytes, from the cache or from
+	 * a thread reading the file, and go on with @p use
+	 */
+	void startChecksum( ChecksumUse use, qint64 bytes = -1 );
+	void checksumDone( Oscar::DWORD checksum );
+	void stopChecksum();
+
+	void receiveExisting( Oscar::DWORD checksum ); //rest of handleReceiveSetup
+	void sendResumeAgree( Oscar::DWORD checksum ); //rest of handleSendResumeRequest
+	void cacheChecksum(); //we have seen the whole file go over the wire
+
+	/** How far sendDirect got */
+	enum DirectResult { DirectDone, DirectYield, DirectBlocked, DirectFailed };
+	DirectResult sendDirect(); //hand the file to the kernel, no copies through us
 
 	Oscar::OFT m_oft;
+	Oscar::OFT m_resumeRequest; //resume request waiting for our checksum
+
+	OftChecksumThread *m_checksumThread;
+	ChecksumUse m_checksumUse;
 
 	QFile m_file;
+	QByteArray m_buffer; //reused for every chunk we read or write
+	bool m_directSend; //we can sendfile() to the socket
 
 	QString m_dir; //directory where we save files
 	QStringList m_files; //list of files that we want to send
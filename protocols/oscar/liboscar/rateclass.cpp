@@ -16,7 +16,6 @@
 */
 
 #include "rateclass.h"
-#include <QTimer>
 #include <QList>
 #include <kdebug.h>
 #include "transfer.h"
@@ -26,8 +25,10 @@ using namespace Oscar;
 RateClass::RateClass( QObject* parent )
 : QObject( parent )
 {
-	m_waitingToSend = false;
+	m_averageWait = 0;
+	m_longestWait = 0;
 	m_packetTimer.start();
+	m_queueTimer.start();
 }
 
 RateClass::~ RateClass()
@@ -91,22 +92,77 @@ bool RateClass::isMember( Oscar::WORD family, Oscar::WORD subtype ) const
 	return false;
 }
 
-void RateClass::enqueue( Transfer* t )
+QList<SnacPair> RateClass::members() const
 {
-	m_packetQueue.push_back( t );
+	return m_members;
+}
+
+void RateClass::enqueue( Transfer* t, Lane lane )
+{
+	QueuedTransfer qt = { t, m_queueTimer.elapsed() };
+	m_packetQueue[lane].append( qt );
 	/*kDebug(OSCAR_RAW_DEBUG) << "Send queue length is now: "
-		<< m_packetQueue.count() << endl;*/
-	setupTimer();
+		<< queueDepth() << endl;*/
 }
 
-void RateClass::dequeue()
+Transfer* RateClass::dequeue()
 {
-	m_packetQueue.pop_front();
+	for ( int lane = Interactive; lane < LaneCount; lane++ )
+	{
+		if ( m_packetQueue[lane].isEmpty() )
+			continue;
+
+		QueuedTransfer qt = m_packetQueue[lane].takeFirst();
+		int wait = m_queueTimer.elapsed() - qt.queuedAt;
+
+		// smooth out single long waits
+		m_averageWait = ( 7 * m_averageWait + wait ) / 8;
+		m_longestWait = qMax( m_longestWait, wait );
+		return qt.transfer;
+	}
+
+	return 0;
 }
 
 bool RateClass::queueIsEmpty() const
 {
-	return m_packetQueue.isEmpty();
+	return queueDepth() == 0;
+}
+
+int RateClass::queueDepth() const
+{
+	int depth = 0;
+	for ( int lane = Interactive; lane < LaneCount; lane++ )
+		depth += m_packetQueue[lane].count();
+
+	return depth;
+}
+
+int RateClass::queueDepth( Lane lane ) const
+{
+	return m_packetQueue[lane].count();
+}
+
+int RateClass::oldestWaitTime() const
+{
+	int wait = 0;
+	for ( int lane = Interactive; lane < LaneCount; lane++ )
+	{
+		if ( !m_packetQueue[lane].isEmpty() )
+			wait = qMax( wait, m_queueTimer.elapsed() - m_packetQueue[lane].first().queuedAt );
+	}
+
+	return wait;
+}
+
+int RateClass::averageWaitTime() const
+{
+	return m_averageWait;
+}
+
+int RateClass::longestWaitTime() const
+{
+	return m_longestWait;
 }
 
 int RateClass::timeToInitialLevel()
@@ -177,44 +233,6 @@ Oscar::DWORD RateClass::calcNewLevel( int timeDifference ) const
 	return newLevel;
 }
 
-void RateClass::setupTimer()
-{
-	if ( !m_waitingToSend )
-	{
-		m_waitingToSend = true;
-		
-		int ttns = timeToNextSend();
-		if ( ttns <= 0 )
-		{
-			slotSend(); //send now
-		}
-		else
-		{
-			QTimer::singleShot( ttns, this, SLOT(slotSend()) ); //or send later
-		}
-	}
-}
-
-void RateClass::slotSend()
-{
-	//kDebug(OSCAR_RAW_DEBUG) ;
-
-	if ( m_packetQueue.isEmpty() )
-		return;
-	
-	//send then pop off the list
-	emit dataReady( m_packetQueue.first() );
-	dequeue();
-	
-	updateRateInfo();
-	
-	m_waitingToSend = false;
-	
-	// check if we still have packets to send
-	if ( !m_packetQueue.isEmpty() )
-		setupTimer();
-}
-
 void RateClass::updateRateInfo()
 {
 	//Update rate info
@@ -228,12 +246,15 @@ void RateClass::updateRateInfo()
 
 void RateClass::dumpQueue()
 {
-	QList<Transfer*>::iterator it = m_packetQueue.begin();
-	while ( it != m_packetQueue.end() && m_packetQueue.count() > 0 )
+	for ( int lane = Interactive; lane < LaneCount; lane++ )
 	{
-		Transfer* t = ( *it );
-		it = m_packetQueue.erase( it );
-		delete t;
+		QList<QueuedTransfer>::iterator it = m_packetQueue[lane].begin();
+		while ( it != m_packetQueue[lane].end() )
+		{
+			Transfer* t = ( *it ).transfer;
+			it = m_packetQueue[lane].erase( it );
+			delete t;
+		}
 	}
 }
 
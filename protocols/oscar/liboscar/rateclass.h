@@ -39,6 +39,12 @@ class LIBOSCAR_EXPORT RateClass : public QObject
 {
 	Q_OBJECT
 public:
+	/**
+	 * Queues inside the class. The first transfer of the most urgent
+	 * non-empty lane is sent first, each lane is sent in FIFO order.
+	 */
+	enum Lane { Interactive = 0, Normal, Background, LaneCount };
+
 	RateClass( QObject* parent = 0 );
 	~RateClass();
 
@@ -66,19 +72,38 @@ public:
 	 */
 	bool isMember( Oscar::WORD family, Oscar::WORD subtype ) const;
 
-	/** Add a packet to the queue */
-	void enqueue( Transfer* );
+	/** Get the SNACs that are members of this rate class */
+	QList<SnacPair> members() const;
 
-	/** Takes a packet off the front of the queue */
-	void dequeue();
+	/** Add a packet to the back of the queue for lane @p lane */
+	void enqueue( Transfer*, Lane lane = Normal );
+
+	/**
+	 * Takes the next packet off the queue
+	 * \return the packet, or 0 if the queue is empty
+	 */
+	Transfer* dequeue();
 
 	/** Check if the queue is empty */
 	bool queueIsEmpty() const;
 
+	/** Number of packets waiting in all lanes */
+	int queueDepth() const;
+
+	/** Number of packets waiting in @p lane */
+	int queueDepth( Lane lane ) const;
+
+	/** Time in milliseconds the oldest waiting packet has been queued */
+	int oldestWaitTime() const;
+
+	/** Smoothed time in milliseconds the sent packets spent in the queue */
+	int averageWaitTime() const;
+
+	/** Longest time in milliseconds a sent packet spent in the queue */
+	int longestWaitTime() const;
+
 	/**
 	 * Calulate the time until we can send again
-	 * Uses the first packet on the queue to determine the time since that's
-	 * the packet that will get sent.
 	 * \return the time in milliseconds that we need to wait
 	 */
 	int timeToNextSend();
@@ -101,34 +126,26 @@ public:
 	 */
 	void dumpQueue();
 
-signals:
-
-	/** Tell the rate class manager we're ready to send */
-	void dataReady( Transfer* );
-
 private:
 	
 	/** Calculate our new rate level */
 	Oscar::DWORD calcNewLevel( int timeDifference ) const;
 
-	/** sets up the timer for the transfer just added to the queue */
-	void setupTimer();
-
-private slots:
-	/**
-	 * Send the packet. Basically emits dataReady for the first transfer
-	 */
-	void slotSend();
-	
 private:
 
+	struct QueuedTransfer
+	{
+		Transfer* transfer;
+		int queuedAt; // m_queueTimer.elapsed() when it was queued
+	};
+
 	Oscar::RateInfo m_rateInfo;
 	QList<SnacPair> m_members;
-	QList<Transfer*> m_packetQueue;
+	QList<QueuedTransfer> m_packetQueue[LaneCount];
 	QTime m_packetTimer;
-	
-	// we are waiting for the QTimer::singleShot() to send 
-	bool m_waitingToSend;
+	QTime m_queueTimer;
+	int m_averageWait;
+	int m_longestWait;
 };
 
 #endif
@@ -19,6 +19,8 @@
 #include "rateclassmanager.h"
 
 #include <QList>
+#include <QHash>
+#include <QTimer>
 #include <kdebug.h>
 
 
@@ -27,11 +29,49 @@
 #include "rateclass.h"
 
 
+static inline quint32 snacKey( Oscar::WORD family, Oscar::WORD subtype )
+{
+	return ( quint32( family ) << 16 ) | subtype;
+}
+
+/**
+ * The lane a SNAC waits in when its rate class is busy. Whole families
+ * share a lane where the server expects their packets in order, e.g. the
+ * SSI edits between the start and end of a transaction.
+ */
+static RateClass::Lane laneFor( const Oscar::SNAC& s )
+{
+	switch ( s.family )
+	{
+	case 0x0004: // ICBM, messages and typing notifications
+	case 0x000E: // chat messages
+		return RateClass::Interactive;
+	case 0x0002: // user info and away message requests
+		if ( s.subtype == 0x0005 || s.subtype == 0x0015 )
+			return RateClass::Background;
+		return RateClass::Normal;
+	case 0x0010: // buddy icons
+	case 0x0013: // SSI
+	case 0x0015: // ICQ meta info requests
+		return RateClass::Background;
+	default:
+		return RateClass::Normal;
+	}
+}
+
 class RateClassManagerPrivate
 {
 public:
 	//! The list of rate classes owned by this manager
 	QList<RateClass*> classList;
+	//! The rate class for every SNAC
+	QHash<quint32, RateClass*> snacToClass;
+	//! Classes with packets waiting to be sent
+	QList<RateClass*> waiting;
+	//! Wakes us up when the next waiting class can send
+	QTimer timer;
+	bool sending;
+	bool queuedWhileSending;
 	Connection* client;
 };
 
@@ -40,6 +80,10 @@ RateClassManager::RateClassManager( Connection* parent )
 {
 	d = new RateClassManagerPrivate();
 	d->client = parent;
+	d->sending = false;
+	d->queuedWhileSending = false;
+	d->timer.setSingleShot( true );
+	QObject::connect( &d->timer, SIGNAL(timeout()), this, SLOT(sendQueued()) );
 }
 
 RateClassManager::~RateClassManager()
@@ -50,6 +94,10 @@ RateClassManager::~RateClassManager()
 
 void RateClassManager::reset()
 {
+	d->timer.stop();
+	d->waiting.clear();
+	d->snacToClass.clear();
+
 	QList<RateClass*>::iterator it = d->classList.begin();
 	while ( it != d->classList.end() && d->classList.count() > 0)
 	{
@@ -61,8 +109,17 @@ void RateClassManager::reset()
 
 void RateClassManager::registerClass( RateClass* rc )
 {
-	QObject::connect( rc, SIGNAL(dataReady(Transfer*)), this, SLOT(transferReady(Transfer*)) );
 	d->classList.append( rc );
+
+	// a SNAC listed in several classes stays with the first one
+	QList<SnacPair> members = rc->members();
+	QList<SnacPair>::const_iterator it, spEnd = members.constEnd();
+	for ( it = members.constBegin(); it != spEnd; ++it )
+	{
+		quint32 key = snacKey( ( *it ).family, ( *it ).subtype );
+		if ( !d->snacToClass.contains( key ) )
+			d->snacToClass.insert( key, rc );
+	}
 }
 
 bool RateClassManager::canSend( Transfer* t ) const
@@ -105,10 +162,70 @@ void RateClassManager::queue( Transfer* t )
 	}
 
 	RateClass* rc = findRateClass( st );
-	if ( rc )
-		rc->enqueue( st );
-	else
+	if ( !rc )
+	{
 		transferReady( t );
+		return;
+	}
+
+	rc->enqueue( st, laneFor( st->snac() ) );
+	if ( !d->waiting.contains( rc ) )
+		d->waiting.append( rc );
+
+	// packets queued while we are sending go out with the current run
+	if ( d->sending )
+		d->queuedWhileSending = true;
+	else
+		sendQueued();
+}
+
+void RateClassManager::sendQueued()
+{
+	d->sending = true;
+
+	int nextSend;
+	do
+	{
+		d->queuedWhileSending = false;
+		nextSend = -1;
+
+		for ( int i = 0; i < d->waiting.count(); )
+		{
+			RateClass* rc = d->waiting.at( i );
+
+			int wait = 0;
+			while ( !rc->queueIsEmpty() && ( wait = rc->timeToNextSend() ) <= 0 )
+			{
+				Transfer* t = rc->dequeue();
+				rc->updateRateInfo();
+				transferReady( t );
+
+				// a failed write can reset us and take the classes with it
+				if ( d->waiting.value( i ) != rc )
+				{
+					d->sending = false;
+					return;
+				}
+			}
+
+			if ( rc->queueIsEmpty() )
+			{
+				d->waiting.removeAt( i );
+				continue;
+			}
+
+			if ( nextSend == -1 || wait < nextSend )
+				nextSend = wait;
+			i++;
+		}
+	} while ( d->queuedWhileSending );
+
+	if ( nextSend != -1 )
+		d->timer.start( nextSend );
+	else
+		d->timer.stop();
+
+	d->sending = false;
 }
 
 QList<RateClass*> RateClassManager::classList() const
@@ -133,21 +250,7 @@ RateClass* RateClassManager::findRateClass( SnacTransfer* st ) const
 {
 	SNAC s = st->snac();
 	//kDebug(OSCAR_RAW_DEBUG) << "Looking for SNAC " << s.family << ", " << s.subtype;
-	RateClass* rc = 0L;
-	QList<RateClass*>::const_iterator it;
-	QList<RateClass*>::const_iterator rcEnd = d->classList.constEnd();
-
-	for ( it = d->classList.constBegin(); it != rcEnd; ++it )
-	{
-		if ( ( *it )->isMember( s.family, s.subtype ) )
-		{
-			//kDebug(OSCAR_RAW_DEBUG) << "Found SNAC(" << s.family << ", " << s.subtype << ") in class";
-			rc = ( *it );
-			break;
-		}
-	}
-
-	return rc;
+	return d->snacToClass.value( snacKey( s.family, s.subtype ) );
 }
 
 void RateClassManager::recalcRateLevels()
@@ -160,17 +263,8 @@ void RateClassManager::recalcRateLevels()
 
 int RateClassManager::timeToInitialLevel( SNAC s )
 {
-	QList<RateClass*>::const_iterator it;
-	QList<RateClass*>::const_iterator rcEnd = d->classList.constEnd();
-
-	for ( it = d->classList.constBegin(); it != rcEnd; ++it )
-	{
-		if ( ( *it )->isMember( s.family, s.subtype ) )
-		{
-			return ( *it )->timeToInitialLevel();
-		}
-	}
-	return 0;
+	RateClass* rc = d->snacToClass.value( snacKey( s.family, s.subtype ) );
+	return rc ? rc->timeToInitialLevel() : 0;
 }
 
 #include "rateclassmanager.moc"
@@ -67,6 +67,14 @@ public slots:
 
 	void transferReady( Transfer* );
 
+private slots:
+
+	/**
+	 * Send what the rate classes allow us to send now and set up the
+	 * timer for the class that can send next
+	 */
+	void sendQueued();
+
 private:
 
 	/** Find the rate class for the transfer */
@@ -19,7 +19,6 @@
 
 #include "snacprotocol.h"
 
-#include <qdatastream.h>
 #include <qobject.h>
 #include <kdebug.h>
 #include <stdlib.h>
@@ -39,65 +38,51 @@ SnacProtocol::~SnacProtocol()
 
 Transfer* SnacProtocol::parse( const QByteArray & packet, uint& bytes )
 {
-	Oscar::BYTE b;
-	Oscar::WORD w;
-	Oscar::DWORD dw;
+	return parse( packet, 0, bytes );
+}
 
+Transfer* SnacProtocol::parse( const QByteArray & wire, int offset, uint& bytes )
+{
 	FLAP f;
 	SNAC s;
-	SnacTransfer *st;
-	QDataStream din( const_cast<QByteArray*>( &packet ), QIODevice::ReadOnly );
-
-	//flap parsing
-	din >> b; //this should be the start byte
-	//kDebug(OSCAR_RAW_DEBUG) << "start byte is " << b;
-	din >> b;
-	f.channel = b;
-	din >> w;
-	f.sequence = w;
-	din >> w;
-	f.length = w;
-
-	if ( ( f.length + 6 ) > packet.size() )
+
+	const uchar* p = reinterpret_cast<const uchar*>( wire.constData() ) + offset;
+	int available = wire.size() - offset;
+
+	//flap parsing, p[0] is the start byte
+	f.channel = p[1];
+	f.sequence = ( p[2] << 8 ) | p[3];
+	f.length = ( p[4] << 8 ) | p[5];
+
+	if ( ( f.length + 6 ) > available || f.length < 10 )
 	{
 		kDebug(OSCAR_RAW_DEBUG) << "Packet not big enough to parse!";
-		kDebug(OSCAR_RAW_DEBUG) << "packet size is " << packet.size()
+		kDebug(OSCAR_RAW_DEBUG) << "packet size is " << available
 			<< " we need " << f.length + 6 << endl;
 		return 0;
 	}
+
 	//snac parsing
-	din >> w;
-	s.family = w;
-	din >> w;
-	s.subtype = w;
-	din >> w;
-	s.flags = w;
-	din >> dw;
-	s.id = dw;
+	p += 6;
+	s.family = ( p[0] << 8 ) | p[1];
+	s.subtype = ( p[2] << 8 ) | p[3];
+	s.flags = ( p[4] << 8 ) | p[5];
+	s.id = ( Oscar::DWORD( p[6] ) << 24 ) | ( p[7] << 16 ) | ( p[8] << 8 ) | p[9];
 
 	kDebug(OSCAR_RAW_DEBUG) << "family: " << s.family
 			<< " subtype: " << s.subtype << " flags: " << s.flags
 			<< " id: " << s.id << endl;
 
-	//use pointer arithmatic to skip the flap and snac headers
-	//so we don't have to do double parsing in the tasks
-	char* charPacket = const_cast<char*>( packet.data() );
-	char* snacData;
+	//skip the flap and snac headers so we don't have to do double parsing in the tasks
 	int snacOffset = 10; //default
-	if ( s.flags >= 0x8000  ) //skip the next 8 bytes, we don't care about the snac version ATM
+	if ( s.flags >= 0x8000 && f.length >= 18 ) //skip the next 8 bytes, we don't care about the snac version ATM
 	{
 		//kDebug(OSCAR_RAW_DEBUG) << "skipping snac version";
 		snacOffset = 18;
-		snacData = charPacket + 24;
-	}
-	else
-	{
-		snacOffset = 10;
-		snacData = charPacket + 16;
 	}
 
-	Buffer *snacBuffer = new Buffer( snacData, f.length - snacOffset  );
-	st = new SnacTransfer( f, s, snacBuffer );
+	Buffer *snacBuffer = new Buffer( wire, offset + 6 + snacOffset, f.length - snacOffset );
+	SnacTransfer *st = new SnacTransfer( f, s, snacBuffer );
 	bytes = f.length + 6;
 	return st;
 }
@@ -41,6 +41,12 @@ public:
 	 */
 	Transfer * parse( const QByteArray &, uint & bytes );
 
+	/**
+	 * Same as above, for the packet starting at @p offset in @p wire.
+	 * The transfer's buffer is a slice of @p wire, nothing is copied.
+	 */
+	Transfer * parse( const QByteArray &wire, int offset, uint & bytes );
+
 };
 
 #endif
@@ -26,6 +26,7 @@
 BLMLimitsTask::BLMLimitsTask( Task* parent )
  : Task( parent )
 {
+	registerSnac( 0x0003, 0x0003 );
 }
 
 
@@ -35,6 +35,10 @@ BuddyIconTask::BuddyIconTask( Task* parent )
 	m_iconLength = 0;
 	m_iconType = 0x0001;
 	m_hashType = 0;
+
+	registerSnac( 0x0010, 0x0003 );
+	registerSnac( 0x0010, 0x0005 );
+	registerSnac( 0x0010, 0x0007 );
 }
 
 void BuddyIconTask::uploadIcon( Oscar::WORD length, const QByteArray& data )
@@ -29,6 +29,8 @@
 ChatNavServiceTask::ChatNavServiceTask( Task* parent ) : Task( parent )
 {
 	m_type = Limits;
+
+	registerSnac( 0x000D, 0x0009 );
 }
 
 
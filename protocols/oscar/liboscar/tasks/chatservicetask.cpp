@@ -36,6 +36,12 @@ ChatServiceTask::ChatServiceTask( Task* parent, Oscar::WORD exchange, const QStr
 {
     m_exchange = exchange;
     m_room = room;
+
+	registerSnac( 0x000E, 0x0002 );
+	registerSnac( 0x000E, 0x0003 );
+	registerSnac( 0x000E, 0x0004 );
+	registerSnac( 0x000E, 0x0006 );
+	registerSnac( 0x000E, 0x0009 );
 }
 
 ChatServiceTask::~ChatServiceTask()
@@ -468,6 +468,8 @@ void FileTransferTask::doOft()
 	         this, SLOT(fileProcessedOft(uint,uint)) );
 	connect( oft, SIGNAL(fileFinished(QString,uint)),
 	         this, SLOT(fileFinishedOft(QString,uint)) );
+	connect( oft, SIGNAL(checksumProgress(quint64,quint64)),
+	         this, SIGNAL(checksumProgress(quint64,quint64)) );
 
 	connect( oft, SIGNAL(transferError(int,QString)),
 	         this, SLOT(errorOft(int,QString)) );
@@ -77,6 +77,7 @@ signals:
 	void nextFile( const QString& sourceFile, const QString& destinationFile );
 	void nextFile( const QString& fileName, unsigned int fileSize );
 	void fileProcessed( unsigned int bytesSent, unsigned int fileSize );
+	void checksumProgress( quint64 bytesRead, quint64 bytesTotal );
 
 	void sendMessage( const Oscar::Message &msg );
 	
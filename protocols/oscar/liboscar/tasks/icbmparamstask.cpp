@@ -26,7 +26,9 @@
 
 ICBMParamsTask::ICBMParamsTask( Task* parent )
 		: Task( parent )
-{}
+{
+	registerSnac( 0x0004, 0x0005 );
+}
 
 
 ICBMParamsTask::~ICBMParamsTask()
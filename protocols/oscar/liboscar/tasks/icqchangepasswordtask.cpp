@@ -99,6 +99,7 @@ void ICQChangePasswordTask::onGo()
 	b.addLELNTS( m_password.toLatin1() );
 
 	m_goSequence = client()->snacSequence();
+	registerRequest( m_goSequence );
 
 	Buffer *sendBuf = addInitialData( &b );
 	FLAP f = { 0x02, 0, 0 };
@@ -27,6 +27,8 @@
 ICQTlvInfoRequestTask::ICQTlvInfoRequestTask( Task* parent ) : ICQTask( parent )
 {
 	m_type = Short;
+
+	registerSnac( 0x0015, 0x0003 );
 }
 
 ICQTlvInfoRequestTask::~ICQTlvInfoRequestTask()
@@ -118,6 +120,7 @@ void ICQTlvInfoRequestTask::onGo()
 
 	Oscar::DWORD seq = client()->snacSequence();
 	m_contactSequenceMap[seq] = m_userToRequestFor;
+	m_typeSequenceMap[seq] = m_type;
 
 	FLAP f = { 0x02, 0, 0 };
 	SNAC s = { 0x0015, 0x0002, 0, seq };
@@ -127,9 +130,8 @@ void ICQTlvInfoRequestTask::onGo()
 
 ICQFullInfo ICQTlvInfoRequestTask::fullInfoFor( const QString& contact )
 {
-	ICQFullInfo info = m_fullInfoMap.value( contact );
-	m_fullInfoMap.remove( contact );
-	return info;
+	//kept around, the client answers repeated requests with it
+	return m_fullInfoMap.value( contact );
 }
 
 void ICQTlvInfoRequestTask::parse( Oscar::DWORD seq, const QByteArray &data )
@@ -145,8 +147,9 @@ void ICQTlvInfoRequestTask::parse( Oscar::DWORD seq, const QByteArray &data )
 	info.fill( &buf );
 	m_fullInfoMap[contact] = info;
 
-	emit receivedInfoFor( contact );
+	emit receivedInfoFor( contact, m_typeSequenceMap.value( seq ) );
 	m_contactSequenceMap.remove( seq );
+	m_typeSequenceMap.remove( seq );
 }
 
 #include "icqtlvinforequesttask.moc"
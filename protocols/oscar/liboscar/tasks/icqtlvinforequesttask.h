@@ -52,13 +52,14 @@ public:
 	virtual void onGo();
 
 Q_SIGNALS:
-	void receivedInfoFor( const QString& contact );
+	void receivedInfoFor( const QString& contact, unsigned int type );
 
 private:
 	void parse( Oscar::DWORD seq, const QByteArray &data );
 
 	QMap<QString, ICQFullInfo> m_fullInfoMap;
 	QMap<int, QString> m_contactSequenceMap;
+	QMap<int, InfoType> m_typeSequenceMap;
 
 	QString m_userToRequestFor;
 	InfoType m_type;
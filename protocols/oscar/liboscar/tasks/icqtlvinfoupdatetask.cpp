@@ -105,6 +105,7 @@ void ICQTlvInfoUpdateTask::onGo()
 	b.endBlock();
 
 	m_goSequence = client()->snacSequence();
+	registerRequest( m_goSequence );
 
 	Buffer *sendBuf = addInitialData( &b );
 	FLAP f = { 0x02, 0, 0 };
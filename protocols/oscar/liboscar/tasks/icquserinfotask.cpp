@@ -27,6 +27,8 @@ ICQUserInfoRequestTask::ICQUserInfoRequestTask( Task* parent ) : ICQTask( parent
 {
 	//by default, request short info. it saves bandwidth
 	m_type = Short;
+
+	registerSnac( 0x0015, 0x0003 );
 }
 
 
@@ -103,43 +105,43 @@ bool ICQUserInfoRequestTask::take( Transfer* transfer )
 			kDebug( OSCAR_RAW_DEBUG ) << "Received basic info";
 			genInfo.setSequenceNumber( seq );
 			genInfo.fill( buffer );
-			m_genInfoMap[seq] = genInfo;
+			m_genInfoMap[contactId] = genInfo;
 			break;
 		case 0x00D2:  //work user info
 			kDebug( OSCAR_RAW_DEBUG ) << "Received work info";
 			workInfo.setSequenceNumber( seq );
 			workInfo.fill( buffer );
-			m_workInfoMap[seq] = workInfo;
+			m_workInfoMap[contactId] = workInfo;
 			break;
 		case 0x00DC:  //more user info
 			kDebug( OSCAR_RAW_DEBUG ) << "Received more info";
 			moreInfo.setSequenceNumber( seq );
 			moreInfo.fill( buffer );
-			m_moreInfoMap[seq] = moreInfo;
+			m_moreInfoMap[contactId] = moreInfo;
 			break;
 		case 0x00E6:  //notes user info
 			kDebug( OSCAR_RAW_DEBUG ) << "Received notes info";
 			notesInfo.setSequenceNumber( seq );
 			notesInfo.fill( buffer );
-			m_notesInfoMap[seq] = notesInfo;
+			m_notesInfoMap[contactId] = notesInfo;
 			break;
 		case 0x00EB:  //email user info
 			kDebug( OSCAR_RAW_DEBUG ) << "Received email info";
 			emailInfo.setSequenceNumber( seq );
 			emailInfo.fill( buffer );
-			m_emailInfoMap[seq] = emailInfo;
+			m_emailInfoMap[contactId] = emailInfo;
 			break;
 		case 0x00F0:  //interests user info
 			kDebug( OSCAR_RAW_DEBUG ) << "Received interest info";
 			interestInfo.setSequenceNumber( seq );
 			interestInfo.fill( buffer );
-			m_interestInfoMap[seq] = interestInfo;
+			m_interestInfoMap[contactId] = interestInfo;
 			break;
 		case 0x00FA:  //affliations user info
 			kDebug( OSCAR_RAW_DEBUG ) << "Received organization & affliation info";
 			orgAffInfo.setSequenceNumber( seq );
 			orgAffInfo.fill( buffer );
-			m_orgAffInfoMap[seq] = orgAffInfo;
+			m_orgAffInfoMap[contactId] = orgAffInfo;
 			//affliations seems to be the last info we get, so be hacky and only emit the signal once
 			emit receivedInfoFor( contactId, Long );
 			break;
@@ -147,7 +149,8 @@ bool ICQUserInfoRequestTask::take( Transfer* transfer )
 			kDebug( OSCAR_RAW_DEBUG ) << "Received short user info";
 			shortInfo.setSequenceNumber( seq );
 			shortInfo.fill( buffer );
-			m_shortInfoMap[seq] = shortInfo;
+			m_shortInfoMap[contactId] = shortInfo;
+			emit receivedInfoFor( contactId, Short );
 			break;
 		case 0x010E:  //homepage category user info
 			kDebug( OSCAR_RAW_DEBUG ) << "Got homepage category info, but we don't support it yet";
@@ -156,10 +159,6 @@ bool ICQUserInfoRequestTask::take( Transfer* transfer )
 			break;
 		}
 		
-		
-		if ( m_type == Short )
-			emit receivedInfoFor( contactId, Short );
-
 		setTransfer( 0 );
 		delete buffer;
 		return true;
@@ -194,7 +193,6 @@ void ICQUserInfoRequestTask::onGo()
 	Oscar::SNAC s = { 0x0015, 0x0002, 0, client()->snacSequence() };
 	
 	m_contactSequenceMap[s.id] = m_userToRequestFor;
-	m_reverseContactMap[m_userToRequestFor] = s.id;
 	
 	Transfer* t = createTransfer( f, s, sendBuf );
 	send( t );
@@ -202,50 +200,42 @@ void ICQUserInfoRequestTask::onGo()
 
 ICQGeneralUserInfo ICQUserInfoRequestTask::generalInfoFor( const QString& contact )
 {
-	Oscar::DWORD seq = m_reverseContactMap[contact];
-	return m_genInfoMap[seq];
+	return m_genInfoMap.value( contact );
 }
 
 ICQWorkUserInfo ICQUserInfoRequestTask::workInfoFor( const QString& contact )
 {
-	Oscar::DWORD seq = m_reverseContactMap[contact];
-	return m_workInfoMap[seq];
+	return m_workInfoMap.value( contact );
 }
 
 ICQMoreUserInfo ICQUserInfoRequestTask::moreInfoFor( const QString& contact )
 {
-	Oscar::DWORD seq = m_reverseContactMap[contact];
-	return m_moreInfoMap[seq];
+	return m_moreInfoMap.value( contact );
 }
 
 ICQEmailInfo ICQUserInfoRequestTask::emailInfoFor( const QString& contact )
 {
-	Oscar::DWORD seq = m_reverseContactMap[contact];
-	return m_emailInfoMap[seq];
+	return m_emailInfoMap.value( contact );
 }
 
 ICQNotesInfo ICQUserInfoRequestTask::notesInfoFor( const QString& contact )
 {
-	Oscar::DWORD seq = m_reverseContactMap[contact];
-	return m_notesInfoMap[seq];
+	return m_notesInfoMap.value( contact );
 }
 
 ICQShortInfo ICQUserInfoRequestTask::shortInfoFor( const QString& contact )
 {
-	Oscar::DWORD seq = m_reverseContactMap[contact];
-	return m_shortInfoMap[seq];
+	return m_shortInfoMap.value( contact );
 }
 
 ICQInterestInfo ICQUserInfoRequestTask::interestInfoFor( const QString& contact )
 {
-	Oscar::DWORD seq = m_reverseContactMap[contact];
-	return m_interestInfoMap[seq];
+	return m_interestInfoMap.value( contact );
 }
 
 ICQOrgAffInfo ICQUserInfoRequestTask::orgAffInfoFor( const QString& contact )
 {
-	Oscar::DWORD seq = m_reverseContactMap[contact];
-	return m_orgAffInfoMap[seq];
+	return m_orgAffInfoMap.value( contact );
 }
 
 #include "icquserinfotask.moc"
@@ -22,6 +22,7 @@
 #include <qmap.h>
 #include <qstring.h>
 
+#include "liboscar_export.h"
 #include "icqtask.h"
 #include "icquserinfo.h"
 
@@ -30,7 +31,7 @@ class Transfer;
 /**
 @author Kopete Developers
 */
-class ICQUserInfoRequestTask : public ICQTask
+class LIBOSCAR_EXPORT ICQUserInfoRequestTask : public ICQTask
 {
 Q_OBJECT
 public:
@@ -60,16 +61,17 @@ signals:
 	void receivedInfoFor( const QString& contact, unsigned int type );
 	
 private:
-	QMap<Oscar::DWORD, ICQGeneralUserInfo> m_genInfoMap;
-	QMap<Oscar::DWORD, ICQEmailInfo> m_emailInfoMap;
-	QMap<Oscar::DWORD, ICQNotesInfo> m_notesInfoMap;
-	QMap<Oscar::DWORD, ICQMoreUserInfo> m_moreInfoMap;
-	QMap<Oscar::DWORD, ICQWorkUserInfo> m_workInfoMap;
-	QMap<Oscar::DWORD, ICQShortInfo> m_shortInfoMap;
-	QMap<Oscar::DWORD, ICQInterestInfo> m_interestInfoMap;
-	QMap<Oscar::DWORD, ICQOrgAffInfo> m_orgAffInfoMap;
+	//results by contact, each info type in its own map, so one type
+	//is still there after another one was requested
+	QMap<QString, ICQGeneralUserInfo> m_genInfoMap;
+	QMap<QString, ICQEmailInfo> m_emailInfoMap;
+	QMap<QString, ICQNotesInfo> m_notesInfoMap;
+	QMap<QString, ICQMoreUserInfo> m_moreInfoMap;
+	QMap<QString, ICQWorkUserInfo> m_workInfoMap;
+	QMap<QString, ICQShortInfo> m_shortInfoMap;
+	QMap<QString, ICQInterestInfo> m_interestInfoMap;
+	QMap<QString, ICQOrgAffInfo> m_orgAffInfoMap;
 	QMap<Oscar::DWORD, QString> m_contactSequenceMap;
-	QMap<QString, Oscar::DWORD> m_reverseContactMap;
 	unsigned int m_type;
 	QString m_userToRequestFor;
 
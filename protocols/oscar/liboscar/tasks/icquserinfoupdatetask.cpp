@@ -100,6 +100,7 @@ void ICQUserInfoUpdateTask::onGo()
 	}
 
 	m_goSequence = client()->snacSequence();
+	registerRequest( m_goSequence );
 
 	Buffer *sendBuf = addInitialData( &b );
 	FLAP f = { 0x02, 0, 0 };
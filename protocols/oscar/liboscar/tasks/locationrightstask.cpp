@@ -29,6 +29,7 @@ using namespace Oscar;
 LocationRightsTask::LocationRightsTask( Task* parent ) 
 	: Task( parent )
 {
+	registerSnac( 0x0002, 0x0003 );
 }
 
 
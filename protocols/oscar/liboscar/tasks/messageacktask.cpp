@@ -21,6 +21,7 @@
 
 MessageAckTask::MessageAckTask( Task* parent ) : Task( parent )
 {
+	registerSnac( 0x0004, 0x000C );
 }
 
 bool MessageAckTask::forMe( const Transfer* transfer ) const
@@ -32,6 +32,8 @@
 
 MessageReceiverTask::MessageReceiverTask( Task* parent ) : Task( parent )
 {
+	registerSnac( 0x0004, 0x0007 );
+	registerSnac( 0x0004, 0x000B );
 }
 
 
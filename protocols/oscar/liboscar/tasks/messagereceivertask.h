@@ -21,6 +21,7 @@
 #include <QByteArray>
 #include "oscarmessage.h"
 #include "oscartypeclasses.h"
+#include "liboscar_export.h"
 
 class QTextCodec;
 
@@ -28,7 +29,7 @@ class QTextCodec;
  * Handles receiving messages. 
  * @author Matt Rogers
 */
-class MessageReceiverTask : public Task
+class LIBOSCAR_EXPORT MessageReceiverTask : public Task
 {
 Q_OBJECT
 public:
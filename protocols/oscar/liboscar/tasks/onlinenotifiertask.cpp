@@ -28,6 +28,8 @@
 
 OnlineNotifierTask::OnlineNotifierTask( Task* parent ) : Task( parent )
 {
+	registerSnac( 0x0003, 0x000B );
+	registerSnac( 0x0003, 0x000C );
 }
 
 
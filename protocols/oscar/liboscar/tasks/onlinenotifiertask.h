@@ -23,6 +23,7 @@
 
 #include <task.h>
 #include "userdetails.h"
+#include "liboscar_export.h"
 
 class Transfer;
 class QString;
@@ -32,7 +33,7 @@ Implements SNACS (0x03, 0x11) and (0x03, 0x12)
  
 @author Matt Rogers
 */
-class OnlineNotifierTask : public Task
+class LIBOSCAR_EXPORT OnlineNotifierTask : public Task
 {
 Q_OBJECT
 public:
@@ -33,6 +33,10 @@ using namespace Oscar;
 OscarLoginTask::OscarLoginTask( Task* parent )
 	: Task ( parent )
 {
+	registerSnac( 0x0017, 0x0002 );
+	registerSnac( 0x0017, 0x0003 );
+	registerSnac( 0x0017, 0x0006 );
+	registerSnac( 0x0017, 0x0007 );
 }
 
 OscarLoginTask::~OscarLoginTask()
@@ -30,6 +30,8 @@ using namespace Oscar;
 
 OwnUserInfoTask::OwnUserInfoTask( Task* parent ) : Task( parent )
 {
+	registerSnac( 0x0001, 0x000F );
+	registerSnac( 0x0001, 0x0021 );
 }
 
 
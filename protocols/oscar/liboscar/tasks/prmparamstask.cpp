@@ -27,6 +27,7 @@ using namespace Oscar;
 PRMParamsTask::PRMParamsTask( Task* parent )
 	: Task( parent )
 {
+	registerSnac( 0x0009, 0x0003 );
 }
 
 
@@ -33,6 +33,8 @@ RateInfoTask::RateInfoTask( Task* parent )
 		: Task( parent )
 {
 	connect( this, SIGNAL(gotRateLimits()), this, SLOT(sendRateInfoAck()) );
+
+	registerSnac( 0x0001, 0x0007 );
 }
 
 
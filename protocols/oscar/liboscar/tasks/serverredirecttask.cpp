@@ -28,7 +28,7 @@
 ServerRedirectTask::ServerRedirectTask( Task* parent )
 	:Task( parent ),  m_service( 0 )
 {
-
+	registerSnac( 0x0001, 0x0005 );
 }
 
 void ServerRedirectTask::setService( Oscar::WORD family )
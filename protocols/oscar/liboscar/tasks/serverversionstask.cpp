@@ -33,6 +33,10 @@ ServerVersionsTask::ServerVersionsTask( Task* parent )
  : Task( parent )
 {
     m_family = 0;
+
+	registerSnac( 0x0001, 0x0003 );
+	registerSnac( 0x0001, 0x0017 );
+	registerSnac( 0x0001, 0x0018 );
 }
 
 
@@ -31,6 +31,11 @@ SSIAuthTask::SSIAuthTask( Task* parent )
 	: Task( parent )
 {
 	m_manager = parent->client()->ssiManager();
+
+	registerSnac( 0x0013, 0x0015 );
+	registerSnac( 0x0013, 0x0019 );
+	registerSnac( 0x0013, 0x001B );
+	registerSnac( 0x0013, 0x001C );
 }
 
 SSIAuthTask::~SSIAuthTask()
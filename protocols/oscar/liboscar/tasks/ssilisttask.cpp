@@ -24,12 +24,15 @@
 #include "transfer.h"
 #include <QList>
 
-SSIListTask::SSIListTask( Task* parent ) : Task( parent )
+SSIListTask::SSIListTask( Task* parent ) : Task( parent ), m_listCleared( false )
 {
 	m_ssiManager = client()->ssiManager();
 	QObject::connect( this, SIGNAL(newContact(OContact)), m_ssiManager, SLOT(newContact(OContact)) );
 	QObject::connect( this, SIGNAL(newGroup(OContact)), m_ssiManager, SLOT(newGroup(OContact)) );
 	QObject::connect( this, SIGNAL(newItem(OContact)), m_ssiManager, SLOT(newItem(OContact)) );
+
+	registerSnac( 0x0013, 0x0006 );
+	registerSnac( 0x0013, 0x000F );
 }
 
 
@@ -97,6 +100,13 @@ void SSIListTask::handleContactListReply()
 	kDebug(OSCAR_RAW_DEBUG) << "SSI Protocol version: " << protocolVersion;
 	kDebug(OSCAR_RAW_DEBUG) << "Number of items in this SSI packet: " << ssiItems;
 
+	if ( !m_listCleared )
+	{
+		//the server sends the whole list, drop the one we loaded from disk
+		m_ssiManager->clear();
+		m_listCleared = true;
+	}
+
 	Oscar::WORD parsedItems;
 	for ( parsedItems = 1; parsedItems <= ssiItems; ++parsedItems )
 	{
@@ -167,7 +177,7 @@ void SSIListTask::checkContactTimestamp()
 	SNAC s = { 0x0013, 0x0005, 0x0000, client()->snacSequence() };
 	Buffer* buffer = new Buffer();
 	buffer->addDWord( client()->ssiManager()->lastModificationTime() );
-	buffer->addDWord( client()->ssiManager()->numberOfItems() );
+	buffer->addWord( client()->ssiManager()->numberOfItems() );
 	Transfer* t = createTransfer( f, s, buffer );
 	send( t );
 }
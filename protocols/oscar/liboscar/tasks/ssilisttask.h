@@ -19,6 +19,7 @@
 #define SSILISTTASK_H
 
 #include <task.h>
+#include "liboscar_export.h"
 
 class OContact;
 class ContactManager;
@@ -32,7 +33,7 @@ class ContactManager;
  *
  * @author Matt Rogers
 */
-class SSIListTask : public Task
+class LIBOSCAR_EXPORT SSIListTask : public Task
 {
 Q_OBJECT
 public:
@@ -99,6 +100,12 @@ private:
 	 */
 	ContactManager* m_ssiManager;
 
+	/**
+	 * The manager may hold a list loaded from disk. It's dropped
+	 * when the first packet of a new list arrives.
+	 */
+	bool m_listCleared;
+
 };
 
 #endif
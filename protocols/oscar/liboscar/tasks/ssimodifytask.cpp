@@ -35,6 +35,14 @@ SSIModifyTask::SSIModifyTask( Task* parent, bool staticTask ) : Task( parent )
 	m_opType = NoType;
 	m_opSubject = NoSubject;
 	m_id = 0;
+
+	// the static task handles server side changes, the others the replies to their requests
+	if ( m_static )
+	{
+		registerSnac( 0x0013, 0x0008 );
+		registerSnac( 0x0013, 0x0009 );
+		registerSnac( 0x0013, 0x000A );
+	}
 }
 
 
@@ -315,6 +323,7 @@ void SSIModifyTask::sendContactUpdate()
 		//add the item
 		FLAP f1 = { 0x02, 0, 0 };
 		m_id = client()->snacSequence();
+		registerRequest( m_id );
 		SNAC s1 = { 0x0013, 0x0008, 0x0000, m_id };
 		Buffer* ssiBuffer = new Buffer;
 		ssiBuffer->addString( m_newItem );
@@ -333,6 +342,7 @@ void SSIModifyTask::sendContactUpdate()
 		//remove the item
 		FLAP f1 = { 0x02, 0, 0 };
 		m_id = client()->snacSequence();
+		registerRequest( m_id );
 		SNAC s1 = { 0x0013, 0x000A, 0x0000, m_id };
 		Buffer* ssiBuffer = new Buffer;
 		ssiBuffer->addString( m_oldItem );
@@ -353,6 +363,7 @@ void SSIModifyTask::sendContactUpdate()
 		//change the group name
 		FLAP f1 = { 0x02, 0, 0 };
 		m_id = client()->snacSequence();
+		registerRequest( m_id );
 		SNAC s1 = { 0x0013, 0x0009, 0x0000, m_id };
 		Buffer* ssiBuffer = new Buffer;
 		ssiBuffer->addString( m_newItem );
@@ -385,6 +396,7 @@ void SSIModifyTask::changeGroupOnServer()
 	//add the buddy to the list with a different group
 	FLAP f2 = { 0x02, 0, 0 };
 	m_id = client()->snacSequence(); //we don't care about the first ack
+	registerRequest( m_id );
 	SNAC s2 = { 0x0013, 0x0008, 0x0000, m_id };
 	Buffer* b2 = new Buffer;
 	addItemToBuffer( m_newItem, b2 );
@@ -553,7 +565,11 @@ void SSIModifyTask::sendEditEnd()
 
 void SSIModifyTask::addItemToBuffer( OContact item, Buffer* buffer )
 {
-	buffer->addBSTR( item.name().toUtf8() );
+	QByteArray name = item.name().toUtf8();
+	// name, ids, type and length words, then the tlvs
+	buffer->reserve( 2 + name.length() + 8 + item.tlvListLength() );
+
+	buffer->addBSTR( name );
 	buffer->addWord( item.gid() );
 	buffer->addWord( item.bid() );
 	buffer->addWord( item.type() );
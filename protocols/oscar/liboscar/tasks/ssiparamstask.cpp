@@ -29,6 +29,7 @@ using namespace Oscar;
 
 SSIParamsTask::SSIParamsTask(Task* parent): Task(parent)
 {
+	registerSnac( 0x0013, 0x0003 );
 }
 
 
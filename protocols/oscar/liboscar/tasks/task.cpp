@@ -21,6 +21,8 @@
 
 #include <qtimer.h>
 #include <qstring.h>
+#include <qhash.h>
+#include <qset.h>
 #include <kdebug.h>
 
 #include "connection.h"
@@ -42,6 +44,60 @@ public:
 	AutoDeleteSetting autoDelete;
 	bool done;
 	Transfer* transfer;
+
+	Task* root;
+	quint32 serial; // creation order, transfers are offered to the oldest task first
+	bool routed; // registered what it handles instead of taking everything
+	QList<quint32> snacs;
+	QList<Oscar::DWORD> requests;
+
+	// the routing table, only used by the root task
+	quint32 nextSerial;
+	QSet<Task*> tasks;
+	QList<Task*> fallback;
+	QHash<quint32, QList<Task*> > snacRoutes;
+	QHash<Oscar::DWORD, QList<Task*> > requestRoutes;
+
+	static quint32 snacKey( Oscar::WORD family, Oscar::WORD subtype )
+	{
+		return ( quint32( family ) << 16 ) | subtype;
+	}
+
+	// keeps the list in creation order, new tasks usually go to the end
+	static void insert( QList<Task*>& list, Task* task )
+	{
+		int i = list.count();
+		while ( i > 0 && list.at( i - 1 )->d->serial > task->d->serial )
+			--i;
+		list.insert( i, task );
+	}
+
+	static QList<Task*> merge( const QList<Task*>& a, const QList<Task*>& b )
+	{
+		if ( a.isEmpty() )
+			return b;
+		if ( b.isEmpty() )
+			return a;
+
+		QList<Task*> merged;
+		int i = 0, j = 0;
+		while ( i < a.count() && j < b.count() )
+		{
+			quint32 sa = a.at( i )->d->serial;
+			quint32 sb = b.at( j )->d->serial;
+			if ( sa <= sb )
+				merged.append( a.at( i++ ) );
+			else
+				merged.append( b.at( j++ ) );
+			if ( sa == sb )
+				++j;
+		}
+		while ( i < a.count() )
+			merged.append( a.at( i++ ) );
+		while ( j < b.count() )
+			merged.append( b.at( j++ ) );
+		return merged;
+	}
 };
 
 Task::Task(Task *parent)
@@ -50,6 +106,14 @@ Task::Task(Task *parent)
 	init();
 	d->client = parent->client();
 	connect(d->client, SIGNAL(disconnected()), SLOT(clientDisconnected()));
+
+	// every task is registered with the root, until it says what it handles
+	// it is offered everything
+	d->root = parent->d->root;
+	TaskPrivate* r = d->root->d;
+	d->serial = r->nextSerial++;
+	r->tasks.insert( this );
+	r->fallback.append( this );
 }
 
 Task::Task(Connection* parent, bool)
@@ -58,10 +122,34 @@ Task::Task(Connection* parent, bool)
 	init();
 	d->client = parent;
 	connect(d->client, SIGNAL(disconnected()), SLOT(clientDisconnected()));
+	d->root = this;
 }
 
 Task::~Task()
 {
+	if ( d->root == this )
+	{
+		// the tasks are deleted after us by QObject
+		foreach ( Task* t, d->tasks )
+			t->d->root = 0;
+	}
+	else if ( d->root )
+	{
+		TaskPrivate* r = d->root->d;
+		r->tasks.remove( this );
+		if ( !d->routed )
+			r->fallback.removeAll( this );
+		foreach ( quint32 key, d->snacs )
+		{
+			QHash<quint32, QList<Task*> >::iterator it = r->snacRoutes.find( key );
+			it.value().removeAll( this );
+			if ( it.value().isEmpty() )
+				r->snacRoutes.erase( it );
+		}
+		foreach ( Oscar::DWORD id, d->requests )
+			unregisterRequest( id );
+	}
+
 	delete d->transfer;
 	delete d;
 }
@@ -76,6 +164,10 @@ void Task::init()
 	d->done = false;
 	d->transfer = 0;
 	d->id = 0;
+	d->root = 0;
+	d->serial = 0;
+	d->routed = false;
+	d->nextSerial = 1;
 }
 
 Task *Task::parent() const
@@ -126,9 +218,25 @@ void Task::go(AutoDeleteSetting autoDelete)
 
 bool Task::take( Transfer * transfer)
 {
-	const QList<Task*> p = findChildren<Task*>();
+	// only the root dispatches, the other tasks are registered with it
+	if ( d->root != this )
+		return false;
 
-	// pass along the transfer to our children
+	QList<Task*> p = d->fallback;
+	const SnacTransfer* st = dynamic_cast<const SnacTransfer*>( transfer );
+	if ( st )
+	{
+		QHash<quint32, QList<Task*> >::const_iterator it =
+			d->snacRoutes.constFind( TaskPrivate::snacKey( st->snacService(), st->snacSubtype() ) );
+		if ( it != d->snacRoutes.constEnd() )
+			p = TaskPrivate::merge( p, it.value() );
+
+		QHash<Oscar::DWORD, QList<Task*> >::const_iterator rit = d->requestRoutes.constFind( st->snacRequest() );
+		if ( rit != d->requestRoutes.constEnd() )
+			p = TaskPrivate::merge( p, rit.value() );
+	}
+
+	// pass along the transfer to the tasks that may want it
 	foreach( Task* t, p)
 	{
 		if ( t->take( transfer ) )
@@ -138,6 +246,57 @@ bool Task::take( Transfer * transfer)
 	return false;
 }
 
+void Task::registerSnac( Oscar::WORD family, Oscar::WORD subtype )
+{
+	Q_ASSERT( d->root != this );
+	if ( !d->root )
+		return;
+
+	TaskPrivate* r = d->root->d;
+	quint32 key = TaskPrivate::snacKey( family, subtype );
+	if ( d->snacs.contains( key ) )
+		return;
+
+	if ( !d->routed )
+	{
+		r->fallback.removeAll( this );
+		d->routed = true;
+	}
+	d->snacs.append( key );
+	TaskPrivate::insert( r->snacRoutes[key], this );
+}
+
+void Task::registerRequest( Oscar::DWORD id )
+{
+	Q_ASSERT( d->root != this );
+	if ( !d->root || id == 0 || d->requests.contains( id ) )
+		return;
+
+	TaskPrivate* r = d->root->d;
+	if ( !d->routed )
+	{
+		r->fallback.removeAll( this );
+		d->routed = true;
+	}
+	d->requests.append( id );
+	TaskPrivate::insert( r->requestRoutes[id], this );
+}
+
+void Task::unregisterRequest( Oscar::DWORD id )
+{
+	if ( !d->root || !d->requests.removeAll( id ) )
+		return;
+
+	TaskPrivate* r = d->root->d;
+	QHash<Oscar::DWORD, QList<Task*> >::iterator it = r->requestRoutes.find( id );
+	if ( it == r->requestRoutes.end() )
+		return;
+
+	it.value().removeAll( this );
+	if ( it.value().isEmpty() )
+		r->requestRoutes.erase( it );
+}
+
 void Task::safeDelete()
 {
 	if(d->deleteme)
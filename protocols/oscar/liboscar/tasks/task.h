@@ -24,6 +24,7 @@
 #include <qobject.h>
 
 #include "oscartypes.h"
+#include "liboscar_export.h"
 
 
 class QString;
@@ -34,7 +35,7 @@ class Transfer;
 using namespace Oscar;
 
 
-class Task : public QObject
+class LIBOSCAR_EXPORT Task : public QObject
 {
 	Q_OBJECT
 public:
@@ -85,6 +86,21 @@ protected:
 	 */
 	virtual bool forMe( const Transfer * transfer ) const;
 
+	/**
+	 * Tells the root task that this task handles SNACs of @p family and
+	 * @p subtype. A task that registers SNACs or requests is only offered
+	 * matching transfers, so everything forMe() accepts has to be registered.
+	 * Tasks that register nothing are offered every transfer.
+	 */
+	void registerSnac( Oscar::WORD family, Oscar::WORD subtype );
+
+	/**
+	 * Offer this task the SNACs carrying the request id @p id, whatever
+	 * their family and subtype. Use it for replies to our own requests.
+	 */
+	void registerRequest( Oscar::DWORD id );
+	void unregisterRequest( Oscar::DWORD id );
+
 	/**
 	 * Creates a transfer with the given flap, snac, and buffer
 	 */
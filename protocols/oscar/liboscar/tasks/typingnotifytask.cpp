@@ -29,6 +29,8 @@ TypingNotifyTask::TypingNotifyTask( Task* parent )
 : Task( parent )
 {
 	m_notificationType = 0x0000;
+
+	registerSnac( 0x0004, 0x0014 );
 }
 
 TypingNotifyTask::~TypingNotifyTask()
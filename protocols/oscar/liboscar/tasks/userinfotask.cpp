@@ -28,6 +28,7 @@ Kopete (c) 2002-2005 by the Kopete developers <kopete-devel@kde.org>
 UserInfoTask::UserInfoTask( Task* parent )
 : Task( parent )
 {
+	registerSnac( 0x0002, 0x0006 );
 }
 
 
@@ -25,6 +25,7 @@
 UserSearchTask::UserSearchTask( Task* parent )
  : ICQTask( parent )
 {
+	registerSnac( 0x0015, 0x0003 );
 }
 
 
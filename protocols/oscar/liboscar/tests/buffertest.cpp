@@ -85,4 +85,162 @@ void BufferTest::testGuid()
 	
 }
 
+void BufferTest::testAddString()
+{
+	Buffer b;
+	b.addString( "abc", 3 );
+	b.addString( (const unsigned char*) "de", 2 );
+	b.addLEString( "f", 1 );
+	b.addString( "", 0 );
+	QCOMPARE( b.buffer(), QByteArray( "abcdef" ) );
+
+	b.addBSTR( "gh" );
+	QCOMPARE( b.length(), 10 );
+	b.skipBytes( 6 );
+	QCOMPARE( b.getBSTR(), QByteArray( "gh" ) );
+}
+
+void BufferTest::testBlockUnderflow()
+{
+	Buffer b( QByteArray( "abcd" ) );
+	QCOMPARE( b.getBlock( 2 ), QByteArray( "ab" ) );
+	QCOMPARE( b.getBBlock( 10 ), QByteArray( "cd" ) );
+	QCOMPARE( b.bytesAvailable(), 0 );
+	QCOMPARE( b.getBlock( 1 ), QByteArray() );
+	QCOMPARE( b.getBBlock( 1 ), QByteArray() );
+}
+
+void BufferTest::testTLVIterator()
+{
+	Buffer b;
+	b.addTLV16( 0x0001, 0x0102 );
+	b.addTLV32( 0x0003, 0x01020304 );
+	b.addTLV( 0x0005, QByteArray( "hello" ) );
+	b.addTLV8( 0x0007, 0x09 );
+	b.addWord( 0x0009 );
+	b.addWord( 0x0010 ); // claims more data than there is
+	b.addByte( 0x42 );
+
+	TLVIterator t( &b );
+	QVERIFY( t.next() );
+	QCOMPARE( t.type(), (Oscar::WORD)0x0001 );
+	QCOMPARE( t.toWord(), (Oscar::WORD)0x0102 );
+	QCOMPARE( t.toDWord(), (Oscar::DWORD)0 );
+
+	QVERIFY( t.next() );
+	QCOMPARE( t.toDWord(), (Oscar::DWORD)0x01020304 );
+
+	QVERIFY( t.next() );
+	QCOMPARE( t.length(), (Oscar::WORD)5 );
+	QCOMPARE( t.toByteArray(), QByteArray( "hello" ) );
+	QVERIFY( t.data() >= b.buffer().constData() ); // read in place
+	TLV copy = t.toTLV();
+	QCOMPARE( copy.type, (Oscar::WORD)0x0005 );
+	QCOMPARE( copy.data, QByteArray( "hello" ) );
+	Buffer inner = t.buffer();
+	QCOMPARE( inner.getBlock( 2 ), QByteArray( "he" ) );
+
+	QVERIFY( t.next() );
+	QCOMPARE( t.toByte(), (Oscar::BYTE)0x09 );
+
+	// the truncated tlv gets what is left
+	QVERIFY( t.next() );
+	QCOMPARE( t.type(), (Oscar::WORD)0x0009 );
+	QCOMPARE( t.length(), (Oscar::WORD)1 );
+	QVERIFY( !t.next() );
+	QCOMPARE( b.bytesAvailable(), 0 );
+
+	// reading copies and reading in place see the same tlvs
+	Buffer c;
+	c.addTLV16( 0x0001, 0x0102 );
+	c.addTLV( 0x0005, QByteArray( "hello" ) );
+	QList<TLV> list = Buffer( c.buffer() ).getTLVList();
+	TLVIterator it( &c );
+	int n = 0;
+	while ( it.next() )
+	{
+		QCOMPARE( it.type(), list[n].type );
+		QCOMPARE( it.toByteArray(), list[n].data );
+		++n;
+	}
+	QCOMPARE( n, list.count() );
+}
+static const int ITEM_TLV_LENGTH = 4 * 5 + 7 + 4 + 2 + 18 + 4;
+
+// a roster item with the usual handful of tlvs
+static void addItem( Buffer& b, int i )
+{
+	b.addBSTR( "someone@example.com" );
+	b.addWord( 0x0001 );
+	b.addWord( i );
+	b.addWord( 0x0000 );
+	b.addWord( ITEM_TLV_LENGTH );
+	b.addTLV( 0x0131, QByteArray( "Someone" ) );
+	b.addTLV32( 0x0145, 0x4a5b6c7d );
+	b.addTLV16( 0x00ca, 0x0001 );
+	b.addTLV( 0x013c, QByteArray( "a longer note here" ) );
+	b.addTLV32( 0x015c, i );
+}
+
+void BufferTest::benchmarkWrite()
+{
+	QBENCHMARK
+	{
+		Buffer b;
+		for ( int i = 0; i < BENCHMARK_ITEMS; ++i )
+			addItem( b, i );
+	}
+}
+
+void BufferTest::benchmarkWriteReserved()
+{
+	QBENCHMARK
+	{
+		Buffer b;
+		b.reserve( BENCHMARK_ITEMS * ( 2 + 19 + 8 + ITEM_TLV_LENGTH ) );
+		for ( int i = 0; i < BENCHMARK_ITEMS; ++i )
+			addItem( b, i );
+	}
+}
+
+static QByteArray benchmarkTLVs()
+{
+	Buffer b;
+	for ( int i = 0; i < BENCHMARK_ITEMS; ++i )
+	{
+		b.addTLV16( 0x0001, 0x0010 );
+		b.addTLV32( 0x0003, i );
+		b.addTLV( 0x000d, QByteArray( 64, 'c' ) );
+		b.addTLV32( 0x000f, i );
+	}
+	return b.buffer();
+}
+
+void BufferTest::benchmarkReadTLVList()
+{
+	QByteArray data = benchmarkTLVs();
+	Oscar::DWORD sum = 0;
+	QBENCHMARK
+	{
+		Buffer b( data );
+		foreach ( const TLV& t, b.getTLVList() )
+			sum += Buffer( t.data ).getWord();
+	}
+	QVERIFY( sum > 0 );
+}
+
+void BufferTest::benchmarkReadTLVIterator()
+{
+	QByteArray data = benchmarkTLVs();
+	Oscar::DWORD sum = 0;
+	QBENCHMARK
+	{
+		Buffer b( data );
+		TLVIterator t( &b );
+		while ( t.next() )
+			sum += t.toWord();
+	}
+	QVERIFY( sum > 0 );
+}
+
 #include "buffertest.moc"
@@ -14,6 +14,15 @@ private slots:
 	void testBytesAvailable();
 	void testLength();
 	void testGuid();
+	void testAddString();
+	void testBlockUnderflow();
+	void testTLVIterator();
+
+	// throughput of building and reading a TLV heavy packet
+	void benchmarkWrite();
+	void benchmarkWriteReserved();
+	void benchmarkReadTLVList();
+	void benchmarkReadTLVIterator();
 
 };
 
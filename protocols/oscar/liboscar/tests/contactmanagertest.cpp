@@ -0,0 +1,192 @@
+/*
+    Contact Manager Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#include "contactmanagertest.h"
+#include "contactmanager.h"
+
+#include <QtCore/QBuffer>
+
+OSCAR_TEST_MAIN( ContactManagerTest )
+
+static OContact item( const QString& name, int gid, int bid, int type )
+{
+	return OContact( name, gid, bid, type, QList<TLV>() );
+}
+
+void ContactManagerTest::testLookups()
+{
+	ContactManager manager;
+	QVERIFY( manager.newGroup( item( "Friends", 1, 0, ROSTER_GROUP ) ) );
+	QVERIFY( manager.newGroup( item( "Work", 2, 0, ROSTER_GROUP ) ) );
+	QVERIFY( manager.newContact( item( "alice", 1, 10, ROSTER_CONTACT ) ) );
+	QVERIFY( manager.newContact( item( "alice", 2, 11, ROSTER_CONTACT ) ) );
+	QVERIFY( manager.newItem( item( "bob", 0, 12, ROSTER_IGNORE ) ) );
+	QVERIFY( manager.newItem( item( "", 0, 13, 0x0004 ) ) );
+	QCOMPARE( manager.numberOfItems(), Oscar::WORD( 6 ) );
+
+	// group names are case insensitive, contact names are not
+	QCOMPARE( manager.findGroup( "FRIENDS" ).gid(), quint16( 1 ) );
+	QCOMPARE( manager.findGroup( 2 ).name(), QString( "Work" ) );
+	QVERIFY( !manager.findGroup( 3 ).isValid() );
+	QVERIFY( !manager.findContact( "ALICE" ).isValid() );
+
+	// the contact added first wins
+	QCOMPARE( manager.findContact( "alice" ).bid(), quint16( 10 ) );
+	QCOMPARE( manager.findContact( "alice", "Work" ).bid(), quint16( 11 ) );
+	QCOMPARE( manager.findContact( 11 ).gid(), quint16( 2 ) );
+	QVERIFY( !manager.findContact( 12 ).isValid() );
+
+	QCOMPARE( manager.findItem( "bob", ROSTER_IGNORE ).bid(), quint16( 12 ) );
+	QVERIFY( !manager.findItem( "bob", ROSTER_CONTACT ).isValid() );
+	QCOMPARE( manager.visibilityItem().bid(), quint16( 13 ) );
+
+	QVERIFY( manager.hasItem( item( "alice", 2, 11, ROSTER_CONTACT ) ) );
+	QVERIFY( !manager.hasItem( item( "alice", 2, 12, ROSTER_CONTACT ) ) );
+	QVERIFY( !manager.newContact( item( "alice", 2, 11, ROSTER_CONTACT ) ) );
+	QVERIFY( !manager.newGroup( item( "work", 5, 0, ROSTER_GROUP ) ) );
+}
+
+void ContactManagerTest::testListOrder()
+{
+	ContactManager manager;
+	manager.newGroup( item( "Friends", 1, 0, ROSTER_GROUP ) );
+	manager.newContact( item( "carol", 1, 3, ROSTER_CONTACT ) );
+	manager.newContact( item( "alice", 1, 1, ROSTER_CONTACT ) );
+	manager.newItem( item( "dave", 0, 4, ROSTER_VISIBLE ) );
+	manager.newContact( item( "bob", 1, 2, ROSTER_CONTACT ) );
+
+	QList<OContact> contacts = manager.contactsFromGroup( "friends" );
+	QCOMPARE( contacts.count(), 3 );
+	QCOMPARE( contacts[0].name(), QString( "carol" ) );
+	QCOMPARE( contacts[1].name(), QString( "alice" ) );
+	QCOMPARE( contacts[2].name(), QString( "bob" ) );
+	QCOMPARE( manager.contactList().count(), 3 );
+	QCOMPARE( manager.contactList()[2].name(), QString( "bob" ) );
+	QCOMPARE( manager.visibleList().count(), 1 );
+	QCOMPARE( manager.groupList().count(), 1 );
+	QVERIFY( manager.invisibleList().isEmpty() );
+
+	// an update moves the item to the end, like the server list does
+	manager.updateContact( item( "carol", 1, 3, ROSTER_CONTACT ) );
+	contacts = manager.contactsFromGroup( 1 );
+	QCOMPARE( contacts[0].name(), QString( "alice" ) );
+	QCOMPARE( contacts[2].name(), QString( "carol" ) );
+}
+
+void ContactManagerTest::testUpdateAndRemove()
+{
+	ContactManager manager;
+	manager.newGroup( item( "Friends", 1, 0, ROSTER_GROUP ) );
+	manager.newGroup( item( "Work", 2, 0, ROSTER_GROUP ) );
+	manager.newContact( item( "alice", 1, 10, ROSTER_CONTACT ) );
+
+	// moving a contact to another group
+	QVERIFY( manager.updateContact( item( "alice", 2, 10, ROSTER_CONTACT ) ) );
+	QVERIFY( manager.contactsFromGroup( 1 ).isEmpty() );
+	QCOMPARE( manager.contactsFromGroup( 2 ).count(), 1 );
+	QCOMPARE( manager.numberOfItems(), Oscar::WORD( 3 ) );
+
+	// renaming a group keeps the case insensitive lookup current
+	QVERIFY( manager.updateGroup( item( "work", 2, 0, ROSTER_GROUP ) ) );
+	QCOMPARE( manager.findGroup( "WORK" ).name(), QString( "work" ) );
+	QCOMPARE( manager.groupList().count(), 2 );
+
+	QVERIFY( manager.removeContact( "alice" ) );
+	QVERIFY( !manager.findContact( 10 ).isValid() );
+	QVERIFY( manager.contactsFromGroup( 2 ).isEmpty() );
+	QVERIFY( !manager.removeContact( "alice" ) );
+
+	QVERIFY( manager.removeGroup( "friends" ) );
+	QVERIFY( !manager.findGroup( 1 ).isValid() );
+	QCOMPARE( manager.numberOfItems(), Oscar::WORD( 1 ) );
+
+	manager.clear();
+	QCOMPARE( manager.numberOfItems(), Oscar::WORD( 0 ) );
+	QVERIFY( !manager.findGroup( "work" ).isValid() );
+}
+
+void ContactManagerTest::testIdAllocation()
+{
+	ContactManager manager;
+	QCOMPARE( manager.nextContactId(), Oscar::WORD( 1 ) );
+	QCOMPARE( manager.nextContactId(), Oscar::WORD( 2 ) );
+
+	// ids from the server are skipped, a whole word of them at once
+	for ( int id = 3; id < 100; id++ )
+		manager.newContact( item( QString::number( id ), 1, id, ROSTER_CONTACT ) );
+	QCOMPARE( manager.nextContactId(), Oscar::WORD( 100 ) );
+
+	// removing an item makes its id the next one
+	manager.removeContact( "50" );
+	QCOMPARE( manager.nextContactId(), Oscar::WORD( 50 ) );
+	QCOMPARE( manager.nextContactId(), Oscar::WORD( 101 ) );
+
+	// group ids are counted separately
+	QCOMPARE( manager.nextGroupId(), Oscar::WORD( 1 ) );
+	manager.newGroup( item( "Two", 2, 0, ROSTER_GROUP ) );
+	QCOMPARE( manager.nextGroupId(), Oscar::WORD( 3 ) );
+
+	// running out of ids
+	for ( int id = 102; id < 0x8000; id++ )
+		manager.addID( item( QString(), 1, id, ROSTER_CONTACT ) );
+	QCOMPARE( manager.nextContactId(), Oscar::WORD( 0xFFFF ) );
+}
+
+void ContactManagerTest::testSaveAndLoad()
+{
+	ContactManager manager;
+	manager.newGroup( item( "Friends", 1, 0, ROSTER_GROUP ) );
+	QList<TLV> tlvs;
+	tlvs.append( TLV( 0x0131, 5, QByteArray( "Alice" ) ) );
+	manager.newContact( OContact( "alice", 1, 10, ROSTER_CONTACT, tlvs ) );
+	manager.newContact( item( "bob", 1, 11, ROSTER_CONTACT ) );
+	manager.newItem( item( "carol", 0, 12, ROSTER_INVISIBLE ) );
+	manager.setLastModificationTime( 0x12345678 );
+	manager.setListComplete( true );
+
+	QBuffer device;
+	device.open( QIODevice::ReadWrite );
+	QVERIFY( manager.save( &device ) );
+
+	ContactManager loaded;
+	loaded.newContact( item( "stale", 1, 20, ROSTER_CONTACT ) );
+	device.seek( 0 );
+	QVERIFY( loaded.load( &device ) );
+	QCOMPARE( loaded.numberOfItems(), Oscar::WORD( 4 ) );
+	QCOMPARE( loaded.lastModificationTime(), Oscar::DWORD( 0x12345678 ) );
+	QVERIFY( !loaded.listComplete() );
+	QVERIFY( !loaded.findContact( "stale" ).isValid() );
+	QCOMPARE( loaded.findContact( "alice" ).alias(), QString( "Alice" ) );
+	QCOMPARE( loaded.findContact( 11 ).name(), QString( "bob" ) );
+	QCOMPARE( loaded.contactsFromGroup( 1 ).count(), 2 );
+	QCOMPARE( loaded.invisibleList().count(), 1 );
+	QCOMPARE( loaded.nextContactId(), Oscar::WORD( 1 ) );
+
+	// anything else leaves an empty list
+	QBuffer garbage;
+	garbage.setData( "not a list" );
+	garbage.open( QIODevice::ReadOnly );
+	QVERIFY( !loaded.load( &garbage ) );
+	QCOMPARE( loaded.numberOfItems(), Oscar::WORD( 0 ) );
+
+	// so does a list cut short
+	QBuffer truncated;
+	truncated.setData( device.data().left( device.data().size() - 3 ) );
+	truncated.open( QIODevice::ReadOnly );
+	QVERIFY( !loaded.load( &truncated ) );
+	QCOMPARE( loaded.numberOfItems(), Oscar::WORD( 0 ) );
+}
+
+#include "contactmanagertest.moc"
@@ -0,0 +1,41 @@
+/*
+    Contact Manager Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#ifndef CONTACTMANAGERTEST_H
+#define CONTACTMANAGERTEST_H
+
+#include "oscartestbase.h"
+
+class ContactManagerTest : public OscarTestBase
+{
+Q_OBJECT
+private slots:
+	///Items are found by name, type and id
+	void testLookups();
+
+	///Lists come back in the order the items were added
+	void testListOrder();
+
+	///Updated and removed items leave the indexes
+	void testUpdateAndRemove();
+
+	///Free ids are handed out lowest first
+	void testIdAllocation();
+
+	///A saved list loads back with its ids, TLVs and timestamp
+	void testSaveAndLoad();
+};
+
+#endif
@@ -0,0 +1,148 @@
+/*
+    CoreProtocol Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#include "coreprotocoltest.h"
+#include "coreprotocol.h"
+#include "transfer.h"
+#include "buffer.h"
+
+OSCAR_TEST_MAIN( CoreProtocolTest )
+
+void CoreProtocolTest::initTestCase()
+{
+	const char* files[] = { "snac0107.buffer", "snac1503.buffer", "snac1707.buffer" };
+	for ( int i = 0; i < 3; ++i )
+	{
+		QVERIFY( loadFile( files[i] ) );
+		Fixture f;
+		bool ok;
+		f.family = QString( files[i] ).mid( 4, 2 ).toUShort( &ok, 16 );
+		f.subtype = QString( files[i] ).mid( 6, 2 ).toUShort( &ok, 16 );
+		f.data = m_data->buffer();
+		m_fixtures.append( f );
+	}
+}
+
+QByteArray CoreProtocolTest::replayWire( int rounds )
+{
+	Buffer wire;
+	Oscar::WORD sequence = 0;
+	for ( int r = 0; r < rounds; ++r )
+	{
+		foreach ( const Fixture& f, m_fixtures )
+		{
+			wire.addByte( 0x2A );
+			wire.addByte( 0x02 );
+			wire.addWord( sequence++ );
+			wire.addWord( f.data.size() + 10 );
+			wire.addWord( f.family );
+			wire.addWord( f.subtype );
+			wire.addWord( 0x0000 );
+			wire.addDWord( r );
+			wire.addString( f.data );
+		}
+	}
+	return wire.buffer();
+}
+
+void CoreProtocolTest::checkTransfers( int rounds )
+{
+	QCOMPARE( m_transfers.count(), rounds * m_fixtures.count() );
+	for ( int n = 0; n < m_transfers.count(); ++n )
+	{
+		const Fixture& f = m_fixtures[n % m_fixtures.count()];
+		SnacTransfer* st = dynamic_cast<SnacTransfer*>( m_transfers[n] );
+		QVERIFY( st );
+		QCOMPARE( st->snacService(), f.family );
+		QCOMPARE( st->snacSubtype(), f.subtype );
+		QCOMPARE( st->snacRequest(), Oscar::DWORD( n / m_fixtures.count() ) );
+		QCOMPARE( st->buffer()->buffer(), f.data );
+	}
+}
+
+void CoreProtocolTest::slotIncomingData()
+{
+	m_transfers.append( m_protocol->incomingTransfer() );
+}
+
+void CoreProtocolTest::testReplay_data()
+{
+	QTest::addColumn<int>( "chunkSize" );
+
+	QTest::newRow( "byte by byte" ) << 1;
+	QTest::newRow( "split headers" ) << 7;
+	QTest::newRow( "tcp segments" ) << 1448;
+	QTest::newRow( "one burst" ) << 0;
+}
+
+void CoreProtocolTest::testReplay()
+{
+	QFETCH( int, chunkSize );
+
+	const int rounds = 200;
+	QByteArray wire = replayWire( rounds );
+
+	CoreProtocol protocol;
+	m_protocol = &protocol;
+	connect( &protocol, SIGNAL(incomingData()), SLOT(slotIncomingData()) );
+
+	if ( chunkSize == 0 )
+		protocol.addIncomingData( wire );
+	else
+		for ( int pos = 0; pos < wire.size(); pos += chunkSize )
+			protocol.addIncomingData( wire.mid( pos, chunkSize ) );
+
+	checkTransfers( rounds );
+	qDeleteAll( m_transfers );
+	m_transfers.clear();
+}
+
+void CoreProtocolTest::testTransfersOutliveInput()
+{
+	QByteArray wire = replayWire( 2 );
+
+	CoreProtocol protocol;
+	m_protocol = &protocol;
+	connect( &protocol, SIGNAL(incomingData()), SLOT(slotIncomingData()) );
+
+	// the first transfers share their chunk with the protocol's input buffer,
+	// which is appended to and then reset while they are still around
+	protocol.addIncomingData( wire.left( wire.size() - 5 ) );
+	protocol.addIncomingData( wire.right( 5 ) );
+	protocol.reset();
+	protocol.addIncomingData( QByteArray( 4096, 'x' ) );
+
+	checkTransfers( 2 );
+	qDeleteAll( m_transfers );
+	m_transfers.clear();
+}
+
+void CoreProtocolTest::testReplayBenchmark()
+{
+	QByteArray wire = replayWire( 2000 );
+
+	CoreProtocol protocol;
+	m_protocol = &protocol;
+	connect( &protocol, SIGNAL(incomingData()), SLOT(slotIncomingData()) );
+
+	QBENCHMARK
+	{
+		protocol.addIncomingData( wire );
+		qDeleteAll( m_transfers );
+		m_transfers.clear();
+	}
+}
+
+#include "coreprotocoltest.moc"
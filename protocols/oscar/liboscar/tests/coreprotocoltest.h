@@ -0,0 +1,48 @@
+/*
+    CoreProtocol Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#ifndef COREPROTOCOLTEST_H
+#define COREPROTOCOLTEST_H
+
+#include "oscartestbase.h"
+#include "oscartypes.h"
+
+class CoreProtocol;
+class Transfer;
+
+class CoreProtocolTest : public OscarTestBase
+{
+Q_OBJECT
+private slots:
+	void initTestCase();
+	void testReplay_data();
+	void testReplay();
+	void testTransfersOutliveInput();
+	void testReplayBenchmark();
+
+	void slotIncomingData();
+
+private:
+	// the fixtures wrapped into FLAPs, in the order they should come out
+	QByteArray replayWire( int rounds );
+	void checkTransfers( int rounds );
+
+	struct Fixture { Oscar::WORD family, subtype; QByteArray data; };
+	QList<Fixture> m_fixtures;
+	CoreProtocol* m_protocol;
+	QList<Transfer*> m_transfers;
+};
+
+#endif
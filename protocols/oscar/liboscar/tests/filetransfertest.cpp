@@ -18,6 +18,14 @@
 #include "filetransfertest.h"
 #include "filetransfertask.h"
 #include "buffer.h"
+#include "oftchecksum.h"
+#include "oftmetatransfer.h"
+
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryFile>
+#include <QtNetwork/QTcpServer>
+#include <QtNetwork/QTcpSocket>
 
 OSCAR_TEST_MAIN( FileTransferTest )
 
@@ -38,5 +46,161 @@ void FileTransferTest::testRRequest()
     delete b;*/
 }
 
+void FileTransferTest::testChecksum()
+{
+	QCOMPARE( OftChecksum::update( OftChecksum::Initial, "", 0, 0 ), Oscar::DWORD( 0xFFFF0000 ) );
+	QCOMPARE( OftChecksum::update( OftChecksum::Initial, "\x01", 1, 0 ), Oscar::DWORD( 0xFEFF0000 ) );
+	QCOMPARE( OftChecksum::update( OftChecksum::Initial, "\x01", 1, 1 ), Oscar::DWORD( 0xFFFE0000 ) );
+
+	QByteArray data;
+	for ( int i = 0; i < 300000; i++ )
+		data.append( char( i * 7 ) );
+	Oscar::DWORD whole = OftChecksum::update( OftChecksum::Initial, data.constData(), data.size(), 0 );
+
+	// an odd split like the socket gives us
+	Oscar::DWORD pieces = OftChecksum::update( OftChecksum::Initial, data.constData(), 1001, 0 );
+	pieces = OftChecksum::update( pieces, data.constData() + 1001, data.size() - 1001, 1001 );
+	QCOMPARE( pieces, whole );
+
+	QTemporaryFile file;
+	QVERIFY( file.open() );
+	file.write( data );
+	file.flush();
+
+	OftChecksumThread thread( file.fileName() );
+	thread.start();
+	QVERIFY( thread.wait( 10000 ) );
+	QVERIFY( !thread.failed() );
+	QCOMPARE( thread.bytes(), qint64( data.size() ) );
+	QCOMPARE( thread.checksum(), whole );
+
+	OftChecksumThread partial( file.fileName(), 1001 );
+	partial.start();
+	QVERIFY( partial.wait( 10000 ) );
+	QCOMPARE( partial.checksum(), OftChecksum::update( OftChecksum::Initial, data.constData(), 1001, 0 ) );
+
+	OftChecksumThread missing( file.fileName() + ".missing" );
+	missing.start();
+	QVERIFY( missing.wait( 10000 ) );
+	QVERIFY( missing.failed() );
+}
+
+void FileTransferTest::testChecksumCache()
+{
+	OftChecksum::clearCache();
+
+	QTemporaryFile file;
+	QVERIFY( file.open() );
+	file.write( "some file data" );
+	file.flush();
+
+	QFileInfo info( file.fileName() );
+	Oscar::DWORD checksum = 0;
+	QVERIFY( !OftChecksum::lookup( file.fileName(), -1, &checksum ) );
+
+	OftChecksum::insert( file.fileName(), info.size(), info.lastModified(), -1, 0x12340000 );
+	QVERIFY( OftChecksum::lookup( file.fileName(), -1, &checksum ) );
+	QCOMPARE( checksum, Oscar::DWORD( 0x12340000 ) );
+
+	// asking for more than the file has means the whole file
+	QVERIFY( OftChecksum::lookup( file.fileName(), info.size() + 10, &checksum ) );
+	QVERIFY( !OftChecksum::lookup( file.fileName(), 4, &checksum ) );
+
+	file.write( "more" );
+	file.flush();
+	QVERIFY( !OftChecksum::lookup( file.fileName(), -1, &checksum ) );
+}
+static QByteArray testData( int size )
+{
+	QByteArray data( size, 0 );
+	for ( int i = 0; i < size; i++ )
+		data[i] = char( ( i * 31 ) ^ ( i >> 11 ) );
+	return data;
+}
+
+static QString receivedFileName()
+{
+	return QDir::tempPath() + QString( "/oscar-oft-loopback-%1" ).arg( QCoreApplication::applicationPid() );
+}
+
+/**
+ * Sends @p source to @p destination over a loopback connection
+ * \return the time it took in milliseconds, -1 if it didn't finish
+ */
+static int loopbackTransfer( const QString& source, const QString& destination )
+{
+	QTcpServer server;
+	if ( !server.listen( QHostAddress::LocalHost ) )
+		return -1;
+
+	QTcpSocket* senderSocket = new QTcpSocket;
+	senderSocket->connectToHost( QHostAddress::LocalHost, server.serverPort() );
+	if ( !server.waitForNewConnection( 5000 ) || !senderSocket->waitForConnected( 5000 ) )
+	{
+		delete senderSocket;
+		return -1;
+	}
+
+	//the transfers delete their sockets
+	QTcpSocket* receiverSocket = server.nextPendingConnection();
+	receiverSocket->setParent( 0 );
+
+	QByteArray cookie( 8, 'c' );
+	QTime timer;
+	timer.start();
+
+	OftMetaTransfer* receiver = new OftMetaTransfer( cookie, QStringList() << destination, QString(), receiverSocket );
+	OftMetaTransfer* sender = new OftMetaTransfer( cookie, QStringList() << source, senderSocket );
+	QSignalSpy received( receiver, SIGNAL(transferCompleted()) );
+	QSignalSpy sent( sender, SIGNAL(transferCompleted()) );
+	sender->start();
+
+	while ( ( received.isEmpty() || sent.isEmpty() ) && timer.elapsed() < 60000 )
+		QTest::qWait( 10 );
+
+	if ( received.isEmpty() || sent.isEmpty() )
+		return -1;
+
+	return timer.elapsed();
+}
+
+void FileTransferTest::testLoopbackTransfer()
+{
+	QByteArray data = testData( 1000003 );
+	QTemporaryFile source;
+	QVERIFY( source.open() );
+	source.write( data );
+	source.flush();
+
+	QString destination = receivedFileName();
+	QFile::remove( destination );
+	QVERIFY( loopbackTransfer( source.fileName(), destination ) >= 0 );
+
+	QFile received( destination );
+	QVERIFY( received.open( QIODevice::ReadOnly ) );
+	QVERIFY( received.readAll() == data );
+	received.remove();
+}
+
+void FileTransferTest::benchmarkLoopbackTransfer()
+{
+	const int size = 64 * 1024 * 1024;
+	QTemporaryFile source;
+	QVERIFY( source.open() );
+	QByteArray chunk = testData( 1024 * 1024 );
+	for ( int i = 0; i < size / chunk.size(); i++ )
+		source.write( chunk );
+	source.flush();
+
+	QString destination = receivedFileName();
+	QFile::remove( destination );
+	int elapsed = loopbackTransfer( source.fileName(), destination );
+	QVERIFY( elapsed >= 0 );
+	QCOMPARE( QFileInfo( destination ).size(), qint64( size ) );
+	QFile::remove( destination );
+
+	qDebug( "OFT loopback: %d MB in %d ms, %.1f MB/s", size / ( 1024 * 1024 ), elapsed,
+	        ( size / ( 1024.0 * 1024.0 ) ) / ( qMax( elapsed, 1 ) / 1000.0 ) );
+}
 
 #include "filetransfertest.moc"
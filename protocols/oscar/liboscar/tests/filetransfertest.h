@@ -25,6 +25,18 @@ class FileTransferTest : public OscarTestBase
 Q_OBJECT
 private slots:
 	void testRRequest();
+
+	///Checksums come out the same in one go, in pieces and off the GUI thread
+	void testChecksum();
+
+	///Cached checksums are dropped when the file changes
+	void testChecksumCache();
+
+	///A file goes through OFT over loopback unchanged
+	void testLoopbackTransfer();
+
+	///MB/s of an OFT transfer over loopback
+	void benchmarkLoopbackTransfer();
 };
 
 #endif
@@ -0,0 +1,69 @@
+/*
+    ICQ Info Request Broker Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#include "icqinforequestbrokertest.h"
+#include "icqinforequestbroker.h"
+
+OSCAR_TEST_MAIN( ICQInfoRequestBrokerTest )
+
+void ICQInfoRequestBrokerTest::testPending()
+{
+	ICQInfoRequestBroker broker;
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::ShortInfo ), ICQInfoRequestBroker::Send );
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::ShortInfo ), ICQInfoRequestBroker::Pending );
+
+	// other contacts and other info are requested on their own
+	QCOMPARE( broker.request( "54321", ICQInfoRequestBroker::ShortInfo ), ICQInfoRequestBroker::Send );
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::LongInfo ), ICQInfoRequestBroker::Send );
+
+	broker.clear();
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::ShortInfo ), ICQInfoRequestBroker::Send );
+}
+
+void ICQInfoRequestBrokerTest::testCached()
+{
+	ICQInfoRequestBroker broker;
+	broker.request( "12345", ICQInfoRequestBroker::LongInfo );
+	broker.received( "12345", ICQInfoRequestBroker::LongInfo );
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::LongInfo ), ICQInfoRequestBroker::Cached );
+
+	// info that came without asking for it counts too
+	broker.received( "Some Name", ICQInfoRequestBroker::ShortInfo );
+	QCOMPARE( broker.request( "somename", ICQInfoRequestBroker::ShortInfo ), ICQInfoRequestBroker::Cached );
+
+	broker.forget( "12345" );
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::LongInfo ), ICQInfoRequestBroker::Send );
+
+	broker.setTimeToLive( 0 );
+	broker.received( "12345", ICQInfoRequestBroker::LongInfo );
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::LongInfo ), ICQInfoRequestBroker::Send );
+}
+
+void ICQInfoRequestBrokerTest::testTlvInfo()
+{
+	ICQInfoRequestBroker broker;
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::MediumTlvInfo, "id1" ), ICQInfoRequestBroker::Send );
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::ShortTlvInfo, "id1" ), ICQInfoRequestBroker::Pending );
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::LongTlvInfo, "id1" ), ICQInfoRequestBroker::Send );
+
+	broker.received( "12345", ICQInfoRequestBroker::MediumTlvInfo );
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::ShortTlvInfo, "id1" ), ICQInfoRequestBroker::Cached );
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::MediumTlvInfo, "id1" ), ICQInfoRequestBroker::Cached );
+
+	// a new meta info id means the info changed
+	QCOMPARE( broker.request( "12345", ICQInfoRequestBroker::MediumTlvInfo, "id2" ), ICQInfoRequestBroker::Send );
+}
+
+#include "icqinforequestbrokertest.moc"
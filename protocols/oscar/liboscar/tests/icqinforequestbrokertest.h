@@ -0,0 +1,35 @@
+/*
+    ICQ Info Request Broker Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#ifndef ICQINFOREQUESTBROKERTEST_H
+#define ICQINFOREQUESTBROKERTEST_H
+
+#include "oscartestbase.h"
+
+class ICQInfoRequestBrokerTest : public OscarTestBase
+{
+Q_OBJECT
+private slots:
+	///Requests for info on its way are dropped
+	void testPending();
+
+	///Received info is reused until it expires
+	void testCached();
+
+	///TLV info is reused for fewer TLVs with the same meta info id
+	void testTlvInfo();
+};
+
+#endif
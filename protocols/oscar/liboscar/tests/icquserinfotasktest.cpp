@@ -0,0 +1,183 @@
+/*
+    ICQ User Info Task Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#include "icquserinfotasktest.h"
+
+#include <QtTest/QSignalSpy>
+#include <QtNetwork/QSslSocket>
+
+#include "buffer.h"
+#include "client.h"
+#include "connection.h"
+#include "icquserinfotask.h"
+#include "oscarclientstream.h"
+#include "transfer.h"
+
+OSCAR_TEST_MAIN( ICQUserInfoRequestTaskTest )
+
+static const char* CONTACT = "123456";
+
+/**
+ * A socket that keeps what is written to it, so the SNAC id of a
+ * request can be used in the reply.
+ */
+class CaptureSocket : public QSslSocket
+{
+public:
+	CaptureSocket() : lastPacket( 0 )
+	{
+		setOpenMode( QIODevice::ReadWrite | QIODevice::Unbuffered );
+	}
+
+	/** Close it so ClientStream doesn't try to disconnect it */
+	void finish()
+	{
+		setOpenMode( QIODevice::NotOpen );
+	}
+
+	/** SNAC id of the last packet written */
+	Oscar::DWORD lastSnacId() const
+	{
+		Buffer b( written.right( written.size() - lastPacket ) );
+		b.skipBytes( 6 + 6 );
+		return b.getDWord();
+	}
+
+	QByteArray written;
+	int lastPacket;
+
+protected:
+	qint64 readData( char *, qint64 )
+	{
+		return 0;
+	}
+
+	qint64 writeData( const char *data, qint64 size )
+	{
+		lastPacket = written.size();
+		written.append( data, size );
+		return size;
+	}
+};
+
+class InfoTaskFixture
+{
+public:
+	InfoTaskFixture()
+	{
+		client.start( QString(), 5190, "987654321", "password" );
+		socket = new CaptureSocket;
+		ClientStream* stream = new ClientStream( socket, 0 );
+		c = new Connection( stream, "BOS" );
+		stream->setConnection( c );
+		c->setClient( &client );
+		task = new ICQUserInfoRequestTask( c->rootTask() );
+	}
+
+	~InfoTaskFixture()
+	{
+		socket->finish();
+		delete c;
+	}
+
+	Oscar::DWORD request( unsigned int type )
+	{
+		task->setUser( CONTACT );
+		task->setType( type );
+		task->go();
+		return socket->lastSnacId();
+	}
+
+	// a 0x15/0x03 meta info reply with the given subtype, the nickname
+	// and the first name are the strings every info type starts with
+	void reply( Oscar::DWORD id, Oscar::WORD subtype, const char* nickname, const char* firstName )
+	{
+		Buffer data;
+		data.addLEDWord( 987654321 );
+		data.addLEWord( 0x07DA );
+		data.addLEWord( 0 );
+		data.addLEWord( subtype );
+		data.addByte( 0x0A );
+		data.addLELNTS( nickname );
+		data.addLELNTS( firstName );
+		data.addLELNTS( "" );
+		data.addLELNTS( "" );
+
+		Buffer* b = new Buffer;
+		b->addWord( 0x0001 );
+		b->addWord( data.length() + 2 );
+		b->addLEWord( data.length() );
+		b->addString( data.buffer() );
+
+		FLAP f = { 0x02, 0, 0 };
+		SNAC s = { 0x0015, 0x0003, 0x0000, id };
+		SnacTransfer t( f, s, b );
+		QVERIFY( c->rootTask()->take( &t ) );
+	}
+
+	void longReply( Oscar::DWORD id, const char* nickname )
+	{
+		reply( id, 0x00C8, nickname, "Long" );
+		reply( id, 0x00FA, "", "" );
+	}
+
+	Client client;
+	CaptureSocket* socket;
+	Connection* c;
+	ICQUserInfoRequestTask* task;
+};
+
+void ICQUserInfoRequestTaskTest::testShortAfterLong()
+{
+	InfoTaskFixture f;
+	QSignalSpy spy( f.task, SIGNAL(receivedInfoFor(QString,uint)) );
+
+	f.reply( f.request( ICQUserInfoRequestTask::Short ), 0x0104, "shorty", "Short" );
+	QCOMPARE( spy.count(), 1 );
+	QCOMPARE( spy.takeFirst().at( 1 ).toUInt(), uint( ICQUserInfoRequestTask::Short ) );
+
+	f.longReply( f.request( ICQUserInfoRequestTask::Long ), "longy" );
+	QCOMPARE( spy.count(), 1 );
+	QCOMPARE( spy.takeFirst().at( 1 ).toUInt(), uint( ICQUserInfoRequestTask::Long ) );
+
+	// what Client hands out when the short info is answered from the cache
+	ICQShortInfo shortInfo = f.task->shortInfoFor( CONTACT );
+	QCOMPARE( shortInfo.nickname, QByteArray( "shorty" ) );
+	QCOMPARE( shortInfo.firstName, QByteArray( "Short" ) );
+}
+
+void ICQUserInfoRequestTaskTest::testLongAfterShort()
+{
+	InfoTaskFixture f;
+	QSignalSpy spy( f.task, SIGNAL(receivedInfoFor(QString,uint)) );
+
+	Oscar::DWORD longId = f.request( ICQUserInfoRequestTask::Long );
+	Oscar::DWORD shortId = f.request( ICQUserInfoRequestTask::Short );
+
+	// a long reply arriving after the short request went out is still long
+	f.longReply( longId, "longy" );
+	QCOMPARE( spy.count(), 1 );
+	QCOMPARE( spy.takeFirst().at( 1 ).toUInt(), uint( ICQUserInfoRequestTask::Long ) );
+
+	f.reply( shortId, 0x0104, "shorty", "Short" );
+	QCOMPARE( spy.count(), 1 );
+	QCOMPARE( spy.takeFirst().at( 1 ).toUInt(), uint( ICQUserInfoRequestTask::Short ) );
+
+	ICQGeneralUserInfo generalInfo = f.task->generalInfoFor( CONTACT );
+	QCOMPARE( generalInfo.nickName.get(), QByteArray( "longy" ) );
+	QCOMPARE( generalInfo.firstName.get(), QByteArray( "Long" ) );
+}
+
+#include "icquserinfotasktest.moc"
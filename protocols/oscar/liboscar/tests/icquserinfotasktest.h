@@ -0,0 +1,32 @@
+/*
+    ICQ User Info Task Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#ifndef ICQUSERINFOTASKTEST_H
+#define ICQUSERINFOTASKTEST_H
+
+#include "oscartestbase.h"
+
+class ICQUserInfoRequestTaskTest : public OscarTestBase
+{
+Q_OBJECT
+private slots:
+	///Short info received before a long request is still there afterwards
+	void testShortAfterLong();
+
+	///Long info received before a short request is still there afterwards
+	void testLongAfterShort();
+};
+
+#endif
@@ -18,6 +18,7 @@
 #include "rateinfotest.h"
 #include "rateinfotask.h"
 #include "buffer.h"
+#include "transfer.h"
 #include "rateclass.h"
 
 OSCAR_TEST_MAIN( RateInfoTest )
@@ -97,5 +98,37 @@ void RateInfoTest::testRateClasses()
 	}
 }
 
+void RateInfoTest::testQueueLanes()
+{
+	RateClass rc;
+	Transfer* bulk1 = new Transfer();
+	Transfer* bulk2 = new Transfer();
+	Transfer* normal = new Transfer();
+	Transfer* message = new Transfer();
+
+	rc.enqueue( bulk1, RateClass::Background );
+	rc.enqueue( bulk2, RateClass::Background );
+	rc.enqueue( normal );
+	rc.enqueue( message, RateClass::Interactive );
+	QCOMPARE( rc.queueDepth(), 4 );
+	QCOMPARE( rc.queueDepth( RateClass::Background ), 2 );
+
+	// the message jumps the queue, each lane keeps its order
+	QCOMPARE( rc.dequeue(), message );
+	QCOMPARE( rc.dequeue(), normal );
+	QCOMPARE( rc.dequeue(), bulk1 );
+	QCOMPARE( rc.queueDepth(), 1 );
+	QVERIFY( !rc.queueIsEmpty() );
+	QVERIFY( rc.longestWaitTime() >= rc.averageWaitTime() );
+
+	rc.dumpQueue();
+	QVERIFY( rc.queueIsEmpty() );
+	QVERIFY( rc.dequeue() == 0 );
+	QCOMPARE( rc.oldestWaitTime(), 0 );
+
+	delete message;
+	delete normal;
+	delete bulk1;
+}
 
 #include "rateinfotest.moc"
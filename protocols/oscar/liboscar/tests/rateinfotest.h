@@ -25,6 +25,7 @@ class RateInfoTest : public OscarTestBase
 Q_OBJECT
 private slots:
 	void testRateClasses();
+	void testQueueLanes();
 };
 
 #endif
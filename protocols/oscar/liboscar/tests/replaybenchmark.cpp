@@ -0,0 +1,385 @@
+/*
+    Protocol Replay Benchmark
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#include "replaybenchmark.h"
+
+#include <QtCore/QTime>
+#include <QtNetwork/QSslSocket>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+#include "buffer.h"
+#include "client.h"
+#include "connection.h"
+#include "contact.h"
+#include "oscarclientstream.h"
+#include "oscarutils.h"
+#include "messagereceivertask.h"
+#include "onlinenotifiertask.h"
+#include "ssilisttask.h"
+
+OSCAR_TEST_MAIN( ReplayBenchmark )
+
+#if defined(__GLIBC__)
+#include <errno.h>
+#include <malloc.h>
+
+// Count every heap allocation of the process, Qt's and liboscar's included,
+// by wrapping glibc's allocator.
+extern "C"
+{
+	void *__libc_malloc( size_t size ) __THROW;
+	void *__libc_calloc( size_t count, size_t size ) __THROW;
+	void *__libc_realloc( void *ptr, size_t size ) __THROW;
+	void *__libc_memalign( size_t alignment, size_t size ) __THROW;
+	void *__libc_valloc( size_t size ) __THROW;
+	void *__libc_pvalloc( size_t size ) __THROW;
+	void __libc_free( void *ptr ) __THROW;
+}
+
+static qint64 s_allocations = 0;
+static qint64 s_heap = 0;
+static qint64 s_peakHeap = 0;
+
+static void *allocated( void *ptr )
+{
+	if ( ptr )
+	{
+		++s_allocations;
+		s_heap += malloc_usable_size( ptr );
+		if ( s_heap > s_peakHeap )
+			s_peakHeap = s_heap;
+	}
+	return ptr;
+}
+
+extern "C" void *malloc( size_t size ) __THROW
+{
+	return allocated( __libc_malloc( size ) );
+}
+
+extern "C" void *calloc( size_t count, size_t size ) __THROW
+{
+	return allocated( __libc_calloc( count, size ) );
+}
+
+extern "C" void *realloc( void *ptr, size_t size ) __THROW
+{
+	const qint64 oldSize = ptr ? malloc_usable_size( ptr ) : 0;
+	void *newPtr = __libc_realloc( ptr, size );
+	if ( newPtr || size == 0 )
+		s_heap -= oldSize;
+	return allocated( newPtr );
+}
+
+// the aligned ones too, free() subtracts whatever they hand out
+extern "C" void *memalign( size_t alignment, size_t size ) __THROW
+{
+	return allocated( __libc_memalign( alignment, size ) );
+}
+
+extern "C" void *aligned_alloc( size_t alignment, size_t size ) __THROW
+{
+	return allocated( __libc_memalign( alignment, size ) );
+}
+
+extern "C" int posix_memalign( void **ptr, size_t alignment, size_t size ) __THROW
+{
+	if ( alignment % sizeof( void * ) != 0 || ( alignment & ( alignment - 1 ) ) != 0 || alignment == 0 )
+		return EINVAL;
+
+	void *mem = allocated( __libc_memalign( alignment, size ) );
+	if ( !mem )
+		return ENOMEM;
+
+	*ptr = mem;
+	return 0;
+}
+
+extern "C" void *valloc( size_t size ) __THROW
+{
+	return allocated( __libc_valloc( size ) );
+}
+
+extern "C" void *pvalloc( size_t size ) __THROW
+{
+	return allocated( __libc_pvalloc( size ) );
+}
+
+extern "C" void free( void *ptr ) __THROW
+{
+	if ( ptr )
+		s_heap -= malloc_usable_size( ptr );
+	__libc_free( ptr );
+}
+
+#define HAVE_HEAP_STATS 1
+#else
+static qint64 s_allocations = 0;
+static qint64 s_heap = 0;
+static qint64 s_peakHeap = 0;
+#endif
+
+/**
+ * A socket that hands out whatever it is fed and drops what is written
+ * to it, so a ClientStream can run without a network.
+ */
+class ReplaySocket : public QSslSocket
+{
+public:
+	ReplaySocket() : m_pos( 0 )
+	{
+		setOpenMode( QIODevice::ReadWrite | QIODevice::Unbuffered );
+	}
+
+	void feed( const QByteArray& data )
+	{
+		m_pending = data;
+		m_pos = 0;
+		emit readyRead();
+	}
+
+	/** Close it so ClientStream doesn't try to disconnect it */
+	void finish()
+	{
+		setOpenMode( QIODevice::NotOpen );
+	}
+
+protected:
+	qint64 readData( char *data, qint64 maxSize )
+	{
+		const qint64 size = qMin<qint64>( maxSize, m_pending.size() - m_pos );
+		qMemCopy( data, m_pending.constData() + m_pos, size );
+		m_pos += size;
+		return size;
+	}
+
+	qint64 writeData( const char *, qint64 size )
+	{
+		return size;
+	}
+
+private:
+	QByteArray m_pending;
+	int m_pos;
+};
+
+static Oscar::WORD s_flapSequence = 0;
+
+static void addSnac( Buffer& wire, Oscar::WORD family, Oscar::WORD subtype, Oscar::WORD flags,
+                     Oscar::DWORD id, const QByteArray& data )
+{
+	wire.addByte( 0x2A );
+	wire.addByte( 0x02 );
+	wire.addWord( s_flapSequence++ );
+	wire.addWord( data.size() + 10 );
+	wire.addWord( family );
+	wire.addWord( subtype );
+	wire.addWord( flags );
+	wire.addDWord( id );
+	wire.addString( data );
+}
+
+static QByteArray uin( int n )
+{
+	return QByteArray::number( 100000000 + n );
+}
+
+// the whole contact list in 0x13/0x06 packets of 100 items
+static QByteArray ssiList( int groups, int contacts, int* snacs )
+{
+	QList<QByteArray> items;
+	for ( int g = 1; g <= groups; ++g )
+		items.append( OContact( QString( "Group %1" ).arg( g ), g, 0, ROSTER_GROUP, QList<TLV>() ) );
+	for ( int c = 0; c < contacts; ++c )
+	{
+		QList<TLV> tlvs;
+		const QByteArray alias = QString( "Contact %1" ).arg( c ).toUtf8();
+		tlvs.append( TLV( 0x0131, alias.size(), alias ) );
+		tlvs.append( TLV( 0x015C, 16, QByteArray( 16, char( c ) ) ) );
+		items.append( OContact( QString::fromLatin1( uin( c ) ), c % groups + 1, c + 1, ROSTER_CONTACT, tlvs ) );
+	}
+
+	Buffer wire;
+	*snacs = 0;
+	for ( int first = 0; first < items.count(); first += 100 )
+	{
+		const int count = qMin( 100, items.count() - first );
+		const bool last = first + count == items.count();
+		Buffer packet;
+		packet.addByte( 0x00 );
+		packet.addWord( count );
+		for ( int i = first; i < first + count; ++i )
+			packet.addString( items[i] );
+		if ( last )
+			packet.addDWord( 0x4C000000 );
+		addSnac( wire, 0x0013, 0x0006, last ? 0x0000 : 0x0001, 1, packet.buffer() );
+		++( *snacs );
+	}
+	return wire.buffer();
+}
+
+static QByteArray userDetails( int n )
+{
+	Buffer b;
+	const QByteArray name = uin( n );
+	b.addByte( name.size() );
+	b.addString( name );
+	b.addWord( 0x0000 ); // warning level
+	b.addWord( 6 );
+	b.addTLV16( 0x0001, 0x0050 ); // user class
+	b.addTLV32( 0x0006, 0x00000000 ); // status
+	b.addTLV32( 0x000A, 0xC0A80000 + n ); // external ip
+	b.addTLV32( 0x0003, 0x4C000000 ); // signon time
+	b.addTLV32( 0x000F, n ); // online time
+	b.addTLV( 0x000D, QByteArray( 4 * 16, char( n ) ) ); // capabilities
+	return b.buffer();
+}
+
+// everyone on the list signing on at once
+static QByteArray buddyArrivals( int count )
+{
+	Buffer wire;
+	for ( int n = 0; n < count; ++n )
+		addSnac( wire, 0x0003, 0x000B, 0x0000, 0, userDetails( n ) );
+	return wire.buffer();
+}
+
+// offline messages arriving as channel 1 messages after login
+static QByteArray offlineMessages( int count )
+{
+	Buffer wire;
+	for ( int n = 0; n < count; ++n )
+	{
+		Buffer text;
+		text.addWord( 0x0000 );
+		text.addWord( 0x0000 );
+		text.addString( QString( "offline message number %1 sent while you were away" ).arg( n ).toLatin1() );
+
+		Buffer message;
+		message.addTLV( 0x0501, QByteArray( "\x01", 1 ) );
+		message.addTLV( 0x0101, text.buffer() );
+
+		Buffer b;
+		b.addDWord( n );
+		b.addDWord( 0 );
+		b.addWord( 0x0001 );
+		b.addString( userDetails( n % 500 ) );
+		b.addTLV( 0x0002, message.buffer() );
+		b.addTLV32( 0x0016, 0x4C000000 + n ); // timestamp
+		addSnac( wire, 0x0004, 0x0007, 0x0000, 0, b.buffer() );
+	}
+	return wire.buffer();
+}
+
+void ReplayBenchmark::countSnac()
+{
+	++m_snacs;
+}
+
+void ReplayBenchmark::countEvent()
+{
+	++m_events;
+}
+
+void ReplayBenchmark::testReplay_data()
+{
+	QTest::addColumn<QByteArray>( "wire" );
+	QTest::addColumn<int>( "snacs" );
+	QTest::addColumn<int>( "events" );
+
+	int snacs;
+	QByteArray ssi = ssiList( 50, 5000, &snacs );
+	QTest::newRow( "ssi list" ) << ssi << snacs << 5050;
+	QTest::newRow( "buddy arrivals" ) << buddyArrivals( 20000 ) << 20000 << 20000;
+	QTest::newRow( "offline messages" ) << offlineMessages( 5000 ) << 5000 << 5000;
+}
+
+void ReplayBenchmark::testReplay()
+{
+	QFETCH( QByteArray, wire );
+	QFETCH( int, snacs );
+	QFETCH( int, events );
+
+	// the second run is measured, the first warms up Qt and liboscar
+	for ( int run = 0; run < 2; ++run )
+	{
+		Client client;
+		ReplaySocket* socket = new ReplaySocket;
+		ClientStream* stream = new ClientStream( socket, 0 );
+		Connection* c = new Connection( stream, "BOS" );
+		stream->setConnection( c );
+		c->setClient( &client );
+
+		SSIListTask* ssiTask = new SSIListTask( c->rootTask() );
+		connect( ssiTask, SIGNAL(newGroup(OContact)), SLOT(countEvent()) );
+		connect( ssiTask, SIGNAL(newContact(OContact)), SLOT(countEvent()) );
+		connect( ssiTask, SIGNAL(newItem(OContact)), SLOT(countEvent()) );
+		OnlineNotifierTask* notifier = new OnlineNotifierTask( c->rootTask() );
+		connect( notifier, SIGNAL(userIsOnline(QString,UserDetails)), SLOT(countEvent()) );
+		MessageReceiverTask* receiver = new MessageReceiverTask( c->rootTask() );
+		connect( receiver, SIGNAL(receivedMessage(Oscar::Message)), SLOT(countEvent()) );
+
+		// what Connection::connectToServer() would hook up, minus the socket
+		connect( stream, SIGNAL(readyRead()), SLOT(countSnac()) );
+		connect( stream, SIGNAL(readyRead()), c, SLOT(streamReadyRead()) );
+
+		m_snacs = 0;
+		m_events = 0;
+		const qint64 allocationsBefore = s_allocations;
+		const qint64 heapBefore = s_heap;
+		s_peakHeap = s_heap;
+		QTime timer;
+		timer.start();
+
+		// in TCP segments, like the socket would hand them out
+		for ( int pos = 0; pos < wire.size(); pos += 1448 )
+			socket->feed( wire.mid( pos, 1448 ) );
+
+		const int elapsed = timer.elapsed();
+		const qint64 allocations = s_allocations - allocationsBefore;
+		const qint64 peakHeap = s_peakHeap - heapBefore;
+
+		QCOMPARE( m_snacs, snacs );
+		QCOMPARE( m_events, events );
+
+		if ( run == 1 )
+		{
+			qDebug( "%s: %d SNACs, %d bytes in %d ms, %.0f SNACs/s",
+			        QTest::currentDataTag(), m_snacs, wire.size(), elapsed,
+			        m_snacs * 1000.0 / qMax( 1, elapsed ) );
+#ifdef HAVE_HEAP_STATS
+			qDebug( "%s: %.1f allocations per SNAC, peak heap %lld KiB above the start",
+			        QTest::currentDataTag(), double( allocations ) / m_snacs, peakHeap / 1024 );
+#else
+			Q_UNUSED( allocations );
+			Q_UNUSED( peakHeap );
+#endif
+#ifdef Q_OS_UNIX
+			struct rusage usage;
+			if ( getrusage( RUSAGE_SELF, &usage ) == 0 )
+				qDebug( "%s: peak resident size of the process %ld KiB",
+				        QTest::currentDataTag(), usage.ru_maxrss );
+#endif
+		}
+
+		socket->finish();
+		delete c;
+	}
+}
+
+#include "replaybenchmark.moc"
@@ -0,0 +1,46 @@
+/*
+    Protocol Replay Benchmark
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#ifndef REPLAYBENCHMARK_H
+#define REPLAYBENCHMARK_H
+
+#include "oscartestbase.h"
+
+/**
+ * Replays large made up server streams through ClientStream, CoreProtocol
+ * and the task tree, without a network, and reports SNACs per second,
+ * allocations per SNAC and peak heap use.
+ *
+ * Allocations are only counted with glibc. Turn off the oscar debug
+ * areas before looking at the numbers, kDebug() output dominates them.
+ */
+class ReplayBenchmark : public OscarTestBase
+{
+Q_OBJECT
+private slots:
+	void testReplay_data();
+	void testReplay();
+
+protected slots:
+	//not tests, QTest runs every private slot
+	void countSnac();
+	void countEvent();
+
+private:
+	int m_snacs;
+	int m_events;
+};
+
+#endif
@@ -0,0 +1,180 @@
+/*
+    SSI List Task Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#include "ssilisttasktest.h"
+
+#include <QtCore/QBuffer>
+#include <QtNetwork/QSslSocket>
+
+#include "buffer.h"
+#include "client.h"
+#include "connection.h"
+#include "contactmanager.h"
+#include "oscarclientstream.h"
+#include "ssilisttask.h"
+#include "transfer.h"
+
+OSCAR_TEST_MAIN( SSIListTaskTest )
+
+static const Oscar::DWORD CACHED_TIME = 0x4C000000;
+
+/**
+ * A socket that keeps what is written to it, so the packets a task
+ * sends can be checked without a network.
+ */
+class CaptureSocket : public QSslSocket
+{
+public:
+	CaptureSocket()
+	{
+		setOpenMode( QIODevice::ReadWrite | QIODevice::Unbuffered );
+	}
+
+	/** Close it so ClientStream doesn't try to disconnect it */
+	void finish()
+	{
+		setOpenMode( QIODevice::NotOpen );
+	}
+
+	QByteArray written;
+
+protected:
+	qint64 readData( char *, qint64 )
+	{
+		return 0;
+	}
+
+	qint64 writeData( const char *data, qint64 size )
+	{
+		written.append( data, size );
+		return size;
+	}
+};
+
+// what OscarAccount::loadSSICache() reads from disk
+static QByteArray savedList()
+{
+	ContactManager manager;
+	manager.newGroup( OContact( "Friends", 1, 0, ROSTER_GROUP, QList<TLV>() ) );
+	manager.newContact( OContact( "123456", 1, 10, ROSTER_CONTACT, QList<TLV>() ) );
+	manager.newContact( OContact( "654321", 1, 11, ROSTER_CONTACT, QList<TLV>() ) );
+	manager.setLastModificationTime( CACHED_TIME );
+	manager.setListComplete( true );
+
+	QBuffer device;
+	device.open( QIODevice::WriteOnly );
+	manager.save( &device );
+	return device.data();
+}
+
+static void loadList( Client* client )
+{
+	QByteArray data = savedList();
+	QBuffer device( &data );
+	device.open( QIODevice::ReadOnly );
+	client->ssiManager()->load( &device );
+}
+
+static bool offer( Connection* c, Oscar::WORD subtype, Oscar::WORD flags, const QByteArray& data )
+{
+	FLAP f = { 0x02, 0, 0 };
+	SNAC s = { 0x0013, subtype, flags, 0 };
+	SnacTransfer t( f, s, new Buffer( data ) );
+	return c->rootTask()->take( &t );
+}
+
+void SSIListTaskTest::testCachedListReachesStageTwo()
+{
+	Client client;
+	client.start( QString(), 5190, "987654321", "password" );
+	loadList( &client );
+	QCOMPARE( client.ssiManager()->numberOfItems(), Oscar::WORD( 3 ) );
+
+	// what happens once stage one succeeded
+	client.close();
+	QCOMPARE( client.ssiManager()->numberOfItems(), Oscar::WORD( 3 ) );
+
+	CaptureSocket* socket = new CaptureSocket;
+	ClientStream* stream = new ClientStream( socket, 0 );
+	Connection* c = new Connection( stream, "BOS" );
+	stream->setConnection( c );
+	c->setClient( &client );
+
+	SSIListTask* task = new SSIListTask( c->rootTask() );
+	task->go();
+
+	// FLAP and SNAC header, then the DWORD timestamp and WORD item count we have
+	Buffer sent( socket->written );
+	QCOMPARE( sent.length(), 6 + 10 + 4 + 2 );
+	sent.skipBytes( 6 );
+	QCOMPARE( sent.getWord(), Oscar::WORD( 0x0013 ) );
+	QCOMPARE( sent.getWord(), Oscar::WORD( 0x0005 ) );
+	sent.skipBytes( 6 );
+	QCOMPARE( sent.getDWord(), CACHED_TIME );
+	QCOMPARE( sent.getWord(), Oscar::WORD( 3 ) );
+	QCOMPARE( sent.bytesAvailable(), 0 );
+
+	socket->finish();
+	delete c;
+}
+
+void SSIListTaskTest::testUpToDate()
+{
+	Client client;
+	client.start( QString(), 5190, "987654321", "password" );
+	loadList( &client );
+
+	Connection* c = new Connection( 0, "BOS" );
+	c->setClient( &client );
+	new SSIListTask( c->rootTask() );
+
+	Buffer reply;
+	reply.addDWord( CACHED_TIME );
+	reply.addWord( 3 );
+	QVERIFY( offer( c, 0x000F, 0x0000, reply.buffer() ) );
+
+	QVERIFY( client.ssiManager()->listComplete() );
+	QCOMPARE( client.ssiManager()->numberOfItems(), Oscar::WORD( 3 ) );
+	QVERIFY( client.ssiManager()->findContact( "654321" ).isValid() );
+
+	delete c;
+}
+
+void SSIListTaskTest::testNewList()
+{
+	Client client;
+	client.start( QString(), 5190, "987654321", "password" );
+	loadList( &client );
+
+	Connection* c = new Connection( 0, "BOS" );
+	c->setClient( &client );
+	new SSIListTask( c->rootTask() );
+
+	Buffer reply;
+	reply.addByte( 0x00 );
+	reply.addWord( 1 );
+	reply.addString( OContact( "Family", 2, 0, ROSTER_GROUP, QList<TLV>() ) );
+	reply.addDWord( CACHED_TIME + 1 );
+	QVERIFY( offer( c, 0x0006, 0x0000, reply.buffer() ) );
+
+	QVERIFY( client.ssiManager()->listComplete() );
+	QCOMPARE( client.ssiManager()->numberOfItems(), Oscar::WORD( 1 ) );
+	QCOMPARE( client.ssiManager()->lastModificationTime(), CACHED_TIME + 1 );
+	QVERIFY( !client.ssiManager()->findContact( "123456" ).isValid() );
+
+	delete c;
+}
+
+#include "ssilisttasktest.moc"
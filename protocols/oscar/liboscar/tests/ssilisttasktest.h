@@ -0,0 +1,35 @@
+/*
+    SSI List Task Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#ifndef SSILISTTASKTEST_H
+#define SSILISTTASKTEST_H
+
+#include "oscartestbase.h"
+
+class SSIListTaskTest : public OscarTestBase
+{
+Q_OBJECT
+private slots:
+	///A list loaded before stage one is still there when stage two asks for the timestamp
+	void testCachedListReachesStageTwo();
+
+	///The server says the cached list is current
+	void testUpToDate();
+
+	///The server sends a new list, the cached one is dropped
+	void testNewList();
+};
+
+#endif
@@ -0,0 +1,170 @@
+/*
+    Task Routing Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#include "tasktest.h"
+#include "task.h"
+#include "connection.h"
+#include "transfer.h"
+#include "buffer.h"
+
+OSCAR_TEST_MAIN( TaskTest )
+
+class RecordingTask : public Task
+{
+public:
+	RecordingTask( Task* parent, bool accept = false )
+		: Task( parent ), offered( 0 ), taken( 0 ), m_accept( accept ) {}
+
+	void snac( Oscar::WORD family, Oscar::WORD subtype ) { registerSnac( family, subtype ); }
+	void request( Oscar::DWORD id ) { registerRequest( id ); }
+	void dropRequest( Oscar::DWORD id ) { unregisterRequest( id ); }
+
+	bool take( Transfer* )
+	{
+		++offered;
+		if ( m_accept )
+			++taken;
+		return m_accept;
+	}
+
+	int offered;
+	int taken;
+
+private:
+	bool m_accept;
+};
+
+static bool offer( Connection* c, Oscar::WORD family, Oscar::WORD subtype, Oscar::DWORD id = 0 )
+{
+	FLAP f = { 0x02, 0, 10 };
+	SNAC s = { family, subtype, 0x0000, id };
+	SnacTransfer t( f, s, new Buffer );
+	return c->rootTask()->take( &t );
+}
+
+static bool offerFlap( Connection* c, Oscar::BYTE channel )
+{
+	FLAP f = { channel, 0, 0 };
+	FlapTransfer t( f, new Buffer );
+	return c->rootTask()->take( &t );
+}
+
+void TaskTest::testSnacRouting()
+{
+	Connection* c = new Connection( 0, 0 );
+	RecordingTask* a = new RecordingTask( c->rootTask() );
+	a->snac( 0x0001, 0x0003 );
+	RecordingTask* b = new RecordingTask( c->rootTask() );
+	b->snac( 0x0004, 0x0007 );
+	b->snac( 0x0004, 0x000B );
+	RecordingTask* all = new RecordingTask( c->rootTask() );
+
+	QVERIFY( !offer( c, 0x0001, 0x0003 ) );
+	QCOMPARE( a->offered, 1 );
+	QCOMPARE( b->offered, 0 );
+	QCOMPARE( all->offered, 1 );
+
+	offer( c, 0x0004, 0x000B );
+	offer( c, 0x0004, 0x0007 );
+	QCOMPARE( a->offered, 1 );
+	QCOMPARE( b->offered, 2 );
+
+	// family matches, subtype doesn't
+	offer( c, 0x0001, 0x0004 );
+	QCOMPARE( a->offered, 1 );
+
+	// plain flaps only reach the tasks that see everything
+	offerFlap( c, 0x04 );
+	QCOMPARE( a->offered, 1 );
+	QCOMPARE( b->offered, 2 );
+	QCOMPARE( all->offered, 5 );
+
+	delete c;
+}
+
+void TaskTest::testCreationOrder()
+{
+	Connection* c = new Connection( 0, 0 );
+	RecordingTask* first = new RecordingTask( c->rootTask(), true );
+	first->snac( 0x0013, 0x0008 );
+	RecordingTask* all = new RecordingTask( c->rootTask(), true );
+	RecordingTask* last = new RecordingTask( c->rootTask(), true );
+	last->snac( 0x0013, 0x0008 );
+	last->request( 7 );
+
+	QVERIFY( offer( c, 0x0013, 0x0008, 7 ) );
+	QCOMPARE( first->taken, 1 );
+	QCOMPARE( all->offered, 0 );
+	QCOMPARE( last->offered, 0 );
+
+	// registering late doesn't move a task ahead of older ones
+	RecordingTask* late = new RecordingTask( c->rootTask(), true );
+	late->snac( 0x0013, 0x0009 );
+	first->snac( 0x0013, 0x0009 );
+	QVERIFY( offer( c, 0x0013, 0x0009 ) );
+	QCOMPARE( first->taken, 2 );
+	QCOMPARE( late->offered, 0 );
+
+	QVERIFY( offer( c, 0x0013, 0x000A ) );
+	QCOMPARE( all->taken, 1 );
+
+	delete c;
+}
+
+void TaskTest::testRequestRouting()
+{
+	Connection* c = new Connection( 0, 0 );
+	RecordingTask* t = new RecordingTask( c->rootTask(), true );
+	t->request( 42 );
+	t->request( 43 );
+
+	QVERIFY( !offer( c, 0x0013, 0x000E, 41 ) );
+	QVERIFY( offer( c, 0x0013, 0x000E, 42 ) );
+	// errors come back with the request id too
+	QVERIFY( offer( c, 0x0013, 0x0001, 43 ) );
+	QCOMPARE( t->taken, 2 );
+
+	t->dropRequest( 42 );
+	QVERIFY( !offer( c, 0x0013, 0x000E, 42 ) );
+	t->dropRequest( 43 );
+	QVERIFY( !offer( c, 0x0013, 0x000E, 43 ) );
+	// it registered once, so it doesn't fall back to seeing everything
+	QVERIFY( !offerFlap( c, 0x04 ) );
+	QCOMPARE( t->offered, 2 );
+
+	delete c;
+}
+
+void TaskTest::testDeletedTasks()
+{
+	Connection* c = new Connection( 0, 0 );
+	RecordingTask* a = new RecordingTask( c->rootTask(), true );
+	a->snac( 0x0001, 0x0003 );
+	a->request( 5 );
+	RecordingTask* all = new RecordingTask( c->rootTask(), true );
+	RecordingTask* b = new RecordingTask( c->rootTask(), true );
+	b->snac( 0x0001, 0x0003 );
+
+	delete a;
+	delete all;
+	QVERIFY( offer( c, 0x0001, 0x0003, 5 ) );
+	QCOMPARE( b->taken, 1 );
+	QVERIFY( !offerFlap( c, 0x01 ) );
+
+	// the remaining tasks go away with the connection
+	delete c;
+}
+
+#include "tasktest.moc"
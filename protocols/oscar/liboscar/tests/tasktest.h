@@ -0,0 +1,38 @@
+/*
+    Task Routing Test
+
+    Kopete    (c) 2002-2010 by the Kopete developers  <kopete-devel@kde.org>
+
+    *************************************************************************
+    *                                                                       *
+    * This library is free software; you can redistribute it and/or         *
+    * modify it under the terms of the GNU Lesser General Public            *
+    * License as published by the Free Software Foundation; either          *
+    * version 2 of the License, or (at your option) any later version.      *
+    *                                                                       *
+    *************************************************************************
+*/
+
+#ifndef TASKTEST_H
+#define TASKTEST_H
+
+#include "oscartestbase.h"
+
+class TaskTest : public OscarTestBase
+{
+Q_OBJECT
+private slots:
+	///Tasks that registered SNACs only see those, the others see everything
+	void testSnacRouting();
+
+	///The oldest task that wants a transfer gets it, registered or not
+	void testCreationOrder();
+
+	///Tasks can ask for the replies to their requests
+	void testRequestRouting();
+
+	///Deleted tasks drop out of the routing table
+	void testDeletedTasks();
+};
+
+#endif
@@ -20,11 +20,12 @@
 
 #include "oscartypes.h"
 #include "buffer.h"
+#include "liboscar_export.h"
 
 
 using namespace Oscar;
 
-class Transfer
+class LIBOSCAR_EXPORT Transfer
 {
 public:
         enum TransferType { RawTransfer, FlapTransfer, SnacTransfer, DIMTransfer, FileTransfer };
@@ -65,7 +66,7 @@ private:
 	
 };
 
-class FlapTransfer : public Transfer
+class LIBOSCAR_EXPORT FlapTransfer : public Transfer
 {
 public:
 
@@ -111,7 +112,7 @@ private:
 /**
 @author Matt Rogers
 */
-class SnacTransfer : public FlapTransfer
+class LIBOSCAR_EXPORT SnacTransfer : public FlapTransfer
 {
 public:
 
@@ -263,14 +263,14 @@ void UserDetails::fill( Buffer * buffer )
 #ifdef OSCAR_USERINFO_DEBUG
 	kDebug( OSCAR_RAW_DEBUG ) << "Warning level is " << m_warningLevel;
 #endif
-	//start parsing TLVs
-	for( int i = 0; i < numTLVs; ++i  )
+	//start parsing TLVs, read them in place instead of copying each one
+	TLVIterator t( buffer );
+	for( int i = 0; i < numTLVs && t.next(); ++i  )
 	{
-		TLV t = buffer->getTLV();
-		if ( t )
+		if ( t.type() != 0 )
 		{
-			Buffer b( t.data, t.length );
-			switch( t.type )
+			Buffer b = t.buffer();
+			switch( t.type() )
 			{
 			case 0x0001: //user class
 				m_userClass = b.getWord();
@@ -361,7 +361,7 @@ void UserDetails::fill( Buffer * buffer )
 				break;
 			case 0x001D:
 			{
-				if ( t.length == 0 )
+				if ( t.length() == 0 )
 					break;
 
 				while ( b.bytesAvailable() > 0 )
@@ -451,12 +451,10 @@ void UserDetails::fill( Buffer * buffer )
 #endif
 				break;
 			default:
-				kDebug(OSCAR_RAW_DEBUG) << "Unknown TLV, type=" << t.type << ", length=" << t.length
+				kDebug(OSCAR_RAW_DEBUG) << "Unknown TLV, type=" << t.type() << ", length=" << t.length()
 					<< " in userinfo" << endl;
 				break;
 			};
-			//detach buffer and free TLV data
-			b.clear();
 		}
 	}
 
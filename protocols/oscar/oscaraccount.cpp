@@ -53,6 +53,7 @@
 #include <knotification.h>
 #include <kstandarddirs.h>
 #include <kprotocolmanager.h>
+#include <ksavefile.h>
 
 #include "client.h"
 #include "connection.h"
@@ -201,6 +202,7 @@ void OscarAccount::logOff( Kopete::Account::DisconnectReason reason )
 	QObject::disconnect( d->engine->ssiManager(), SIGNAL(contactUpdated(OContact)),
 	                     this, SLOT(ssiContactUpdated(OContact)) );
 
+	saveSSICache();
 	d->engine->close();
 	OscarProtocol* p = dynamic_cast<OscarProtocol*>(protocol());
 	if ( myself() && p && p->statusManager() )
@@ -240,6 +242,7 @@ void OscarAccount::loginActions()
     password().setWrong( false );
     kDebug(OSCAR_GEN_DEBUG) << "processing SSI list";
     processSSIList();
+	saveSSICache();
 
 	//start a chat nav connection
 	if ( !engine()->isIcq() )
@@ -255,20 +258,46 @@ void OscarAccount::loginActions()
 		updateBuddyIconInSSI();
 }
 
-void OscarAccount::processSSIList()
+QString OscarAccount::ssiCacheFileName() const
 {
-	//disconnect signals so we don't attempt to add things to SSI!
-	Kopete::ContactList* kcl = Kopete::ContactList::self();
-	QObject::disconnect( kcl, SIGNAL(groupRenamed(Kopete::Group*,QString)),
-	                     this, SLOT(kopeteGroupRenamed(Kopete::Group*,QString)) );
-	QObject::disconnect( kcl, SIGNAL(groupRemoved(Kopete::Group*)),
-	                     this, SLOT(kopeteGroupRemoved(Kopete::Group*)) );
+	return KStandardDirs::locateLocal( "appdata", "oscarssi/" + protocol()->pluginId() + '_' + accountId() );
+}
 
-	kDebug(OSCAR_RAW_DEBUG) ;
+void OscarAccount::loadSSICache()
+{
+	QFile file( ssiCacheFileName() );
+	if ( !file.open( QIODevice::ReadOnly ) )
+		return;
+
+	if ( !d->engine->ssiManager()->load( &file ) )
+		return;
+
+	kDebug(OSCAR_GEN_DEBUG) << "loaded the SSI list of the last session";
+
+	//show the list right away, processSSIList() syncs it once we're online
+	addSSIContacts();
+}
+
+void OscarAccount::saveSSICache()
+{
+	ContactManager* ssiManager = d->engine->ssiManager();
+	if ( !ssiManager->listComplete() )
+		return;
+
+	KSaveFile file( ssiCacheFileName() );
+	if ( !file.open() || !ssiManager->save( &file ) || !file.finalize() )
+	{
+		kWarning(OSCAR_GEN_DEBUG) << "couldn't save the SSI list: " << file.errorString();
+		file.abort();
+	}
+}
 
+void OscarAccount::addSSIContacts()
+{
+	Kopete::ContactList* kcl = Kopete::ContactList::self();
 	ContactManager* listManager = d->engine->ssiManager();
 
-    //first add groups
+	//first add groups
 	QList<OContact> groupList = listManager->groupList();
 	QList<OContact>::const_iterator git = groupList.constBegin();
 	QList<OContact>::const_iterator listEnd = groupList.constEnd();
@@ -321,6 +350,22 @@ void OscarAccount::processSSIList()
 		else
 			addContact( ( *bit ).name(), QString(), group, Kopete::Account::DontChangeKABC );
 	}
+}
+
+void OscarAccount::processSSIList()
+{
+	//disconnect signals so we don't attempt to add things to SSI!
+	Kopete::ContactList* kcl = Kopete::ContactList::self();
+	QObject::disconnect( kcl, SIGNAL(groupRenamed(Kopete::Group*,QString)),
+	                     this, SLOT(kopeteGroupRenamed(Kopete::Group*,QString)) );
+	QObject::disconnect( kcl, SIGNAL(groupRemoved(Kopete::Group*)),
+	                     this, SLOT(kopeteGroupRemoved(Kopete::Group*)) );
+
+	kDebug(OSCAR_RAW_DEBUG) ;
+
+	ContactManager* listManager = d->engine->ssiManager();
+
+	addSSIContacts();
 
 	QObject::connect( kcl, SIGNAL(groupRenamed(Kopete::Group*,QString)),
 	                  this, SLOT(kopeteGroupRenamed(Kopete::Group*,QString)) );
@@ -566,6 +611,7 @@ void OscarAccount::fileTransferAccept( Kopete::Transfer* transfer, const QString
 	QObject::connect( ftHandler, SIGNAL(transferCancelled()), transfer, SLOT(slotCancelled()) );
 	QObject::connect( ftHandler, SIGNAL(transferError(int,QString)), transfer, SLOT(slotError(int,QString)) );
 	QObject::connect( ftHandler, SIGNAL(transferProcessed(uint)), transfer, SLOT(slotProcessed(uint)) );
+	QObject::connect( ftHandler, SIGNAL(transferInfoMessage(QString)), transfer, SLOT(slotInfoMessage(QString)) );
 	QObject::connect( ftHandler, SIGNAL(transferFinished()), transfer, SLOT(slotComplete()) );
 	QObject::connect( ftHandler, SIGNAL(transferNextFile(QString,QString)),
 	                  transfer, SLOT(slotNextFile(QString,QString)) );
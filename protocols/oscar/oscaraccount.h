@@ -162,6 +162,17 @@ protected:
 
 	void updateVersionUpdaterStamp();
 
+	/**
+	 * Load the SSI list saved at the end of the last session into the
+	 * engine so the server only sends the list again if it changed, and
+	 * add its groups and contacts to the contact list.
+	 * Call it after starting the engine and before connecting.
+	 */
+	void loadSSICache();
+
+	/** Save the SSI list for loadSSICache(), if the server sent all of it */
+	void saveSSICache();
+
 	virtual QString sanitizedMessage( const QString& message ) const;
 
 protected slots:
@@ -218,6 +229,11 @@ private:
 
 	QList<QDomNode> getElementsByTagNameCI( const QDomNode& node, const QString& tagName ) const;
 
+	QString ssiCacheFileName() const;
+
+	/** Add the groups and contacts of the engine's SSI list to the Kopete contact list */
+	void addSSIContacts();
+
 private slots:
 	/** Handler from socket errors from a connection */
 	void slotSocketError( int, const QString& );
@@ -382,6 +382,7 @@ void OscarContact::sendFile( const KUrl &sourceURL, const QString &altFileName,
 	connect( ftHandler, SIGNAL(transferCancelled()), transfer, SLOT(slotCancelled()) );
 	connect( ftHandler, SIGNAL(transferError(int,QString)), transfer, SLOT(slotError(int,QString)) );
 	connect( ftHandler, SIGNAL(transferProcessed(uint)), transfer, SLOT(slotProcessed(uint)) );
+	connect( ftHandler, SIGNAL(transferInfoMessage(QString)), transfer, SLOT(slotInfoMessage(QString)) );
 	connect( ftHandler, SIGNAL(transferFinished()), transfer, SLOT(slotComplete()) );
 	connect( ftHandler, SIGNAL(transferNextFile(QString,QString)),
 	         transfer, SLOT(slotNextFile(QString,QString)) );